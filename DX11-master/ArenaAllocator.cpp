@@ -0,0 +1,128 @@
+#include "ArenaAllocator.h"
+#include <algorithm>
+
+ArenaAllocator::ArenaAllocator(uint32_t capacity)
+{
+	this->capacity = 0;
+	usedSize = 0;
+	Grow(capacity);
+}
+
+uint32_t ArenaAllocator::Allocate(uint32_t size)
+{
+	if (size == 0)
+		return InvalidOffset;
+
+	for (size_t i = 0; i < freeBlocks.size(); i++)
+	{
+		Block& block = freeBlocks[i];
+		if (block.Size < size)
+			continue;
+
+		// Take the front of the block, keep whatever is left over
+		uint32_t offset = block.Offset;
+		block.Offset += size;
+		block.Size -= size;
+		if (block.Size == 0)
+			freeBlocks.erase(freeBlocks.begin() + i);
+
+		allocations[offset] = size;
+		usedSize += size;
+		return offset;
+	}
+
+	return InvalidOffset;
+}
+
+void ArenaAllocator::Free(uint32_t offset)
+{
+	auto found = allocations.find(offset);
+	if (found == allocations.end())
+		return;
+
+	uint32_t size = found->second;
+	allocations.erase(found);
+	usedSize -= size;
+
+	// Insert in offset order, then merge with the neighbours
+	auto next = std::lower_bound(freeBlocks.begin(), freeBlocks.end(), offset,
+		[](const Block& b, uint32_t o) { return b.Offset < o; });
+	size_t index = next - freeBlocks.begin();
+	freeBlocks.insert(next, { offset, size });
+
+	if (index + 1 < freeBlocks.size() &&
+		freeBlocks[index].Offset + freeBlocks[index].Size == freeBlocks[index + 1].Offset)
+	{
+		freeBlocks[index].Size += freeBlocks[index + 1].Size;
+		freeBlocks.erase(freeBlocks.begin() + index + 1);
+	}
+
+	if (index > 0 &&
+		freeBlocks[index - 1].Offset + freeBlocks[index - 1].Size == freeBlocks[index].Offset)
+	{
+		freeBlocks[index - 1].Size += freeBlocks[index].Size;
+		freeBlocks.erase(freeBlocks.begin() + index);
+	}
+}
+
+// --------------------------------------------------------
+// Slides every live block down over the gaps before it, in
+// offset order, leaving one free block at the end.  A block
+// only ever moves to a lower offset, so applying the moves
+// in order never overwrites data that has yet to be moved
+// (a move's source and destination may still overlap).
+// --------------------------------------------------------
+void ArenaAllocator::Defragment(std::vector<ArenaMove>& moves)
+{
+	moves.clear();
+	if (freeBlocks.empty() ||
+		(freeBlocks.size() == 1 && freeBlocks[0].Offset + freeBlocks[0].Size == capacity))
+		return;
+
+	std::map<uint32_t, uint32_t> packed;
+	uint32_t cursor = 0;
+	for (auto& a : allocations)
+	{
+		if (a.first != cursor)
+			moves.push_back({ a.first, cursor, a.second });
+
+		packed[cursor] = a.second;
+		cursor += a.second;
+	}
+
+	allocations.swap(packed);
+	freeBlocks.clear();
+	if (cursor < capacity)
+		freeBlocks.push_back({ cursor, capacity - cursor });
+}
+
+void ArenaAllocator::Grow(uint32_t newCapacity)
+{
+	if (newCapacity <= capacity)
+		return;
+
+	uint32_t added = newCapacity - capacity;
+	if (!freeBlocks.empty() && freeBlocks.back().Offset + freeBlocks.back().Size == capacity)
+		freeBlocks.back().Size += added;
+	else
+		freeBlocks.push_back({ capacity, added });
+
+	capacity = newCapacity;
+}
+
+void ArenaAllocator::Reset()
+{
+	allocations.clear();
+	freeBlocks.clear();
+	usedSize = 0;
+	if (capacity > 0)
+		freeBlocks.push_back({ 0, capacity });
+}
+
+uint32_t ArenaAllocator::GetLargestFreeBlock() const
+{
+	uint32_t largest = 0;
+	for (const Block& b : freeBlocks)
+		largest = std::max(largest, b.Size);
+	return largest;
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+// --------------------------------------------------------
+// One block relocated by ArenaAllocator::Defragment().  The
+// caller copies Size units from OldOffset to NewOffset in
+// whatever storage the arena describes.
+// --------------------------------------------------------
+struct ArenaMove
+{
+	uint32_t OldOffset;
+	uint32_t NewOffset;
+	uint32_t Size;
+};
+
+// --------------------------------------------------------
+// Sub-allocates ranges out of a fixed-size linear space
+// (elements of a GPU buffer, bytes of a heap, ...).  It only
+// does the bookkeeping and never touches the storage itself.
+//
+//  - Free space is kept as an offset-sorted free list;
+//    allocation is first-fit, and freed blocks coalesce with
+//    their neighbours
+//  - Defragment() packs every live block towards offset 0 and
+//    reports the moves, so the caller can copy the data
+//  - Grow() extends the space at the end
+// --------------------------------------------------------
+class ArenaAllocator
+{
+public:
+	static const uint32_t InvalidOffset = 0xFFFFFFFF;
+
+	ArenaAllocator(uint32_t capacity = 0);
+
+	// Returns InvalidOffset when no free block is large enough
+	uint32_t Allocate(uint32_t size);
+	void Free(uint32_t offset);
+
+	// Moves are returned in increasing offset order
+	void Defragment(std::vector<ArenaMove>& moves);
+	void Grow(uint32_t newCapacity);
+	void Reset();
+
+	uint32_t GetCapacity() const { return capacity; }
+	uint32_t GetUsedSize() const { return usedSize; }
+	uint32_t GetFreeSize() const { return capacity - usedSize; }
+	uint32_t GetLargestFreeBlock() const;
+	size_t GetAllocationCount() const { return allocations.size(); }
+	size_t GetFreeBlockCount() const { return freeBlocks.size(); }
+
+private:
+	struct Block
+	{
+		uint32_t Offset;
+		uint32_t Size;
+	};
+
+	uint32_t capacity;
+	uint32_t usedSize;
+
+	// Sorted by offset, never adjacent (adjacent blocks are merged)
+	std::vector<Block> freeBlocks;
+
+	// Live allocations: offset -> size
+	std::map<uint32_t, uint32_t> allocations;
+};
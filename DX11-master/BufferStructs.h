@@ -1,10 +1,167 @@
+// Generated by Tools/GenerateShaderStructs.py from the shaders' cbuffers.
+// Don't edit by hand; change the HLSL and rerun the script.
 #pragma once
+#include <cstddef>
 #include <DirectXMath.h>
+#include "Lights.h"
 
-struct VertexShaderExternalData
+// VertexShader.hlsl, cbuffer PerFrame
+struct alignas(16) VertexShaderPerFrame
+{
+	DirectX::XMFLOAT4X4 view;
+	DirectX::XMFLOAT4X4 projection;
+};
+static_assert(sizeof(VertexShaderPerFrame) == 128, "VertexShaderPerFrame does not match VertexShader.hlsl");
+static_assert(offsetof(VertexShaderPerFrame, view) == 0, "VertexShaderPerFrame::view does not match VertexShader.hlsl");
+static_assert(offsetof(VertexShaderPerFrame, projection) == 64, "VertexShaderPerFrame::projection does not match VertexShader.hlsl");
+
+// VertexShader.hlsl, cbuffer PerObject
+struct alignas(16) VertexShaderPerObject
+{
+	DirectX::XMFLOAT4X4 world;
+	DirectX::XMFLOAT4X4 worldInverseTranspose;
+};
+static_assert(sizeof(VertexShaderPerObject) == 128, "VertexShaderPerObject does not match VertexShader.hlsl");
+static_assert(offsetof(VertexShaderPerObject, world) == 0, "VertexShaderPerObject::world does not match VertexShader.hlsl");
+static_assert(offsetof(VertexShaderPerObject, worldInverseTranspose) == 64, "VertexShaderPerObject::worldInverseTranspose does not match VertexShader.hlsl");
+
+// VertexShaderInstanced.hlsl, cbuffer PerFrame
+struct alignas(16) VertexShaderInstancedPerFrame
+{
+	DirectX::XMFLOAT4X4 view;
+	DirectX::XMFLOAT4X4 projection;
+};
+static_assert(sizeof(VertexShaderInstancedPerFrame) == 128, "VertexShaderInstancedPerFrame does not match VertexShaderInstanced.hlsl");
+static_assert(offsetof(VertexShaderInstancedPerFrame, view) == 0, "VertexShaderInstancedPerFrame::view does not match VertexShaderInstanced.hlsl");
+static_assert(offsetof(VertexShaderInstancedPerFrame, projection) == 64, "VertexShaderInstancedPerFrame::projection does not match VertexShaderInstanced.hlsl");
+
+// PixelShader.hlsl, cbuffer PerFrame
+struct alignas(16) PixelShaderPerFrame
+{
+	DirectX::XMFLOAT3 cameraPos;
+	float _pad0[1];
+	DirectX::XMFLOAT3 ambient;
+	float _pad1[1];
+	Light directionalLight1;
+	DirectX::XMFLOAT4X4 cascadeViewProjection[4];
+	DirectX::XMFLOAT4 cascadeSplits;
+	DirectX::XMFLOAT3 cameraForward;
+	int cascadeCount;
+	Light localLights[8];
+	DirectX::XMFLOAT4 localShadowInfo[8];
+	DirectX::XMFLOAT4X4 localShadowViewProjection[24];
+	DirectX::XMFLOAT4 localShadowRects[24];
+	int localLightCount;
+	int shadowFilter;
+	int pcfRadius;
+	float _pad2[1];
+	DirectX::XMFLOAT2 evsmExponents;
+	float evsmLightBleedReduction;
+};
+static_assert(sizeof(PixelShaderPerFrame) == 2976, "PixelShaderPerFrame does not match PixelShader.hlsl");
+static_assert(offsetof(PixelShaderPerFrame, cameraPos) == 0, "PixelShaderPerFrame::cameraPos does not match PixelShader.hlsl");
+static_assert(offsetof(PixelShaderPerFrame, ambient) == 16, "PixelShaderPerFrame::ambient does not match PixelShader.hlsl");
+static_assert(offsetof(PixelShaderPerFrame, directionalLight1) == 32, "PixelShaderPerFrame::directionalLight1 does not match PixelShader.hlsl");
+static_assert(sizeof(Light) == 64, "Light does not match the HLSL struct");
+static_assert(offsetof(PixelShaderPerFrame, cascadeViewProjection) == 96, "PixelShaderPerFrame::cascadeViewProjection does not match PixelShader.hlsl");
+static_assert(offsetof(PixelShaderPerFrame, cascadeSplits) == 352, "PixelShaderPerFrame::cascadeSplits does not match PixelShader.hlsl");
+static_assert(offsetof(PixelShaderPerFrame, cameraForward) == 368, "PixelShaderPerFrame::cameraForward does not match PixelShader.hlsl");
+static_assert(offsetof(PixelShaderPerFrame, cascadeCount) == 380, "PixelShaderPerFrame::cascadeCount does not match PixelShader.hlsl");
+static_assert(offsetof(PixelShaderPerFrame, localLights) == 384, "PixelShaderPerFrame::localLights does not match PixelShader.hlsl");
+static_assert(sizeof(Light) == 64, "Light does not match the HLSL struct");
+static_assert(offsetof(PixelShaderPerFrame, localShadowInfo) == 896, "PixelShaderPerFrame::localShadowInfo does not match PixelShader.hlsl");
+static_assert(offsetof(PixelShaderPerFrame, localShadowViewProjection) == 1024, "PixelShaderPerFrame::localShadowViewProjection does not match PixelShader.hlsl");
+static_assert(offsetof(PixelShaderPerFrame, localShadowRects) == 2560, "PixelShaderPerFrame::localShadowRects does not match PixelShader.hlsl");
+static_assert(offsetof(PixelShaderPerFrame, localLightCount) == 2944, "PixelShaderPerFrame::localLightCount does not match PixelShader.hlsl");
+static_assert(offsetof(PixelShaderPerFrame, shadowFilter) == 2948, "PixelShaderPerFrame::shadowFilter does not match PixelShader.hlsl");
+static_assert(offsetof(PixelShaderPerFrame, pcfRadius) == 2952, "PixelShaderPerFrame::pcfRadius does not match PixelShader.hlsl");
+static_assert(offsetof(PixelShaderPerFrame, evsmExponents) == 2960, "PixelShaderPerFrame::evsmExponents does not match PixelShader.hlsl");
+static_assert(offsetof(PixelShaderPerFrame, evsmLightBleedReduction) == 2968, "PixelShaderPerFrame::evsmLightBleedReduction does not match PixelShader.hlsl");
+
+// PixelShader.hlsl, cbuffer PerMaterial
+struct alignas(16) PixelShaderPerMaterial
 {
 	DirectX::XMFLOAT4 colorTint;
-	DirectX::XMFLOAT4X4 worldMatrix;
+	float roughness;
+	unsigned int materialIndex;
+};
+static_assert(sizeof(PixelShaderPerMaterial) == 32, "PixelShaderPerMaterial does not match PixelShader.hlsl");
+static_assert(offsetof(PixelShaderPerMaterial, colorTint) == 0, "PixelShaderPerMaterial::colorTint does not match PixelShader.hlsl");
+static_assert(offsetof(PixelShaderPerMaterial, roughness) == 16, "PixelShaderPerMaterial::roughness does not match PixelShader.hlsl");
+static_assert(offsetof(PixelShaderPerMaterial, materialIndex) == 20, "PixelShaderPerMaterial::materialIndex does not match PixelShader.hlsl");
+
+// ShadowVShader.hlsl, cbuffer PerFrame
+struct alignas(16) ShadowVShaderPerFrame
+{
 	DirectX::XMFLOAT4X4 view;
 	DirectX::XMFLOAT4X4 projection;
-};
\ No newline at end of file
+};
+static_assert(sizeof(ShadowVShaderPerFrame) == 128, "ShadowVShaderPerFrame does not match ShadowVShader.hlsl");
+static_assert(offsetof(ShadowVShaderPerFrame, view) == 0, "ShadowVShaderPerFrame::view does not match ShadowVShader.hlsl");
+static_assert(offsetof(ShadowVShaderPerFrame, projection) == 64, "ShadowVShaderPerFrame::projection does not match ShadowVShader.hlsl");
+
+// ShadowVShader.hlsl, cbuffer PerObject
+struct alignas(16) ShadowVShaderPerObject
+{
+	DirectX::XMFLOAT4X4 world;
+};
+static_assert(sizeof(ShadowVShaderPerObject) == 64, "ShadowVShaderPerObject does not match ShadowVShader.hlsl");
+static_assert(offsetof(ShadowVShaderPerObject, world) == 0, "ShadowVShaderPerObject::world does not match ShadowVShader.hlsl");
+
+// SkyVertexShader.hlsl, cbuffer ExternalData
+struct alignas(16) SkyVertexShaderExternalData
+{
+	DirectX::XMFLOAT4X4 view;
+	DirectX::XMFLOAT4X4 projection;
+};
+static_assert(sizeof(SkyVertexShaderExternalData) == 128, "SkyVertexShaderExternalData does not match SkyVertexShader.hlsl");
+static_assert(offsetof(SkyVertexShaderExternalData, view) == 0, "SkyVertexShaderExternalData::view does not match SkyVertexShader.hlsl");
+static_assert(offsetof(SkyVertexShaderExternalData, projection) == 64, "SkyVertexShaderExternalData::projection does not match SkyVertexShader.hlsl");
+
+// CustomPs.hlsl, cbuffer ExternalData
+struct alignas(16) CustomPsExternalData
+{
+	DirectX::XMFLOAT4 colorTint;
+};
+static_assert(sizeof(CustomPsExternalData) == 16, "CustomPsExternalData does not match CustomPs.hlsl");
+static_assert(offsetof(CustomPsExternalData, colorTint) == 0, "CustomPsExternalData::colorTint does not match CustomPs.hlsl");
+
+// SSAOPixelShader.hlsl, cbuffer externalData
+struct alignas(16) SSAOPixelShaderExternalData
+{
+	DirectX::XMFLOAT4X4 viewMatrix;
+	DirectX::XMFLOAT4X4 projectionMatrix;
+	DirectX::XMFLOAT4X4 invProjMatrix;
+	DirectX::XMFLOAT4 offsets[64];
+	float ssaoRadius;
+	int ssaoSamples;
+	DirectX::XMFLOAT2 randomTextureScreenScale;
+};
+static_assert(sizeof(SSAOPixelShaderExternalData) == 1232, "SSAOPixelShaderExternalData does not match SSAOPixelShader.hlsl");
+static_assert(offsetof(SSAOPixelShaderExternalData, viewMatrix) == 0, "SSAOPixelShaderExternalData::viewMatrix does not match SSAOPixelShader.hlsl");
+static_assert(offsetof(SSAOPixelShaderExternalData, projectionMatrix) == 64, "SSAOPixelShaderExternalData::projectionMatrix does not match SSAOPixelShader.hlsl");
+static_assert(offsetof(SSAOPixelShaderExternalData, invProjMatrix) == 128, "SSAOPixelShaderExternalData::invProjMatrix does not match SSAOPixelShader.hlsl");
+static_assert(offsetof(SSAOPixelShaderExternalData, offsets) == 192, "SSAOPixelShaderExternalData::offsets does not match SSAOPixelShader.hlsl");
+static_assert(offsetof(SSAOPixelShaderExternalData, ssaoRadius) == 1216, "SSAOPixelShaderExternalData::ssaoRadius does not match SSAOPixelShader.hlsl");
+static_assert(offsetof(SSAOPixelShaderExternalData, ssaoSamples) == 1220, "SSAOPixelShaderExternalData::ssaoSamples does not match SSAOPixelShader.hlsl");
+static_assert(offsetof(SSAOPixelShaderExternalData, randomTextureScreenScale) == 1224, "SSAOPixelShaderExternalData::randomTextureScreenScale does not match SSAOPixelShader.hlsl");
+
+// BlurSSAOPShader.hlsl, cbuffer externalData
+struct alignas(16) BlurSSAOPShaderExternalData
+{
+	DirectX::XMFLOAT2 pixelSize;
+};
+static_assert(sizeof(BlurSSAOPShaderExternalData) == 16, "BlurSSAOPShaderExternalData does not match BlurSSAOPShader.hlsl");
+static_assert(offsetof(BlurSSAOPShaderExternalData, pixelSize) == 0, "BlurSSAOPShaderExternalData::pixelSize does not match BlurSSAOPShader.hlsl");
+
+// PPPixelShader.hlsl, cbuffer externalData
+struct alignas(16) PPPixelShaderExternalData
+{
+	DirectX::XMFLOAT4 taps[17];
+	DirectX::XMFLOAT2 direction;
+	int tapCount;
+};
+static_assert(sizeof(PPPixelShaderExternalData) == 288, "PPPixelShaderExternalData does not match PPPixelShader.hlsl");
+static_assert(offsetof(PPPixelShaderExternalData, taps) == 0, "PPPixelShaderExternalData::taps does not match PPPixelShader.hlsl");
+static_assert(offsetof(PPPixelShaderExternalData, direction) == 272, "PPPixelShaderExternalData::direction does not match PPPixelShader.hlsl");
+static_assert(offsetof(PPPixelShaderExternalData, tapCount) == 280, "PPPixelShaderExternalData::tapCount does not match PPPixelShader.hlsl");
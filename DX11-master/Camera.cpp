@@ -33,6 +33,16 @@ float Camera::GetFOV()
     return fov;
 }
 
+float Camera::GetNearClip()
+{
+    return nearZ;
+}
+
+float Camera::GetFarClip()
+{
+    return farZ;
+}
+
 void Camera::UpdateProjectionMatrix(float aspectRatio)
 {
     if (isPerspective)
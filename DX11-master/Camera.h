@@ -24,6 +24,8 @@ public:
 	DirectX::XMFLOAT4X4 GetProjectionMatrix();
 	Transform* GetTransform();
 	float GetFOV();
+	float GetNearClip();
+	float GetFarClip();
 
 	//methods
 	void UpdateProjectionMatrix(float aspectRatio);
@@ -0,0 +1,116 @@
+#include "ConstantBufferRing.h"
+
+ConstantBufferRing::ConstantBufferRing(Microsoft::WRL::ComPtr<ID3D11Device> _device,
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> _context,
+	UINT byteSize,
+	unsigned int _maxFramesInFlight)
+	: allocator(byteSize, 256)
+{
+	context = _context;
+	maxFramesInFlight = _maxFramesInFlight;
+	oldestFence = 0;
+	pendingFences = 0;
+	frameIndex = 1;
+	uploads = 0;
+	failedUploads = 0;
+	mappedOnce = false;
+
+	D3D11_FEATURE_DATA_D3D11_OPTIONS options = {};
+	supported =
+		SUCCEEDED(_device->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options))) &&
+		options.ConstantBufferOffsetting &&
+		options.MapNoOverwriteOnDynamicConstantBuffer;
+	if (!supported)
+		return;
+
+	D3D11_BUFFER_DESC desc = {};
+	desc.Usage = D3D11_USAGE_DYNAMIC;
+	desc.ByteWidth = allocator.GetCapacity();
+	desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	_device->CreateBuffer(&desc, 0, buffer.GetAddressOf());
+
+	fences.resize(maxFramesInFlight);
+	D3D11_QUERY_DESC queryDesc = {};
+	queryDesc.Query = D3D11_QUERY_EVENT;
+	for (FrameFence& f : fences)
+		_device->CreateQuery(&queryDesc, f.Query.GetAddressOf());
+}
+
+bool ConstantBufferRing::Upload(const void* data, UINT size, ConstantBufferRange& range)
+{
+	if (!supported)
+		return false;
+
+	UINT offset = allocator.Allocate(size);
+	if (offset == FrameRingAllocator::InvalidOffset)
+	{
+		failedUploads++;
+		return false;
+	}
+
+	// The allocator guarantees the GPU is done with this range, so
+	// nothing needs discarding (except the very first time, which
+	// some drivers expect before any no-overwrite map)
+	D3D11_MAPPED_SUBRESOURCE mapped = {};
+	D3D11_MAP mapType = mappedOnce ? D3D11_MAP_WRITE_NO_OVERWRITE : D3D11_MAP_WRITE_DISCARD;
+	if (FAILED(context->Map(buffer.Get(), 0, mapType, 0, &mapped)))
+	{
+		failedUploads++;
+		return false;
+	}
+	memcpy((unsigned char*)mapped.pData + offset, data, size);
+	context->Unmap(buffer.Get(), 0);
+	mappedOnce = true;
+
+	// Constant counts must also be multiples of 16 (256 bytes)
+	range.FirstConstant = offset / 16;
+	range.NumConstants = ((size + 255) & ~255u) / 16;
+	uploads++;
+	return true;
+}
+
+void ConstantBufferRing::EndFrame()
+{
+	if (!supported)
+		return;
+
+	// Hand back whatever the GPU has finished with, and wait
+	// for the oldest frame if there's no fence free for this one
+	while (PollOldest(pendingFences == maxFramesInFlight)) {}
+
+	unsigned int slot = (oldestFence + pendingFences) % maxFramesInFlight;
+	fences[slot].Fence = frameIndex;
+	context->End(fences[slot].Query.Get());
+	pendingFences++;
+
+	allocator.EndFrame(frameIndex);
+	frameIndex++;
+	uploads = 0;
+	failedUploads = 0;
+}
+
+// --------------------------------------------------------
+// Checks the oldest outstanding fence, releasing its frame's
+// space if the GPU has reached it.  Returns true if it did.
+// --------------------------------------------------------
+bool ConstantBufferRing::PollOldest(bool wait)
+{
+	if (pendingFences == 0)
+		return false;
+
+	FrameFence& f = fences[oldestFence];
+	HRESULT hr;
+	do
+	{
+		hr = context->GetData(f.Query.Get(), 0, 0, wait ? 0 : D3D11_ASYNC_GETDATA_DONOTFLUSH);
+	} while (wait && hr == S_FALSE);
+
+	if (hr != S_OK)
+		return false;
+
+	allocator.Release(f.Fence);
+	oldestFence = (oldestFence + 1) % maxFramesInFlight;
+	pendingFences--;
+	return true;
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include <d3d11_1.h>
+#include <wrl/client.h>
+#include <vector>
+#include "FrameRingAllocator.h"
+
+// --------------------------------------------------------
+// Where one draw's constants landed in a ConstantBufferRing,
+// in the units *SetConstantBuffers1 expects (16-byte constants)
+// --------------------------------------------------------
+struct ConstantBufferRange
+{
+	UINT FirstConstant;
+	UINT NumConstants;
+};
+
+// --------------------------------------------------------
+// One large dynamic constant buffer shared by every per-draw
+// cbuffer in a frame.  Each upload is bump-allocated into it
+// (256-byte aligned, as the D3D11.1 offset binding requires)
+// and written with Map/WRITE_NO_OVERWRITE, so no draw ever
+// waits on a buffer an earlier draw is still reading.
+//
+// Each frame ends with an event query; the frame's space is
+// only reused once the GPU has passed that query.  If more
+// than maxFramesInFlight frames are queued, EndFrame() waits
+// on the oldest.
+//
+// Needs D3D11.1 constant buffer offsetting and no-overwrite
+// maps on constant buffers; check IsSupported().
+// --------------------------------------------------------
+class ConstantBufferRing
+{
+public:
+	ConstantBufferRing(Microsoft::WRL::ComPtr<ID3D11Device> _device,
+		Microsoft::WRL::ComPtr<ID3D11DeviceContext> _context,
+		UINT byteSize,
+		unsigned int _maxFramesInFlight = 3);
+
+	bool IsSupported() const { return supported; }
+
+	// Copies data into the ring; false if the ring is full this frame
+	bool Upload(const void* data, UINT size, ConstantBufferRange& range);
+
+	// Call once per frame, after the last draw
+	void EndFrame();
+
+	ID3D11Buffer* GetBuffer() const { return buffer.Get(); }
+	UINT64 GetFrameIndex() const { return frameIndex; }
+	const FrameRingAllocator& GetAllocator() const { return allocator; }
+
+	// Since the last EndFrame()
+	unsigned int GetUploadCount() const { return uploads; }
+	unsigned int GetFailedUploadCount() const { return failedUploads; }
+
+private:
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> buffer;
+	bool supported;
+	bool mappedOnce;
+
+	FrameRingAllocator allocator;
+
+	// One event query per frame in flight, reused round robin
+	struct FrameFence
+	{
+		Microsoft::WRL::ComPtr<ID3D11Query> Query;
+		UINT64 Fence;
+	};
+	std::vector<FrameFence> fences;
+	unsigned int maxFramesInFlight;
+	unsigned int oldestFence;
+	unsigned int pendingFences;
+	UINT64 frameIndex;
+
+	unsigned int uploads;
+	unsigned int failedUploads;
+
+	bool PollOldest(bool wait);
+};
@@ -56,6 +56,9 @@ DXCore::DXCore(
 	previousTime(0),
 	currentTime(0),
 	hasFocus(true),
+	resizePending(false),
+	resizeRequests(0),
+	resizesApplied(0),
 	deltaTime(0),
 	startTime(0),
 	totalTime(0),
@@ -308,6 +311,25 @@ HRESULT DXCore::InitDirect3D()
 	return S_OK;
 }
 
+// --------------------------------------------------------
+// Applies the size of the latest WM_SIZE, unless the swap
+// chain already has it (say, the window was dragged back to
+// where it started)
+// --------------------------------------------------------
+void DXCore::ApplyResize()
+{
+	resizePending = false;
+
+	DXGI_SWAP_CHAIN_DESC swapChainDesc = {};
+	swapChain->GetDesc(&swapChainDesc);
+	if (swapChainDesc.BufferDesc.Width == windowWidth &&
+		swapChainDesc.BufferDesc.Height == windowHeight)
+		return;
+
+	OnResize();
+	resizesApplied++;
+}
+
 // --------------------------------------------------------
 // When the window is resized, the underlying 
 // buffers (textures) must also be resized to match.
@@ -433,6 +455,11 @@ HRESULT DXCore::Run()
 			if(titleBarStats)
 				UpdateTitleBarStats();
 
+			// Resize once for all the WM_SIZE messages since the
+			// last frame
+			if (resizePending)
+				ApplyResize();
+
 			// Update the input manager
 			Input::GetInstance().Update();
 
@@ -622,10 +649,14 @@ LRESULT DXCore::ProcessMessage(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lPara
 		windowWidth = LOWORD(lParam);
 		windowHeight = HIWORD(lParam);
 
-		// If DX is initialized, resize 
-		// our required buffers
-		if (device) 
-			OnResize();
+		// If DX is initialized, resize our required buffers
+		// before the next frame.  Dragging the window's edge
+		// sends these far faster than frames are drawn.
+		if (device)
+		{
+			resizePending = true;
+			resizeRequests++;
+		}
 
 		return 0;
 
@@ -43,6 +43,7 @@ public:
 	HRESULT InitDirect3D();
 	HRESULT Run();
 	void Quit();
+	void ApplyResize();
 	virtual void OnResize();
 
 	// Pure virtual methods for setup and game functionality
@@ -64,6 +65,12 @@ protected:
 	// Helpful if we want to pause while not the active window
 	bool hasFocus;
 
+	// WM_SIZE only records the new size; the buffers are
+	// resized once at the start of the next frame
+	bool resizePending;
+	unsigned int resizeRequests;
+	unsigned int resizesApplied;
+
 	// Should our framerate sync to the vertical refresh
 	// of the monitor (true) or run as fast as possible (false)?
 	bool vsync;
@@ -0,0 +1,98 @@
+#pragma once
+#include <cstring>
+
+// --------------------------------------------------------
+// Tracks the span of bytes written in a CPU-side copy of a
+// buffer since it was last uploaded.  Writes widen a single
+// [Begin, End) range; nothing is dirty when Begin == End.
+//
+// Kept free of any Direct3D types so the bookkeeping can be
+// reasoned about (and checked) on its own.
+// --------------------------------------------------------
+struct DirtyRange
+{
+	unsigned int Begin = 0;
+	unsigned int End = 0;
+
+	bool IsEmpty() const { return End <= Begin; }
+	unsigned int GetSize() const { return IsEmpty() ? 0 : End - Begin; }
+
+	void Clear()
+	{
+		Begin = 0;
+		End = 0;
+	}
+
+	void Mark(unsigned int offset, unsigned int size)
+	{
+		if (size == 0)
+			return;
+
+		if (IsEmpty())
+		{
+			Begin = offset;
+			End = offset + size;
+			return;
+		}
+
+		if (offset < Begin) Begin = offset;
+		if (offset + size > End) End = offset + size;
+	}
+
+	// The range widened out to multiples of alignment (a power
+	// of two), clamped to the buffer size
+	void GetAligned(unsigned int alignment, unsigned int bufferSize, unsigned int& alignedBegin, unsigned int& alignedEnd) const
+	{
+		alignedBegin = Begin & ~(alignment - 1);
+		alignedEnd = (End + alignment - 1) & ~(alignment - 1);
+		if (alignedEnd > bufferSize)
+			alignedEnd = bufferSize;
+	}
+
+	// Copies data into the buffer, marking the range dirty only
+	// if the bytes actually changed.  Returns true if they did.
+	bool Write(unsigned char* buffer, unsigned int offset, const void* data, unsigned int size)
+	{
+		if (memcmp(buffer + offset, data, size) == 0)
+			return false;
+
+		memcpy(buffer + offset, data, size);
+		Mark(offset, size);
+		return true;
+	}
+};
+
+// --------------------------------------------------------
+// Brings a default-usage buffer up to date from its CPU copy,
+// as ISimpleShader::UploadBuffer() does:
+//
+//  - A clean range sends nothing, and returns false
+//  - With partial updates, uploadRange(begin, end) gets the
+//    dirty range widened to 16 bytes (UpdateSubresource1's
+//    box has to be aligned for constant buffers)
+//  - Otherwise uploadAll() sends the whole buffer
+//
+// The range is cleared after an upload.  The Direct3D calls
+// stay in the callbacks, so this header remains free of them.
+// --------------------------------------------------------
+template <typename UploadRange, typename UploadAll>
+bool UploadDirtyRange(DirtyRange& dirty, unsigned int bufferSize, bool partialUpdates,
+	UploadRange uploadRange, UploadAll uploadAll)
+{
+	if (dirty.IsEmpty())
+		return false;
+
+	if (partialUpdates)
+	{
+		unsigned int begin, end;
+		dirty.GetAligned(16, bufferSize, begin, end);
+		uploadRange(begin, end);
+	}
+	else
+	{
+		uploadAll();
+	}
+
+	dirty.Clear();
+	return true;
+}
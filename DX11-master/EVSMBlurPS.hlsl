@@ -0,0 +1,27 @@
+cbuffer externalData : register(b0)
+{
+	int blurRadius;
+}
+struct VertexToPixel
+{
+	float4 position : SV_POSITION;
+	float2 uv : TEXCOORD0;
+};
+Texture2D Moments : register(t0);
+
+// Second half of the moment prefilter: the vertical box blur,
+// written into the cascade's slice of the moment array
+float4 main(VertexToPixel input) : SV_TARGET
+{
+	uint width, height;
+	Moments.GetDimensions(width, height);
+	int2 pixel = int2(input.position.xy);
+
+	float4 total = 0;
+	for (int y = -blurRadius; y <= blurRadius; y++)
+	{
+		int2 tap = int2(pixel.x, clamp(pixel.y + y, 0, (int)height - 1));
+		total += Moments.Load(int3(tap, 0));
+	}
+	return total / (2 * blurRadius + 1);
+}
@@ -0,0 +1,33 @@
+#include "ShadowMoments.hlsli"
+
+cbuffer externalData : register(b0)
+{
+	float2 exponents;
+	int blurRadius;
+	int cascade;
+}
+struct VertexToPixel
+{
+	float4 position : SV_POSITION;
+	float2 uv : TEXCOORD0;
+};
+Texture2DArray ShadowMap : register(t0);
+
+// First half of the moment prefilter: converts one cascade's
+// depths to EVSM moments and box blurs them horizontally.
+// The blur runs on moments, not depths, so it's done here
+// rather than on the depth map.
+float4 main(VertexToPixel input) : SV_TARGET
+{
+	uint width, height, slices;
+	ShadowMap.GetDimensions(width, height, slices);
+	int2 pixel = int2(input.position.xy);
+
+	float4 total = 0;
+	for (int x = -blurRadius; x <= blurRadius; x++)
+	{
+		int2 tap = int2(clamp(pixel.x + x, 0, (int)width - 1), pixel.y);
+		total += WarpDepth(ShadowMap.Load(int4(tap, cascade, 0)).r, exponents);
+	}
+	return total / (2 * blurRadius + 1);
+}
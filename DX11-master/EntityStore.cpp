@@ -0,0 +1,176 @@
+#include "EntityStore.h"
+
+using namespace DirectX;
+
+EntityStore::EntityStore(ResourceRegistry& registry)
+{
+	resources = &registry;
+	staticVersion = 0;
+}
+
+EntityID EntityStore::Create(MeshHandle mesh, MaterialHandle material)
+{
+	// Reuse a freed ID if there is one
+	EntityID id;
+	if (!freeIDs.empty())
+	{
+		id = freeIDs.back();
+		freeIDs.pop_back();
+	}
+	else
+	{
+		id = (EntityID)sparse.size();
+		sparse.push_back(INVALID_ENTITY);
+	}
+
+	sparse[id] = (unsigned int)ids.size();
+	ids.push_back(id);
+	transforms.push_back(Transform());
+	transformVersions.push_back(0);
+	meshes.push_back(mesh);
+	materials.push_back(material);
+	bounds.push_back(resources->Meshes.Get(mesh)->GetLocalBounds());
+	angularVelocities.push_back(XMFLOAT3(0.0f, 0.0f, 0.0f));
+	staticVersion++;
+	return id;
+}
+
+// --------------------------------------------------------
+// Swap-and-pop: the last entity moves into the freed slot,
+// keeping every array packed
+// --------------------------------------------------------
+void EntityStore::Destroy(EntityID id)
+{
+	if (!IsAlive(id))
+		return;
+
+	if (!IsDynamic(sparse[id]))
+		staticVersion++;
+
+	unsigned int index = sparse[id];
+	unsigned int last = (unsigned int)ids.size() - 1;
+	if (index != last)
+	{
+		ids[index] = ids[last];
+		transforms[index] = transforms[last];
+		transformVersions[index] = transformVersions[last];
+		meshes[index] = meshes[last];
+		materials[index] = materials[last];
+		bounds[index] = bounds[last];
+		angularVelocities[index] = angularVelocities[last];
+		sparse[ids[index]] = index;
+	}
+
+	ids.pop_back();
+	transforms.pop_back();
+	transformVersions.pop_back();
+	meshes.pop_back();
+	materials.pop_back();
+	bounds.pop_back();
+	angularVelocities.pop_back();
+
+	sparse[id] = INVALID_ENTITY;
+	freeIDs.push_back(id);
+}
+
+void EntityStore::Clear()
+{
+	sparse.clear();
+	freeIDs.clear();
+	ids.clear();
+	transforms.clear();
+	transformVersions.clear();
+	meshes.clear();
+	materials.clear();
+	bounds.clear();
+	angularVelocities.clear();
+	staticVersion++;
+}
+
+void EntityStore::Reserve(size_t count)
+{
+	sparse.reserve(count);
+	ids.reserve(count);
+	transforms.reserve(count);
+	transformVersions.reserve(count);
+	meshes.reserve(count);
+	materials.reserve(count);
+	bounds.reserve(count);
+	angularVelocities.reserve(count);
+}
+
+bool EntityStore::IsAlive(EntityID id) const
+{
+	return id < sparse.size() && sparse[id] != INVALID_ENTITY;
+}
+
+unsigned int EntityStore::GetDenseIndex(EntityID id) const
+{
+	return IsAlive(id) ? sparse[id] : INVALID_ENTITY;
+}
+
+Transform& EntityStore::GetTransform(EntityID id)
+{
+	return transforms[sparse[id]];
+}
+
+MeshHandle EntityStore::GetMesh(EntityID id)
+{
+	return meshes[sparse[id]];
+}
+
+MaterialHandle EntityStore::GetMaterial(EntityID id)
+{
+	return materials[sparse[id]];
+}
+
+void EntityStore::SetMaterial(EntityID id, MaterialHandle material)
+{
+	materials[sparse[id]] = material;
+}
+
+void EntityStore::SetAngularVelocity(EntityID id, XMFLOAT3 pitchYawRollPerSecond)
+{
+	bool wasDynamic = IsDynamic(sparse[id]);
+	angularVelocities[sparse[id]] = pitchYawRollPerSecond;
+	if (IsDynamic(sparse[id]) != wasDynamic)
+		staticVersion++;
+}
+
+bool EntityStore::IsDynamic(size_t index) const
+{
+	const XMFLOAT3& v = angularVelocities[index];
+	return v.x != 0.0f || v.y != 0.0f || v.z != 0.0f;
+}
+
+void EntityStore::UpdateRotations(float deltaTime)
+{
+	for (size_t i = 0; i < ids.size(); i++)
+	{
+		if (!IsDynamic(i))
+			continue;
+
+		const XMFLOAT3& v = angularVelocities[i];
+		transforms[i].Rotate(v.x * deltaTime, v.y * deltaTime, v.z * deltaTime);
+	}
+}
+
+void EntityStore::UpdateTransforms()
+{
+	for (size_t i = 0; i < ids.size(); i++)
+	{
+		// Compare against the version seen last time rather than the
+		// dirty flag - a draw that calls GetWorldMatrix() in between
+		// would have cleared that flag already
+		unsigned int version = transforms[i].GetVersion();
+		if (version == transformVersions[i])
+			continue;
+
+		transformVersions[i] = version;
+		transforms[i].UpdateMatrices();
+		if (!IsDynamic(i))
+			staticVersion++;
+		XMFLOAT4X4 world = transforms[i].GetWorldMatrix();
+		resources->Meshes.Get(meshes[i])->GetLocalBounds().Transform(bounds[i], XMLoadFloat4x4(&world));
+	}
+}
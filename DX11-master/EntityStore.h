@@ -0,0 +1,89 @@
+#pragma once
+#include <DirectXCollision.h>
+#include <memory>
+#include <vector>
+#include "Transform.h"
+#include "ResourceRegistry.h"
+
+// Stable handle to an entity.  IDs are never reused while the
+// entity is alive, and survive other entities being destroyed.
+typedef unsigned int EntityID;
+static const EntityID INVALID_ENTITY = 0xFFFFFFFF;
+
+// --------------------------------------------------------
+// Sparse-set entity storage.  Every component lives in its
+// own tightly packed array, all indexed by the same dense
+// index, so systems can sweep them linearly:
+//
+//   for (size_t i = 0; i < store.Size(); i++)
+//       transforms[i] / meshes[i] / materials[i] / bounds[i]
+//
+// Destroying an entity moves the last one into its slot, so
+// dense indices are only valid until the next Destroy().
+// Hold on to EntityIDs instead across frames.
+// --------------------------------------------------------
+class EntityStore
+{
+public:
+	// Mesh and material handles are resolved through this registry
+	EntityStore(ResourceRegistry& registry);
+
+	EntityID Create(MeshHandle mesh, MaterialHandle material);
+	void Destroy(EntityID id);
+	void Clear();
+	void Reserve(size_t count);
+
+	bool IsAlive(EntityID id) const;
+	unsigned int GetDenseIndex(EntityID id) const;
+	size_t Size() const { return ids.size(); }
+
+	ResourceRegistry& GetResources() { return *resources; }
+
+	// Per-entity access, used by the gameEntity facade
+	Transform& GetTransform(EntityID id);
+	MeshHandle GetMesh(EntityID id);
+	MaterialHandle GetMaterial(EntityID id);
+	void SetMaterial(EntityID id, MaterialHandle material);
+	void SetAngularVelocity(EntityID id, DirectX::XMFLOAT3 pitchYawRollPerSecond);
+
+	// Dense component arrays, Size() entries each
+	const EntityID* GetIDs() const { return ids.data(); }
+	Transform* GetTransforms() { return transforms.data(); }
+	const MeshHandle* GetMeshes() const { return meshes.data(); }
+	const MaterialHandle* GetMaterials() const { return materials.data(); }
+	const DirectX::BoundingSphere* GetBounds() const { return bounds.data(); }
+
+	// System: spins every entity with a non-zero angular velocity
+	void UpdateRotations(float deltaTime);
+
+	// System: refreshes any changed world matrices and the
+	// world-space bounds that depend on them
+	void UpdateTransforms();
+
+	// Entities that spin are dynamic; everything else is static
+	// until it's moved.  The version changes whenever the set of
+	// static entities or any of their transforms does, so caches
+	// built from static entities (shadows) know to rebuild.
+	bool IsDynamic(size_t index) const;
+	unsigned int GetStaticVersion() const { return staticVersion; }
+
+private:
+	ResourceRegistry* resources;
+
+	// Sparse: entity ID -> dense index (or INVALID_ENTITY when free)
+	std::vector<unsigned int> sparse;
+	std::vector<EntityID> freeIDs;
+
+	// Dense component arrays
+	std::vector<EntityID> ids;
+	std::vector<Transform> transforms;
+	std::vector<MeshHandle> meshes;
+	std::vector<MaterialHandle> materials;
+	std::vector<DirectX::BoundingSphere> bounds;
+	std::vector<DirectX::XMFLOAT3> angularVelocities;
+
+	// Transform version each entity's bounds were last built from
+	std::vector<unsigned int> transformVersions;
+
+	unsigned int staticVersion;
+};
@@ -0,0 +1,50 @@
+#include "FrameRingAllocator.h"
+
+FrameRingAllocator::FrameRingAllocator(uint32_t capacity, uint32_t alignment)
+{
+	this->alignment = alignment;
+	this->capacity = (capacity + alignment - 1) & ~(alignment - 1);
+	Reset();
+}
+
+uint32_t FrameRingAllocator::Allocate(uint32_t size)
+{
+	uint32_t alignedSize = (size + alignment - 1) & ~(alignment - 1);
+	if (size == 0 || alignedSize > capacity)
+		return InvalidOffset;
+
+	// Wrap to the start if this won't fit before the end
+	uint32_t position = (uint32_t)(headTotal % capacity);
+	uint32_t skipped = 0;
+	if (position + alignedSize > capacity)
+		skipped = capacity - position;
+
+	if (headTotal + skipped + alignedSize - tailTotal > capacity)
+		return InvalidOffset;
+
+	headTotal += skipped + alignedSize;
+	return skipped > 0 ? 0 : position;
+}
+
+void FrameRingAllocator::EndFrame(uint64_t fence)
+{
+	frames.push_back({ fence, headTotal });
+	frameStart = headTotal;
+}
+
+void FrameRingAllocator::Release(uint64_t completedFence)
+{
+	while (!frames.empty() && frames.front().Fence <= completedFence)
+	{
+		tailTotal = frames.front().End;
+		frames.pop_front();
+	}
+}
+
+void FrameRingAllocator::Reset()
+{
+	headTotal = 0;
+	tailTotal = 0;
+	frameStart = 0;
+	frames.clear();
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+
+// --------------------------------------------------------
+// Bump-allocates short-lived ranges out of a fixed-size ring
+// (bytes of a per-frame GPU buffer).  Like ArenaAllocator it
+// only does the bookkeeping and never touches the storage.
+//
+//  - Allocations are aligned and always contiguous; one that
+//    doesn't fit before the end of the ring wraps to offset 0
+//    and the skipped tail counts as used
+//  - EndFrame() tags everything allocated since the previous
+//    call with a fence value; Release() hands those bytes back
+//    once the caller knows that fence has completed
+//
+// Positions are tracked as running byte totals, so a full
+// ring and an empty one never look alike.
+// --------------------------------------------------------
+class FrameRingAllocator
+{
+public:
+	static const uint32_t InvalidOffset = 0xFFFFFFFF;
+
+	// Capacity is rounded up to a multiple of alignment (a power of two)
+	FrameRingAllocator(uint32_t capacity, uint32_t alignment = 256);
+
+	// Returns InvalidOffset when the frames still in flight hold too much
+	uint32_t Allocate(uint32_t size);
+
+	void EndFrame(uint64_t fence);
+
+	// Frees every frame whose fence is <= completedFence
+	void Release(uint64_t completedFence);
+	void Reset();
+
+	uint32_t GetCapacity() const { return capacity; }
+	uint32_t GetAlignment() const { return alignment; }
+	uint32_t GetUsedSize() const { return (uint32_t)(headTotal - tailTotal); }
+	uint32_t GetFreeSize() const { return capacity - GetUsedSize(); }
+	size_t GetFramesInFlight() const { return frames.size(); }
+
+	// Bytes allocated since the last EndFrame(), including any wrap
+	uint32_t GetFrameSize() const { return (uint32_t)(headTotal - frameStart); }
+
+private:
+	struct Frame
+	{
+		uint64_t Fence;
+		uint64_t End;
+	};
+
+	uint32_t capacity;
+	uint32_t alignment;
+
+	// Running totals: bytes ever allocated (plus skipped tails),
+	// bytes ever released, and the total when this frame began
+	uint64_t headTotal;
+	uint64_t tailTotal;
+	uint64_t frameStart;
+
+	// Oldest first
+	std::deque<Frame> frames;
+};
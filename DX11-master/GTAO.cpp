@@ -0,0 +1,197 @@
+#include "GTAO.h"
+#include <cmath>
+
+static const float Pi = 3.14159265f;
+static const float HalfPi = 1.57079633f;
+
+// The fade starts this far out along the radius
+static const float FalloffStart = 0.385f;
+
+// Steps start past the pixel's own texel
+static const float MinimumStepPixels = 1.3f;
+
+namespace
+{
+	struct Vector3
+	{
+		float X, Y, Z;
+	};
+
+	Vector3 Make(float x, float y, float z) { Vector3 v = { x, y, z }; return v; }
+	Vector3 Add(Vector3 a, Vector3 b) { return Make(a.X + b.X, a.Y + b.Y, a.Z + b.Z); }
+	Vector3 Subtract(Vector3 a, Vector3 b) { return Make(a.X - b.X, a.Y - b.Y, a.Z - b.Z); }
+	Vector3 Scale(Vector3 v, float s) { return Make(v.X * s, v.Y * s, v.Z * s); }
+	float Dot(Vector3 a, Vector3 b) { return a.X * b.X + a.Y * b.Y + a.Z * b.Z; }
+	float Length(Vector3 v) { return sqrtf(Dot(v, v)); }
+	Vector3 Normalize(Vector3 v) { return Scale(v, 1.0f / Length(v)); }
+	Vector3 Cross(Vector3 a, Vector3 b) { return Make(a.Y * b.Z - a.Z * b.Y, a.Z * b.X - a.X * b.Z, a.X * b.Y - a.Y * b.X); }
+	float Saturate(float x) { return x < 0.0f ? 0.0f : (x > 1.0f ? 1.0f : x); }
+
+	// Rotates v by the rotation taking unit vector from to unit vector to
+	Vector3 RotateFromTo(Vector3 from, Vector3 to, Vector3 v)
+	{
+		float e = Dot(from, to);
+		if (fabsf(e) > 1.0f - 0.0003f)
+			return v;
+
+		Vector3 c = Cross(from, to);
+		float h = 1.0f / (1.0f + e);
+		float hvx = h * c.X;
+		float hvz = h * c.Z;
+		float hvxy = hvx * c.Y;
+		float hvxz = hvx * c.Z;
+		float hvyz = hvz * c.Y;
+		return Make(
+			(e + hvx * c.X) * v.X + (hvxy - c.Z) * v.Y + (hvxz + c.Y) * v.Z,
+			(hvxy + c.Z) * v.X + (e + h * c.Y * c.Y) * v.Y + (hvyz - c.X) * v.Z,
+			(hvxz - c.Y) * v.X + (hvyz + c.X) * v.Y + (e + hvz * c.Z) * v.Z);
+	}
+
+	float Fraction(float x) { return x - floorf(x); }
+}
+
+GTAOProjection GTAO::FromProjection(const float* projection)
+{
+	GTAOProjection result = {};
+	result.ScaleX = 1.0f / projection[0];
+	result.ScaleY = 1.0f / projection[5];
+	result.DepthScale = projection[10];
+	result.DepthOffset = projection[14];
+	return result;
+}
+
+float GTAO::ViewDepth(const GTAOProjection& projection, float depth)
+{
+	return projection.DepthOffset / (depth - projection.DepthScale);
+}
+
+float GTAO::InterleavedGradientNoise(float x, float y)
+{
+	return Fraction(52.9829189f * Fraction(0.06711056f * x + 0.00583715f * y));
+}
+
+// View space position of the texel at (x, y)
+static Vector3 ViewPosition(const float* depths, uint32_t width, uint32_t height, int x, int y,
+	const GTAOProjection& projection)
+{
+	x = x < 0 ? 0 : (x > (int)width - 1 ? (int)width - 1 : x);
+	y = y < 0 ? 0 : (y > (int)height - 1 ? (int)height - 1 : y);
+	float z = GTAO::ViewDepth(projection, depths[(size_t)y * width + x]);
+	float ndcX = (x + 0.5f) / width * 2.0f - 1.0f;
+	float ndcY = 1.0f - (y + 0.5f) / height * 2.0f;
+	return Make(ndcX * projection.ScaleX * z, ndcY * projection.ScaleY * z, z);
+}
+
+GTAOResult GTAO::Evaluate(const float* depths, const float* viewNormals, uint32_t width, uint32_t height,
+	uint32_t x, uint32_t y, const GTAOProjection& projection, float radius, int slices, int steps, float noiseOffset)
+{
+	size_t pixel = (size_t)y * width + x;
+	Vector3 normal = Make(viewNormals[pixel * 3], viewNormals[pixel * 3 + 1], viewNormals[pixel * 3 + 2]);
+	GTAOResult result = { 1.0f, { normal.X, normal.Y, normal.Z } };
+	if (depths[pixel] >= 1.0f)
+		return result;
+
+	Vector3 position = ViewPosition(depths, width, height, (int)x, (int)y, projection);
+	Vector3 view = Normalize(Scale(position, -1.0f));
+
+	// The radius on screen, in pixels; nothing to march if under one
+	float radiusPixels = radius * 0.5f * height / (projection.ScaleY * position.Z);
+	if (radiusPixels < 1.0f)
+		return result;
+
+	float falloffRange = (1.0f - FalloffStart) * radius;
+	float falloffMultiply = -1.0f / falloffRange;
+	float falloffAdd = FalloffStart * radius / falloffRange + 1.0f;
+
+	float sliceNoise = Fraction(InterleavedGradientNoise((float)x, (float)y) + noiseOffset);
+	float stepNoise = InterleavedGradientNoise(x + 5.588238f, y + 5.588238f);
+	float minimumStep = MinimumStepPixels / radiusPixels;
+
+	float visibility = 0.0f;
+	Vector3 bentNormal = Make(0.0f, 0.0f, 0.0f);
+	for (int slice = 0; slice < slices; slice++)
+	{
+		// The slice's direction on screen (y down) and in view space (y up)
+		float angle = (slice + sliceNoise) / slices * Pi;
+		float omegaX = cosf(angle);
+		float omegaY = -sinf(angle);
+		Vector3 direction = Make(omegaX, -omegaY, 0.0f);
+
+		// The normal projected onto the slice's plane, and its angle from the view vector
+		Vector3 orthoDirection = Subtract(direction, Scale(view, Dot(direction, view)));
+		Vector3 axis = Normalize(Cross(orthoDirection, view));
+		Vector3 projectedNormal = Subtract(normal, Scale(axis, Dot(normal, axis)));
+		float projectedLength = Length(projectedNormal);
+		if (projectedLength < 1e-6f)
+			continue;
+		float signNormal = Dot(orthoDirection, projectedNormal) < 0.0f ? -1.0f : 1.0f;
+		float cosNormal = Saturate(Dot(projectedNormal, view) / projectedLength);
+		float n = signNormal * acosf(cosNormal);
+
+		// Horizons start at the tangent plane on either side
+		float lowCos0 = cosf(n + HalfPi);
+		float lowCos1 = cosf(n - HalfPi);
+		float horizonCos0 = lowCos0;
+		float horizonCos1 = lowCos1;
+		for (int stepIndex = 0; stepIndex < steps; stepIndex++)
+		{
+			float s = (stepIndex + stepNoise) / steps;
+			s = s * s + minimumStep;
+			float offsetX = s * omegaX * radiusPixels;
+			float offsetY = s * omegaY * radiusPixels;
+
+			for (int side = 0; side < 2; side++)
+			{
+				float sign = side == 0 ? 1.0f : -1.0f;
+				int sampleX = (int)floorf(x + 0.5f + sign * offsetX);
+				int sampleY = (int)floorf(y + 0.5f + sign * offsetY);
+				Vector3 delta = Subtract(ViewPosition(depths, width, height, sampleX, sampleY, projection), position);
+				float sampleDistance = Length(delta);
+				if (sampleDistance < 1e-6f)
+					continue;
+
+				float horizonCos = Dot(delta, view) / sampleDistance;
+				float weight = Saturate(sampleDistance * falloffMultiply + falloffAdd);
+				if (side == 0)
+				{
+					horizonCos = lowCos0 + (horizonCos - lowCos0) * weight;
+					horizonCos0 = horizonCos > horizonCos0 ? horizonCos : horizonCos0;
+				}
+				else
+				{
+					horizonCos = lowCos1 + (horizonCos - lowCos1) * weight;
+					horizonCos1 = horizonCos > horizonCos1 ? horizonCos : horizonCos1;
+				}
+			}
+		}
+
+		// h0 on the negative side, h1 on the positive, clamped to the hemisphere
+		float h0 = -acosf(horizonCos1);
+		float h1 = acosf(horizonCos0);
+		h0 = n + (h0 - n > -HalfPi ? h0 - n : -HalfPi);
+		h1 = n + (h1 - n < HalfPi ? h1 - n : HalfPi);
+
+		float sinN = sinf(n);
+		float arc0 = (cosNormal + 2.0f * h0 * sinN - cosf(2.0f * h0 - n)) / 4.0f;
+		float arc1 = (cosNormal + 2.0f * h1 * sinN - cosf(2.0f * h1 - n)) / 4.0f;
+		visibility += projectedLength * (arc0 + arc1);
+
+		float t0 = (6.0f * sinf(h0 - n) - sinf(3.0f * h0 - n) + 6.0f * sinf(h1 - n) - sinf(3.0f * h1 - n)
+			+ 16.0f * sinN - 3.0f * (sinf(h0 + n) + sinf(h1 + n))) / 12.0f;
+		float t1 = (-cosf(3.0f * h0 - n) - cosf(3.0f * h1 - n) + 8.0f * cosf(n)
+			- 3.0f * (cosf(h0 + n) + cosf(h1 + n))) / 12.0f;
+		Vector3 localBent = Make(direction.X * t0, direction.Y * t0, -t1);
+		localBent = RotateFromTo(Make(0.0f, 0.0f, -1.0f), view, localBent);
+		bentNormal = Add(bentNormal, Scale(localBent, projectedLength));
+	}
+
+	result.Visibility = Saturate(visibility / slices);
+	if (Length(bentNormal) > 1e-6f)
+	{
+		bentNormal = Normalize(bentNormal);
+		result.BentNormal[0] = bentNormal.X;
+		result.BentNormal[1] = bentNormal.Y;
+		result.BentNormal[2] = bentNormal.Z;
+	}
+	return result;
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <cstdint>
+
+// --------------------------------------------------------
+// What GTAO needs of a perspective projection (row-major,
+// row vectors, like XMFLOAT4X4): view x and y per unit of
+// NDC at view depth 1 (1 / _11, 1 / _22), and the two terms
+// that turn depth back into view depth (_33, _43)
+// --------------------------------------------------------
+struct GTAOProjection
+{
+	float ScaleX, ScaleY;
+	float DepthScale, DepthOffset;
+};
+
+struct GTAOResult
+{
+	float Visibility;		// 1 is unoccluded
+	float BentNormal[3];	// View space, unit length; for debugging, the renderer only uses Visibility
+};
+
+// --------------------------------------------------------
+// Horizon based ground truth AO (Jimenez et al., "Practical
+// Real-Time Strategies for Accurate Indirect Occlusion"), a
+// CPU reference matching GTAOPixelShader.hlsl step for step.
+//
+// Around each pixel, Slices screen space lines through it are
+// marched Steps texels each way, out to the AO radius.  Each
+// fetch turns its depth straight into a view space position
+// (a divide for depth, two multiplies for x and y), and each
+// side keeps its highest horizon, faded out past 38% of the
+// radius.  The visible arc between the two horizons, cosine
+// weighted around the normal projected onto the slice, is
+// integrated in closed form; so is its bent normal, the mean
+// unoccluded direction.
+//
+// Slices turn by interleaved gradient noise per pixel, plus
+// noiseOffset (in turns) to step them from frame to frame,
+// and steps are jittered by a second noise.  Steps bunch up
+// near the pixel (their distances go as the square), starting
+// past the pixel's own texel.
+//
+// Depths are post projection, normals view space (3 floats
+// per pixel), both row by row.  Fetches take the nearest
+// texel, clamped to the edges.  Depth 1 is sky: unoccluded.
+// --------------------------------------------------------
+class GTAO
+{
+public:
+	static const int MaxSlices = 4;
+	static const int MaxSteps = 8;
+
+	static GTAOProjection FromProjection(const float* projection);
+	static float ViewDepth(const GTAOProjection& projection, float depth);
+	static float InterleavedGradientNoise(float x, float y);
+
+	static GTAOResult Evaluate(const float* depths, const float* viewNormals, uint32_t width, uint32_t height,
+		uint32_t x, uint32_t y, const GTAOProjection& projection, float radius, int slices, int steps, float noiseOffset);
+};
@@ -0,0 +1,162 @@
+cbuffer externalData : register(b0)
+{
+	matrix viewMatrix;
+	float4 projectionParams;	// 1 / _11, 1 / _22, _33, _43 of the projection
+	float radius;
+	int sliceCount;
+	int stepCount;
+	float noiseOffset;
+}
+struct VertexToPixel
+{
+	float4 position : SV_POSITION;
+	float2 uv : TEXCOORD0;
+};
+Texture2D Normals : register(t0);
+Texture2D Depths : register(t1);
+
+static const float PI = 3.14159265f;
+static const float HALF_PI = 1.57079633f;
+static const float FALLOFF_START = 0.385f;
+static const float MINIMUM_STEP_PIXELS = 1.3f;
+
+// View space position of a texel, straight from its depth
+float3 ViewPosition(int2 texel, float2 size)
+{
+	texel = clamp(texel, 0, int2(size) - 1);
+	float depth = Depths.Load(int3(texel, 0)).r;
+	float z = projectionParams.w / (depth - projectionParams.z);
+	float2 ndc = float2((texel.x + 0.5f) / size.x * 2 - 1, 1 - (texel.y + 0.5f) / size.y * 2);
+	return float3(ndc * projectionParams.xy * z, z);
+}
+
+float InterleavedGradientNoise(float2 position)
+{
+	return frac(52.9829189f * frac(dot(position, float2(0.06711056f, 0.00583715f))));
+}
+
+// Rotates v by the rotation taking unit vector from to unit vector to
+float3 RotateFromTo(float3 from, float3 to, float3 v)
+{
+	float e = dot(from, to);
+	if (abs(e) > 1.0f - 0.0003f)
+		return v;
+
+	float3 c = cross(from, to);
+	float h = 1.0f / (1.0f + e);
+	float hvx = h * c.x;
+	float hvz = h * c.z;
+	float hvxy = hvx * c.y;
+	float hvxz = hvx * c.z;
+	float hvyz = hvz * c.y;
+	return float3(
+		(e + hvx * c.x) * v.x + (hvxy - c.z) * v.y + (hvxz + c.y) * v.z,
+		(hvxy + c.z) * v.x + (e + h * c.y * c.y) * v.y + (hvyz - c.x) * v.z,
+		(hvxz - c.y) * v.x + (hvyz + c.x) * v.y + (e + hvz * c.z) * v.z);
+}
+
+// Horizon based AO: a few screen space slices through the pixel
+// are marched both ways over depth, and the visible arc between
+// their horizons is integrated in closed form.  Returns the
+// visibility in r and the view space bent normal in gba.  The
+// bent normal is debug output only: the blur, temporal and
+// upsample passes carry r alone, so nothing downstream sees it.
+// See GTAO.h, which this follows step for step.
+float4 main(VertexToPixel input) : SV_TARGET
+{
+	uint width, height;
+	Depths.GetDimensions(width, height);
+	float2 size = float2(width, height);
+	int2 pixel = int2(input.position.xy);
+
+	float3 normal = Normals.Load(int3(pixel, 0)).xyz * 2 - 1;
+	normal = normalize(mul((float3x3)viewMatrix, normal));
+	if (Depths.Load(int3(pixel, 0)).r >= 1.0f)
+		return float4(1, normal * 0.5f + 0.5f);
+
+	float3 position = ViewPosition(pixel, size);
+	float3 view = normalize(-position);
+
+	// The radius on screen, in pixels; nothing to march if under one
+	float radiusPixels = radius * 0.5f * height / (projectionParams.y * position.z);
+	if (radiusPixels < 1.0f)
+		return float4(1, normal * 0.5f + 0.5f);
+
+	float falloffRange = (1.0f - FALLOFF_START) * radius;
+	float falloffMultiply = -1.0f / falloffRange;
+	float falloffAdd = FALLOFF_START * radius / falloffRange + 1.0f;
+
+	float sliceNoise = frac(InterleavedGradientNoise(pixel) + noiseOffset);
+	float stepNoise = InterleavedGradientNoise(pixel + 5.588238f);
+	float minimumStep = MINIMUM_STEP_PIXELS / radiusPixels;
+
+	float visibility = 0;
+	float3 bentNormal = 0;
+	for (int slice = 0; slice < sliceCount; slice++)
+	{
+		// The slice's direction on screen (y down) and in view space (y up)
+		float angle = (slice + sliceNoise) / sliceCount * PI;
+		float2 omega = float2(cos(angle), -sin(angle));
+		float3 direction = float3(omega.x, -omega.y, 0);
+
+		// The normal projected onto the slice's plane, and its angle from the view vector
+		float3 orthoDirection = direction - view * dot(direction, view);
+		float3 axis = normalize(cross(orthoDirection, view));
+		float3 projectedNormal = normal - axis * dot(normal, axis);
+		float projectedLength = length(projectedNormal);
+		if (projectedLength < 1e-6f)
+			continue;
+		float signNormal = dot(orthoDirection, projectedNormal) < 0 ? -1.0f : 1.0f;
+		float cosNormal = saturate(dot(projectedNormal, view) / projectedLength);
+		float n = signNormal * acos(cosNormal);
+
+		// Horizons start at the tangent plane on either side
+		float lowCos0 = cos(n + HALF_PI);
+		float lowCos1 = cos(n - HALF_PI);
+		float horizonCos0 = lowCos0;
+		float horizonCos1 = lowCos1;
+		for (int stepIndex = 0; stepIndex < stepCount; stepIndex++)
+		{
+			float s = (stepIndex + stepNoise) / stepCount;
+			s = s * s + minimumStep;
+			float2 offset = s * omega * radiusPixels;
+
+			float3 delta = ViewPosition(int2(floor(input.position.xy + offset)), size) - position;
+			float sampleDistance = length(delta);
+			if (sampleDistance >= 1e-6f)
+			{
+				float horizonCos = lerp(lowCos0, dot(delta, view) / sampleDistance, saturate(sampleDistance * falloffMultiply + falloffAdd));
+				horizonCos0 = max(horizonCos0, horizonCos);
+			}
+
+			delta = ViewPosition(int2(floor(input.position.xy - offset)), size) - position;
+			sampleDistance = length(delta);
+			if (sampleDistance >= 1e-6f)
+			{
+				float horizonCos = lerp(lowCos1, dot(delta, view) / sampleDistance, saturate(sampleDistance * falloffMultiply + falloffAdd));
+				horizonCos1 = max(horizonCos1, horizonCos);
+			}
+		}
+
+		// h0 on the negative side, h1 on the positive, clamped to the hemisphere
+		float h0 = -acos(horizonCos1);
+		float h1 = acos(horizonCos0);
+		h0 = n + max(h0 - n, -HALF_PI);
+		h1 = n + min(h1 - n, HALF_PI);
+
+		float sinN = sin(n);
+		float arc0 = (cosNormal + 2 * h0 * sinN - cos(2 * h0 - n)) / 4;
+		float arc1 = (cosNormal + 2 * h1 * sinN - cos(2 * h1 - n)) / 4;
+		visibility += projectedLength * (arc0 + arc1);
+
+		float t0 = (6 * sin(h0 - n) - sin(3 * h0 - n) + 6 * sin(h1 - n) - sin(3 * h1 - n)
+			+ 16 * sinN - 3 * (sin(h0 + n) + sin(h1 + n))) / 12;
+		float t1 = (-cos(3 * h0 - n) - cos(3 * h1 - n) + 8 * cos(n) - 3 * (cos(h0 + n) + cos(h1 + n))) / 12;
+		float3 localBent = float3(direction.xy * t0, -t1);
+		bentNormal += RotateFromTo(float3(0, 0, -1), view, localBent) * projectedLength;
+	}
+
+	visibility = saturate(visibility / sliceCount);
+	bentNormal = length(bentNormal) > 1e-6f ? normalize(bentNormal) : normal;
+	return float4(visibility, bentNormal * 0.5f + 0.5f);
+}
@@ -3,8 +3,11 @@
 #include "Input.h"
 #include "Helpers.h"
 #include "material.h"
+#include "BufferStructs.h"
 #include "WICTextureLoader.h"
 #include "Sky.h"
+#include <chrono>
+#include <algorithm>
 
 
 // Needed for a helper function to load pre-compiled shader files
@@ -34,11 +37,18 @@ Game::Game(HINSTANCE hInstance)
 		1280,				// Width of the window's client area
 		720,				// Height of the window's client area
 		false,				// Sync the framerate to the monitor refresh? (lock framerate)
-		true)				// Show extra stats (fps) in title bar?
+		true),				// Show extra stats (fps) in title bar?
+	entityStore(resources)
 {
-	gameEntities = std::vector<std::shared_ptr<gameEntity>>();
+	gameEntities = std::vector<gameEntity>();
+	stressSpawnCount = 100000;
+	entityUpdateMilliseconds = 0.0f;
+	shaderLoadMilliseconds = 0.0f;
 	cameras = std::vector<std::shared_ptr<Camera>>();
-	meshes = std::vector<std::shared_ptr<Mesh>>();
+	meshes = std::vector<MeshHandle>();
+	instanceBufferCapacity = 0;
+	useInstancing = true;
+	useConstantRing = true;
 	ambientColor = XMFLOAT3(0.1f,0.1f,0.25f);
 #if defined(DEBUG) || defined(_DEBUG)
 	// Do we want a console window?  Probably only in debug mode
@@ -66,7 +76,89 @@ Game::~Game()
 	ImGui_ImplWin32_Shutdown();
 	ImGui::DestroyContext();
 
+	ISimpleShader::PerDrawRing = 0;
 	gameEntities.clear();
+	entityStore.Clear();
+	resources.Clear();
+}
+
+// --------------------------------------------------------
+// Loads a texture from disk and hands ownership of it to
+// the resource registry
+// --------------------------------------------------------
+TextureHandle Game::LoadTexture(const std::wstring& file)
+{
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv;
+	DirectX::CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(file).c_str(), 0, srv.GetAddressOf());
+	return resources.Textures.Add(srv);
+}
+
+// --------------------------------------------------------
+// Reads an image back into CPU memory as 8-bit RGBA (grayscale
+// is expanded).  Returns an empty image if it can't be loaded.
+// --------------------------------------------------------
+PackedImage Game::LoadImagePixels(const std::wstring& file)
+{
+	PackedImage image;
+	Microsoft::WRL::ComPtr<ID3D11Resource> resource;
+	HRESULT hr = DirectX::CreateWICTextureFromFileEx(device.Get(), FixPath(file).c_str(), 0,
+		D3D11_USAGE_STAGING, 0, D3D11_CPU_ACCESS_READ, 0,
+		DirectX::WIC_LOADER_FORCE_RGBA32 | DirectX::WIC_LOADER_IGNORE_SRGB,
+		resource.GetAddressOf(), 0);
+	if (FAILED(hr))
+		return image;
+
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> texture;
+	resource.As(&texture);
+	D3D11_TEXTURE2D_DESC desc;
+	texture->GetDesc(&desc);
+
+	D3D11_MAPPED_SUBRESOURCE mapped;
+	if (FAILED(context->Map(texture.Get(), 0, D3D11_MAP_READ, 0, &mapped)))
+		return image;
+
+	image = PackedImage(desc.Width, desc.Height);
+	for (unsigned int y = 0; y < desc.Height; y++)
+		memcpy(&image.Pixels[(size_t)y * desc.Width * 4], (const uint8_t*)mapped.pData + (size_t)y * mapped.RowPitch, desc.Width * 4);
+	context->Unmap(texture.Get(), 0);
+	return image;
+}
+
+// --------------------------------------------------------
+// Uploads a packed texture array (every slice and mip) and
+// hands ownership of it to the resource registry
+// --------------------------------------------------------
+TextureHandle Game::CreateTextureArray(const TextureArrayPacker& packer)
+{
+	D3D11_TEXTURE2D_DESC desc = {};
+	desc.Width = packer.GetSize();
+	desc.Height = packer.GetSize();
+	desc.MipLevels = packer.GetMipCount();
+	desc.ArraySize = packer.GetSliceCount();
+	desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	desc.SampleDesc.Count = 1;
+	desc.Usage = D3D11_USAGE_IMMUTABLE;
+	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+	// Subresources are ordered mip first, then slice
+	std::vector<D3D11_SUBRESOURCE_DATA> initialData;
+	for (unsigned int slice = 0; slice < packer.GetSliceCount(); slice++)
+	{
+		for (unsigned int mip = 0; mip < packer.GetMipCount(); mip++)
+		{
+			const PackedImage& image = packer.GetMip(slice, mip);
+			D3D11_SUBRESOURCE_DATA data = {};
+			data.pSysMem = image.Pixels.data();
+			data.SysMemPitch = image.Width * 4;
+			initialData.push_back(data);
+		}
+	}
+
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> texture;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv;
+	device->CreateTexture2D(&desc, initialData.data(), texture.GetAddressOf());
+	device->CreateShaderResourceView(texture.Get(), 0, srv.GetAddressOf());
+	return resources.Textures.Add(srv);
 }
 
 // --------------------------------------------------------
@@ -78,11 +170,23 @@ void Game::Init()
 	// Helper methods for loading shaders, creating some basic
 	// geometry to draw and some simple camera matrices.
 	//  - You'll be expanding and/or replacing these later
+	auto shaderLoadStart = std::chrono::high_resolution_clock::now();
 	LoadShaders();
+	std::chrono::duration<float, std::milli> shaderLoadTime = std::chrono::high_resolution_clock::now() - shaderLoadStart;
+	shaderLoadMilliseconds = shaderLoadTime.count();
 	CreateGeometry();
+
+	pipelineStates = std::make_shared<PipelineStateCache>(device);
+	stateTracker = std::make_shared<StateTracker>(context,
+		[](SimpleVertexShader* shader) { shader->SetShader(); },
+		[](SimplePixelShader* shader) { shader->SetShader(); });
+	gpuTimer = std::make_shared<GpuTimer>(device, context, GPU_SPAN_COUNT);
+	// Textures of an old window size are dropped two frames after a resize
+	renderTargetPool = std::make_shared<RenderTargetPool>(device, 2);
+	graphExecutor = std::make_shared<RenderGraphExecutor>(context, renderTargetPool);
 	
-	skyBox = std::make_shared<Sky>(meshes[5], sampler, device, skyVertexShader, 
-		skyPixelShader, context, FixPath(L"../../Assets/Textures/Clouds_Pink/right.png").c_str(),
+	skyBox = std::make_shared<Sky>(resources.Meshes.GetOwner(meshes[5]), sampler, device, skyVertexShader, 
+		skyPixelShader, context, *pipelineStates, FixPath(L"../../Assets/Textures/Clouds_Pink/right.png").c_str(),
 		FixPath(L"../../Assets/Textures/Clouds_Pink/left.png").c_str(),
 		FixPath(L"../../Assets/Textures/Clouds_Pink/up.png").c_str(),
 		FixPath(L"../../Assets/Textures/Clouds_Pink/down.png").c_str(),
@@ -132,7 +236,45 @@ void Game::Init()
 	directionalLight1.Color = XMFLOAT3(1, 1, 1);
 	directionalLight1.Intensity = 0.8f;
 
+	// Point and spot lights, every one casting shadows into the atlas
+	Light pointLight = {};
+	pointLight.Type = LIGHT_TYPE_POINT;
+	pointLight.Position = XMFLOAT3(0.0f, 2.0f, -2.0f);
+	pointLight.Range = 8.0f;
+	pointLight.Intensity = 1.5f;
+	pointLight.Color = XMFLOAT3(1.0f, 0.6f, 0.3f);
+	localLights.push_back(pointLight);
+	pointLight.Position = XMFLOAT3(4.0f, 1.5f, 0.0f); // Circles the scene when animated
+	pointLight.Range = 6.0f;
+	pointLight.Color = XMFLOAT3(0.3f, 0.5f, 1.0f);
+	localLights.push_back(pointLight);
+
+	Light spotLight = {};
+	spotLight.Type = LIGHT_TYPE_SPOT;
+	spotLight.Position = XMFLOAT3(-6.0f, 4.0f, -2.0f);
+	spotLight.Direction = XMFLOAT3(0.0f, -1.0f, 0.5f);
+	spotLight.Range = 10.0f;
+	spotLight.Intensity = 2.0f;
+	spotLight.Color = XMFLOAT3(1.0f, 1.0f, 0.8f);
+	spotLight.SpotFalloff = 16.0f;
+	localLights.push_back(spotLight);
+	spotLight.Position = XMFLOAT3(6.0f, 4.0f, -2.0f);
+	spotLight.Color = XMFLOAT3(0.8f, 1.0f, 0.8f);
+	localLights.push_back(spotLight);
+	animateLocalLights = true;
+	localShadowBudget = 2;
+
+	shadowCascadeSetting = ShadowCascades::MaxCascades;
+	shadowSplitLambda = 0.75f;
+	shadowDistance = cameras[activeCam]->GetFarClip();
+	shadowMapSize = 2048;
+	useShadowCache = true;
+	shadowFilter = SHADOW_FILTER_PCF;
+	shadowPCFRadius = 2;
+	evsmBlurRadius = 2;
+	evsmLightBleedReduction = 0.2f;
 	CreateShadowMap();
+	CreateShadowAtlas();
 
 	// Sampler state for post processing
 	D3D11_SAMPLER_DESC ppSampDesc = {};
@@ -143,18 +285,108 @@ void Game::Init()
 	ppSampDesc.MaxLOD = D3D11_FLOAT32_MAX;
 	device->CreateSamplerState(&ppSampDesc, ppSampler.GetAddressOf());
 
-	setupPP();
+	CreateSSAOResources();
+	CreatePipelineStates();
 	blur = 0;
+	useBlurPyramid = true;
 	ssaoRadius = 1.0f;
 	ssaoSamples = 64;
+	ssaoScale = 2;
+	ssaoDepthTolerance = 0.05f;
+	for (int method = 0; method < AO_METHOD_COUNT; method++)
+	{
+		for (float& milliseconds : ssaoMilliseconds[method])
+			milliseconds = 0.0f;
+	}
+	aoMethod = AO_METHOD_HEMISPHERE;
+	gtaoSlices = 2;
+	gtaoSteps = 4;
+	ssaoTemporal = true;
+	ssaoFrame = 0;
+	ssaoHistoryWidth = 0;
+	ssaoHistoryHeight = 0;
+	ssaoHistoryIndex = 0;
+	ssaoHistoryValid = false;
+	XMStoreFloat4x4(&ssaoPreviousView, XMMatrixIdentity());
+	XMStoreFloat4x4(&ssaoPreviousProjection, XMMatrixIdentity());
+}
+
+// --------------------------------------------------------
+// Pipeline states for the full screen passes.  The scene's
+// come from its materials' shaders as it draws, and the
+// shadow and sky passes make their own.
+// --------------------------------------------------------
+void Game::CreatePipelineStates()
+{
+	// Full screen triangles neither test nor write depth
+	PipelineStateDesc postDesc;
+	postDesc.VertexShader = ppVS.get();
+	postDesc.DepthStencil.DepthEnable = false;
+	postDesc.DepthStencil.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ZERO;
+
+	postDesc.PixelShader = ssaoDownsamplePS.get();
+	ssaoDownsamplePipeline = pipelineStates->Get(postDesc);
+	postDesc.PixelShader = ppssaoPS.get();
+	ssaoPipeline = pipelineStates->Get(postDesc);
+	postDesc.PixelShader = gtaoPS.get();
+	gtaoPipeline = pipelineStates->Get(postDesc);
+	postDesc.PixelShader = ssaoTemporalPS.get();
+	ssaoTemporalPipeline = pipelineStates->Get(postDesc);
+	postDesc.PixelShader = ppssaoblurPS.get();
+	ssaoBlurPipeline = pipelineStates->Get(postDesc);
+	postDesc.PixelShader = ssaoUpsamplePS.get();
+	ssaoUpsamplePipeline = pipelineStates->Get(postDesc);
+	postDesc.PixelShader = combinePS.get();
+	combinePipeline = pipelineStates->Get(postDesc);
+	postDesc.PixelShader = blurPPPS.get();
+	blurPipeline = pipelineStates->Get(postDesc);
+	postDesc.PixelShader = evsmConvertPS.get();
+	evsmConvertPipeline = pipelineStates->Get(postDesc);
+	postDesc.PixelShader = evsmBlurPS.get();
+	evsmBlurPipeline = pipelineStates->Get(postDesc);
 }
 
 void Game::CreateShadowMap()
+{
+	CreateShadowTextures();
+
+	// Depth only, no pixel shader.  Casters between the light and a
+	// cascade's near plane are clamped onto it rather than clipped.
+	PipelineStateDesc shadowPipelineDesc;
+	shadowPipelineDesc.VertexShader = shadowVShader.get();
+	shadowPipelineDesc.Rasterizer.DepthClipEnable = false;
+	shadowPipelineDesc.Rasterizer.DepthBias = 1000; // Min. precision units, not world units!
+	shadowPipelineDesc.Rasterizer.SlopeScaledDepthBias = 1.0f; // Bias more based on slope
+	shadowPipeline = pipelineStates->Get(shadowPipelineDesc);
+
+	// Writes a cascade's window of its cached slice as depth
+	PipelineStateDesc cacheCopyDesc;
+	cacheCopyDesc.VertexShader = ppVS.get();
+	cacheCopyDesc.PixelShader = shadowCacheCopyPS.get();
+	cacheCopyDesc.DepthStencil.DepthFunc = D3D11_COMPARISON_ALWAYS;
+	shadowCacheCopyPipeline = pipelineStates->Get(cacheCopyDesc);
+
+	D3D11_SAMPLER_DESC shadowSampDesc = {};
+	shadowSampDesc.Filter = D3D11_FILTER_COMPARISON_MIN_MAG_MIP_LINEAR;
+	shadowSampDesc.ComparisonFunc = D3D11_COMPARISON_LESS;
+	shadowSampDesc.AddressU = D3D11_TEXTURE_ADDRESS_BORDER;
+	shadowSampDesc.AddressV = D3D11_TEXTURE_ADDRESS_BORDER;
+	shadowSampDesc.AddressW = D3D11_TEXTURE_ADDRESS_BORDER;
+	shadowSampDesc.BorderColor[0] = 1.0f; // Only need the first component
+	device->CreateSamplerState(&shadowSampDesc, &shadowSampler);
+}
+
+// --------------------------------------------------------
+// (Re)creates the shadow array at shadowMapSize, one slice
+// per cascade the setting asks for, and the cache and moment
+// arrays that go with it
+// --------------------------------------------------------
+void Game::CreateShadowTextures()
 {
 	D3D11_TEXTURE2D_DESC shadowDesc = {};
-	shadowDesc.Width = windowWidth;
-	shadowDesc.Height = windowHeight;
-	shadowDesc.ArraySize = 1;
+	shadowDesc.Width = shadowMapSize;
+	shadowDesc.Height = shadowMapSize;
+	shadowDesc.ArraySize = shadowCascadeSetting;
 	shadowDesc.BindFlags = D3D11_BIND_DEPTH_STENCIL | D3D11_BIND_SHADER_RESOURCE;
 	shadowDesc.CPUAccessFlags = 0;
 	shadowDesc.Format = DXGI_FORMAT_R32_TYPELESS;
@@ -163,135 +395,266 @@ void Game::CreateShadowMap()
 	shadowDesc.SampleDesc.Count = 1;
 	shadowDesc.SampleDesc.Quality = 0;
 	shadowDesc.Usage = D3D11_USAGE_DEFAULT;
-	Microsoft::WRL::ComPtr<ID3D11Texture2D> shadowTexture;
+	shadowTexture.Reset();
 	device->CreateTexture2D(&shadowDesc, 0, shadowTexture.GetAddressOf());
 
-	//depth stencil view
-	D3D11_DEPTH_STENCIL_VIEW_DESC shadowDSDesc = {};
-	shadowDSDesc.Format = DXGI_FORMAT_D32_FLOAT;
-	shadowDSDesc.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2D;
-	shadowDSDesc.Texture2D.MipSlice = 0;
-	device->CreateDepthStencilView(
-		shadowTexture.Get(),
-		&shadowDSDesc,
-		shadowDSV.GetAddressOf());
+	//depth stencil views for each cascade
+	shadowCascadeDSVs.clear();
+	shadowCascadeDSVs.resize(shadowCascadeSetting);
+	for (int i = 0; i < shadowCascadeSetting; i++)
+	{
+		D3D11_DEPTH_STENCIL_VIEW_DESC shadowDSDesc = {};
+		shadowDSDesc.Format = DXGI_FORMAT_D32_FLOAT;
+		shadowDSDesc.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2DARRAY;
+		shadowDSDesc.Texture2DArray.MipSlice = 0;
+		shadowDSDesc.Texture2DArray.FirstArraySlice = i;
+		shadowDSDesc.Texture2DArray.ArraySize = 1;
+		device->CreateDepthStencilView(
+			shadowTexture.Get(),
+			&shadowDSDesc,
+			shadowCascadeDSVs[i].GetAddressOf());
+	}
 
-	//SRV for shadow map
+	//SRV for the whole array
 	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
 	srvDesc.Format = DXGI_FORMAT_R32_FLOAT;
-	srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
-	srvDesc.Texture2D.MipLevels = 1;
-	srvDesc.Texture2D.MostDetailedMip = 0;
+	srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
+	srvDesc.Texture2DArray.MipLevels = 1;
+	srvDesc.Texture2DArray.MostDetailedMip = 0;
+	srvDesc.Texture2DArray.FirstArraySlice = 0;
+	srvDesc.Texture2DArray.ArraySize = shadowCascadeSetting;
+	shadowSRV.Reset();
 	device->CreateShaderResourceView(
 		shadowTexture.Get(),
 		&srvDesc,
 		shadowSRV.GetAddressOf());
 
-	D3D11_RASTERIZER_DESC shadowRastDesc = {};
-	shadowRastDesc.FillMode = D3D11_FILL_SOLID;
-	shadowRastDesc.CullMode = D3D11_CULL_BACK;
-	shadowRastDesc.DepthClipEnable = true;
-	shadowRastDesc.DepthBias = 1000; // Min. precision units, not world units!
-	shadowRastDesc.SlopeScaledDepthBias = 1.0f; // Bias more based on slope
-	device->CreateRasterizerState(&shadowRastDesc, &shadowRasterizer);
+	CreateShadowCacheTextures();
+	CreateShadowMomentTextures();
+}
 
-	D3D11_SAMPLER_DESC shadowSampDesc = {};
-	shadowSampDesc.Filter = D3D11_FILTER_COMPARISON_MIN_MAG_MIP_LINEAR;
-	shadowSampDesc.ComparisonFunc = D3D11_COMPARISON_LESS;
-	shadowSampDesc.AddressU = D3D11_TEXTURE_ADDRESS_BORDER;
-	shadowSampDesc.AddressV = D3D11_TEXTURE_ADDRESS_BORDER;
-	shadowSampDesc.AddressW = D3D11_TEXTURE_ADDRESS_BORDER;
-	shadowSampDesc.BorderColor[0] = 1.0f; // Only need the first component
-	device->CreateSamplerState(&shadowSampDesc, &shadowSampler);
+// --------------------------------------------------------
+// (Re)creates the static-caster cache array, one slice per
+// cascade, or releases it when caching is off.  It covers a
+// margin of an eighth of the map around each cascade, and is
+// read back through an SRV since depth can't be copied with
+// an offset.
+// --------------------------------------------------------
+void Game::CreateShadowCacheTextures()
+{
+	shadowCacheDSVs.clear();
+	shadowCacheSRV.Reset();
+	shadowCacheTexture.Reset();
+	InvalidateShadowCache();
+	if (!useShadowCache)
+		return;
+
+	shadowCacheMargin = shadowMapSize / 8;
+	D3D11_TEXTURE2D_DESC cacheDesc = {};
+	cacheDesc.Width = shadowMapSize + 2 * shadowCacheMargin;
+	cacheDesc.Height = shadowMapSize + 2 * shadowCacheMargin;
+	cacheDesc.ArraySize = shadowCascadeSetting;
+	cacheDesc.BindFlags = D3D11_BIND_DEPTH_STENCIL | D3D11_BIND_SHADER_RESOURCE;
+	cacheDesc.Format = DXGI_FORMAT_R32_TYPELESS;
+	cacheDesc.MipLevels = 1;
+	cacheDesc.SampleDesc.Count = 1;
+	cacheDesc.Usage = D3D11_USAGE_DEFAULT;
+	device->CreateTexture2D(&cacheDesc, 0, shadowCacheTexture.GetAddressOf());
+
+	shadowCacheDSVs.resize(shadowCascadeSetting);
+	for (int i = 0; i < shadowCascadeSetting; i++)
+	{
+		D3D11_DEPTH_STENCIL_VIEW_DESC cacheDSDesc = {};
+		cacheDSDesc.Format = DXGI_FORMAT_D32_FLOAT;
+		cacheDSDesc.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2DARRAY;
+		cacheDSDesc.Texture2DArray.FirstArraySlice = i;
+		cacheDSDesc.Texture2DArray.ArraySize = 1;
+		device->CreateDepthStencilView(shadowCacheTexture.Get(), &cacheDSDesc, shadowCacheDSVs[i].GetAddressOf());
+	}
 
-	XMMATRIX lightView = XMMatrixLookToLH(
-		XMVectorSet(-directionalLight1.Direction.x * 20, -directionalLight1.Direction.y * 20, -directionalLight1.Direction.z * 20, 0),
-		XMVectorSet(directionalLight1.Direction.x, directionalLight1.Direction.y, directionalLight1.Direction.z, 0),
-		XMVectorSet(0, 1, 0, 0));
-	XMStoreFloat4x4(&lightViewMatrix, lightView);
-
-	float lightProjectionSize = 15.0f;
-	XMMATRIX lightProj = XMMatrixOrthographicLH(
-		lightProjectionSize,
-		lightProjectionSize,
-		1.0f,
-		100.0f);
-	XMStoreFloat4x4(&lightProjectionMatrix, lightProj);
-}
-
-void Game::setupPP()
-{
-
-	// Describe the texture we're creating
-	D3D11_TEXTURE2D_DESC textureDesc = {};
-	textureDesc.Width = windowWidth;
-	textureDesc.Height = windowHeight;
-	textureDesc.ArraySize = 1;
-	textureDesc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
-	textureDesc.CPUAccessFlags = 0;
-	textureDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-	textureDesc.MipLevels = 1;
-	textureDesc.MiscFlags = 0;
-	textureDesc.SampleDesc.Count = 1;
-	textureDesc.SampleDesc.Quality = 0;
-	textureDesc.Usage = D3D11_USAGE_DEFAULT;
-	// Create the resource (no need to track it after the views are created below)
-	Microsoft::WRL::ComPtr<ID3D11Texture2D> ppTexture;
-	device->CreateTexture2D(&textureDesc, 0, ppTexture.GetAddressOf());
-
-	Microsoft::WRL::ComPtr<ID3D11Texture2D> colorTexture;
-	device->CreateTexture2D(&textureDesc, 0, colorTexture.GetAddressOf());
-
-	Microsoft::WRL::ComPtr<ID3D11Texture2D> ambientTexture;
-	device->CreateTexture2D(&textureDesc, 0, ambientTexture.GetAddressOf());
-
-	Microsoft::WRL::ComPtr<ID3D11Texture2D> SSAOTexture;
-	device->CreateTexture2D(&textureDesc, 0, SSAOTexture.GetAddressOf());
-
-	Microsoft::WRL::ComPtr<ID3D11Texture2D> blurredTexture;
-	device->CreateTexture2D(&textureDesc, 0, blurredTexture.GetAddressOf());
-
-	Microsoft::WRL::ComPtr<ID3D11Texture2D> normalsTexture;
-	device->CreateTexture2D(&textureDesc, 0, normalsTexture.GetAddressOf());
-	
-	textureDesc.Format = DXGI_FORMAT_R32_FLOAT;
-	Microsoft::WRL::ComPtr<ID3D11Texture2D> depthTexture;
-	device->CreateTexture2D(&textureDesc, 0, depthTexture.GetAddressOf());
-	textureDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-
-	// Create the Render Target View
-	D3D11_RENDER_TARGET_VIEW_DESC rtvDesc = {};
-	rtvDesc.Format = textureDesc.Format;
-	rtvDesc.Texture2D.MipSlice = 0;
-	rtvDesc.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2D;
-	device->CreateRenderTargetView(
-		ppTexture.Get(),
-		&rtvDesc,
-		ppRTV.ReleaseAndGetAddressOf());
-	// Create the Shader Resource View
-	// By passing it a null description for the SRV, we
-	// get a "default" SRV that has access to the entire resource
-	device->CreateShaderResourceView(
-		ppTexture.Get(),
-		0,
-		ppSRV.ReleaseAndGetAddressOf());
-
-	device->CreateRenderTargetView(colorTexture.Get(), &rtvDesc, colorRTV.ReleaseAndGetAddressOf());
-	device->CreateRenderTargetView(ambientTexture.Get(), &rtvDesc, ambientRTV.ReleaseAndGetAddressOf());
-	device->CreateRenderTargetView(SSAOTexture.Get(), &rtvDesc, SSAORTV.ReleaseAndGetAddressOf());
-	device->CreateRenderTargetView(blurredTexture.Get(), &rtvDesc, blurredSSAORTV.ReleaseAndGetAddressOf());
-	device->CreateRenderTargetView(normalsTexture.Get(), &rtvDesc, normalsRTV.ReleaseAndGetAddressOf());
-
-	rtvDesc.Format = DXGI_FORMAT_R32_FLOAT;
-	device->CreateRenderTargetView(depthTexture.Get(), &rtvDesc, depthRTV.ReleaseAndGetAddressOf());
-
-	device->CreateShaderResourceView(colorTexture.Get(), 0, colorSRV.ReleaseAndGetAddressOf());
-	device->CreateShaderResourceView(ambientTexture.Get(), 0, ambientSRV.ReleaseAndGetAddressOf());
-	device->CreateShaderResourceView(SSAOTexture.Get(), 0, SSAOSRV.ReleaseAndGetAddressOf());
-	device->CreateShaderResourceView(blurredTexture.Get(), 0, blurredSSAOSRV.ReleaseAndGetAddressOf());
-	device->CreateShaderResourceView(normalsTexture.Get(), 0, normalsSRV.ReleaseAndGetAddressOf());
-	device->CreateShaderResourceView(depthTexture.Get(), 0, depthSRV.ReleaseAndGetAddressOf());
+	D3D11_SHADER_RESOURCE_VIEW_DESC cacheSRVDesc = {};
+	cacheSRVDesc.Format = DXGI_FORMAT_R32_FLOAT;
+	cacheSRVDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
+	cacheSRVDesc.Texture2DArray.MipLevels = 1;
+	cacheSRVDesc.Texture2DArray.ArraySize = shadowCascadeSetting;
+	device->CreateShaderResourceView(shadowCacheTexture.Get(), &cacheSRVDesc, shadowCacheSRV.GetAddressOf());
+}
+
+// --------------------------------------------------------
+// (Re)creates the EVSM moment array, one full resolution
+// slice per cascade, and the single slice the horizontal
+// blur goes through.
+// 16-bit floats: half the memory of 32-bit, and the warp
+// exponents are kept low enough to fit.
+// --------------------------------------------------------
+void Game::CreateShadowMomentTextures()
+{
+	shadowMomentRTVs.clear();
+	shadowMomentSRV.Reset();
+	shadowMomentTempRTV.Reset();
+	shadowMomentTempSRV.Reset();
+	if (shadowFilter != SHADOW_FILTER_EVSM)
+		return;
+
+	D3D11_TEXTURE2D_DESC momentDesc = {};
+	momentDesc.Width = shadowMapSize;
+	momentDesc.Height = shadowMapSize;
+	momentDesc.ArraySize = shadowCascadeSetting;
+	momentDesc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
+	momentDesc.Format = DXGI_FORMAT_R16G16B16A16_FLOAT;
+	momentDesc.MipLevels = 1;
+	momentDesc.SampleDesc.Count = 1;
+	momentDesc.Usage = D3D11_USAGE_DEFAULT;
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> momentTexture;
+	device->CreateTexture2D(&momentDesc, 0, momentTexture.GetAddressOf());
+
+	shadowMomentRTVs.resize(shadowCascadeSetting);
+	for (int i = 0; i < shadowCascadeSetting; i++)
+	{
+		D3D11_RENDER_TARGET_VIEW_DESC momentRTVDesc = {};
+		momentRTVDesc.Format = momentDesc.Format;
+		momentRTVDesc.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2DARRAY;
+		momentRTVDesc.Texture2DArray.FirstArraySlice = i;
+		momentRTVDesc.Texture2DArray.ArraySize = 1;
+		device->CreateRenderTargetView(momentTexture.Get(), &momentRTVDesc, shadowMomentRTVs[i].GetAddressOf());
+	}
+	device->CreateShaderResourceView(momentTexture.Get(), 0, shadowMomentSRV.GetAddressOf());
+
+	momentDesc.ArraySize = 1;
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> tempTexture;
+	device->CreateTexture2D(&momentDesc, 0, tempTexture.GetAddressOf());
+	device->CreateRenderTargetView(tempTexture.Get(), 0, shadowMomentTempRTV.GetAddressOf());
+	device->CreateShaderResourceView(tempTexture.Get(), 0, shadowMomentTempSRV.GetAddressOf());
+}
+
+// --------------------------------------------------------
+// The EVSM prefilter: every cascade's depths are converted
+// to moments and blurred horizontally into the temporary
+// slice, then blurred vertically into the moment array
+// --------------------------------------------------------
+void Game::FilterShadowMoments()
+{
+	D3D11_VIEWPORT viewport = {};
+	viewport.Width = (float)shadowMapSize;
+	viewport.Height = (float)shadowMapSize;
+	viewport.MaxDepth = 1.0f;
+	context->RSSetViewports(1, &viewport);
+
+	ID3D11ShaderResourceView* nullSRV = 0;
+	for (unsigned int c = 0; c < shadowCascadeCount; c++)
+	{
+		context->OMSetRenderTargets(1, shadowMomentTempRTV.GetAddressOf(), 0);
+		stateTracker->SetPipelineState(evsmConvertPipeline);
+		evsmConvertPS->SetFloat2("exponents", XMFLOAT2(ShadowMoments::MaxExponent16, ShadowMoments::MaxExponent16));
+		evsmConvertPS->SetInt("blurRadius", evsmBlurRadius);
+		evsmConvertPS->SetInt("cascade", c);
+		evsmConvertPS->SetShaderResourceView("ShadowMap", shadowSRV.Get());
+		evsmConvertPS->CopyAllBufferData();
+		context->Draw(3, 0);
+
+		context->OMSetRenderTargets(1, shadowMomentRTVs[c].GetAddressOf(), 0);
+		stateTracker->SetPipelineState(evsmBlurPipeline);
+		evsmBlurPS->SetInt("blurRadius", evsmBlurRadius);
+		evsmBlurPS->SetShaderResourceView("Moments", shadowMomentTempSRV.Get());
+		evsmBlurPS->CopyAllBufferData();
+		context->Draw(3, 0);
+
+		// The temporary slice is the next cascade's target
+		context->PSSetShaderResources(0, 1, &nullSRV);
+	}
+}
+
+void Game::InvalidateShadowCache()
+{
+	for (unsigned int c = 0; c < ShadowCascades::MaxCascades; c++)
+		shadowCacheValid[c] = false;
+}
+
+// --------------------------------------------------------
+// One depth texture for every point and spot light shadow,
+// handed out in tiles by shadowAtlas
+// --------------------------------------------------------
+void Game::CreateShadowAtlas()
+{
+	shadowAtlas = std::make_shared<ShadowAtlas>(4096, 128, 1024);
+	unsigned int atlasSize = shadowAtlas->GetAllocator().GetAtlasSize();
+
+	D3D11_TEXTURE2D_DESC atlasDesc = {};
+	atlasDesc.Width = atlasSize;
+	atlasDesc.Height = atlasSize;
+	atlasDesc.ArraySize = 1;
+	atlasDesc.BindFlags = D3D11_BIND_DEPTH_STENCIL | D3D11_BIND_SHADER_RESOURCE;
+	atlasDesc.Format = DXGI_FORMAT_R32_TYPELESS;
+	atlasDesc.MipLevels = 1;
+	atlasDesc.SampleDesc.Count = 1;
+	atlasDesc.Usage = D3D11_USAGE_DEFAULT;
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> atlasTexture;
+	device->CreateTexture2D(&atlasDesc, 0, atlasTexture.GetAddressOf());
+
+	D3D11_DEPTH_STENCIL_VIEW_DESC atlasDSDesc = {};
+	atlasDSDesc.Format = DXGI_FORMAT_D32_FLOAT;
+	atlasDSDesc.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2D;
+	device->CreateDepthStencilView(atlasTexture.Get(), &atlasDSDesc, shadowAtlasDSV.GetAddressOf());
+
+	D3D11_SHADER_RESOURCE_VIEW_DESC atlasSRVDesc = {};
+	atlasSRVDesc.Format = DXGI_FORMAT_R32_FLOAT;
+	atlasSRVDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+	atlasSRVDesc.Texture2D.MipLevels = 1;
+	device->CreateShaderResourceView(atlasTexture.Get(), &atlasSRVDesc, shadowAtlasSRV.GetAddressOf());
+	context->ClearDepthStencilView(shadowAtlasDSV.Get(), D3D11_CLEAR_DEPTH, 1.0f, 0);
+
+	// Perspective views, so unlike the cascades these clip at the near plane
+	PipelineStateDesc localDesc;
+	localDesc.VertexShader = shadowVShader.get();
+	localDesc.Rasterizer.DepthBias = 100;
+	localDesc.Rasterizer.SlopeScaledDepthBias = 1.5f;
+	localShadowPipeline = pipelineStates->Get(localDesc);
+
+	// Clears one tile: a full screen triangle that the tile's
+	// viewport squeezes to depth 1
+	PipelineStateDesc clearDesc;
+	clearDesc.VertexShader = ppVS.get();
+	clearDesc.DepthStencil.DepthFunc = D3D11_COMPARISON_ALWAYS;
+	shadowTileClearPipeline = pipelineStates->Get(clearDesc);
+
+	localShadows.assign(localLights.size(), LocalShadow());
+	localShadowFrame = 0;
+	localShadowUpdates = 0;
+}
 
+// --------------------------------------------------------
+// Splits the active camera's view into cascades and fits a
+// light projection to each one
+// --------------------------------------------------------
+void Game::UpdateShadowCascades()
+{
+	Camera* camera = cameras[activeCam].get();
+	Transform* transform = camera->GetTransform();
+	XMFLOAT3 position = transform->GetPosition();
+	XMFLOAT3 forward = transform->GetForward();
+	XMFLOAT3 right = transform->GetRight();
+	XMFLOAT3 up = transform->GetUp();
+
+	CascadeCamera cascadeCamera;
+	cascadeCamera.Position = { position.x, position.y, position.z };
+	cascadeCamera.Forward = { forward.x, forward.y, forward.z };
+	cascadeCamera.Right = { right.x, right.y, right.z };
+	cascadeCamera.Up = { up.x, up.y, up.z };
+	cascadeCamera.TanHalfFovY = tanf(camera->GetFOV() * 0.5f);
+	cascadeCamera.AspectRatio = (float)windowWidth / windowHeight;
+
+	// Casters up to 20 units outside a cascade can still reach into it
+	CascadeVector lightDirection = { directionalLight1.Direction.x, directionalLight1.Direction.y, directionalLight1.Direction.z };
+	float farDepth = shadowDistance < camera->GetFarClip() ? shadowDistance : camera->GetFarClip();
+	shadowCascadeCount = ShadowCascades::Fit(cascadeCamera, camera->GetNearClip(), farDepth,
+		shadowCascadeSetting, shadowSplitLambda, lightDirection, shadowMapSize, shadowMapSize, 20.0f, shadowCascades);
+}
+
+// --------------------------------------------------------
+// SSAO's noise texture and sample kernel
+// --------------------------------------------------------
+void Game::CreateSSAOResources()
+{
 	// Create a random texture for SSAO
 	const int textureSize = 4;
 	const int totalPixels = textureSize * textureSize;
@@ -351,6 +714,35 @@ void Game::setupPP()
 
 }
 
+// --------------------------------------------------------
+// Temporal SSAO's two history textures at SSAO's size:
+// (AO, view depth, frames blended).  Whatever history there
+// was is dropped.
+// --------------------------------------------------------
+void Game::CreateSSAOHistory(uint32_t width, uint32_t height)
+{
+	D3D11_TEXTURE2D_DESC historyDesc = {};
+	historyDesc.Width = width;
+	historyDesc.Height = height;
+	historyDesc.ArraySize = 1;
+	historyDesc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
+	historyDesc.Format = DXGI_FORMAT_R16G16B16A16_FLOAT;
+	historyDesc.MipLevels = 1;
+	historyDesc.SampleDesc.Count = 1;
+	historyDesc.Usage = D3D11_USAGE_DEFAULT;
+	for (int i = 0; i < 2; i++)
+	{
+		Microsoft::WRL::ComPtr<ID3D11Texture2D> historyTexture;
+		device->CreateTexture2D(&historyDesc, 0, historyTexture.GetAddressOf());
+		device->CreateRenderTargetView(historyTexture.Get(), 0, ssaoHistoryRTVs[i].ReleaseAndGetAddressOf());
+		device->CreateShaderResourceView(historyTexture.Get(), 0, ssaoHistorySRVs[i].ReleaseAndGetAddressOf());
+	}
+
+	ssaoHistoryWidth = width;
+	ssaoHistoryHeight = height;
+	ssaoHistoryValid = false;
+}
+
 // --------------------------------------------------------
 // Loads shaders from compiled shader object (.cso) files
 // and also created the Input Layout that describes our 
@@ -362,6 +754,7 @@ void Game::setupPP()
 void Game::LoadShaders()
 {
 	vertexShader = std::make_shared<SimpleVertexShader>(device, context, FixPath(L"VertexShader.cso").c_str());
+	instancedVertexShader = std::make_shared<SimpleVertexShader>(device, context, FixPath(L"VertexShaderInstanced.cso").c_str());
 	pixelShader = std::make_shared<SimplePixelShader>(device, context, FixPath(L"PixelShader.cso").c_str());
 	skyVertexShader = std::make_shared<SimpleVertexShader>(device, context, FixPath(L"SkyVertexShader.cso").c_str());
 	skyPixelShader = std::make_shared<SimplePixelShader>(device, context, FixPath(L"SkyPixelShader.cso").c_str());
@@ -370,7 +763,67 @@ void Game::LoadShaders()
 	blurPPPS = std::make_shared<SimplePixelShader>(device, context, FixPath(L"PPPixelShader.cso").c_str());
 	ppssaoPS = std::make_shared<SimplePixelShader>(device, context, FixPath(L"SSAOPixelShader.cso").c_str());
 	ppssaoblurPS = std::make_shared<SimplePixelShader>(device, context, FixPath(L"BlurSSAOPShader.cso").c_str());
+	ssaoDownsamplePS = std::make_shared<SimplePixelShader>(device, context, FixPath(L"SSAODownsamplePS.cso").c_str());
+	ssaoUpsamplePS = std::make_shared<SimplePixelShader>(device, context, FixPath(L"SSAOUpsamplePS.cso").c_str());
+	ssaoTemporalPS = std::make_shared<SimplePixelShader>(device, context, FixPath(L"SSAOTemporalPS.cso").c_str());
+	gtaoPS = std::make_shared<SimplePixelShader>(device, context, FixPath(L"GTAOPixelShader.cso").c_str());
 	combinePS = std::make_shared<SimplePixelShader>(device, context, FixPath(L"CombineShader.cso").c_str());
+	evsmConvertPS = std::make_shared<SimplePixelShader>(device, context, FixPath(L"EVSMConvertPS.cso").c_str());
+	evsmBlurPS = std::make_shared<SimplePixelShader>(device, context, FixPath(L"EVSMBlurPS.cso").c_str());
+	shadowCacheCopyPS = std::make_shared<SimplePixelShader>(device, context, FixPath(L"ShadowCacheCopyPS.cso").c_str());
+
+	// Specialized variants of the scene pixel shader; any that
+	// didn't build fall back to one with more features
+	pixelShaderVariants.Set(SHADER_FEATURE_ALL, pixelShader);
+	for (unsigned int features = 0; features < SHADER_FEATURE_ALL; features++)
+	{
+		std::shared_ptr<SimplePixelShader> variant = std::make_shared<SimplePixelShader>(device, context,
+			FixPath(GetPermutationFileName(L"PixelShader", features)).c_str());
+		if (variant->IsShaderValid())
+		{
+			pixelShaderVariants.Set(features, variant);
+			resources.PixelShaders.Add(variant);
+		}
+	}
+
+	// Set once per shadow caster, so resolve it up front
+	shadowPerObjectBuffer = shadowVShader->GetBufferIndex("PerObject");
+
+#if defined(DEBUG) || defined(_DEBUG)
+	// BufferStructs.h is generated from the HLSL (Tools/GenerateShaderStructs.py),
+	// so a mismatch here means the shaders changed without regenerating it
+	struct { ISimpleShader* Shader; const char* Buffer; unsigned int Size; } layouts[] = {
+		{ vertexShader.get(), "PerFrame", sizeof(VertexShaderPerFrame) },
+		{ vertexShader.get(), "PerObject", sizeof(VertexShaderPerObject) },
+		{ instancedVertexShader.get(), "PerFrame", sizeof(VertexShaderInstancedPerFrame) },
+		{ pixelShader.get(), "PerFrame", sizeof(PixelShaderPerFrame) },
+		{ pixelShader.get(), "PerMaterial", sizeof(PixelShaderPerMaterial) },
+		{ shadowVShader.get(), "PerFrame", sizeof(ShadowVShaderPerFrame) },
+		{ shadowVShader.get(), "PerObject", sizeof(ShadowVShaderPerObject) },
+	};
+	for (auto& l : layouts)
+	{
+		unsigned int size = l.Shader->GetBufferSize(l.Shader->GetBufferIndex(l.Buffer));
+		if ((size + 15) / 16 * 16 != l.Size)
+			printf("BufferStructs.h is out of date: %s is %u bytes in HLSL, %u in C++\n", l.Buffer, size, l.Size);
+	}
+#endif
+
+	// These change every draw, so they go to the per-frame ring (or,
+	// without D3D11.1, let the driver rename them rather than stall)
+	vertexShader->SetBufferDynamic("PerObject", true);
+	vertexShader->SetBufferPerDraw("PerObject", true);
+	shadowVShader->SetBufferDynamic("PerObject", true);
+	shadowVShader->SetBufferPerDraw("PerObject", true);
+	constantRing = std::make_shared<ConstantBufferRing>(device, context, 4 * 1024 * 1024);
+
+	// The registry owns these too, so everything loaded lives in one place
+	std::shared_ptr<SimpleVertexShader> vertexShaders[] = { vertexShader, instancedVertexShader, skyVertexShader, shadowVShader, ppVS };
+	std::shared_ptr<SimplePixelShader> pixelShaders[] = { pixelShader, skyPixelShader, blurPPPS, ppssaoPS, ppssaoblurPS, ssaoDownsamplePS, ssaoUpsamplePS, ssaoTemporalPS, gtaoPS, combinePS, evsmConvertPS, evsmBlurPS };
+	for (auto& vs : vertexShaders)
+		resources.VertexShaders.Add(vs);
+	for (auto& ps : pixelShaders)
+		resources.PixelShaders.Add(ps);
 }
 
 
@@ -388,33 +841,6 @@ void Game::CreateGeometry()
 	XMFLOAT4 black = XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f);
 	XMFLOAT4 white = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
 	
-	//bronze
-	DirectX::CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"../../Assets/Textures/bronze_albedo.png").c_str(), 0, bronze_albedo.GetAddressOf());
-	DirectX::CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"../../Assets/Textures/bronze_metal.png").c_str(), 0, bronze_metal.GetAddressOf());
-	DirectX::CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"../../Assets/Textures/bronze_normals.png").c_str(), 0, bronze_normals.GetAddressOf());
-	DirectX::CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"../../Assets/Textures/bronze_roughness.png").c_str(), 0, bronze_roughness.GetAddressOf());
-
-	DirectX::CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"../../Assets/Textures/cobblestone_albedo.png").c_str(), 0, cobblestone_albedo.GetAddressOf());
-	DirectX::CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"../../Assets/Textures/cobblestone_metal.png").c_str(), 0, cobblestone_metal.GetAddressOf());
-	DirectX::CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"../../Assets/Textures/cobblestone_normals.png").c_str(), 0, cobblestone_normals.GetAddressOf());
-	DirectX::CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"../../Assets/Textures/cobblestone_roughness.png").c_str(), 0, cobblestone_roughness.GetAddressOf());
-
-	DirectX::CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"../../Assets/Textures/paint_albedo.png").c_str(), 0, paint_albedo.GetAddressOf());
-	DirectX::CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"../../Assets/Textures/paint_metal.png").c_str(), 0, paint_metal.GetAddressOf());
-	DirectX::CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"../../Assets/Textures/paint_normals.png").c_str(), 0, paint_normals.GetAddressOf());
-	DirectX::CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"../../Assets/Textures/paint_roughness.png").c_str(), 0, paint_roughness.GetAddressOf());
-
-	DirectX::CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"../../Assets/Textures/scratched_albedo.png").c_str(), 0, scratched_albedo.GetAddressOf());
-	DirectX::CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"../../Assets/Textures/scratched_metal.png").c_str(), 0, scratched_metal.GetAddressOf());
-	DirectX::CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"../../Assets/Textures/scratched_normals.png").c_str(), 0, scratched_normals.GetAddressOf());
-	DirectX::CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"../../Assets/Textures/scratched_roughness.png").c_str(), 0, scratched_roughness.GetAddressOf());
-
-	DirectX::CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"../../Assets/Textures/wood_albedo.png").c_str(), 0, wood_albedo.GetAddressOf());
-	DirectX::CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"../../Assets/Textures/wood_metal.png").c_str(), 0, wood_metal.GetAddressOf());
-	DirectX::CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"../../Assets/Textures/wood_normals.png").c_str(), 0, wood_normals.GetAddressOf());
-	DirectX::CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"../../Assets/Textures/wood_roughness.png").c_str(), 0, wood_roughness.GetAddressOf());
-
-
 	D3D11_SAMPLER_DESC sampDesc = {};
 	sampDesc.AddressU = D3D11_TEXTURE_ADDRESS_WRAP;
 	sampDesc.AddressV = D3D11_TEXTURE_ADDRESS_WRAP;
@@ -427,63 +853,113 @@ void Game::CreateGeometry()
 	
 	
 
-	bronzeMat = std::make_shared<Material>(XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), vertexShader, pixelShader, 0.15f);
-	cobblestoneMat = std::make_shared<Material>(XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), vertexShader, pixelShader, 0.15f);
-	paintMat = std::make_shared<Material>(XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), vertexShader, pixelShader, 0.15f);
-	scratchedMat = std::make_shared<Material>(XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), vertexShader, pixelShader, 0.15f);
-	woodMat = std::make_shared<Material>(XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), vertexShader, pixelShader, 0.15f);
-
-	bronzeMat->AddTextureSRV("Albedo", bronze_albedo);
-	bronzeMat->AddTextureSRV("NormalMap", bronze_normals);
-	bronzeMat->AddTextureSRV("RoughnessMap", bronze_roughness);
-	bronzeMat->AddTextureSRV("MetalnessMap", bronze_metal);
-	bronzeMat->AddSampler("BasicSampler", sampler);
-
-	cobblestoneMat->AddTextureSRV("Albedo", cobblestone_albedo);
-	cobblestoneMat->AddTextureSRV("NormalMap", cobblestone_normals);
-	cobblestoneMat->AddTextureSRV("RoughnessMap", cobblestone_roughness);
-	cobblestoneMat->AddTextureSRV("MetalnessMap", cobblestone_metal);
-	cobblestoneMat->AddSampler("BasicSampler", sampler);
-
-	paintMat->AddTextureSRV("Albedo", paint_albedo);
-	paintMat->AddTextureSRV("NormalMap", paint_normals);
-	paintMat->AddTextureSRV("RoughnessMap", paint_roughness);
-	paintMat->AddTextureSRV("MetalnessMap", paint_metal);
-	paintMat->AddSampler("BasicSampler", sampler);
-
-	scratchedMat->AddTextureSRV("Albedo", scratched_albedo);
-	scratchedMat->AddTextureSRV("NormalMap", scratched_normals);
-	scratchedMat->AddTextureSRV("RoughnessMap", scratched_roughness);
-	scratchedMat->AddTextureSRV("MetalnessMap", scratched_metal);
-	scratchedMat->AddSampler("BasicSampler", sampler);
-
-	woodMat->AddTextureSRV("Albedo", wood_albedo);
-	woodMat->AddTextureSRV("NormalMap", wood_normals);
-	woodMat->AddTextureSRV("RoughnessMap", wood_roughness);
-	woodMat->AddTextureSRV("MetalnessMap", wood_metal);
-	woodMat->AddSampler("BasicSampler", sampler);
-
-	meshes.push_back(std::make_shared<Mesh>(FixPath(L"../../Assets/Models/sphere.obj").c_str(), device, context));
-	meshes.push_back(std::make_shared<Mesh>(FixPath(L"../../Assets/Models/objStar.obj").c_str(), device, context));
-	meshes.push_back(std::make_shared<Mesh>(FixPath(L"../../Assets/Models/helix.obj").c_str(), device, context));
-	meshes.push_back(std::make_shared<Mesh>(FixPath(L"../../Assets/Models/quad.obj").c_str(), device, context));
-	meshes.push_back(std::make_shared<Mesh>(FixPath(L"../../Assets/Models/quad_double_sided.obj").c_str(), device, context));
-	meshes.push_back(std::make_shared<Mesh>(FixPath(L"../../Assets/Models/cube.obj").c_str(), device, context));
-	meshes.push_back(std::make_shared<Mesh>(FixPath(L"../../Assets/Models/torus.obj").c_str(), device, context));
-
-	gameEntities.push_back(std::make_shared<gameEntity>(meshes[4], woodMat)); //floor
-	gameEntities.push_back(std::make_shared<gameEntity>(meshes[2], scratchedMat)); 
-	gameEntities.push_back(std::make_shared<gameEntity>(meshes[6], paintMat)); 
-	gameEntities.push_back(std::make_shared<gameEntity>(meshes[0], cobblestoneMat)); 
-	gameEntities.push_back(std::make_shared<gameEntity>(meshes[1], bronzeMat)); 
-
-	gameEntities[0]->GetTransform().SetPosition(0.0f, -1.5f, 0.0f);
-	gameEntities[0]->GetTransform().SetScale(10.0f, 1.0f, 10.0f);
-	gameEntities[1]->GetTransform().SetPosition(-2.0f, 0.0f, 0.0f);
-	gameEntities[2]->GetTransform().SetPosition(6.0f, 0.0f, 0.0f);
-	gameEntities[4]->GetTransform().SetPosition(2.0f, 0.0f, 0.0f);
-	gameEntities[3]->GetTransform().SetPosition(-6.0f, 0.0f, 0.0f); //cube
+	// Every PBR material uses the same four maps, named after the material.
+	// Each kind of map is packed into one texture array with a slice per
+	// material, so all the materials bind the same three textures and
+	// only differ by their constants.
+	const wchar_t* materialNames[] = { L"bronze", L"cobblestone", L"paint", L"scratched", L"wood" };
+	MaterialHandle* materialHandles[] = { &bronzeMat, &cobblestoneMat, &paintMat, &scratchedMat, &woodMat };
+	TextureArrayPacker albedoPacker(0, true);
+	TextureArrayPacker normalPacker;
+	TextureArrayPacker roughMetalPacker;
+	for (int i = 0; i < 5; i++)
+	{
+		std::wstring path = std::wstring(L"../../Assets/Textures/") + materialNames[i];
+		PackedImage albedo = LoadImagePixels(path + L"_albedo.png");
+		PackedImage normals = LoadImagePixels(path + L"_normals.png");
+		PackedImage roughness = LoadImagePixels(path + L"_roughness.png");
+		PackedImage metalness = LoadImagePixels(path + L"_metal.png");
+
+		// Missing maps become neutral values (white, flat, rough, non-metal)
+		if (albedo.IsEmpty()) albedo = PackedImage::Solid(1, 1, 255, 255, 255, 255);
+		if (normals.IsEmpty()) normals = PackedImage::Solid(1, 1, 128, 128, 255, 255);
+		if (roughness.IsEmpty()) roughness = PackedImage::Solid(1, 1, 255, 255, 255, 255);
+		if (metalness.IsEmpty()) metalness = PackedImage::Solid(1, 1, 0, 0, 0, 255);
+
+		albedoPacker.AddSlice(albedo);
+		normalPacker.AddSlice(normals);
+		roughMetalPacker.AddSlice(TextureArrayPacker::MergeChannels(roughness, metalness));
+	}
+	albedoPacker.Pack();
+	normalPacker.Pack();
+	roughMetalPacker.Pack();
+	TextureHandle albedoArray = CreateTextureArray(albedoPacker);
+	TextureHandle normalArray = CreateTextureArray(normalPacker);
+	TextureHandle roughMetalArray = CreateTextureArray(roughMetalPacker);
+
+	for (int i = 0; i < 5; i++)
+	{
+		std::shared_ptr<Material> mat = std::make_shared<Material>(XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), vertexShader, pixelShader, 0.15f);
+		mat->AddTextureSRV("AlbedoArray", resources.Textures.GetOwner(albedoArray));
+		mat->AddTextureSRV("NormalArray", resources.Textures.GetOwner(normalArray));
+		mat->AddTextureSRV("RoughMetalArray", resources.Textures.GetOwner(roughMetalArray));
+		mat->AddSampler("BasicSampler", sampler);
+		mat->SetTextureSlice(i);
+		*materialHandles[i] = resources.Materials.Add(mat);
+	}
+
+	// All of the scene's meshes share one vertex/index buffer pair
+	staticGeometry = std::make_shared<GeometryArena>(device, context, 65536, 196608);
+
+	meshes.push_back(resources.Meshes.Add(std::make_shared<Mesh>(FixPath(L"../../Assets/Models/sphere.obj").c_str(), device, context, staticGeometry.get())));
+	meshes.push_back(resources.Meshes.Add(std::make_shared<Mesh>(FixPath(L"../../Assets/Models/objStar.obj").c_str(), device, context, staticGeometry.get())));
+	meshes.push_back(resources.Meshes.Add(std::make_shared<Mesh>(FixPath(L"../../Assets/Models/helix.obj").c_str(), device, context, staticGeometry.get())));
+	meshes.push_back(resources.Meshes.Add(std::make_shared<Mesh>(FixPath(L"../../Assets/Models/quad.obj").c_str(), device, context, staticGeometry.get())));
+	meshes.push_back(resources.Meshes.Add(std::make_shared<Mesh>(FixPath(L"../../Assets/Models/quad_double_sided.obj").c_str(), device, context, staticGeometry.get())));
+	meshes.push_back(resources.Meshes.Add(std::make_shared<Mesh>(FixPath(L"../../Assets/Models/cube.obj").c_str(), device, context, staticGeometry.get())));
+	meshes.push_back(resources.Meshes.Add(std::make_shared<Mesh>(FixPath(L"../../Assets/Models/torus.obj").c_str(), device, context, staticGeometry.get())));
+
+	gameEntities.push_back(gameEntity(entityStore, meshes[4], woodMat)); //floor
+	gameEntities.push_back(gameEntity(entityStore, meshes[2], scratchedMat)); 
+	gameEntities.push_back(gameEntity(entityStore, meshes[6], paintMat)); 
+	gameEntities.push_back(gameEntity(entityStore, meshes[0], cobblestoneMat)); 
+	gameEntities.push_back(gameEntity(entityStore, meshes[1], bronzeMat)); 
+
+	gameEntities[0].GetTransform().SetPosition(0.0f, -1.5f, 0.0f);
+	gameEntities[0].GetTransform().SetScale(10.0f, 1.0f, 10.0f);
+	gameEntities[1].GetTransform().SetPosition(-2.0f, 0.0f, 0.0f);
+	gameEntities[2].GetTransform().SetPosition(6.0f, 0.0f, 0.0f);
+	gameEntities[4].GetTransform().SetPosition(2.0f, 0.0f, 0.0f);
+	gameEntities[3].GetTransform().SetPosition(-6.0f, 0.0f, 0.0f); //cube
+
+	// These two spin in place every frame
+	entityStore.SetAngularVelocity(gameEntities[3].GetID(), XMFLOAT3(0.0f, 0.5f, 0.0f));
+	entityStore.SetAngularVelocity(gameEntities[1].GetID(), XMFLOAT3(0.0f, 0.5f, 0.0f));
+
+}
+
+// --------------------------------------------------------
+// Fills a grid above the floor with small spinning entities,
+// cycling through the loaded meshes and materials, so the
+// entity systems and draw path can be timed at scale
+// --------------------------------------------------------
+void Game::SpawnStressEntities(unsigned int count)
+{
+	MeshHandle stressMeshes[] = { meshes[0], meshes[1], meshes[2], meshes[5], meshes[6] };
+	MaterialHandle stressMaterials[] = { bronzeMat, cobblestoneMat, paintMat, scratchedMat, woodMat };
+
+	unsigned int side = (unsigned int)ceilf(sqrtf((float)count));
+	float spacing = 1.5f;
+	float start = -0.5f * spacing * (float)(side - 1);
 
+	entityStore.Reserve(entityStore.Size() + count);
+	stressEntities.reserve(stressEntities.size() + count);
+	for (unsigned int i = 0; i < count; i++)
+	{
+		EntityID id = entityStore.Create(stressMeshes[i % 5], stressMaterials[(i / 5) % 5]);
+		Transform& transform = entityStore.GetTransform(id);
+		transform.SetPosition(start + spacing * (float)(i % side), 2.0f, start + spacing * (float)(i / side));
+		transform.SetScale(0.5f, 0.5f, 0.5f);
+		entityStore.SetAngularVelocity(id, XMFLOAT3(0.0f, 0.5f + 0.1f * (float)(i % 7), 0.0f));
+		stressEntities.push_back(id);
+	}
+}
+
+void Game::ClearStressEntities()
+{
+	for (EntityID id : stressEntities)
+		entityStore.Destroy(id);
+	stressEntities.clear();
 }
 
 
@@ -499,23 +975,8 @@ void Game::OnResize()
 	// Handle base-level DX resize stuff
 	DXCore::OnResize();
 
-	ppRTV.Reset();
-	ppSRV.Reset();
-	colorRTV.Reset();
-	colorSRV.Reset();	
-	ambientRTV.Reset();
-	ambientSRV.Reset();	
-	normalsRTV.Reset();
-	normalsSRV.Reset();
-	depthRTV.Reset();
-	depthSRV.Reset();
-	SSAORTV.Reset();
-	SSAOSRV.Reset();	
-	blurredSSAORTV.Reset();
-	blurredSSAOSRV.Reset();
-	randomTextureSRV.Reset();
-
-	setupPP();
+	// The render graph asks the pool for textures of the new
+	// size the next time it's declared
 }
 
 // --------------------------------------------------------
@@ -539,14 +1000,20 @@ void Game::Update(float deltaTime, float totalTime)
 	input.SetKeyboardCapture(io.WantCaptureKeyboard);
 	input.SetMouseCapture(io.WantCaptureMouse);
 
-	
-	gameEntities[3]->GetTransform().Rotate(0.0f, 0.5f * deltaTime,0.0f); 
-	gameEntities[1]->GetTransform().Rotate(0.0f, 0.5f * deltaTime,0.0f); 
-	
+	// Entity systems - linear sweeps over the component arrays
+	auto updateStart = std::chrono::high_resolution_clock::now();
+	entityStore.UpdateRotations(deltaTime);
+	entityStore.UpdateTransforms();
+	std::chrono::duration<float, std::milli> updateTime = std::chrono::high_resolution_clock::now() - updateStart;
+	entityUpdateMilliseconds = updateTime.count();
 	
 
 	cameras[activeCam]->Update(deltaTime);
 
+	// The second point light circles the scene, so its shadow keeps changing
+	if (animateLocalLights)
+		localLights[1].Position = XMFLOAT3(4.0f * cosf(totalTime * 0.5f), 1.5f, 4.0f * sinf(totalTime * 0.5f));
+
 	ImGui::ShowDemoWindow();
 
 	ImGui::Begin("Homework Window");
@@ -563,19 +1030,27 @@ void Game::Update(float deltaTime, float totalTime)
 		{
 			if (ImGui::TreeNode((void*)(intptr_t)i, "Entity %d", i))
 			{
-				DirectX::XMFLOAT3 pos = gameEntities[i]->GetTransform().GetPosition();
-				DirectX::XMFLOAT3 rot = gameEntities[i]->GetTransform().GetPitchYawRoll();
-				DirectX::XMFLOAT3 sca = gameEntities[i]->GetTransform().GetScale();
+				DirectX::XMFLOAT3 pos = gameEntities[i].GetTransform().GetPosition();
+				DirectX::XMFLOAT3 rot = gameEntities[i].GetTransform().GetPitchYawRoll();
+				DirectX::XMFLOAT3 sca = gameEntities[i].GetTransform().GetScale();
 				if (ImGui::DragFloat3("Position: ", &pos.x))
-					gameEntities[i]->GetTransform().SetPosition(pos);
+					gameEntities[i].GetTransform().SetPosition(pos);
 				if (ImGui::DragFloat3("Rotation: ", &rot.x))
-					gameEntities[i]->GetTransform().SetRotation(rot);
+					gameEntities[i].GetTransform().SetRotation(rot);
 				if (ImGui::DragFloat3("Scale: ", &sca.x))
-					gameEntities[i]->GetTransform().SetScale(sca);
+					gameEntities[i].GetTransform().SetScale(sca);
 				
 				ImGui::TreePop();
 			}
 		}
+		ImGui::Text("Entities: %u", (unsigned int)entityStore.Size());
+		ImGui::Text("Update systems: %.3f ms", entityUpdateMilliseconds);
+		ImGui::InputInt("Stress count", &stressSpawnCount, 1000, 10000);
+		if (ImGui::Button("Spawn"))
+			SpawnStressEntities(stressSpawnCount > 0 ? (unsigned int)stressSpawnCount : 0);
+		ImGui::SameLine();
+		if (ImGui::Button("Clear spawned"))
+			ClearStressEntities();
 		ImGui::TreePop();
 	}
 	if (ImGui::TreeNode("Cameras"))
@@ -596,32 +1071,192 @@ void Game::Update(float deltaTime, float totalTime)
 			ImGui::ColorEdit3("color", &directionalLight1.Color.x);
 			ImGui::TreePop();
 		}
+		for (unsigned int i = 0; i < localLights.size(); i++)
+		{
+			if (ImGui::TreeNode((void*)(intptr_t)i, localLights[i].Type == LIGHT_TYPE_POINT ? "Point Light %u" : "Spot Light %u", i))
+			{
+				ImGui::ColorEdit3("color", &localLights[i].Color.x);
+				ImGui::DragFloat3("position", &localLights[i].Position.x, 0.1f);
+				if (localLights[i].Type == LIGHT_TYPE_SPOT)
+					ImGui::DragFloat3("direction", &localLights[i].Direction.x, 0.05f);
+				ImGui::SliderFloat("intensity", &localLights[i].Intensity, 0.0f, 5.0f);
+				ImGui::SliderFloat("range", &localLights[i].Range, 1.0f, 30.0f);
+				ImGui::TreePop();
+			}
+		}
+		ImGui::Checkbox("Animate point light 1", &animateLocalLights);
+		ImGui::TreePop();
+	}
+	if (ImGui::TreeNode("Materials"))
+	{
+		// Each combination of features is its own pixel shader variant
+		const char* materialNames[] = { "Bronze", "Cobblestone", "Paint", "Scratched", "Wood" };
+		MaterialHandle materialHandles[] = { bronzeMat, cobblestoneMat, paintMat, scratchedMat, woodMat };
+		const char* featureNames[SHADER_FEATURE_COUNT] = { "Shadows", "Normal map", "Roughness & metalness maps", "SSAO" };
+		for (int i = 0; i < 5; i++)
+		{
+			if (ImGui::TreeNode(materialNames[i]))
+			{
+				Material* mat = resources.Materials.Get(materialHandles[i]);
+				unsigned int features = mat->GetShaderFeatures();
+				for (unsigned int f = 0; f < SHADER_FEATURE_COUNT; f++)
+					ImGui::CheckboxFlags(featureNames[f], &features, 1u << f);
+				if (features != mat->GetShaderFeatures())
+					mat->SetShaderFeatures(features, pixelShaderVariants);
+				ImGui::TreePop();
+			}
+		}
+		ImGui::Text("Pixel shader variants: %u", pixelShaderVariants.GetLoadedCount());
+		ImGui::TreePop();
+	}
+	if (ImGui::TreeNode("Shadows"))
+	{
+		// Each 8192 cascade is 256 MB of depth, 400 MB more cached and
+		// 512 MB more as EVSM moments, so fewer cascades, no cache or
+		// PCF is what makes the top size fit
+		const char* sizeNames[] = { "512", "1024", "2048", "4096", "8192" };
+		int sizeIndex = 0;
+		while ((512u << sizeIndex) < shadowMapSize && (512u << sizeIndex) < MaxShadowMapSize)
+			sizeIndex++;
+		if (ImGui::Combo("Resolution", &sizeIndex, sizeNames, IM_ARRAYSIZE(sizeNames)))
+		{
+			shadowMapSize = 512u << sizeIndex;
+			CreateShadowTextures();
+		}
+		if (ImGui::Checkbox("Cache static casters", &useShadowCache))
+			CreateShadowCacheTextures();
+		const char* filterNames[SHADOW_FILTER_COUNT] = { "PCF (1 tap)", "Wide PCF", "EVSM" };
+		if (ImGui::Combo("Filter", &shadowFilter, filterNames, SHADOW_FILTER_COUNT))
+			CreateShadowMomentTextures();
+		if (shadowFilter == SHADOW_FILTER_WIDE_PCF)
+			ImGui::SliderInt("PCF radius", &shadowPCFRadius, 1, 4);
+		if (shadowFilter == SHADOW_FILTER_EVSM)
+		{
+			ImGui::SliderInt("Prefilter radius", &evsmBlurRadius, 0, 8);
+			ImGui::SliderFloat("Light bleed reduction", &evsmLightBleedReduction, 0.0f, 0.9f);
+		}
+		ImGui::Text("GPU: shadow maps %.3f ms, EVSM prefilter %.3f ms, scene %.3f ms",
+			gpuTimer->GetMilliseconds(GPU_SPAN_SHADOWS),
+			gpuTimer->GetMilliseconds(GPU_SPAN_SHADOW_FILTER),
+			gpuTimer->GetMilliseconds(GPU_SPAN_SCENE));
+		if (ImGui::SliderInt("Cascades", &shadowCascadeSetting, 1, ShadowCascades::MaxCascades))
+			CreateShadowTextures();
+		ImGui::SliderFloat("Split blend (uniform - log)", &shadowSplitLambda, 0.0f, 1.0f);
+		ImGui::SliderFloat("Shadow distance", &shadowDistance, 5.0f, cameras[activeCam]->GetFarClip());
+		for (unsigned int c = 0; c < shadowCascadeCount; c++)
+			ImGui::Text("Cascade %u: %.2f - %.2f (%.2f units wide)", c, shadowCascades[c].NearDepth, shadowCascades[c].FarDepth, 2.0f * shadowCascades[c].Radius);
+		ImGui::Text("Shadow draws: %u", renderStats.ShadowDrawCalls);
+		ImGui::Text("Cached cascades rebuilt: %u", renderStats.ShadowCacheRebuilds);
+		ImGui::SliderInt("Light updates per frame", &localShadowBudget, 0, (int)localLights.size());
+		const ShadowAtlasAllocator& atlasAllocator = shadowAtlas->GetAllocator();
+		float atlasArea = (float)atlasAllocator.GetAtlasSize() * atlasAllocator.GetAtlasSize();
+		ImGui::Text("Atlas: %u tiles, %.1f%% used", (unsigned int)shadowAtlas->GetTileCount(), 100.0f * atlasAllocator.GetUsedArea() / atlasArea);
+		ImGui::Text("Lights re-rendered: %u, tiles evicted: %u", localShadowUpdates, shadowAtlas->GetEvictions());
+		for (unsigned int i = 0; i < localShadows.size(); i++)
+		{
+			if (localShadows[i].Visible)
+				ImGui::Text("Light %u: %u x %u tiles%s", i, localShadows[i].ViewCount, localShadows[i].Tiles[0].Size, localShadows[i].Ready ? "" : " (waiting)");
+		}
+		ImGui::TreePop();
+	}
+	if (ImGui::TreeNode("Render Graph"))
+	{
+		ImGui::Text("Passes: %u, culled: %u", (unsigned int)renderGraph.GetPassCount(), renderGraph.GetCulledPassCount());
+		ImGui::Text("Transient textures: %u in %u allocations", renderGraph.GetTransientCount(), renderGraph.GetTransientPhysicalCount());
+		const RenderTargetPool::Stats& poolStats = renderTargetPool->GetStats();
+		ImGui::Text("Target pool: %u textures, %.1f MB", (unsigned int)renderTargetPool->GetCount(), renderTargetPool->GetBytes() / (1024.0f * 1024.0f));
+		ImGui::Text("Textures created: %u, reused: %u, released: %u", poolStats.Allocations, poolStats.Reuses, poolStats.Releases);
+		ImGui::Text("Window resizes: %u of %u applied", resizesApplied, resizeRequests);
+		for (RenderGraphPass p = 0; p < renderGraph.GetPassCount(); p++)
+			ImGui::Text("%s%s", renderGraph.GetPassName(p).c_str(), renderGraph.IsCulled(p) ? " (culled)" : "");
 		ImGui::TreePop();
 	}
 	if (ImGui::TreeNode("SRVS"))
 	{
-		ImGui::Text("Shadow");
-		ImGui::Image(shadowSRV.Get(), ImVec2(512, 512));
-		ImGui::Text("Color");
-		ImGui::Image(colorSRV.Get(), ImVec2(512, 512));
-		ImGui::Text("Ambient");
-		ImGui::Image(ambientSRV.Get(), ImVec2(512, 512));
-		ImGui::Text("Normals");
-		ImGui::Image(normalsSRV.Get(), ImVec2(512, 512));
-		ImGui::Text("Depth");
-		ImGui::Image(depthSRV.Get(), ImVec2(512, 512));
-		ImGui::Text("SSAO");
-		ImGui::Image(SSAOSRV.Get(), ImVec2(512, 512));
-		ImGui::Text("Blurred SSAO");
-		ImGui::Image(blurredSSAOSRV.Get(), ImVec2(512, 512));
-		ImGui::Text("Post Process Blur");
-		ImGui::Image(ppSRV.Get(), ImVec2(512, 512));
+		// Last frame's transients.  Those sharing a texture all show
+		// whichever of them was written last.
+		for (RenderGraphResource r = 0; r < renderGraph.GetResourceCount(); r++)
+		{
+			ID3D11ShaderResourceView* srv = graphExecutor->GetShaderResourceView(r);
+			if (renderGraph.IsImported(r) || !srv)
+				continue;
+			ImGui::Text("%s (texture %u)", renderGraph.GetName(r).c_str(), renderGraph.GetPhysical(r));
+			ImGui::Image(srv, ImVec2(512, 512));
+		}
+		ImGui::TreePop();
+	}
+	if (ImGui::TreeNode("Render Stats"))
+	{
+		ImGui::Text("Draw calls: %u", renderStats.DrawCalls);
+		ImGui::Text("State changes: %u (unsorted: %u)", renderStats.StateChanges, renderStats.NaiveStateChanges);
+		ImGui::Text("Shader binds: %u", renderStats.ShaderBinds);
+		ImGui::Text("Pipeline states: %u, %u state calls (%u redundant skipped)", (unsigned int)pipelineStates->Size(),
+			stateTracker->GetCallsIssued(), stateTracker->GetCallsSkipped());
+		ImGui::Text("Material binds: %u (%u binding tables)", renderStats.MaterialBinds, renderStats.BindingTableBinds);
+		ImGui::Text("Mesh binds: %u", renderStats.MeshBinds);
+		ImGui::Checkbox("Instancing", &useInstancing);
+		ImGui::Text("Instanced batches: %u (%u instances)", renderStats.InstancedBatches, renderStats.InstancesDrawn);
+		ImGui::Text("Culled: %u", renderStats.CulledDraws);
+		ImGui::Text("Scene submit: %.3f ms (%.2f us per draw)", renderStats.SubmitMilliseconds,
+			renderStats.DrawCalls > 0 ? 1000.0f * renderStats.SubmitMilliseconds / renderStats.DrawCalls : 0.0f);
+		ImGui::Checkbox("Shader variable handles", &Material::UseShaderHandles);
+		ImGui::Text("Constant buffer uploads: %u (%u skipped, %u bytes)",
+			ISimpleShader::UploadStats.Uploads, ISimpleShader::UploadStats.UploadsSkipped, ISimpleShader::UploadStats.BytesUploaded);
+		if (constantRing->IsSupported())
+		{
+			const FrameRingAllocator& ring = constantRing->GetAllocator();
+			ImGui::Checkbox("Per-draw constant ring", &useConstantRing);
+			ImGui::Text("Ring: %u uploads, %u KB this frame, %u / %u KB in use, %u frames in flight",
+				ISimpleShader::UploadStats.RingUploads, ring.GetFrameSize() / 1024,
+				ring.GetUsedSize() / 1024, ring.GetCapacity() / 1024, (unsigned int)ring.GetFramesInFlight());
+		}
+		else
+		{
+			ImGui::Text("Per-draw constant ring: needs D3D11.1 offset binding");
+		}
+		ImGui::Text("Shadow submit: %.3f ms", renderStats.ShadowMilliseconds);
+		const ArenaAllocator& arenaVerts = staticGeometry->GetVertexAllocator();
+		ImGui::Text("Geometry arena: %u / %u vertices, %u free blocks",
+			arenaVerts.GetUsedSize(), arenaVerts.GetCapacity(), (unsigned int)arenaVerts.GetFreeBlockCount());
+		if (ImGui::Button("Defragment geometry"))
+			staticGeometry->Defragment();
+		ImGui::Text("Resources: %u meshes, %u materials, %u textures",
+			(unsigned int)resources.Meshes.Size(), (unsigned int)resources.Materials.Size(), (unsigned int)resources.Textures.Size());
+		ImGui::Text("Shader setup: %.2f ms (%u reflections cached, %u reflected)", shaderLoadMilliseconds,
+			ISimpleShader::ReflectionCacheHits, ISimpleShader::ReflectionCacheMisses);
 		ImGui::TreePop();
 	}
 	if (ImGui::TreeNode("Post Processing"))
 	{
-		ImGui::SliderInt("Blur ", &blur, 0, 10);
+		ImGui::SliderInt("Blur ", &blur, 0, GaussianBlur::MaxRadius);
+		ImGui::Checkbox("Blur pyramid", &useBlurPyramid);
 		ImGui::SliderFloat("SSAO Radius", &ssaoRadius, 0.0f, 1.0f);
+
+		// The timer is smoothed, so each setting's time settles a few
+		// frames after switching to it and is kept once left
+		const char* methodNames[AO_METHOD_COUNT] = { "Hemisphere kernel", "GTAO" };
+		const char* scaleNames[] = { "Full", "Half", "Quarter" };
+		int scaleIndex = ssaoScale == 4 ? 2 : ssaoScale - 1;
+		ssaoMilliseconds[aoMethod][scaleIndex] = gpuTimer->GetMilliseconds(GPU_SPAN_SSAO);
+		ImGui::Combo("AO method", &aoMethod, methodNames, AO_METHOD_COUNT);
+		if (ImGui::Combo("SSAO resolution", &scaleIndex, scaleNames, IM_ARRAYSIZE(scaleNames)))
+			ssaoScale = 1 << scaleIndex;
+		ImGui::Checkbox("Temporal SSAO", &ssaoTemporal);
+		if (aoMethod == AO_METHOD_GTAO)
+		{
+			ImGui::SliderInt("GTAO slices", &gtaoSlices, 1, GTAO::MaxSlices);
+			ImGui::SliderInt("GTAO steps per side", &gtaoSteps, 1, GTAO::MaxSteps);
+			ImGui::Text("Depth fetches per pixel: %d", gtaoSlices * gtaoSteps * 2);
+		}
+		else
+			ImGui::Text("SSAO samples per frame: %d", ssaoTemporal ? TemporalAO::FrameSamples : ssaoSamples);
+		if (ssaoScale > 1 || ssaoTemporal)
+			ImGui::SliderFloat("SSAO depth tolerance", &ssaoDepthTolerance, 0.005f, 0.5f, "%.3f");
+		for (int method = 0; method < AO_METHOD_COUNT; method++)
+		{
+			ImGui::Text("%s: full %.3f ms, half %.3f ms, quarter %.3f ms", methodNames[method],
+				ssaoMilliseconds[method][0], ssaoMilliseconds[method][1], ssaoMilliseconds[method][2]);
+		}
 		ImGui::TreePop();
 	}
 
@@ -639,6 +1274,331 @@ void Game::Update(float deltaTime, float totalTime)
 // --------------------------------------------------------
 // Clear the screen, redraw everything, present to the user
 // --------------------------------------------------------
+// --------------------------------------------------------
+// Declares this frame's passes in the order they run.  The
+// final blur writes the output only when it has a radius;
+// otherwise combine's result is the output and the graph
+// culls the blur.
+// --------------------------------------------------------
+void Game::BuildRenderGraph()
+{
+	renderGraph.Reset();
+
+	RenderGraphTextureDesc colorDesc = { (uint32_t)windowWidth, (uint32_t)windowHeight, DXGI_FORMAT_R8G8B8A8_UNORM };
+	RenderGraphTextureDesc depthDesc = { (uint32_t)windowWidth, (uint32_t)windowHeight, DXGI_FORMAT_R32_FLOAT };
+	int scale = ssaoScale;
+	RenderGraphTextureDesc ssaoDesc = { SSAOResample::LowSize(colorDesc.Width, scale), SSAOResample::LowSize(colorDesc.Height, scale), colorDesc.Format };
+	RenderGraphTextureDesc ssaoDepthDesc = { ssaoDesc.Width, ssaoDesc.Height, depthDesc.Format };
+
+	RenderGraphResource shadowMap = renderGraph.ImportTexture("Shadow map");
+	RenderGraphResource shadowAtlasMap = renderGraph.ImportTexture("Shadow atlas");
+	RenderGraphResource shadowMoments = renderGraph.ImportTexture("Shadow moments");
+	RenderGraphResource depthBuffer = renderGraph.ImportTexture("Depth buffer");
+	RenderGraphResource color = renderGraph.CreateTexture("Color", colorDesc);
+	RenderGraphResource ambient = renderGraph.CreateTexture("Ambient", colorDesc);
+	RenderGraphResource normals = renderGraph.CreateTexture("Normals", colorDesc);
+	RenderGraphResource depths = renderGraph.CreateTexture("Depth", depthDesc);
+	RenderGraphResource ssaoNormals = scale > 1 ? renderGraph.CreateTexture("SSAO normals", ssaoDesc) : normals;
+	RenderGraphResource ssaoDepths = scale > 1 ? renderGraph.CreateTexture("SSAO depth", ssaoDepthDesc) : depths;
+	RenderGraphResource ssao = renderGraph.CreateTexture("SSAO", ssaoDesc);
+	RenderGraphResource blurredSSAO = renderGraph.CreateTexture("Blurred SSAO", ssaoDesc);
+	RenderGraphResource fullSSAO = scale > 1 ? renderGraph.CreateTexture("Upsampled SSAO", colorDesc) : blurredSSAO;
+	RenderGraphResource ssaoHistory = RenderGraph::NoResource;
+	RenderGraphResource ssaoNewHistory = RenderGraph::NoResource;
+	if (ssaoTemporal)
+	{
+		if (ssaoHistoryWidth != ssaoDesc.Width || ssaoHistoryHeight != ssaoDesc.Height)
+			CreateSSAOHistory(ssaoDesc.Width, ssaoDesc.Height);
+		ssaoHistory = renderGraph.ImportTexture("SSAO history");
+		ssaoNewHistory = renderGraph.ImportTexture("SSAO new history");
+	}
+	else
+		ssaoHistoryValid = false;
+	RenderGraphResource combined = renderGraph.CreateTexture("Combined", colorDesc);
+	RenderGraphResource blurred = renderGraph.CreateTexture("Post Process Blur", colorDesc);
+
+	graphExecutor->SetImported(shadowMap, 0, 0, shadowSRV.Get());
+	graphExecutor->SetImported(shadowAtlasMap, 0, 0, shadowAtlasSRV.Get());
+	graphExecutor->SetImported(shadowMoments, 0, 0, shadowMomentSRV.Get());
+	graphExecutor->SetImported(depthBuffer, 0, depthBufferDSV.Get(), 0);
+	if (ssaoTemporal)
+	{
+		graphExecutor->SetImported(ssaoHistory, 0, 0, ssaoHistorySRVs[ssaoHistoryIndex].Get());
+		graphExecutor->SetImported(ssaoNewHistory, ssaoHistoryRTVs[1 - ssaoHistoryIndex].Get(), 0, ssaoHistorySRVs[1 - ssaoHistoryIndex].Get());
+	}
+	graphExecutor->SetOutput(backBufferRTV.Get());
+
+	RenderGraphPass pass = renderGraph.AddPass("Shadows", [this]()
+	{
+		gpuTimer->Begin(GPU_SPAN_SHADOWS);
+		RenderShadowMap();
+		gpuTimer->End(GPU_SPAN_SHADOWS);
+	});
+	renderGraph.Write(pass, shadowMap, RENDER_GRAPH_WRITE);
+	renderGraph.Write(pass, shadowAtlasMap, RENDER_GRAPH_WRITE);
+	renderGraph.Write(pass, shadowMoments, RENDER_GRAPH_WRITE);
+
+	pass = renderGraph.AddPass("G-buffer", [this, shadowMap, shadowAtlasMap, shadowMoments]()
+	{
+		graphExecutor->BindShaderResource(pixelShader.get(), "ShadowMap", shadowMap);
+		graphExecutor->BindShaderResource(pixelShader.get(), "ShadowAtlas", shadowAtlasMap);
+		graphExecutor->BindShaderResource(pixelShader.get(), "ShadowMoments", shadowMoments);
+		gpuTimer->Begin(GPU_SPAN_SCENE);
+		DrawScene();
+		gpuTimer->End(GPU_SPAN_SCENE);
+
+		skyBox->Draw(*stateTracker, cameras[activeCam]);
+	});
+	renderGraph.Read(pass, shadowMap);
+	renderGraph.Read(pass, shadowAtlasMap);
+	renderGraph.Read(pass, shadowMoments);
+	renderGraph.Write(pass, color, RENDER_GRAPH_RENDER_TARGET, true);
+	renderGraph.Write(pass, ambient, RENDER_GRAPH_RENDER_TARGET, true);
+	renderGraph.Write(pass, normals, RENDER_GRAPH_RENDER_TARGET, true);
+	renderGraph.Write(pass, depths, RENDER_GRAPH_RENDER_TARGET, true);
+	renderGraph.Write(pass, depthBuffer, RENDER_GRAPH_DEPTH_STENCIL);
+
+	// SSAO at 1 / scale of the window's size, from a shrunk
+	// copy of the G-buffer, brought back up after its blur
+	if (scale > 1)
+	{
+		pass = renderGraph.AddPass("SSAO downsample", [this, normals, depths, scale]()
+		{
+			gpuTimer->Begin(GPU_SPAN_SSAO);
+			stateTracker->SetPipelineState(ssaoDownsamplePipeline);
+			ssaoDownsamplePS->SetInt("scale", scale);
+			graphExecutor->BindShaderResource(ssaoDownsamplePS.get(), "Depths", depths);
+			graphExecutor->BindShaderResource(ssaoDownsamplePS.get(), "Normals", normals);
+			ssaoDownsamplePS->CopyAllBufferData();
+			context->Draw(3, 0);
+		});
+		renderGraph.Read(pass, depths);
+		renderGraph.Read(pass, normals);
+		renderGraph.Write(pass, ssaoDepths, RENDER_GRAPH_RENDER_TARGET);
+		renderGraph.Write(pass, ssaoNormals, RENDER_GRAPH_RENDER_TARGET);
+	}
+
+	// Either AO method writes the same target, so the rest of the chain is shared
+	if (aoMethod == AO_METHOD_GTAO)
+	{
+		pass = renderGraph.AddPass("GTAO", [this, ssaoNormals, ssaoDepths, scale]()
+		{
+			if (scale == 1)
+				gpuTimer->Begin(GPU_SPAN_SSAO);
+			XMFLOAT4X4 projection = cameras[activeCam]->GetProjectionMatrix();
+			GTAOProjection gtaoProjection = GTAO::FromProjection(&projection._11);
+
+			stateTracker->SetPipelineState(gtaoPipeline);
+			gtaoPS->SetMatrix4x4("viewMatrix", cameras[activeCam]->GetViewMatrix());
+			gtaoPS->SetFloat4("projectionParams", XMFLOAT4(gtaoProjection.ScaleX, gtaoProjection.ScaleY,
+				gtaoProjection.DepthScale, gtaoProjection.DepthOffset));
+			gtaoPS->SetFloat("radius", ssaoRadius);
+			gtaoPS->SetInt("sliceCount", gtaoSlices);
+			gtaoPS->SetInt("stepCount", gtaoSteps);
+			// Accumulating over frames, the slices turn a little further each one
+			gtaoPS->SetFloat("noiseOffset", ssaoTemporal ? TemporalAO::KernelAngle(ssaoFrame++) / XM_2PI : 0.0f);
+			graphExecutor->BindShaderResource(gtaoPS.get(), "Normals", ssaoNormals);
+			graphExecutor->BindShaderResource(gtaoPS.get(), "Depths", ssaoDepths);
+			gtaoPS->CopyAllBufferData();
+			context->Draw(3, 0);
+		});
+	}
+	else
+	{
+		pass = renderGraph.AddPass("SSAO", [this, ssaoNormals, ssaoDepths, ssaoDesc, scale]()
+		{
+			if (scale == 1)
+				gpuTimer->Begin(GPU_SPAN_SSAO);
+			XMFLOAT4X4 camProj = cameras[activeCam]->GetProjectionMatrix();
+			XMMATRIX proj = XMLoadFloat4x4(&camProj);
+			XMFLOAT4X4 invProj;
+			XMStoreFloat4x4(&invProj, DirectX::XMMatrixInverse(0, proj));
+
+			stateTracker->SetPipelineState(ssaoPipeline);
+			ppssaoPS->SetMatrix4x4("viewMatrix", cameras[activeCam]->GetViewMatrix());
+			ppssaoPS->SetMatrix4x4("projectionMatrix", cameras[activeCam]->GetProjectionMatrix());
+			ppssaoPS->SetMatrix4x4("invProjMatrix", invProj);
+			if (ssaoTemporal)
+			{
+				// This frame's share of the kernel, turned a little further
+				XMFLOAT4 frameOffsets[TemporalAO::FrameSamples];
+				TemporalAO::FrameKernel(&ssaoOffsets[0].x, ssaoFrame++, &frameOffsets[0].x);
+				ppssaoPS->SetData("offsets", (void*)(&frameOffsets[0]), sizeof(XMFLOAT4) * TemporalAO::FrameSamples);
+				ppssaoPS->SetInt("ssaoSamples", TemporalAO::FrameSamples);
+			}
+			else
+			{
+				ppssaoPS->SetData("offsets", (void*)(&ssaoOffsets[0]), sizeof(XMFLOAT4) * 64);
+				ppssaoPS->SetInt("ssaoSamples", ssaoSamples);
+			}
+			ppssaoPS->SetFloat("ssaoRadius", ssaoRadius);
+			ppssaoPS->SetFloat2("randomTextureScreenScale", XMFLOAT2(ssaoDesc.Width / 4.0f, ssaoDesc.Height / 4.0f));
+			graphExecutor->BindShaderResource(ppssaoPS.get(), "Normals", ssaoNormals);
+			graphExecutor->BindShaderResource(ppssaoPS.get(), "Depths", ssaoDepths);
+			ppssaoPS->SetShaderResourceView("Random", randomTextureSRV.Get());
+			ppssaoPS->SetSamplerState("BasicSampler", sampler.Get());
+			ppssaoPS->SetSamplerState("ClampSampler", ppSampler.Get());
+			ppssaoPS->CopyAllBufferData();
+			context->Draw(3, 0);
+		});
+	}
+	renderGraph.Read(pass, ssaoNormals);
+	renderGraph.Read(pass, ssaoDepths);
+	renderGraph.Write(pass, ssao, RENDER_GRAPH_RENDER_TARGET);
+
+	// The blur takes the accumulated AO (through the new history's
+	// SRV); the history itself stays unblurred
+	RenderGraphResource blurSource = ssao;
+	if (ssaoTemporal)
+	{
+		pass = renderGraph.AddPass("SSAO temporal", [this, ssao, ssaoDepths, ssaoHistory, ssaoDesc]()
+		{
+			XMFLOAT4X4 view = cameras[activeCam]->GetViewMatrix();
+			XMFLOAT4X4 projection = cameras[activeCam]->GetProjectionMatrix();
+			XMFLOAT4X4 invProj;
+			XMStoreFloat4x4(&invProj, XMMatrixInverse(0, XMLoadFloat4x4(&projection)));
+			XMFLOAT4X4 currentToPreviousView;
+			if (!TemporalAO::CurrentToPreviousView(&view._11, &projection._11, &ssaoPreviousView._11, &currentToPreviousView._11))
+				ssaoHistoryValid = false;
+
+			// The new history is imported, so the graph leaves its viewport to us
+			D3D11_VIEWPORT viewport = {};
+			viewport.Width = (float)ssaoDesc.Width;
+			viewport.Height = (float)ssaoDesc.Height;
+			viewport.MaxDepth = 1.0f;
+			context->RSSetViewports(1, &viewport);
+
+			stateTracker->SetPipelineState(ssaoTemporalPipeline);
+			ssaoTemporalPS->SetMatrix4x4("currentToPreviousView", currentToPreviousView);
+			ssaoTemporalPS->SetMatrix4x4("previousProjection", ssaoPreviousProjection);
+			ssaoTemporalPS->SetMatrix4x4("invProjMatrix", invProj);
+			ssaoTemporalPS->SetFloat("depthTolerance", ssaoDepthTolerance);
+			ssaoTemporalPS->SetInt("historyValid", ssaoHistoryValid);
+			ssaoTemporalPS->SetInt("maxHistory", TemporalAO::MaxHistory);
+			graphExecutor->BindShaderResource(ssaoTemporalPS.get(), "SSAO", ssao);
+			graphExecutor->BindShaderResource(ssaoTemporalPS.get(), "Depths", ssaoDepths);
+			graphExecutor->BindShaderResource(ssaoTemporalPS.get(), "History", ssaoHistory);
+			ssaoTemporalPS->CopyAllBufferData();
+			context->Draw(3, 0);
+
+			ssaoPreviousView = view;
+			ssaoPreviousProjection = projection;
+			ssaoHistoryIndex = 1 - ssaoHistoryIndex;
+			ssaoHistoryValid = true;
+		});
+		renderGraph.Read(pass, ssao);
+		renderGraph.Read(pass, ssaoDepths);
+		renderGraph.Read(pass, ssaoHistory);
+		renderGraph.Write(pass, ssaoNewHistory, RENDER_GRAPH_RENDER_TARGET);
+		blurSource = ssaoNewHistory;
+	}
+
+	pass = renderGraph.AddPass("SSAO blur", [this, blurSource, ssaoDesc, scale]()
+	{
+		stateTracker->SetPipelineState(ssaoBlurPipeline);
+		ppssaoblurPS->SetFloat2("pixelSize", XMFLOAT2(1.0f / ssaoDesc.Width, 1.0f / ssaoDesc.Height));
+		graphExecutor->BindShaderResource(ppssaoblurPS.get(), "SSAO", blurSource);
+		ppssaoblurPS->SetSamplerState("ClampSampler", ppSampler.Get());
+		ppssaoblurPS->CopyAllBufferData();
+		context->Draw(3, 0);
+		if (scale == 1)
+			gpuTimer->End(GPU_SPAN_SSAO);
+	});
+	renderGraph.Read(pass, blurSource);
+	renderGraph.Write(pass, blurredSSAO, RENDER_GRAPH_RENDER_TARGET);
+
+	if (scale > 1)
+	{
+		pass = renderGraph.AddPass("SSAO upsample", [this, blurredSSAO, ssaoDepths, depths, scale]()
+		{
+			XMFLOAT4X4 camProj = cameras[activeCam]->GetProjectionMatrix();
+			XMFLOAT4X4 invProj;
+			XMStoreFloat4x4(&invProj, XMMatrixInverse(0, XMLoadFloat4x4(&camProj)));
+
+			stateTracker->SetPipelineState(ssaoUpsamplePipeline);
+			ssaoUpsamplePS->SetMatrix4x4("invProjMatrix", invProj);
+			ssaoUpsamplePS->SetInt("scale", scale);
+			ssaoUpsamplePS->SetFloat("depthTolerance", ssaoDepthTolerance);
+			graphExecutor->BindShaderResource(ssaoUpsamplePS.get(), "SSAO", blurredSSAO);
+			graphExecutor->BindShaderResource(ssaoUpsamplePS.get(), "LowDepths", ssaoDepths);
+			graphExecutor->BindShaderResource(ssaoUpsamplePS.get(), "Depths", depths);
+			ssaoUpsamplePS->CopyAllBufferData();
+			context->Draw(3, 0);
+			gpuTimer->End(GPU_SPAN_SSAO);
+		});
+		renderGraph.Read(pass, blurredSSAO);
+		renderGraph.Read(pass, ssaoDepths);
+		renderGraph.Read(pass, depths);
+		renderGraph.Write(pass, fullSSAO, RENDER_GRAPH_RENDER_TARGET);
+	}
+
+	pass = renderGraph.AddPass("Combine", [this, color, ambient, fullSSAO]()
+	{
+		stateTracker->SetPipelineState(combinePipeline);
+		graphExecutor->BindShaderResource(combinePS.get(), "SceneColorsNoAmbient", color);
+		graphExecutor->BindShaderResource(combinePS.get(), "Ambient", ambient);
+		graphExecutor->BindShaderResource(combinePS.get(), "SSAOBlur", fullSSAO);
+		combinePS->SetSamplerState("BasicSampler", sampler.Get());
+		context->Draw(3, 0);
+	});
+	renderGraph.Read(pass, color);
+	renderGraph.Read(pass, ambient);
+	renderGraph.Read(pass, fullSSAO);
+	renderGraph.Write(pass, combined, RENDER_GRAPH_RENDER_TARGET);
+
+	// Halve the image until the radius left is small enough,
+	// blur it both ways, and scale it back up
+	int levelRadius = blur;
+	int levels = useBlurPyramid ? GaussianBlur::PyramidLevels(blur, levelRadius) : 0;
+	RenderGraphResource source = combined;
+	RenderGraphTextureDesc levelDesc = colorDesc;
+	for (int l = 0; l < levels; l++)
+	{
+		levelDesc.Width = (levelDesc.Width + 1) / 2;
+		levelDesc.Height = (levelDesc.Height + 1) / 2;
+		RenderGraphResource level = renderGraph.CreateTexture("Blur level " + std::to_string(l + 1), levelDesc);
+		AddBlurPass("Blur downsample", source, level, XMFLOAT2(0, 0), 0);
+		source = level;
+	}
+	RenderGraphResource horizontal = renderGraph.CreateTexture("Blur horizontal", levelDesc);
+	AddBlurPass("Blur horizontal", source, horizontal, XMFLOAT2(1.0f / levelDesc.Width, 0), levelRadius);
+	RenderGraphResource vertical = levels > 0 ? renderGraph.CreateTexture("Blur vertical", levelDesc) : blurred;
+	AddBlurPass("Blur vertical", horizontal, vertical, XMFLOAT2(0, 1.0f / levelDesc.Height), levelRadius);
+	if (levels > 0)
+		AddBlurPass("Blur upsample", vertical, blurred, XMFLOAT2(0, 0), 0);
+
+	renderGraph.SetOutput(blur > 0 ? blurred : combined);
+}
+
+// --------------------------------------------------------
+// One full screen pass of PPPixelShader: a Gaussian blur
+// along direction (one texel of the target, in UV), or a
+// bilinear copy for radius 0
+// --------------------------------------------------------
+void Game::AddBlurPass(const std::string& name, RenderGraphResource source, RenderGraphResource target,
+	XMFLOAT2 direction, int radius)
+{
+	std::vector<GaussianTap> gaussianTaps;
+	GaussianBlur::Taps(radius, gaussianTaps);
+	std::vector<XMFLOAT4> taps;
+	for (const GaussianTap& tap : gaussianTaps)
+		taps.push_back(XMFLOAT4(tap.Offset, tap.Weight, 0, 0));
+
+	RenderGraphPass pass = renderGraph.AddPass(name, [this, source, direction, taps]()
+	{
+		stateTracker->SetPipelineState(blurPipeline);
+		blurPPPS->SetData("taps", taps.data(), (unsigned int)(sizeof(XMFLOAT4) * taps.size()));
+		blurPPPS->SetFloat2("direction", direction);
+		blurPPPS->SetInt("tapCount", (int)taps.size());
+		graphExecutor->BindShaderResource(blurPPPS.get(), "Pixels", source);
+		blurPPPS->SetSamplerState("ClampSampler", ppSampler.Get());
+		blurPPPS->CopyAllBufferData();
+		context->Draw(3, 0); // Draw exactly 3 vertices (one triangle)
+	});
+	renderGraph.Read(pass, source);
+	renderGraph.Write(pass, target, RENDER_GRAPH_RENDER_TARGET);
+}
+
 void Game::Draw(float deltaTime, float totalTime)
 {
 	// Frame START
@@ -654,101 +1614,25 @@ void Game::Draw(float deltaTime, float totalTime)
 		//Pre-render 
 		
 	}
-	RenderShadowMap();
-	
-	const float clearColor[4] = { 0.0f, 0.0f, 0.0f, 0.0f }; // ClearColor
-	
-	context->ClearRenderTargetView(colorRTV.Get(),   clearColor);
-	context->ClearRenderTargetView(ambientRTV.Get(), clearColor);
-	context->ClearRenderTargetView(normalsRTV.Get(), clearColor);
-	context->ClearRenderTargetView(depthRTV.Get(),   clearColor);
-	context->ClearRenderTargetView(SSAORTV.Get(),   clearColor);
-	context->ClearRenderTargetView(blurredSSAORTV.Get(),   clearColor);
-	context->ClearRenderTargetView(ppRTV.Get(),   clearColor);
-
-	ID3D11RenderTargetView* renderTargets[4] = {};
-	renderTargets[0] = colorRTV.Get();
-	renderTargets[1] = ambientRTV.Get();
-	renderTargets[2] = normalsRTV.Get();
-	renderTargets[3] = depthRTV.Get();
-	context->OMSetRenderTargets(4, renderTargets, depthBufferDSV.Get());
-
-	for (int i = 0; i < gameEntities.size(); i++)
-	{
-		std::shared_ptr<SimpleVertexShader> vs = gameEntities[i]->getMaterial()->getVertexShader();
-		vs->SetMatrix4x4("lightView", lightViewMatrix);
-		vs->SetMatrix4x4("lightProjection", lightProjectionMatrix);
-		
-		std::shared_ptr<SimplePixelShader> ps = gameEntities[i]->getMaterial()->getPixelShader();
-		ps->SetFloat3("ambient", ambientColor);
-		ps->SetData("directionalLight1", &directionalLight1, sizeof(Light));
-		ps->SetShaderResourceView("ShadowMap", shadowSRV);
-		ps->SetSamplerState("ShadowSampler", shadowSampler);
-		gameEntities[i]->DrawEntity(context, cameras[activeCam]);
-	}
-
-	skyBox->Draw(context, cameras[activeCam], device);
-
-	context->OMSetRenderTargets(1, SSAORTV.GetAddressOf(), depthBufferDSV.Get());
-
-	XMFLOAT4X4 camProj = cameras[activeCam]->GetProjectionMatrix();
-	XMMATRIX proj = XMLoadFloat4x4(&camProj);
-	XMFLOAT4X4 invProj;
-	XMStoreFloat4x4(&invProj, DirectX::XMMatrixInverse(0, proj));
-
-	ppVS->SetShader();
-	ppssaoPS->SetShader();
-	ppssaoPS->SetMatrix4x4("viewMatrix", cameras[activeCam]->GetViewMatrix());
-	ppssaoPS->SetMatrix4x4("projectionMatrix", cameras[activeCam]->GetProjectionMatrix());
-	ppssaoPS->SetMatrix4x4("invProjMatrix", invProj);
-	ppssaoPS->SetData("offsets", (void*)(&ssaoOffsets[0]), sizeof(XMFLOAT4) * 64);
-	ppssaoPS->SetFloat("ssaoRadius", ssaoRadius);
-	ppssaoPS->SetInt("ssaoSamples", ssaoSamples);
-	ppssaoPS->SetFloat2("randomTextureScreenScale", XMFLOAT2(windowWidth / 4.0, windowHeight / 4.0));
-	ppssaoPS->SetShaderResourceView("Normals", normalsSRV.Get());
-	ppssaoPS->SetShaderResourceView("Depths", depthSRV.Get());
-	ppssaoPS->SetShaderResourceView("Random", randomTextureSRV.Get());
-	ppssaoPS->SetSamplerState("BasicSampler", sampler.Get());
-	ppssaoPS->SetSamplerState("ClampSampler", ppSampler.Get());
-	ppssaoPS->CopyAllBufferData();
-	context->Draw(3, 0);
-
-	context->OMSetRenderTargets(1, blurredSSAORTV.GetAddressOf(), 0);
-	ppVS->SetShader();
-	ppssaoblurPS->SetShader();
-	ppssaoblurPS->SetFloat2("pixelSize", XMFLOAT2(1.0/windowWidth, 1.0/windowHeight));
-	ppssaoblurPS->SetShaderResourceView("SSAO", SSAOSRV.Get());
-	ppssaoblurPS->SetSamplerState("ClampSampler", ppSampler.Get());
-	ppssaoblurPS->CopyAllBufferData();
-	context->Draw(3, 0);
-
-	context->ClearRenderTargetView(ppRTV.Get(), clearColor);
-	context->OMSetRenderTargets(1, ppRTV.GetAddressOf(), 0);
-	ppVS->SetShader();
-	combinePS->SetShader();
-	combinePS->SetShaderResourceView("SceneColorsNoAmbient", colorSRV.Get());
-	combinePS->SetShaderResourceView("Ambient", ambientSRV.Get());
-	combinePS->SetShaderResourceView("SSAOBlur", blurredSSAOSRV.Get());
-	combinePS->SetSamplerState("BasicSampler", sampler.Get());
-	context->Draw(3, 0);
-
-
-	context->OMSetRenderTargets(1, backBufferRTV.GetAddressOf(), 0);
-	// Activate shaders and bind resources
-	// Also set any required cbuffer data (not shown)
-	ppVS->SetShader();
-	blurPPPS->SetShader();
-	blurPPPS->SetInt("blurRadius", blur);
-	blurPPPS->SetFloat("pixelWidth", 1.0f / this->windowWidth);
-	blurPPPS->SetFloat("pixelHeight", 1.0f / this->windowHeight);
-	blurPPPS->SetShaderResourceView("Pixels", ppSRV.Get());
-	blurPPPS->SetSamplerState("ClampSampler", ppSampler.Get());
-	blurPPPS->CopyAllBufferData();
-	context->Draw(3, 0); // Draw exactly 3 vertices (one triangle)
-
+	renderStats.Reset();
+	ISimpleShader::ResetUploadStats();
+	stateTracker->ResetStats();
+	ISimpleShader::PerDrawRing = useConstantRing ? constantRing.get() : 0;
+	gpuTimer->BeginFrame();
+
+	// Catch transform edits the UI made after Update's sweep, so
+	// culling and the static shadow cache see them this frame
+	entityStore.UpdateTransforms();
+
+	BuildRenderGraph();
+	if (renderGraph.Compile())
+		graphExecutor->Execute(renderGraph);
+	else
+		printf("Render graph: %s\n", renderGraph.GetError().c_str());
 
 	ImGui::Render();
 	ImGui_ImplDX11_RenderDrawData(ImGui::GetDrawData());
+	stateTracker->Invalidate();
 
 
 	// Frame END
@@ -766,8 +1650,9 @@ void Game::Draw(float deltaTime, float totalTime)
 		// Must re-bind buffers after presenting, as they become unbound
 		context->OMSetRenderTargets(1, backBufferRTV.GetAddressOf(), depthBufferDSV.Get());
 
-		ID3D11ShaderResourceView* nullSRVs[128] = {};
-		context->PSSetShaderResources(0, 128, nullSRVs);
+		// Fence this frame's per-draw constants
+		constantRing->EndFrame();
+		gpuTimer->EndFrame();
 	}
 }
 
@@ -848,41 +1733,595 @@ Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> Game::setCubeSRV(const wchar_t*
 	return cubeSRV;
 }
 
-void Game::RenderShadowMap() 
+// --------------------------------------------------------
+// Draws every visible entity through the render queue.
+// Draws are sorted by pass, shaders, material, mesh and then
+// depth, and any bind that matches the previous draw is skipped.
+// --------------------------------------------------------
+void Game::DrawScene()
+{
+	auto submitStart = std::chrono::high_resolution_clock::now();
+
+	Camera* camera = cameras[activeCam].get();
+	XMFLOAT4X4 view = camera->GetViewMatrix();
+	XMFLOAT4X4 projection = camera->GetProjectionMatrix();
+	XMFLOAT3 camPos = camera->GetTransform()->GetPosition();
+	XMVECTOR camPosVec = XMLoadFloat3(&camPos);
+	float farClip = camera->GetFarClip();
+
+	// World-space view frustum, for culling against entity bounds
+	BoundingFrustum frustum(XMLoadFloat4x4(&projection));
+	frustum.Transform(frustum, XMMatrixInverse(0, XMLoadFloat4x4(&view)));
+
+	// Component arrays, all indexed by the same dense index
+	const size_t entityCount = entityStore.Size();
+	Transform* transforms = entityStore.GetTransforms();
+	const MeshHandle* meshList = entityStore.GetMeshes();
+	const MaterialHandle* materialList = entityStore.GetMaterials();
+	const BoundingSphere* bounds = entityStore.GetBounds();
+
+	// Camera, light and shadow constants, uploaded once for the whole frame
+	// - Every scene material uses these shaders, so their PerFrame
+	//   buffers hold everything that doesn't change between draws
+	VertexShaderPerFrame vsFrame;
+	vsFrame.view = view;
+	vsFrame.projection = projection;
+	unsigned int vsFrameBuffer = vertexShader->GetBufferIndex("PerFrame");
+	vertexShader->SetBufferData(vsFrameBuffer, &vsFrame, sizeof(vsFrame));
+	vertexShader->CopyBufferData(vsFrameBuffer);
+
+	// Same layout, but the generated struct is its own type
+	VertexShaderInstancedPerFrame instancedFrame;
+	instancedFrame.view = view;
+	instancedFrame.projection = projection;
+	unsigned int instancedFrameBuffer = instancedVertexShader->GetBufferIndex("PerFrame");
+	instancedVertexShader->SetBufferData(instancedFrameBuffer, &instancedFrame, sizeof(instancedFrame));
+	instancedVertexShader->CopyBufferData(instancedFrameBuffer);
+
+	// Every pixel shader variant has its own copy of PerFrame; ones
+	// that no material uses stay clean and skip the upload
+	PixelShaderPerFrame psFrame = {};
+	psFrame.cameraPos = camPos;
+	psFrame.ambient = ambientColor;
+	psFrame.directionalLight1 = directionalLight1;
+	for (unsigned int c = 0; c < shadowCascadeCount; c++)
+	{
+		XMMATRIX cascadeView = XMLoadFloat4x4((const XMFLOAT4X4*)shadowCascades[c].View);
+		XMMATRIX cascadeProjection = XMLoadFloat4x4((const XMFLOAT4X4*)shadowCascades[c].Projection);
+		XMStoreFloat4x4(&psFrame.cascadeViewProjection[c], cascadeView * cascadeProjection);
+		(&psFrame.cascadeSplits.x)[c] = shadowCascades[c].FarDepth;
+	}
+	psFrame.cameraForward = camera->GetTransform()->GetForward();
+	psFrame.cascadeCount = shadowCascadeCount;
+	psFrame.shadowFilter = shadowFilter;
+	psFrame.pcfRadius = shadowPCFRadius;
+	psFrame.evsmExponents = XMFLOAT2(ShadowMoments::MaxExponent16, ShadowMoments::MaxExponent16);
+	psFrame.evsmLightBleedReduction = evsmLightBleedReduction;
+
+	// Point and spot lights; only the ones whose tiles all hold
+	// their views get shadows, while the others wait their turn
+	float atlasScale = 1.0f / shadowAtlas->GetAllocator().GetAtlasSize();
+	unsigned int shadowViews = 0;
+	psFrame.localLightCount = (int)(localLights.size() < _countof(psFrame.localLights) ? localLights.size() : _countof(psFrame.localLights));
+	for (int i = 0; i < psFrame.localLightCount; i++)
+	{
+		psFrame.localLights[i] = localLights[i];
+		const LocalShadow& shadow = localShadows[i];
+		if (!shadow.Visible || !shadow.Ready || shadowViews + shadow.ViewCount > _countof(psFrame.localShadowRects))
+			continue;
+
+		psFrame.localShadowInfo[i] = XMFLOAT4((float)shadowViews, (float)shadow.ViewCount, 0, 0);
+		for (unsigned int v = 0; v < shadow.ViewCount; v++, shadowViews++)
+		{
+			const AtlasTile& tile = shadow.Tiles[v];
+			psFrame.localShadowViewProjection[shadowViews] = shadow.ViewProjection[v];
+			psFrame.localShadowRects[shadowViews] = XMFLOAT4(tile.X * atlasScale, tile.Y * atlasScale, tile.Size * atlasScale, tile.Size * atlasScale);
+		}
+	}
+	for (const std::shared_ptr<SimplePixelShader>& variant : pixelShaderVariants.GetVariants())
+	{
+		if (!variant)
+			continue;
+		unsigned int psFrameBuffer = variant->GetBufferIndex("PerFrame");
+		variant->SetBufferData(psFrameBuffer, &psFrame, sizeof(psFrame));
+		variant->CopyBufferData(psFrameBuffer);
+	}
+	pixelShader->SetSamplerState("MomentSampler", ppSampler);
+	pixelShader->SetSamplerState("ShadowSampler", shadowSampler);
+
+	// Build the queue from everything in view
+	renderQueue.Clear();
+	for (unsigned int i = 0; i < entityCount; i++)
+	{
+		if (!frustum.Intersects(bounds[i]))
+		{
+			renderStats.CulledDraws++;
+			continue;
+		}
+
+		Material* material = resources.Materials.Get(materialList[i]);
+		float dist = XMVectorGetX(XMVector3Length(XMLoadFloat3(&bounds[i].Center) - camPosVec));
+
+		unsigned int shaderPair = RenderQueue::MakeShaderPair(
+			material->getVertexShader()->GetShaderID(),
+			material->getPixelShader()->GetShaderID());
+		renderQueue.Push(RenderQueue::MakeKey(RENDER_PASS_OPAQUE, shaderPair, material->GetID(),
+			resources.Meshes.Get(meshList[i])->GetID(), dist / farClip), i);
+	}
+	renderQueue.Sort();
+
+	// Group the sorted draws by mesh and material
+	instanceBatcher.Clear();
+	for (const RenderItem& item : renderQueue.GetItems())
+	{
+		XMFLOAT4X4 world = transforms[item.Index].GetWorldMatrix();
+		XMFLOAT4X4 worldInvTrans = transforms[item.Index].GetWorldInverseTransposeMatrix();
+		instanceBatcher.Add(resources.Meshes.Get(meshList[item.Index])->GetID(), resources.Materials.Get(materialList[item.Index])->GetID(),
+			&world._11, &worldInvTrans._11, item.Index);
+	}
+	instanceBatcher.Build();
+	UploadInstanceData();
+
+	const std::vector<InstanceData>& instances = instanceBatcher.GetInstances();
+	const std::vector<unsigned int>& drawOrder = instanceBatcher.GetUserIndices();
+
+	// Submit, only rebinding what changed since the previous draw
+	SimpleVertexShader* lastVS = 0;
+	SimplePixelShader* lastPS = 0;
+	Material* lastMaterial = 0;
+	unsigned int lastBindingTable = 0xFFFFFFFF;
+	ID3D11Buffer* lastVertexBuffer = 0;
+	for (const InstanceBatch& batch : instanceBatcher.GetBatches())
+	{
+		unsigned int first = drawOrder[batch.FirstInstance];
+		Material* material = resources.Materials.Get(materialList[first]);
+		Mesh* mesh = resources.Meshes.Get(meshList[first]);
+		SimpleVertexShader* vs = material->getVertexShader().get();
+		SimplePixelShader* ps = material->getPixelShader().get();
+
+		// Only the standard vertex shader has an instanced twin
+		bool instanced = useInstancing &&
+			batch.InstanceCount > 1 &&
+			vs == vertexShader.get() &&
+			instancedVertexShader->GetPerInstanceCompatible();
+		if (instanced)
+			vs = instancedVertexShader.get();
+
+		// Everything else about the scene pipeline is the default
+		if (vs != lastVS || ps != lastPS)
+		{
+			PipelineStateDesc sceneDesc;
+			sceneDesc.VertexShader = vs;
+			sceneDesc.PixelShader = ps;
+			stateTracker->SetPipelineState(pipelineStates->Get(sceneDesc));
+
+			renderStats.ShaderBinds++;
+			renderStats.StateChanges += 2; // VS & PS
+			lastVS = vs;
+			lastPS = ps;
+		}
+
+		if (material != lastMaterial)
+		{
+			material->SetMaterialData();
+			renderStats.MaterialBinds++;
+			lastMaterial = material;
+		}
+
+		// Materials with the same textures and samplers share a table
+		if (material->GetBindingTableID() != lastBindingTable)
+		{
+			material->BindResources();
+			renderStats.BindingTableBinds++;
+			renderStats.StateChanges += Material::UseShaderHandles ? 2 : material->GetBindingCount(); // Ranged SRV & sampler binds
+			lastBindingTable = material->GetBindingTableID();
+		}
+
+		// Meshes sharing an arena share buffers, so only the first one binds
+		if (mesh->GetBoundVertexBuffer() != lastVertexBuffer)
+		{
+			mesh->SetBuffers();
+			renderStats.MeshBinds++;
+			renderStats.StateChanges += 2; // Vertex & index buffer
+			lastVertexBuffer = mesh->GetBoundVertexBuffer();
+		}
+
+		if (instanced)
+		{
+			mesh->DrawInstanced(batch.InstanceCount, batch.FirstInstance);
+			renderStats.DrawCalls++;
+			renderStats.InstancedBatches++;
+			renderStats.InstancesDrawn += batch.InstanceCount;
+		}
+		else
+		{
+			for (unsigned int i = batch.FirstInstance; i < batch.FirstInstance + batch.InstanceCount; i++)
+			{
+				material->SetPerObjectData(XMFLOAT4X4(instances[i].World), XMFLOAT4X4(instances[i].WorldInverseTranspose));
+				mesh->DrawIndexed();
+				renderStats.DrawCalls++;
+			}
+		}
+
+		// What the unsorted, one-draw-per-entity path issued for these draws
+		renderStats.NaiveStateChanges += (4 + material->GetBindingCount() + 2) * batch.InstanceCount;
+	}
+
+	std::chrono::duration<float, std::milli> submitTime = std::chrono::high_resolution_clock::now() - submitStart;
+	renderStats.SubmitMilliseconds = submitTime.count();
+}
+
+// --------------------------------------------------------
+// Copies this frame's packed instance stream to the GPU and
+// binds it to input slot 1 for the instanced vertex shader
+// --------------------------------------------------------
+void Game::UploadInstanceData()
 {
-	context->ClearDepthStencilView(shadowDSV.Get(), D3D11_CLEAR_DEPTH, 1.0f, 0);
+	// Nothing to do unless at least one group has several draws
+	const std::vector<InstanceData>& instances = instanceBatcher.GetInstances();
+	if (!useInstancing || instanceBatcher.GetBatches().size() == instances.size())
+		return;
+
+	// Grow by doubling, so this rarely reallocates
+	if (instances.size() > instanceBufferCapacity)
+	{
+		unsigned int capacity = instanceBufferCapacity > 0 ? instanceBufferCapacity : 64;
+		while (capacity < instances.size())
+			capacity *= 2;
+
+		D3D11_BUFFER_DESC ibd = {};
+		ibd.Usage = D3D11_USAGE_DYNAMIC;
+		ibd.ByteWidth = sizeof(InstanceData) * capacity;
+		ibd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+		ibd.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		device->CreateBuffer(&ibd, 0, instanceBuffer.ReleaseAndGetAddressOf());
+		instanceBufferCapacity = capacity;
+	}
+
+	D3D11_MAPPED_SUBRESOURCE mapped = {};
+	context->Map(instanceBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped);
+	memcpy(mapped.pData, instances.data(), sizeof(InstanceData) * instances.size());
+	context->Unmap(instanceBuffer.Get(), 0);
+
+	UINT stride = sizeof(InstanceData);
+	UINT offset = 0;
+	context->IASetVertexBuffers(1, 1, instanceBuffer.GetAddressOf(), &stride, &offset);
+}
+
+// --------------------------------------------------------
+// Draws every caster that can reach the cascade into whatever
+// depth target is bound, visible or not.  Static and dynamic
+// casters can be picked separately for the static cache.
+// --------------------------------------------------------
+void Game::DrawShadowCasters(const ShadowCascade& cascade, bool staticCasters, bool dynamicCasters)
+{
+	const size_t entityCount = entityStore.Size();
+	const BoundingSphere* bounds = entityStore.GetBounds();
+	ID3D11Buffer* lastVertexBuffer = 0;
+	for (size_t i = 0; i < entityCount; i++)
+	{
+		if (!(entityStore.IsDynamic(i) ? dynamicCasters : staticCasters))
+			continue;
+
+		CascadeVector center = { bounds[i].Center.x, bounds[i].Center.y, bounds[i].Center.z };
+		if (!ShadowCascades::Overlaps(cascade, center, bounds[i].Radius))
+			continue;
+
+		DrawShadowCaster(i, lastVertexBuffer);
+	}
+}
+
+// --------------------------------------------------------
+// Draws one entity with the shadow vertex shader, rebinding
+// buffers only when the mesh's vertex buffer changes
+// --------------------------------------------------------
+void Game::DrawShadowCaster(size_t index, ID3D11Buffer*& lastVertexBuffer)
+{
+	Transform* transforms = entityStore.GetTransforms();
+	const MeshHandle* meshList = entityStore.GetMeshes();
+	if (Material::UseShaderHandles)
+	{
+		ShadowVShaderPerObject caster;
+		caster.world = transforms[index].GetWorldMatrix();
+		shadowVShader->SetBufferData(shadowPerObjectBuffer, &caster, sizeof(caster));
+	}
+	else
+	{
+		shadowVShader->SetMatrix4x4("world", transforms[index].GetWorldMatrix());
+	}
+	shadowVShader->CopyBufferData(shadowPerObjectBuffer);
+
+	Mesh* mesh = resources.Meshes.Get(meshList[index]);
+	if (mesh->GetBoundVertexBuffer() != lastVertexBuffer)
+	{
+		mesh->SetBuffers();
+		lastVertexBuffer = mesh->GetBoundVertexBuffer();
+	}
+	mesh->DrawIndexed();
+	renderStats.ShadowDrawCalls++;
+}
+
+// --------------------------------------------------------
+// Finds atlas tiles for every point and spot light in view,
+// then re-renders the most important of the ones that
+// changed, up to the per-frame budget.  The rest keep the
+// shadow they were last rendered with.
+// --------------------------------------------------------
+void Game::RenderLocalShadows()
+{
+	shadowAtlas->BeginFrame();
+	localShadowFrame++;
+	localShadowUpdates = 0;
+
+	Camera* camera = cameras[activeCam].get();
+	XMFLOAT4X4 view = camera->GetViewMatrix();
+	XMFLOAT4X4 projection = camera->GetProjectionMatrix();
+	BoundingFrustum frustum(XMLoadFloat4x4(&projection));
+	frustum.Transform(frustum, XMMatrixInverse(0, XMLoadFloat4x4(&view)));
+	XMFLOAT3 camPos = camera->GetTransform()->GetPosition();
+	CascadeVector cameraPosition = { camPos.x, camPos.y, camPos.z };
+	float tanHalfFovY = tanf(camera->GetFOV() * 0.5f);
+
+	// Lights that can light something in view, biggest on screen
+	// first so they get first pick of the atlas
+	std::vector<std::pair<float, unsigned int>> visible;
+	for (unsigned int i = 0; i < localLights.size(); i++)
+	{
+		localShadows[i].Visible = false;
+		if (!frustum.Intersects(BoundingSphere(localLights[i].Position, localLights[i].Range)))
+			continue;
+
+		CascadeVector position = { localLights[i].Position.x, localLights[i].Position.y, localLights[i].Position.z };
+		visible.push_back(std::make_pair(ShadowAtlas::ScreenCoverage(position, localLights[i].Range, cameraPosition, tanHalfFovY), i));
+	}
+	std::sort(visible.begin(), visible.end(),
+		[](const std::pair<float, unsigned int>& a, const std::pair<float, unsigned int>& b) { return a.first > b.first; });
+
+	const size_t entityCount = entityStore.Size();
+	const BoundingSphere* bounds = entityStore.GetBounds();
+	unsigned int staticVersion = entityStore.GetStaticVersion();
+	std::vector<ShadowUpdateCandidate> candidates;
+	for (const std::pair<float, unsigned int>& entry : visible)
+	{
+		const Light& light = localLights[entry.second];
+		LocalShadow& shadow = localShadows[entry.second];
+		unsigned int viewCount = light.Type == LIGHT_TYPE_POINT ? 6 : 1;
+		if (shadow.ViewCount != viewCount)
+		{
+			shadow.ViewCount = viewCount;
+			shadow.Ready = false;
+		}
+
+		// A tile that's new to a view holds nothing for it yet
+		uint32_t tileSize = shadowAtlas->TileSizeFor(entry.first);
+		shadow.Visible = true;
+		for (unsigned int v = 0; v < viewCount && shadow.Visible; v++)
+		{
+			bool fresh;
+			shadow.Visible = shadowAtlas->Request((uint64_t)entry.second * 6 + v, tileSize, shadow.Tiles[v], fresh);
+			if (fresh || !shadow.Visible)
+				shadow.Ready = false;
+		}
+		if (!shadow.Visible)
+			continue;
+
+		// Anything the views depend on: the light's position and
+		// shape, the static casters, or a dynamic caster in reach
+		const Light& rendered = shadow.RenderedLight;
+		bool changed = !shadow.Ready ||
+			shadow.RenderedStaticVersion != staticVersion ||
+			light.Type != rendered.Type ||
+			light.Range != rendered.Range ||
+			light.SpotFalloff != rendered.SpotFalloff ||
+			memcmp(&light.Position, &rendered.Position, sizeof(light.Position)) != 0 ||
+			memcmp(&light.Direction, &rendered.Direction, sizeof(light.Direction)) != 0;
+		BoundingSphere reach(light.Position, light.Range);
+		for (size_t i = 0; i < entityCount && !changed; i++)
+			changed = entityStore.IsDynamic(i) && bounds[i].Intersects(reach);
+
+		if (changed)
+		{
+			ShadowUpdateCandidate candidate;
+			candidate.Light = entry.second;
+			candidate.Priority = ShadowAtlas::UpdatePriority(entry.first, localShadowFrame - shadow.LastRenderFrame);
+			candidates.push_back(candidate);
+		}
+	}
+
+	ShadowAtlas::SelectUpdates(candidates, localShadowBudget > 0 ? (unsigned int)localShadowBudget : 0);
+	if (candidates.empty())
+		return;
 
 	ID3D11RenderTargetView* nullRTV{};
-	context->OMSetRenderTargets(1, &nullRTV, shadowDSV.Get());
+	context->OMSetRenderTargets(1, &nullRTV, shadowAtlasDSV.Get());
+	for (const ShadowUpdateCandidate& candidate : candidates)
+	{
+		RenderLocalShadow(localShadows[candidate.Light], localLights[candidate.Light]);
+		localShadowUpdates++;
+	}
+}
 
-	context->PSSetShader(0, 0, 0);
+// --------------------------------------------------------
+// Renders every view of one light into its atlas tiles
+// --------------------------------------------------------
+void Game::RenderLocalShadow(LocalShadow& shadow, const Light& light)
+{
+	// Cube faces, in the order the pixel shader picks them
+	static const XMFLOAT3 faceForward[6] = { { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 } };
+	static const XMFLOAT3 faceUp[6] = { { 0, 1, 0 }, { 0, 1, 0 }, { 0, 0, -1 }, { 0, 0, 1 }, { 0, 1, 0 }, { 0, 1, 0 } };
 
-	context->RSSetState(shadowRasterizer.Get());
+	// A spot light's cone ends where its falloff drops below 1/256
+	float fov = XM_PIDIV2;
+	if (light.Type == LIGHT_TYPE_SPOT)
+	{
+		float falloff = light.SpotFalloff > 1.0f ? light.SpotFalloff : 1.0f;
+		fov = 2.0f * acosf(powf(1.0f / 256.0f, 1.0f / falloff));
+		fov = fov < XM_PI * 0.9f ? fov : XM_PI * 0.9f;
+	}
+	XMMATRIX projection = XMMatrixPerspectiveFovLH(fov, 1.0f, light.Range * 0.01f, light.Range);
+	BoundingFrustum viewSpaceFrustum(projection);
+
+	const size_t entityCount = entityStore.Size();
+	const BoundingSphere* bounds = entityStore.GetBounds();
+	BoundingSphere reach(light.Position, light.Range);
+	unsigned int shadowFrameBuffer = shadowVShader->GetBufferIndex("PerFrame");
+	for (unsigned int v = 0; v < shadow.ViewCount; v++)
+	{
+		XMVECTOR forward = XMLoadFloat3(&faceForward[v]);
+		XMVECTOR up = XMLoadFloat3(&faceUp[v]);
+		if (light.Type == LIGHT_TYPE_SPOT)
+		{
+			forward = XMVector3Normalize(XMLoadFloat3(&light.Direction));
+			up = fabsf(XMVectorGetY(forward)) > 0.99f ? XMVectorSet(1, 0, 0, 0) : XMVectorSet(0, 1, 0, 0);
+		}
+		XMMATRIX view = XMMatrixLookToLH(XMLoadFloat3(&light.Position), forward, up);
+		XMStoreFloat4x4(&shadow.ViewProjection[v], view * projection);
+
+		// Clear just this tile
+		const AtlasTile& tile = shadow.Tiles[v];
+		D3D11_VIEWPORT viewport = {};
+		viewport.TopLeftX = (float)tile.X;
+		viewport.TopLeftY = (float)tile.Y;
+		viewport.Width = (float)tile.Size;
+		viewport.Height = (float)tile.Size;
+		viewport.MinDepth = 1.0f;
+		viewport.MaxDepth = 1.0f;
+		context->RSSetViewports(1, &viewport);
+		stateTracker->SetPipelineState(shadowTileClearPipeline);
+		context->Draw(3, 0);
+
+		viewport.MinDepth = 0.0f;
+		context->RSSetViewports(1, &viewport);
+		stateTracker->SetPipelineState(localShadowPipeline);
+
+		ShadowVShaderPerFrame shadowFrame;
+		XMStoreFloat4x4(&shadowFrame.view, view);
+		XMStoreFloat4x4(&shadowFrame.projection, projection);
+		shadowVShader->SetBufferData(shadowFrameBuffer, &shadowFrame, sizeof(shadowFrame));
+		shadowVShader->CopyBufferData(shadowFrameBuffer);
+
+		BoundingFrustum viewFrustum;
+		viewSpaceFrustum.Transform(viewFrustum, XMMatrixInverse(0, view));
+		ID3D11Buffer* lastVertexBuffer = 0;
+		for (size_t i = 0; i < entityCount; i++)
+		{
+			if (bounds[i].Intersects(reach) && viewFrustum.Intersects(bounds[i]))
+				DrawShadowCaster(i, lastVertexBuffer);
+		}
+	}
+
+	shadow.RenderedLight = light;
+	shadow.RenderedStaticVersion = entityStore.GetStaticVersion();
+	shadow.LastRenderFrame = localShadowFrame;
+	shadow.Ready = true;
+}
+
+void Game::RenderShadowMap() 
+{
+	auto shadowStart = std::chrono::high_resolution_clock::now();
+	UpdateShadowCascades();
+
+	stateTracker->SetPipelineState(shadowPipeline);
 
 	D3D11_VIEWPORT viewport = {};
-	viewport.Width = (float)this->windowWidth;
-	viewport.Height = (float)this->windowHeight;
+	viewport.Width = (float)shadowMapSize;
+	viewport.Height = (float)shadowMapSize;
 	viewport.MaxDepth = 1.0f;
 	context->RSSetViewports(1, &viewport);
 
-	shadowVShader->SetShader();
-	shadowVShader->SetMatrix4x4("view", lightViewMatrix);
-	shadowVShader->SetMatrix4x4("projection", lightProjectionMatrix);
+	unsigned int staticVersion = entityStore.GetStaticVersion();
+	unsigned int shadowFrameBuffer = shadowVShader->GetBufferIndex("PerFrame");
+	ID3D11RenderTargetView* nullRTV{};
+	ID3D11ShaderResourceView* nullSRV = 0;
+	for (unsigned int c = 0; c < shadowCascadeCount; c++)
+	{
+		ShadowCascade& cascade = shadowCascades[c];
+		ShadowVShaderPerFrame shadowFrame;
+
+		if (!useShadowCache)
+		{
+			memcpy(&shadowFrame.view, cascade.View, sizeof(shadowFrame.view));
+			memcpy(&shadowFrame.projection, cascade.Projection, sizeof(shadowFrame.projection));
+			shadowVShader->SetBufferData(shadowFrameBuffer, &shadowFrame, sizeof(shadowFrame));
+			shadowVShader->CopyBufferData(shadowFrameBuffer);
+
+			context->ClearDepthStencilView(shadowCascadeDSVs[c].Get(), D3D11_CLEAR_DEPTH, 1.0f, 0);
+			context->OMSetRenderTargets(1, &nullRTV, shadowCascadeDSVs[c].Get());
+			DrawShadowCasters(cascade, true, true);
+			continue;
+		}
 
-	for (auto& e : gameEntities) {
-		shadowVShader->SetMatrix4x4("world", e->GetTransform().GetWorldMatrix());
-		shadowVShader->CopyAllBufferData();
+		// The cached region only depends on the light, the cascade's
+		// size and roughly where the camera is, so ordinary camera
+		// motion just slides the cascade around inside it
+		ShadowCascade& region = shadowCacheRegions[c];
+		bool stale = !shadowCacheValid[c] ||
+			shadowCacheVersions[c] != staticVersion ||
+			!ShadowCascades::CacheRegionCovers(region, cascade, shadowMapSize, shadowCacheMargin);
+		if (stale)
+		{
+			region = ShadowCascades::FitCacheRegion(cascade, shadowMapSize, shadowCacheMargin);
+			memcpy(&shadowFrame.view, region.View, sizeof(shadowFrame.view));
+			memcpy(&shadowFrame.projection, region.Projection, sizeof(shadowFrame.projection));
+			shadowVShader->SetBufferData(shadowFrameBuffer, &shadowFrame, sizeof(shadowFrame));
+			shadowVShader->CopyBufferData(shadowFrameBuffer);
+
+			D3D11_VIEWPORT cacheViewport = viewport;
+			cacheViewport.Width = (float)(shadowMapSize + 2 * shadowCacheMargin);
+			cacheViewport.Height = cacheViewport.Width;
+			context->RSSetViewports(1, &cacheViewport);
+			context->ClearDepthStencilView(shadowCacheDSVs[c].Get(), D3D11_CLEAR_DEPTH, 1.0f, 0);
+			context->OMSetRenderTargets(1, &nullRTV, shadowCacheDSVs[c].Get());
+			DrawShadowCasters(region, true, false);
+			context->RSSetViewports(1, &viewport);
+
+			shadowCacheVersions[c] = staticVersion;
+			shadowCacheValid[c] = true;
+			renderStats.ShadowCacheRebuilds++;
+		}
 
-		e->GetMesh()->Draw();
+		// The cascade takes the region's depth range, so the cached
+		// depths can be used as they are
+		uint32_t offsetX, offsetY;
+		ShadowCascades::PlaceInCacheRegion(cascade, region, shadowMapSize, shadowCacheMargin, offsetX, offsetY);
+
+		// Binding the cascade's slice also unbinds the cache, which is read next
+		context->OMSetRenderTargets(1, &nullRTV, shadowCascadeDSVs[c].Get());
+		stateTracker->SetPipelineState(shadowCacheCopyPipeline);
+		int offset[2] = { (int)offsetX, (int)offsetY };
+		shadowCacheCopyPS->SetData("offset", offset, sizeof(offset));
+		shadowCacheCopyPS->SetInt("cascade", c);
+		shadowCacheCopyPS->SetShaderResourceView("CachedDepth", shadowCacheSRV.Get());
+		shadowCacheCopyPS->CopyAllBufferData();
+		context->Draw(3, 0);
+		context->PSSetShaderResources(0, 1, &nullSRV);
+
+		memcpy(&shadowFrame.view, cascade.View, sizeof(shadowFrame.view));
+		memcpy(&shadowFrame.projection, cascade.Projection, sizeof(shadowFrame.projection));
+		shadowVShader->SetBufferData(shadowFrameBuffer, &shadowFrame, sizeof(shadowFrame));
+		shadowVShader->CopyBufferData(shadowFrameBuffer);
+		stateTracker->SetPipelineState(shadowPipeline);
+		DrawShadowCasters(cascade, false, true);
 	}
+
+	if (shadowFilter == SHADOW_FILTER_EVSM)
+	{
+		gpuTimer->Begin(GPU_SPAN_SHADOW_FILTER);
+		FilterShadowMoments();
+		gpuTimer->End(GPU_SPAN_SHADOW_FILTER);
+	}
+	RenderLocalShadows();
+
 	viewport.Width = (float)this->windowWidth;
 	viewport.Height = (float)this->windowHeight;
-	context->RSSetState(0);
 	context->RSSetViewports(1, &viewport);
 	context->OMSetRenderTargets(
 		1,
 		backBufferRTV.GetAddressOf(),
 		depthBufferDSV.Get()
 	);
+
+	std::chrono::duration<float, std::milli> shadowTime = std::chrono::high_resolution_clock::now() - shadowStart;
+	renderStats.ShadowMilliseconds = shadowTime.count();
 }
 
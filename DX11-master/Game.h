@@ -14,6 +14,38 @@
 #include "SimpleShader.h"
 #include "Lights.h"
 #include "Sky.h"
+#include "RenderQueue.h"
+#include "InstanceBatcher.h"
+#include "ResourceRegistry.h"
+#include "PipelineState.h"
+#include "StateTracker.h"
+#include "ShaderPermutations.h"
+#include "TextureArrayPacker.h"
+#include "ShadowCascades.h"
+#include "ShadowAtlas.h"
+#include "ShadowMoments.h"
+#include "GpuTimer.h"
+#include "RenderGraphExecutor.h"
+#include "GaussianBlur.h"
+#include "SSAOResample.h"
+#include "TemporalAO.h"
+#include "GTAO.h"
+
+// --------------------------------------------------------
+// A point or spot light's shadow views, as they were last
+// rendered into the atlas
+// --------------------------------------------------------
+struct LocalShadow
+{
+	Light RenderedLight;				// The light the views were rendered for
+	unsigned int RenderedStaticVersion;	// EntityStore::GetStaticVersion() at the time
+	unsigned int LastRenderFrame;
+	unsigned int ViewCount;				// 6 for point lights, 1 for spot lights
+	AtlasTile Tiles[6];
+	DirectX::XMFLOAT4X4 ViewProjection[6];
+	bool Visible;						// Has all its tiles this frame
+	bool Ready;							// Every tile holds its view
+};
 
 class Game
 	: public DXCore
@@ -36,32 +68,98 @@ public:
 		const wchar_t* front,
 		const wchar_t* back);
 	void CreateShadowMap();
+	void CreateShadowTextures();
 	void RenderShadowMap();
-	void setupPP();
+	void CreateSSAOResources();
 private:
 
 	// Initialization helper methods - feel free to customize, combine, remove, etc.
 	void LoadShaders();
+	float shaderLoadMilliseconds;
 	void CreateGeometry();
 
+	// Shared vertex/index buffers the meshes are sub-allocated from.
+	// Declared before the registry so it outlives every mesh.
+	std::shared_ptr<GeometryArena> staticGeometry;
+
+	// Owns every mesh, material, shader and texture; the rest
+	// of the game refers to them by handle
+	ResourceRegistry resources;
+	TextureHandle LoadTexture(const std::wstring& file);
+
+	// CPU-side loading for the material texture arrays
+	PackedImage LoadImagePixels(const std::wstring& file);
+	TextureHandle CreateTextureArray(const TextureArrayPacker& packer);
+
 	//Shapes
-	std::vector<std::shared_ptr<Mesh>> meshes;
+	std::vector<MeshHandle> meshes;
 	//cameras
 	std::vector<std::shared_ptr<Camera>> cameras;
 	int activeCam;
 	//materials
-	std::shared_ptr<Material> bronzeMat;
-	std::shared_ptr<Material> cobblestoneMat;
-	std::shared_ptr<Material> paintMat;
-	std::shared_ptr<Material> scratchedMat;
-	std::shared_ptr<Material> woodMat;
+	MaterialHandle bronzeMat;
+	MaterialHandle cobblestoneMat;
+	MaterialHandle paintMat;
+	MaterialHandle scratchedMat;
+	MaterialHandle woodMat;
 
 
 	std::shared_ptr<Sky> skyBox;
 
 
 	//entities
-	std::vector<std::shared_ptr<gameEntity>> gameEntities;
+	// - Components live in the store; gameEntities are handles to the named scene objects
+	EntityStore entityStore;
+	std::vector<gameEntity> gameEntities;
+
+	// Extra entities spawned from the UI to measure update/draw cost at scale
+	std::vector<EntityID> stressEntities;
+	int stressSpawnCount;
+	float entityUpdateMilliseconds;
+	void SpawnStressEntities(unsigned int count);
+	void ClearStressEntities();
+
+	// Sorted scene draws, rebuilt every frame
+	RenderQueue renderQueue;
+	RenderStats renderStats;
+	void DrawScene();
+
+	// Per-draw constants are bump-allocated out of this each frame
+	std::shared_ptr<ConstantBufferRing> constantRing;
+	bool useConstantRing;
+
+	// Every pass binds its state through one immutable PSO, and the
+	// tracker drops whatever the previous PSO already had bound
+	std::shared_ptr<PipelineStateCache> pipelineStates;
+	std::shared_ptr<StateTracker> stateTracker;
+	const PipelineState* ssaoDownsamplePipeline;
+	const PipelineState* ssaoPipeline;
+	const PipelineState* gtaoPipeline;
+	const PipelineState* ssaoTemporalPipeline;
+	const PipelineState* ssaoBlurPipeline;
+	const PipelineState* ssaoUpsamplePipeline;
+	const PipelineState* combinePipeline;
+	const PipelineState* blurPipeline;
+
+	// GPU time of the main passes, for comparing shadow filters
+	enum GpuSpan
+	{
+		GPU_SPAN_SHADOWS,
+		GPU_SPAN_SHADOW_FILTER,
+		GPU_SPAN_SCENE,
+		GPU_SPAN_SSAO,
+		GPU_SPAN_COUNT
+	};
+	std::shared_ptr<GpuTimer> gpuTimer;
+	void CreatePipelineStates();
+
+	// Draws sharing a mesh and material are drawn as one instanced call
+	InstanceBatcher instanceBatcher;
+	std::shared_ptr<SimpleVertexShader> instancedVertexShader;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> instanceBuffer;
+	unsigned int instanceBufferCapacity;
+	bool useInstancing;
+	void UploadInstanceData();
 
 	// Note the usage of ComPtr below
 	//  - This is a smart pointer for objects that abide by the
@@ -75,6 +173,10 @@ private:
 	// Shaders and shader-related constructs
 	std::shared_ptr<SimpleVertexShader> vertexShader;
 	std::shared_ptr<SimplePixelShader> pixelShader;
+
+	// Every compiled variant of pixelShader (which is the one with
+	// all features), looked up by a material's feature bits
+	ShaderPermutationTable<SimplePixelShader> pixelShaderVariants;
 	std::shared_ptr<SimplePixelShader> customPShader;
 
 	std::shared_ptr<SimpleVertexShader> skyVertexShader;
@@ -83,72 +185,157 @@ private:
 	DirectX::XMFLOAT3 ambientColor;
 	Light directionalLight1;
 
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> bronze_albedo;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> bronze_metal;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> bronze_normals;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> bronze_roughness;
-
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> cobblestone_albedo;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> cobblestone_metal;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> cobblestone_normals;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> cobblestone_roughness;
-
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> paint_albedo;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> paint_metal;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> paint_normals;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> paint_roughness;
-
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> scratched_albedo;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> scratched_metal;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> scratched_normals;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> scratched_roughness;
-
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> wood_albedo;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> wood_metal;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> wood_normals;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> wood_roughness;
-
 
 	Microsoft::WRL::ComPtr<ID3D11SamplerState> sampler;
 
-	Microsoft::WRL::ComPtr<ID3D11DepthStencilView> shadowDSV;
+	// Cascaded shadows for directional light 1: one slice of the
+	// shadow texture array per cascade, refit to the active camera
+	// every frame.  The resolution is its own setting, independent
+	// of the window's, and the array only has as many slices as
+	// the cascade setting asks for.
+	std::vector<Microsoft::WRL::ComPtr<ID3D11DepthStencilView>> shadowCascadeDSVs;
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> shadowTexture;
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> shadowSRV;
-	Microsoft::WRL::ComPtr<ID3D11RasterizerState> shadowRasterizer;
+	unsigned int shadowMapSize;	// At most MaxShadowMapSize
+	static const unsigned int MaxShadowMapSize = 8192;
+	ShadowCascade shadowCascades[ShadowCascades::MaxCascades];
+	unsigned int shadowCascadeCount;
+	int shadowCascadeSetting;
+	float shadowSplitLambda;
+	float shadowDistance;
+	void UpdateShadowCascades();
+
+	// Static casters are drawn into a second array once, and each
+	// frame a cascade starts as a copy of its window of the cached
+	// slice with only the dynamic casters drawn on top.  Each cached
+	// slice covers a region shadowCacheMargin texels wider than its
+	// cascade on every side (ShadowCascades::FitCacheRegion), so the
+	// camera can wander without a rebuild.  A slice is rebuilt when
+	// its cascade leaves the region, the light turns, the cascade
+	// changes size or a static entity changed.  The cache array
+	// only exists while caching is on.
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> shadowCacheTexture;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> shadowCacheSRV;
+	std::vector<Microsoft::WRL::ComPtr<ID3D11DepthStencilView>> shadowCacheDSVs;
+	ShadowCascade shadowCacheRegions[ShadowCascades::MaxCascades];
+	unsigned int shadowCacheVersions[ShadowCascades::MaxCascades];
+	bool shadowCacheValid[ShadowCascades::MaxCascades];
+	unsigned int shadowCacheMargin;
+	bool useShadowCache;
+	std::shared_ptr<SimplePixelShader> shadowCacheCopyPS;
+	const PipelineState* shadowCacheCopyPipeline;
+	void CreateShadowCacheTextures();
+	void InvalidateShadowCache();
+	void DrawShadowCasters(const ShadowCascade& cascade, bool staticCasters, bool dynamicCasters);
+	void DrawShadowCaster(size_t index, ID3D11Buffer*& lastVertexBuffer);
+	const PipelineState* shadowPipeline;
 	Microsoft::WRL::ComPtr<ID3D11SamplerState> shadowSampler;
+
+	// How the cascades are filtered (ShadowFilter).  EVSM turns
+	// each cascade into moments and blurs them once at shadow map
+	// resolution, so the scene needs only one filtered fetch.  The
+	// moment textures only exist while EVSM is selected.
+	int shadowFilter;
+	int shadowPCFRadius;
+	int evsmBlurRadius;
+	float evsmLightBleedReduction;
+	std::vector<Microsoft::WRL::ComPtr<ID3D11RenderTargetView>> shadowMomentRTVs;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> shadowMomentSRV;
+	Microsoft::WRL::ComPtr<ID3D11RenderTargetView> shadowMomentTempRTV;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> shadowMomentTempSRV;
+	std::shared_ptr<SimplePixelShader> evsmConvertPS;
+	std::shared_ptr<SimplePixelShader> evsmBlurPS;
+	const PipelineState* evsmConvertPipeline;
+	const PipelineState* evsmBlurPipeline;
+	void CreateShadowMomentTextures();
+	void FilterShadowMoments();
 	std::shared_ptr<SimpleVertexShader> shadowVShader;
-	DirectX::XMFLOAT4X4 lightViewMatrix;
-	DirectX::XMFLOAT4X4 lightProjectionMatrix;
+	unsigned int shadowPerObjectBuffer;
+
+	// Point and spot lights.  Their shadows share one atlas: tiles
+	// are sized by how much of the screen each light covers, and
+	// only the most important few changed lights are re-rendered
+	// each frame (see ShadowAtlas.h)
+	std::vector<Light> localLights;
+	std::vector<LocalShadow> localShadows;	// Parallel to localLights
+	bool animateLocalLights;
+	std::shared_ptr<ShadowAtlas> shadowAtlas;
+	Microsoft::WRL::ComPtr<ID3D11DepthStencilView> shadowAtlasDSV;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> shadowAtlasSRV;
+	const PipelineState* localShadowPipeline;
+	const PipelineState* shadowTileClearPipeline;
+	int localShadowBudget;
+	unsigned int localShadowFrame;
+	unsigned int localShadowUpdates;
+	void CreateShadowAtlas();
+	void RenderLocalShadows();
+	void RenderLocalShadow(LocalShadow& shadow, const Light& light);
 
 	// Resources that are shared among all post processes
 	Microsoft::WRL::ComPtr<ID3D11SamplerState> ppSampler;
 	std::shared_ptr<SimpleVertexShader> ppVS;
 
+	// The frame from shadows to the back buffer, declared anew
+	// each frame (see RenderGraph.h).  The G-buffer, SSAO and
+	// post textures are the graph's transients, so they share
+	// memory where their lifetimes allow.
+	RenderGraph renderGraph;
+	std::shared_ptr<RenderTargetPool> renderTargetPool;
+	std::shared_ptr<RenderGraphExecutor> graphExecutor;
+	void BuildRenderGraph();
+
 	// Resources that are tied to a particular post process
+	// - The final blur is separable (see GaussianBlur.h); the
+	//   pyramid blurs large radii at a fraction of the size
 	std::shared_ptr<SimplePixelShader> blurPPPS;
-	Microsoft::WRL::ComPtr<ID3D11RenderTargetView> ppRTV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> ppSRV;
 	int blur;
+	bool useBlurPyramid;
+	void AddBlurPass(const std::string& name, RenderGraphResource source, RenderGraphResource target,
+		DirectX::XMFLOAT2 direction, int radius);
 
-	Microsoft::WRL::ComPtr<ID3D11RenderTargetView> colorRTV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> colorSRV;
-
-	Microsoft::WRL::ComPtr<ID3D11RenderTargetView> ambientRTV; 
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> ambientSRV; 
-
-	Microsoft::WRL::ComPtr<ID3D11RenderTargetView> normalsRTV; 
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> normalsSRV; 
-
-	Microsoft::WRL::ComPtr<ID3D11RenderTargetView> depthRTV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> depthSRV; 
-
-	Microsoft::WRL::ComPtr<ID3D11RenderTargetView> SSAORTV; 
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> SSAOSRV;
+	// - SSAO runs at 1 / ssaoScale of the window's size, from a
+	//   shrunk copy of the G-buffer, and is brought back up by a
+	//   depth-aware upsample (see SSAOResample.h)
 	std::shared_ptr<SimplePixelShader> ppssaoPS;
-
-	Microsoft::WRL::ComPtr<ID3D11RenderTargetView> blurredSSAORTV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>blurredSSAOSRV;
 	std::shared_ptr<SimplePixelShader> ppssaoblurPS;
+	std::shared_ptr<SimplePixelShader> ssaoDownsamplePS;
+	std::shared_ptr<SimplePixelShader> ssaoUpsamplePS;
 	std::shared_ptr<SimplePixelShader> combinePS;
+	int ssaoScale;
+	float ssaoDepthTolerance;
+
+	// - AO is either the hemisphere kernel test or GTAO, which
+	//   marches a few screen space slices for their horizons
+	//   (see GTAO.h); both feed the same blur and upsample,
+	//   which only carry the AO.  GTAO's bent normal (gba of
+	//   its target) is debug output and isn't used for lighting
+	enum AOMethod
+	{
+		AO_METHOD_HEMISPHERE,
+		AO_METHOD_GTAO,
+		AO_METHOD_COUNT
+	};
+	int aoMethod;
+	std::shared_ptr<SimplePixelShader> gtaoPS;
+	int gtaoSlices;
+	int gtaoSteps;
+	float ssaoMilliseconds[AO_METHOD_COUNT][3];	// Last GPU time of each method at full, half and quarter size
+
+	// - Temporal SSAO takes a few kernel offsets a frame and blends
+	//   them into a reprojected history (see TemporalAO.h).  The
+	//   two history textures swap each frame.
+	std::shared_ptr<SimplePixelShader> ssaoTemporalPS;
+	bool ssaoTemporal;
+	uint32_t ssaoFrame;
+	Microsoft::WRL::ComPtr<ID3D11RenderTargetView> ssaoHistoryRTVs[2];
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> ssaoHistorySRVs[2];
+	uint32_t ssaoHistoryWidth;
+	uint32_t ssaoHistoryHeight;
+	int ssaoHistoryIndex;
+	bool ssaoHistoryValid;
+	DirectX::XMFLOAT4X4 ssaoPreviousView;
+	DirectX::XMFLOAT4X4 ssaoPreviousProjection;
+	void CreateSSAOHistory(uint32_t width, uint32_t height);
 
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>randomTextureSRV;
 
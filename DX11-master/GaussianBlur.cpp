@@ -0,0 +1,148 @@
+#include "GaussianBlur.h"
+#include <cmath>
+
+// SSE2 is part of every x64 target; GAUSSIAN_BLUR_SCALAR forces
+// the plain version, to check one against the other
+#if (defined(_M_X64) || defined(__SSE2__)) && !defined(GAUSSIAN_BLUR_SCALAR)
+#include <emmintrin.h>
+
+typedef __m128 Texel;
+static inline Texel Load(const float* p) { return _mm_loadu_ps(p); }
+static inline void Store(float* p, Texel t) { _mm_storeu_ps(p, t); }
+static inline Texel Zero() { return _mm_setzero_ps(); }
+static inline Texel Lerp(Texel a, Texel b, float t) { return _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), _mm_set1_ps(t))); }
+static inline Texel MultiplyAdd(Texel total, Texel t, float weight) { return _mm_add_ps(total, _mm_mul_ps(t, _mm_set1_ps(weight))); }
+#else
+struct Texel { float V[4]; };
+static inline Texel Load(const float* p) { Texel t = { { p[0], p[1], p[2], p[3] } }; return t; }
+static inline void Store(float* p, Texel t) { for (int c = 0; c < 4; c++) p[c] = t.V[c]; }
+static inline Texel Zero() { Texel t = {}; return t; }
+static inline Texel Lerp(Texel a, Texel b, float t)
+{
+	for (int c = 0; c < 4; c++)
+		a.V[c] = a.V[c] + (b.V[c] - a.V[c]) * t;
+	return a;
+}
+static inline Texel MultiplyAdd(Texel total, Texel t, float weight)
+{
+	for (int c = 0; c < 4; c++)
+		total.V[c] += t.V[c] * weight;
+	return total;
+}
+#endif
+
+float GaussianBlur::Sigma(int radius)
+{
+	return radius * 0.5f;
+}
+
+void GaussianBlur::Weights(int radius, std::vector<float>& weights)
+{
+	weights.resize(radius + 1);
+	if (radius == 0)
+	{
+		weights[0] = 1.0f;
+		return;
+	}
+
+	float sigma = Sigma(radius);
+	float total = 0.0f;
+	for (int i = 0; i <= radius; i++)
+	{
+		weights[i] = expf(-(float)(i * i) / (2.0f * sigma * sigma));
+		total += i == 0 ? weights[i] : 2.0f * weights[i];
+	}
+	for (float& weight : weights)
+		weight /= total;
+}
+
+void GaussianBlur::Taps(int radius, std::vector<GaussianTap>& taps)
+{
+	std::vector<float> weights;
+	Weights(radius, weights);
+
+	taps.clear();
+	GaussianTap center = { 0.0f, weights[0] };
+	taps.push_back(center);
+	for (int i = 1; i <= radius; i += 2)
+	{
+		GaussianTap tap = { (float)i, weights[i] };
+		if (i + 1 <= radius)
+		{
+			// Between texels i and i + 1, nearer the heavier one
+			tap.Weight = weights[i] + weights[i + 1];
+			tap.Offset = i + weights[i + 1] / tap.Weight;
+		}
+		taps.push_back(tap);
+	}
+}
+
+int GaussianBlur::PyramidLevels(int radius, int& levelRadius)
+{
+	int levels = 0;
+	while (radius > MaxLevelRadius)
+	{
+		radius = (radius + 1) / 2;
+		levels++;
+	}
+	levelRadius = radius;
+	return levels;
+}
+
+// --------------------------------------------------------
+// A bilinear, clamped fetch offset texels along a row or
+// column of count texels, spaced stride floats apart
+// --------------------------------------------------------
+static Texel Fetch(const float* line, int count, size_t stride, int position, float offset)
+{
+	float t = position + offset;
+	float whole = floorf(t);
+	float fraction = floorf((t - whole) * 256.0f + 0.5f) / 256.0f;
+
+	int i0 = (int)whole;
+	int i1 = i0 + 1;
+	i0 = i0 < 0 ? 0 : (i0 > count - 1 ? count - 1 : i0);
+	i1 = i1 < 0 ? 0 : (i1 > count - 1 ? count - 1 : i1);
+	return Lerp(Load(line + i0 * stride), Load(line + i1 * stride), fraction);
+}
+
+static void BlurLine(const float* source, float* destination, int count, size_t stride, const std::vector<GaussianTap>& taps)
+{
+	for (int i = 0; i < count; i++)
+	{
+		Texel total = MultiplyAdd(Zero(), Load(source + i * stride), taps[0].Weight);
+		for (size_t t = 1; t < taps.size(); t++)
+		{
+			total = MultiplyAdd(total, Fetch(source, count, stride, i, taps[t].Offset), taps[t].Weight);
+			total = MultiplyAdd(total, Fetch(source, count, stride, i, -taps[t].Offset), taps[t].Weight);
+		}
+		Store(destination + i * stride, total);
+	}
+}
+
+void GaussianBlur::BlurHorizontal(const float* source, uint32_t width, uint32_t height,
+	const std::vector<GaussianTap>& taps, float* destination)
+{
+	for (uint32_t y = 0; y < height; y++)
+	{
+		size_t row = (size_t)y * width * 4;
+		BlurLine(source + row, destination + row, (int)width, 4, taps);
+	}
+}
+
+void GaussianBlur::BlurVertical(const float* source, uint32_t width, uint32_t height,
+	const std::vector<GaussianTap>& taps, float* destination)
+{
+	for (uint32_t x = 0; x < width; x++)
+		BlurLine(source + x * 4, destination + x * 4, (int)height, (size_t)width * 4, taps);
+}
+
+void GaussianBlur::Blur(const float* source, uint32_t width, uint32_t height, int radius, float* destination)
+{
+	std::vector<GaussianTap> taps;
+	Taps(radius, taps);
+
+	std::vector<float> horizontal((size_t)width * height * 4);
+	BlurHorizontal(source, width, height, taps, horizontal.data());
+	BlurVertical(horizontal.data(), width, height, taps, destination);
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+// --------------------------------------------------------
+// One bilinear fetch of the separable blur: taken at
+// +Offset and -Offset texels from the pixel (just once for
+// the center tap) and scaled by Weight
+// --------------------------------------------------------
+struct GaussianTap
+{
+	float Offset;
+	float Weight;
+};
+
+// --------------------------------------------------------
+// The final blur's kernel, and a CPU reference of the blur
+// matching PPPixelShader.hlsl step for step.
+//
+// A radius r blur is a horizontal then a vertical pass over
+// the 2r + 1 texel Gaussian with sigma r / 2, truncated and
+// renormalized.  Neighbouring texel pairs are merged into
+// one bilinear fetch placed between them by weight, so a
+// pass takes (r + 1) / 2 taps a side plus the center, about
+// r + 1 fetches rather than 2r + 1.
+//
+// Past MaxLevelRadius the image is first halved (each time
+// with one bilinear fetch per pixel, a 2x2 average) until
+// the radius left fits, then blurred and scaled back up.
+//
+// Pixels are RGBA floats, row by row.  Fetches are rebuilt
+// as the sampler does them: clamped addressing, and the
+// fraction between texels rounded to the 8 bits Direct3D
+// guarantees.  After both targets round to 8 bits, results
+// should agree with the GPU to within one step; the order
+// of the GPU's filter arithmetic isn't specified exactly.
+// --------------------------------------------------------
+class GaussianBlur
+{
+public:
+	static const int MaxRadius = 32;
+	static const int MaxTaps = MaxRadius / 2 + 1;	// Size of taps[] in PPPixelShader.hlsl
+	static const int MaxLevelRadius = 8;
+
+	static float Sigma(int radius);
+
+	// weights[i] for the texels i away from the center, i in [0, radius]
+	static void Weights(int radius, std::vector<float>& weights);
+	static void Taps(int radius, std::vector<GaussianTap>& taps);
+
+	// Times the image is halved before a radius blur, if the
+	// pyramid is used, and the radius left to blur it by
+	static int PyramidLevels(int radius, int& levelRadius);
+
+	static void BlurHorizontal(const float* source, uint32_t width, uint32_t height,
+		const std::vector<GaussianTap>& taps, float* destination);
+	static void BlurVertical(const float* source, uint32_t width, uint32_t height,
+		const std::vector<GaussianTap>& taps, float* destination);
+
+	// Both passes at full resolution
+	static void Blur(const float* source, uint32_t width, uint32_t height, int radius, float* destination);
+};
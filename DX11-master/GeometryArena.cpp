@@ -0,0 +1,169 @@
+#include "GeometryArena.h"
+
+GeometryArena::GeometryArena(Microsoft::WRL::ComPtr<ID3D11Device> _device,
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> _context,
+	UINT vertexCapacity,
+	UINT indexCapacity)
+	: vertexAllocator(vertexCapacity), indexAllocator(indexCapacity)
+{
+	device = _device;
+	context = _context;
+
+	vertexBuffer = CreateBuffer(sizeof(Vertex) * vertexCapacity, D3D11_BIND_VERTEX_BUFFER);
+	indexBuffer = CreateBuffer(sizeof(unsigned int) * indexCapacity, D3D11_BIND_INDEX_BUFFER);
+}
+
+unsigned int GeometryArena::Add(const Vertex* vertices, UINT vertexCount, const unsigned int* indices, UINT indexCount)
+{
+	// Make room first if either buffer is out of space
+	UINT baseVertex = vertexAllocator.Allocate(vertexCount);
+	if (baseVertex == ArenaAllocator::InvalidOffset)
+	{
+		GrowBuffer(vertexBuffer, vertexAllocator, sizeof(Vertex), D3D11_BIND_VERTEX_BUFFER, vertexCount);
+		baseVertex = vertexAllocator.Allocate(vertexCount);
+	}
+
+	UINT startIndex = indexAllocator.Allocate(indexCount);
+	if (startIndex == ArenaAllocator::InvalidOffset)
+	{
+		GrowBuffer(indexBuffer, indexAllocator, sizeof(unsigned int), D3D11_BIND_INDEX_BUFFER, indexCount);
+		startIndex = indexAllocator.Allocate(indexCount);
+	}
+
+	// Copy this mesh's data into its ranges
+	const UINT vertexStride = sizeof(Vertex);
+	const UINT indexStride = sizeof(unsigned int);
+	D3D11_BOX vertexBox = { baseVertex * vertexStride, 0, 0, (baseVertex + vertexCount) * vertexStride, 1, 1 };
+	context->UpdateSubresource(vertexBuffer.Get(), 0, &vertexBox, vertices, 0, 0);
+
+	D3D11_BOX indexBox = { startIndex * indexStride, 0, 0, (startIndex + indexCount) * indexStride, 1, 1 };
+	context->UpdateSubresource(indexBuffer.Get(), 0, &indexBox, indices, 0, 0);
+
+	unsigned int id;
+	if (!freeIDs.empty())
+	{
+		id = freeIDs.back();
+		freeIDs.pop_back();
+	}
+	else
+	{
+		id = (unsigned int)ranges.size();
+		ranges.push_back({});
+		rangeAlive.push_back(false);
+	}
+
+	ranges[id] = { baseVertex, startIndex, vertexCount, indexCount };
+	rangeAlive[id] = true;
+	return id;
+}
+
+void GeometryArena::Remove(unsigned int id)
+{
+	if (id >= ranges.size() || !rangeAlive[id])
+		return;
+
+	vertexAllocator.Free(ranges[id].BaseVertex);
+	indexAllocator.Free(ranges[id].StartIndex);
+	rangeAlive[id] = false;
+	freeIDs.push_back(id);
+}
+
+// --------------------------------------------------------
+// Compacts both buffers and patches every live range to its
+// new location.  Meshes look their range up at draw time, so
+// nothing outside the arena needs to know.
+// --------------------------------------------------------
+void GeometryArena::Defragment()
+{
+	std::vector<ArenaMove> vertexMoves;
+	std::vector<ArenaMove> indexMoves;
+	vertexAllocator.Defragment(vertexMoves);
+	indexAllocator.Defragment(indexMoves);
+
+	ApplyMoves(vertexBuffer.Get(), sizeof(Vertex), vertexMoves);
+	ApplyMoves(indexBuffer.Get(), sizeof(unsigned int), indexMoves);
+
+	for (size_t i = 0; i < ranges.size(); i++)
+	{
+		if (!rangeAlive[i])
+			continue;
+
+		for (const ArenaMove& m : vertexMoves)
+		{
+			if (m.OldOffset == ranges[i].BaseVertex)
+			{
+				ranges[i].BaseVertex = m.NewOffset;
+				break;
+			}
+		}
+		for (const ArenaMove& m : indexMoves)
+		{
+			if (m.OldOffset == ranges[i].StartIndex)
+			{
+				ranges[i].StartIndex = m.NewOffset;
+				break;
+			}
+		}
+	}
+}
+
+void GeometryArena::SetBuffers()
+{
+	UINT stride = sizeof(Vertex);
+	UINT offset = 0;
+	context->IASetVertexBuffers(0, 1, vertexBuffer.GetAddressOf(), &stride, &offset);
+	context->IASetIndexBuffer(indexBuffer.Get(), DXGI_FORMAT_R32_UINT, 0);
+}
+
+Microsoft::WRL::ComPtr<ID3D11Buffer> GeometryArena::CreateBuffer(UINT byteWidth, UINT bindFlags)
+{
+	// Default usage, so ranges can be filled with UpdateSubresource
+	// and moved around with CopySubresourceRegion
+	D3D11_BUFFER_DESC desc = {};
+	desc.Usage = D3D11_USAGE_DEFAULT;
+	desc.ByteWidth = byteWidth;
+	desc.BindFlags = bindFlags;
+
+	Microsoft::WRL::ComPtr<ID3D11Buffer> buffer;
+	device->CreateBuffer(&desc, 0, buffer.GetAddressOf());
+	return buffer;
+}
+
+void GeometryArena::GrowBuffer(Microsoft::WRL::ComPtr<ID3D11Buffer>& buffer, ArenaAllocator& allocator, UINT stride, UINT bindFlags, UINT required)
+{
+	UINT oldCapacity = allocator.GetCapacity();
+	UINT newCapacity = oldCapacity * 2;
+	if (newCapacity < oldCapacity + required)
+		newCapacity = oldCapacity + required;
+
+	// Carry the existing contents over to the bigger buffer
+	Microsoft::WRL::ComPtr<ID3D11Buffer> grown = CreateBuffer(newCapacity * stride, bindFlags);
+	if (oldCapacity > 0)
+	{
+		D3D11_BOX box = { 0, 0, 0, oldCapacity * stride, 1, 1 };
+		context->CopySubresourceRegion(grown.Get(), 0, 0, 0, 0, buffer.Get(), 0, &box);
+	}
+
+	buffer = grown;
+	allocator.Grow(newCapacity);
+}
+
+void GeometryArena::ApplyMoves(ID3D11Buffer* buffer, UINT stride, const std::vector<ArenaMove>& moves)
+{
+	if (moves.empty())
+		return;
+
+	// A move's source and destination can overlap, which a copy
+	// within one resource doesn't allow, so copy out and back
+	D3D11_BUFFER_DESC desc = {};
+	buffer->GetDesc(&desc);
+	Microsoft::WRL::ComPtr<ID3D11Buffer> scratch = CreateBuffer(desc.ByteWidth, desc.BindFlags);
+	D3D11_BOX all = { 0, 0, 0, desc.ByteWidth, 1, 1 };
+	context->CopySubresourceRegion(scratch.Get(), 0, 0, 0, 0, buffer, 0, &all);
+
+	for (const ArenaMove& m : moves)
+	{
+		D3D11_BOX box = { m.OldOffset * stride, 0, 0, (m.OldOffset + m.Size) * stride, 1, 1 };
+		context->CopySubresourceRegion(buffer, 0, m.NewOffset * stride, 0, 0, scratch.Get(), 0, &box);
+	}
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <vector>
+#include "Vertex.h"
+#include "ArenaAllocator.h"
+
+// --------------------------------------------------------
+// Where one mesh lives inside a GeometryArena.  Indices are
+// stored relative to the mesh's own vertices and offset by
+// BaseVertex at draw time, so moving a mesh never requires
+// rewriting its indices.
+// --------------------------------------------------------
+struct GeometryRange
+{
+	UINT BaseVertex;
+	UINT StartIndex;
+	UINT VertexCount;
+	UINT IndexCount;
+};
+
+// --------------------------------------------------------
+// One large vertex buffer and one large index buffer shared
+// by many meshes.  Every mesh in the arena draws from the
+// same two buffers, so switching between them needs no
+// input assembler rebinds.
+//
+// Space is handed out by a pair of ArenaAllocators; the
+// buffers grow (by doubling) when they run out.
+// --------------------------------------------------------
+class GeometryArena
+{
+public:
+	static const unsigned int InvalidID = 0xFFFFFFFF;
+
+	GeometryArena(Microsoft::WRL::ComPtr<ID3D11Device> _device,
+		Microsoft::WRL::ComPtr<ID3D11DeviceContext> _context,
+		UINT vertexCapacity,
+		UINT indexCapacity);
+
+	// Returns an ID for GetRange()/Remove(), stable across Defragment()
+	unsigned int Add(const Vertex* vertices, UINT vertexCount, const unsigned int* indices, UINT indexCount);
+	void Remove(unsigned int id);
+	const GeometryRange& GetRange(unsigned int id) const { return ranges[id]; }
+
+	// Packs live meshes together on the GPU, closing the holes left by Remove()
+	void Defragment();
+
+	void SetBuffers();
+	ID3D11Buffer* GetVertexBuffer() const { return vertexBuffer.Get(); }
+	ID3D11Buffer* GetIndexBuffer() const { return indexBuffer.Get(); }
+
+	const ArenaAllocator& GetVertexAllocator() const { return vertexAllocator; }
+	const ArenaAllocator& GetIndexAllocator() const { return indexAllocator; }
+
+private:
+	Microsoft::WRL::ComPtr<ID3D11Device> device;
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context;
+
+	Microsoft::WRL::ComPtr<ID3D11Buffer> vertexBuffer;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> indexBuffer;
+	ArenaAllocator vertexAllocator;
+	ArenaAllocator indexAllocator;
+
+	std::vector<GeometryRange> ranges;
+	std::vector<bool> rangeAlive;
+	std::vector<unsigned int> freeIDs;
+
+	Microsoft::WRL::ComPtr<ID3D11Buffer> CreateBuffer(UINT byteWidth, UINT bindFlags);
+	void GrowBuffer(Microsoft::WRL::ComPtr<ID3D11Buffer>& buffer, ArenaAllocator& allocator, UINT stride, UINT bindFlags, UINT required);
+	void ApplyMoves(ID3D11Buffer* buffer, UINT stride, const std::vector<ArenaMove>& moves);
+};
@@ -0,0 +1,82 @@
+#include "GpuTimer.h"
+
+GpuTimer::GpuTimer(Microsoft::WRL::ComPtr<ID3D11Device> _device,
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> _context,
+	unsigned int _spanCount)
+	: context(_context), spanCount(_spanCount), frame(0), milliseconds(_spanCount, 0.0f)
+{
+	D3D11_QUERY_DESC disjointDesc = {};
+	disjointDesc.Query = D3D11_QUERY_TIMESTAMP_DISJOINT;
+	D3D11_QUERY_DESC timestampDesc = {};
+	timestampDesc.Query = D3D11_QUERY_TIMESTAMP;
+
+	for (FrameQueries& queries : frames)
+	{
+		_device->CreateQuery(&disjointDesc, queries.Disjoint.GetAddressOf());
+		queries.Begins.resize(spanCount);
+		queries.Ends.resize(spanCount);
+		for (unsigned int s = 0; s < spanCount; s++)
+		{
+			_device->CreateQuery(&timestampDesc, queries.Begins[s].GetAddressOf());
+			_device->CreateQuery(&timestampDesc, queries.Ends[s].GetAddressOf());
+		}
+		queries.Used.assign(spanCount, false);
+		queries.Issued = false;
+	}
+}
+
+void GpuTimer::BeginFrame()
+{
+	FrameQueries& queries = frames[frame % FrameLatency];
+
+	// Read back what this slot measured FrameLatency frames ago
+	// before its queries are reused
+	if (queries.Issued)
+		Collect(queries);
+
+	queries.Used.assign(spanCount, false);
+	queries.Issued = false;
+	context->Begin(queries.Disjoint.Get());
+}
+
+void GpuTimer::EndFrame()
+{
+	FrameQueries& queries = frames[frame % FrameLatency];
+	context->End(queries.Disjoint.Get());
+	queries.Issued = true;
+	frame++;
+}
+
+void GpuTimer::Begin(unsigned int span)
+{
+	FrameQueries& queries = frames[frame % FrameLatency];
+	context->End(queries.Begins[span].Get());
+}
+
+void GpuTimer::End(unsigned int span)
+{
+	FrameQueries& queries = frames[frame % FrameLatency];
+	context->End(queries.Ends[span].Get());
+	queries.Used[span] = true;
+}
+
+void GpuTimer::Collect(FrameQueries& queries)
+{
+	D3D11_QUERY_DATA_TIMESTAMP_DISJOINT disjoint;
+	if (context->GetData(queries.Disjoint.Get(), &disjoint, sizeof(disjoint), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK ||
+		disjoint.Disjoint)
+		return;
+
+	for (unsigned int s = 0; s < spanCount; s++)
+	{
+		UINT64 begin, end;
+		if (!queries.Used[s] ||
+			context->GetData(queries.Begins[s].Get(), &begin, sizeof(begin), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK ||
+			context->GetData(queries.Ends[s].Get(), &end, sizeof(end), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK)
+			continue;
+
+		// Smoothed, or the numbers are unreadable in the UI
+		float measured = (float)((double)(end - begin) / disjoint.Frequency * 1000.0);
+		milliseconds[s] = milliseconds[s] == 0.0f ? measured : milliseconds[s] * 0.9f + measured * 0.1f;
+	}
+}
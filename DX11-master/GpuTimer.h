@@ -0,0 +1,53 @@
+#pragma once
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <vector>
+
+// --------------------------------------------------------
+// GPU time of a few numbered spans of the frame, from
+// timestamp queries.  Each frame gets its own set of
+// queries, and results are read back FrameLatency frames
+// later without flushing, so the CPU never waits on the
+// GPU.  A frame that isn't ready yet or was disjoint (clock
+// changed mid-frame) keeps the previous numbers.
+//
+// Spans may nest or overlap; each one is just the time
+// between its Begin() and End() on the GPU timeline.
+// --------------------------------------------------------
+class GpuTimer
+{
+public:
+	static const unsigned int FrameLatency = 4;
+
+	GpuTimer(Microsoft::WRL::ComPtr<ID3D11Device> _device,
+		Microsoft::WRL::ComPtr<ID3D11DeviceContext> _context,
+		unsigned int _spanCount);
+
+	// Bracket everything measured in a frame
+	void BeginFrame();
+	void EndFrame();
+
+	void Begin(unsigned int span);
+	void End(unsigned int span);
+
+	// Smoothed over the last few readbacks; 0 if never measured
+	float GetMilliseconds(unsigned int span) const { return milliseconds[span]; }
+
+private:
+	struct FrameQueries
+	{
+		Microsoft::WRL::ComPtr<ID3D11Query> Disjoint;
+		std::vector<Microsoft::WRL::ComPtr<ID3D11Query>> Begins;
+		std::vector<Microsoft::WRL::ComPtr<ID3D11Query>> Ends;
+		std::vector<bool> Used;
+		bool Issued;
+	};
+
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context;
+	unsigned int spanCount;
+	unsigned int frame;
+	FrameQueries frames[FrameLatency];
+	std::vector<float> milliseconds;
+
+	void Collect(FrameQueries& queries);
+};
@@ -0,0 +1,70 @@
+#include "InstanceBatcher.h"
+#include <cstring>
+
+void InstanceBatcher::Clear()
+{
+	// Keeps capacity, so steady-state frames don't allocate
+	pending.clear();
+	pendingData.clear();
+	batchLookup.clear();
+	batches.clear();
+	instances.clear();
+	userIndices.clear();
+}
+
+void InstanceBatcher::Add(unsigned int meshID, unsigned int materialID, const float world[16], const float worldInverseTranspose[16], unsigned int userIndex)
+{
+	// Find or start the group for this mesh/material pair
+	uint64_t groupKey = ((uint64_t)meshID << 32) | materialID;
+	auto found = batchLookup.find(groupKey);
+	unsigned int batch;
+	if (found == batchLookup.end())
+	{
+		batch = (unsigned int)batches.size();
+		batchLookup.insert({ groupKey, batch });
+		batches.push_back({ meshID, materialID, 0, 0 });
+	}
+	else
+	{
+		batch = found->second;
+	}
+	batches[batch].InstanceCount++;
+
+	pending.push_back({ batch, userIndex });
+
+	InstanceData data;
+	memcpy(data.World, world, sizeof(data.World));
+	memcpy(data.WorldInverseTranspose, worldInverseTranspose, sizeof(data.WorldInverseTranspose));
+	pendingData.push_back(data);
+}
+
+// --------------------------------------------------------
+// Counting sort of the pending draws by group: the counts
+// gathered in Add() become each group's first instance, then
+// every draw is scattered into its group's range.
+// --------------------------------------------------------
+void InstanceBatcher::Build()
+{
+	unsigned int offset = 0;
+	for (InstanceBatch& b : batches)
+	{
+		b.FirstInstance = offset;
+		offset += b.InstanceCount;
+	}
+
+	instances.resize(pending.size());
+	userIndices.resize(pending.size());
+
+	// Reuse the instance counts as write cursors; they count
+	// back up to their original values as draws are placed
+	for (InstanceBatch& b : batches)
+		b.InstanceCount = 0;
+
+	for (size_t i = 0; i < pending.size(); i++)
+	{
+		InstanceBatch& b = batches[pending[i].Batch];
+		unsigned int slot = b.FirstInstance + b.InstanceCount++;
+		instances[slot] = pendingData[i];
+		userIndices[slot] = pending[i].UserIndex;
+	}
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// --------------------------------------------------------
+// Per-instance data streamed to the instanced vertex shader.
+// Matrices are row-major, laid out like XMFLOAT4X4, so the
+// whole struct can be copied straight into a vertex buffer.
+// --------------------------------------------------------
+struct InstanceData
+{
+	float World[16];
+	float WorldInverseTranspose[16];
+};
+
+// --------------------------------------------------------
+// One group of draws sharing a mesh and a material.  Its
+// instances occupy [FirstInstance, FirstInstance + InstanceCount)
+// of the packed instance stream.
+// --------------------------------------------------------
+struct InstanceBatch
+{
+	unsigned int MeshID;
+	unsigned int MaterialID;
+	unsigned int FirstInstance;
+	unsigned int InstanceCount;
+};
+
+// --------------------------------------------------------
+// Groups draws by (mesh, material) and packs their per-instance
+// data into one contiguous stream, one range per group.
+//
+// Groups are emitted in the order their first draw was added,
+// so feeding this an already sorted draw list keeps that order.
+// --------------------------------------------------------
+class InstanceBatcher
+{
+public:
+	void Clear();
+
+	// userIndex is handed back in GetUserIndices(), parallel to the instance stream
+	void Add(unsigned int meshID, unsigned int materialID, const float world[16], const float worldInverseTranspose[16], unsigned int userIndex);
+	void Build();
+
+	const std::vector<InstanceBatch>& GetBatches() const { return batches; }
+	const std::vector<InstanceData>& GetInstances() const { return instances; }
+	const std::vector<unsigned int>& GetUserIndices() const { return userIndices; }
+
+private:
+	struct PendingDraw
+	{
+		unsigned int Batch;
+		unsigned int UserIndex;
+	};
+
+	std::vector<PendingDraw> pending;
+	std::vector<InstanceData> pendingData;
+	std::unordered_map<uint64_t, unsigned int> batchLookup;
+
+	std::vector<InstanceBatch> batches;
+	std::vector<InstanceData> instances;
+	std::vector<unsigned int> userIndices;
+};
@@ -2,15 +2,27 @@
 #include <vector>
 #include <DirectXMath.h>
 
+// Unique per mesh, used when sorting draws
+unsigned int Mesh::nextID = 0;
 
 Microsoft::WRL::ComPtr<ID3D11Buffer> Mesh::GetVertexBuffer()
 {
-	return vertexBuffer;
+	return arena ? arena->GetVertexBuffer() : vertexBuffer;
 }
 
 Microsoft::WRL::ComPtr<ID3D11Buffer> Mesh::GetIndexBuffer()
 {
-	return indexBuffer;
+	return arena ? arena->GetIndexBuffer() : indexBuffer;
+}
+
+// --------------------------------------------------------
+// The vertex buffer SetBuffers() binds.  Meshes sharing an
+// arena return the same one, so draw loops can compare this
+// to skip rebinding.
+// --------------------------------------------------------
+ID3D11Buffer* Mesh::GetBoundVertexBuffer()
+{
+	return arena ? arena->GetVertexBuffer() : vertexBuffer.Get();
 }
 
 UINT Mesh::GetIndexCount()
@@ -18,13 +30,29 @@ UINT Mesh::GetIndexCount()
 	return indexCount;
 }
 
-void Mesh::Draw()
+unsigned int Mesh::GetID()
+{
+	return id;
+}
+
+const DirectX::BoundingSphere& Mesh::GetLocalBounds()
+{
+	return localBounds;
+}
+
+void Mesh::SetBuffers()
 {
 	/*NOETS
 	* DRAW geometry
 	* - These steps are generally repeated for EACH object you draw
 	* - Other Direct3D calls will also be necessary to do more complex thing
 	*/
+	if (arena)
+	{
+		arena->SetBuffers();
+		return;
+	}
+
 	UINT stride = sizeof(Vertex);
 	UINT offset = 0;
 
@@ -37,7 +65,10 @@ void Mesh::Draw()
 	*/
 	context->IASetVertexBuffers(0, 1, vertexBuffer.GetAddressOf(), &stride, &offset);
 	context->IASetIndexBuffer(indexBuffer.Get(), DXGI_FORMAT_R32_UINT, 0);
+}
 
+void Mesh::DrawIndexed()
+{
 	/*NOTES
 	*  Tell Direct3D to draw
 		  - Begins the rendering pipeline on the GPU
@@ -46,15 +77,63 @@ void Mesh::Draw()
 		  - DrawIndexed() uses the currently set INDEX BUFFER to look up corresponding
 		     vertices in the currently set VERTEX BUFFER
 	*/
+	UINT startIndex = 0;
+	INT baseVertex = 0;
+	if (arena)
+	{
+		const GeometryRange& range = arena->GetRange(arenaID);
+		startIndex = range.StartIndex;
+		baseVertex = range.BaseVertex;
+	}
+
 	context->DrawIndexed(
 		GetIndexCount(), //number of indices used
-		0,			//offset to the first index
-		0);			//offset to add to each index when looking up vertices
+		startIndex,	//offset to the first index
+		baseVertex);	//offset to add to each index when looking up vertices
+}
+
+// --------------------------------------------------------
+// Draws several instances of this mesh.  Per-instance data
+// must already be bound to input slot 1.
+// --------------------------------------------------------
+void Mesh::DrawInstanced(UINT instanceCount, UINT startInstance)
+{
+	UINT startIndex = 0;
+	INT baseVertex = 0;
+	if (arena)
+	{
+		const GeometryRange& range = arena->GetRange(arenaID);
+		startIndex = range.StartIndex;
+		baseVertex = range.BaseVertex;
+	}
+
+	context->DrawIndexedInstanced(
+		GetIndexCount(),	//number of indices per instance
+		instanceCount,		//number of instances
+		startIndex,			//offset to the first index
+		baseVertex,			//offset to add to each index
+		startInstance);		//offset into the per-instance data
+}
+
+void Mesh::Draw()
+{
+	SetBuffers();
+	DrawIndexed();
 }
 
 void Mesh::CreateBuffers(Vertex* verts, UINT vertexCount, unsigned int* indices, UINT indexCount, Microsoft::WRL::ComPtr<ID3D11Device> device)
 {
 	CalculateTangents(verts, vertexCount, indices, indexCount);
+
+	// Object-space bounds, used for culling
+	DirectX::BoundingSphere::CreateFromPoints(localBounds, vertexCount, &verts[0].Position, sizeof(Vertex));
+
+	// Shared geometry only needs a range in the arena's buffers
+	if (arena)
+	{
+		arenaID = arena->Add(verts, vertexCount, indices, indexCount);
+		return;
+	}
 	{
 		//vertexBuffer
 		//buffer desc
@@ -98,8 +177,11 @@ void Mesh::CreateBuffers(Vertex* verts, UINT vertexCount, unsigned int* indices,
 	}
 }
 
-Mesh::Mesh(Vertex* vertices, UINT vertexCount, unsigned int* indices, UINT _indexCount, Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> _context)
+Mesh::Mesh(Vertex* vertices, UINT vertexCount, unsigned int* indices, UINT _indexCount, Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> _context, GeometryArena* _arena)
 {
+	id = nextID++;
+	arena = _arena;
+	arenaID = GeometryArena::InvalidID;
 	indexCount = _indexCount;
 	CreateBuffers(vertices, vertexCount, indices, indexCount, device);
 	context = _context;
@@ -112,8 +194,11 @@ Mesh::Mesh(Vertex* vertices, UINT vertexCount, unsigned int* indices, UINT _inde
 /// <param name="obj"></param>
 /// <param name="device"></param>
 /// <param name="_context"></param>
-Mesh::Mesh(const std::wstring& objFile, Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> _context)
+Mesh::Mesh(const std::wstring& objFile, Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> _context, GeometryArena* _arena)
 {
+	id = nextID++;
+	arena = _arena;
+	arenaID = GeometryArena::InvalidID;
 	context = _context;
 
 	// File input object
@@ -313,7 +398,9 @@ Mesh::Mesh(const std::wstring& objFile, Microsoft::WRL::ComPtr<ID3D11Device> dev
 
 Mesh::~Mesh()
 {
-
+	// Hand the range back, so the space can be reused
+	if (arena)
+		arena->Remove(arenaID);
 }
 
 // --------------------------------------------------------
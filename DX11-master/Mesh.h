@@ -2,7 +2,9 @@
 #include <memory>
 #include <d3d11.h>
 #include <wrl/client.h>
+#include <DirectXCollision.h>
 #include "Vertex.h"
+#include "GeometryArena.h"
 #include <fstream>
 
 class Mesh
@@ -12,6 +14,15 @@ private:
 	Microsoft::WRL::ComPtr<ID3D11Buffer> indexBuffer;
 	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context;
 	UINT indexCount;
+	unsigned int id;
+	DirectX::BoundingSphere localBounds;
+
+	// Set when the geometry lives in a shared arena instead of
+	// this mesh's own buffers
+	GeometryArena* arena;
+	unsigned int arenaID;
+
+	static unsigned int nextID;
 
 public:
 	Mesh(Vertex* vertices,
@@ -19,14 +30,22 @@ public:
 		unsigned int* indices,
 		UINT _indexCount,
 		Microsoft::WRL::ComPtr<ID3D11Device> device,
-		Microsoft::WRL::ComPtr<ID3D11DeviceContext> _context);
+		Microsoft::WRL::ComPtr<ID3D11DeviceContext> _context,
+		GeometryArena* _arena = 0);
 	Mesh(const std::wstring& objFile,
 		Microsoft::WRL::ComPtr<ID3D11Device> device,
-		Microsoft::WRL::ComPtr<ID3D11DeviceContext> _context);
+		Microsoft::WRL::ComPtr<ID3D11DeviceContext> _context,
+		GeometryArena* _arena = 0);
 	~Mesh();
 	Microsoft::WRL::ComPtr<ID3D11Buffer> GetVertexBuffer();
 	Microsoft::WRL::ComPtr<ID3D11Buffer> GetIndexBuffer();
 	UINT GetIndexCount();
+	ID3D11Buffer* GetBoundVertexBuffer();
+	unsigned int GetID();
+	const DirectX::BoundingSphere& GetLocalBounds();
+	void SetBuffers();
+	void DrawIndexed();
+	void DrawInstanced(UINT instanceCount, UINT startInstance);
 	void Draw();
 	void CreateBuffers(Vertex* verts, UINT vertexCount, unsigned int* indices, UINT indexCount, Microsoft::WRL::ComPtr<ID3D11Device> device);
 	void CalculateTangents(Vertex* verts, int numVerts, unsigned int* indices, int numIndices);
@@ -1,8 +1,13 @@
+// One pass of the separable Gaussian blur (see GaussianBlur.h).
+// taps[0] is the center; every other tap is a bilinear fetch
+// covering two texels, taken on both sides.  With a single tap
+// this is a plain bilinear copy, which the blur pyramid uses to
+// halve and restore the image.
 cbuffer externalData : register(b0)
 {
-	int blurRadius;
-	float pixelWidth;
-	float pixelHeight;
+	float4 taps[17];	// x: offset in texels, y: weight (GaussianBlur::MaxTaps)
+	float2 direction;	// One texel along the blur's axis, in UV
+	int tapCount;
 }
 struct VertexToPixel
 {
@@ -13,22 +18,12 @@ Texture2D Pixels : register(t0);
 SamplerState ClampSampler : register(s0);
 float4 main(VertexToPixel input) : SV_TARGET
 {
-	// Track the total color and number of samples
-	float4 total = 0;
-	int sampleCount = 0;
-	// Loop through the "box"
-	for (int x = -blurRadius; x <= blurRadius; x++)
+	float4 total = Pixels.Sample(ClampSampler, input.uv) * taps[0].y;
+	for (int i = 1; i < tapCount; i++)
 	{
-	for (int y = -blurRadius; y <= blurRadius; y++)
-	{
-		// Calculate the uv for this sample
-		float2 uv = input.uv;
-		uv += float2(x * pixelWidth, y * pixelHeight);
-		// Add this color to the running total
-		total += Pixels.Sample(ClampSampler, uv);
-		sampleCount++;
-		}
-		}
-	// Return the average
-	return total / sampleCount;
-}
\ No newline at end of file
+		float2 offset = direction * taps[i].x;
+		total += Pixels.Sample(ClampSampler, input.uv + offset) * taps[i].y;
+		total += Pixels.Sample(ClampSampler, input.uv - offset) * taps[i].y;
+	}
+	return total;
+}
@@ -0,0 +1,7 @@
+// Generated by Tools/GenerateShaderPermutations.py - do not edit
+// PixelShader.hlsl with: no optional features
+#define FEATURE_SHADOWS 0
+#define FEATURE_NORMAL_MAP 0
+#define FEATURE_METALNESS_MAP 0
+#define FEATURE_SSAO_OUTPUTS 0
+#include "../PixelShader.hlsl"
@@ -0,0 +1,7 @@
+// Generated by Tools/GenerateShaderPermutations.py - do not edit
+// PixelShader.hlsl with: normal map, roughness & metalness maps, SSAO outputs
+#define FEATURE_SHADOWS 0
+#define FEATURE_NORMAL_MAP 1
+#define FEATURE_METALNESS_MAP 1
+#define FEATURE_SSAO_OUTPUTS 1
+#include "../PixelShader.hlsl"
@@ -0,0 +1,90 @@
+#include "PipelineState.h"
+#include <cstring>
+
+PipelineStateDesc::PipelineStateDesc()
+{
+	memset(this, 0, sizeof(PipelineStateDesc));
+
+	Rasterizer.FillMode = D3D11_FILL_SOLID;
+	Rasterizer.CullMode = D3D11_CULL_BACK;
+	Rasterizer.DepthClipEnable = true;
+
+	DepthStencil.DepthEnable = true;
+	DepthStencil.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ALL;
+	DepthStencil.DepthFunc = D3D11_COMPARISON_LESS;
+	DepthStencil.StencilReadMask = D3D11_DEFAULT_STENCIL_READ_MASK;
+	DepthStencil.StencilWriteMask = D3D11_DEFAULT_STENCIL_WRITE_MASK;
+	const D3D11_DEPTH_STENCILOP_DESC stencilOp = { D3D11_STENCIL_OP_KEEP, D3D11_STENCIL_OP_KEEP, D3D11_STENCIL_OP_KEEP, D3D11_COMPARISON_ALWAYS };
+	DepthStencil.FrontFace = stencilOp;
+	DepthStencil.BackFace = stencilOp;
+
+	for (D3D11_RENDER_TARGET_BLEND_DESC& rt : Blend.RenderTarget)
+	{
+		rt.SrcBlend = D3D11_BLEND_ONE;
+		rt.DestBlend = D3D11_BLEND_ZERO;
+		rt.BlendOp = D3D11_BLEND_OP_ADD;
+		rt.SrcBlendAlpha = D3D11_BLEND_ONE;
+		rt.DestBlendAlpha = D3D11_BLEND_ZERO;
+		rt.BlendOpAlpha = D3D11_BLEND_OP_ADD;
+		rt.RenderTargetWriteMask = D3D11_COLOR_WRITE_ENABLE_ALL;
+	}
+
+	Topology = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+}
+
+unsigned int PipelineState::GetChangedParts(const PipelineState* previous) const
+{
+	if (!previous)
+		return PIPELINE_PART_ALL;
+
+	unsigned int changed = 0;
+	if (previous->desc.VertexShader != desc.VertexShader) changed |= PIPELINE_PART_VERTEX_SHADER;
+	if (previous->desc.PixelShader != desc.PixelShader) changed |= PIPELINE_PART_PIXEL_SHADER;
+	if (previous->rasterizerState.Get() != rasterizerState.Get()) changed |= PIPELINE_PART_RASTERIZER;
+	if (previous->depthStencilState.Get() != depthStencilState.Get()) changed |= PIPELINE_PART_DEPTH_STENCIL;
+	if (previous->blendState.Get() != blendState.Get()) changed |= PIPELINE_PART_BLEND;
+	if (previous->desc.Topology != desc.Topology) changed |= PIPELINE_PART_TOPOLOGY;
+	return changed;
+}
+
+PipelineStateCache::PipelineStateCache(Microsoft::WRL::ComPtr<ID3D11Device> _device)
+{
+	device = _device;
+}
+
+const PipelineState* PipelineStateCache::Get(const PipelineStateDesc& desc)
+{
+	// 64-bit FNV-1a over the whole description
+	const unsigned char* bytes = (const unsigned char*)&desc;
+	uint64_t hash = 14695981039346656037ull;
+	for (size_t i = 0; i < sizeof(PipelineStateDesc); i++)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+
+	auto range = lookup.equal_range(hash);
+	for (auto it = range.first; it != range.second; ++it)
+	{
+		PipelineState* existing = states[it->second].get();
+		if (memcmp(&existing->desc, &desc, sizeof(PipelineStateDesc)) == 0)
+			return existing;
+	}
+
+	std::unique_ptr<PipelineState> state(new PipelineState());
+	state->desc = desc;
+	state->id = (unsigned int)states.size();
+	device->CreateRasterizerState(&desc.Rasterizer, state->rasterizerState.GetAddressOf());
+	device->CreateDepthStencilState(&desc.DepthStencil, state->depthStencilState.GetAddressOf());
+	device->CreateBlendState(&desc.Blend, state->blendState.GetAddressOf());
+
+	lookup.insert({ hash, state->id });
+	states.push_back(std::move(state));
+	return states.back().get();
+}
+
+void PipelineStateCache::Clear()
+{
+	states.clear();
+	lookup.clear();
+}
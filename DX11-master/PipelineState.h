@@ -0,0 +1,105 @@
+#pragma once
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+class SimpleVertexShader;
+class SimplePixelShader;
+
+// --------------------------------------------------------
+// Everything a draw needs bound besides its resources and
+// constants.  Starts out as the Direct3D defaults (solid,
+// back-face culling, depth test LESS, no blending, triangle
+// list), so only the differences need setting.
+//
+// Compared byte for byte, so it is zeroed (padding too)
+// on construction.
+// --------------------------------------------------------
+struct PipelineStateDesc
+{
+	SimpleVertexShader* VertexShader;
+	SimplePixelShader* PixelShader;		// 0 for depth-only passes
+	D3D11_RASTERIZER_DESC Rasterizer;
+	D3D11_DEPTH_STENCIL_DESC DepthStencil;
+	D3D11_BLEND_DESC Blend;
+	D3D11_PRIMITIVE_TOPOLOGY Topology;
+
+	PipelineStateDesc();
+};
+
+// --------------------------------------------------------
+// The pieces of a PipelineState that are bound by separate
+// context calls
+// --------------------------------------------------------
+enum PipelineStatePart
+{
+	PIPELINE_PART_VERTEX_SHADER		= 1 << 0,	// With the input layout
+	PIPELINE_PART_PIXEL_SHADER		= 1 << 1,
+	PIPELINE_PART_RASTERIZER		= 1 << 2,
+	PIPELINE_PART_DEPTH_STENCIL		= 1 << 3,
+	PIPELINE_PART_BLEND				= 1 << 4,
+	PIPELINE_PART_TOPOLOGY			= 1 << 5,
+
+	PIPELINE_PART_COUNT = 6,
+	PIPELINE_PART_ALL = (1 << PIPELINE_PART_COUNT) - 1
+};
+
+// --------------------------------------------------------
+// An immutable bundle of shaders (and with them the input
+// layout) plus rasterizer, depth-stencil and blend state.
+// Only PipelineStateCache creates these, and it hands out
+// the same object for the same description, so two draws
+// share state exactly when their pointers match.
+// --------------------------------------------------------
+class PipelineState
+{
+public:
+	const PipelineStateDesc& GetDesc() const { return desc; }
+	unsigned int GetID() const { return id; }
+
+	ID3D11RasterizerState* GetRasterizerState() const { return rasterizerState.Get(); }
+	ID3D11DepthStencilState* GetDepthStencilState() const { return depthStencilState.Get(); }
+	ID3D11BlendState* GetBlendState() const { return blendState.Get(); }
+
+	// PipelineStateParts that differ from previous, which
+	// may be 0 (nothing bound, so everything differs)
+	unsigned int GetChangedParts(const PipelineState* previous) const;
+
+private:
+	friend class PipelineStateCache;
+	PipelineState() {}
+
+	PipelineStateDesc desc;
+	unsigned int id;
+
+	// Direct3D already returns the same object for identical
+	// state descriptions, so these are shared between PSOs
+	Microsoft::WRL::ComPtr<ID3D11RasterizerState> rasterizerState;
+	Microsoft::WRL::ComPtr<ID3D11DepthStencilState> depthStencilState;
+	Microsoft::WRL::ComPtr<ID3D11BlendState> blendState;
+};
+
+// --------------------------------------------------------
+// Hash-conses PipelineStates: Get() returns the existing
+// object for a description it has seen before, and only
+// creates one otherwise.  Objects live as long as the cache.
+// --------------------------------------------------------
+class PipelineStateCache
+{
+public:
+	PipelineStateCache(Microsoft::WRL::ComPtr<ID3D11Device> _device);
+
+	const PipelineState* Get(const PipelineStateDesc& desc);
+	size_t Size() const { return states.size(); }
+	void Clear();
+
+private:
+	Microsoft::WRL::ComPtr<ID3D11Device> device;
+	std::vector<std::unique_ptr<PipelineState>> states;
+
+	// Description hash -> indices into states
+	std::unordered_multimap<uint64_t, unsigned int> lookup;
+};
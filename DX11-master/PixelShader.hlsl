@@ -1,21 +1,70 @@
 #include "ShaderIncludes.hlsli"
+#include "ShadowMoments.hlsli"
 
-cbuffer ExternalData : register(b0)
+// Feature switches (see ShaderPermutations.h).  The wrappers in
+// Permutations/ define these before including this file; compiled
+// on its own, everything is on.
+#ifndef FEATURE_SHADOWS
+#define FEATURE_SHADOWS 1
+#endif
+#ifndef FEATURE_NORMAL_MAP
+#define FEATURE_NORMAL_MAP 1
+#endif
+#ifndef FEATURE_METALNESS_MAP
+#define FEATURE_METALNESS_MAP 1
+#endif
+#ifndef FEATURE_SSAO_OUTPUTS
+#define FEATURE_SSAO_OUTPUTS 1
+#endif
+
+// Set once per frame
+cbuffer PerFrame : register(b0)
 {
-	float4 colorTint;
-	float roughness;
 	float3 cameraPos;
 	float3 ambient;
 	Light directionalLight1;
+
+	// Light view-projection of each shadow cascade, and the view
+	// depth each one ends at (see ShadowCascades.h)
+	matrix cascadeViewProjection[4];
+	float4 cascadeSplits;
+	float3 cameraForward;
+	int cascadeCount;
+
+	// Point and spot lights, and where their shadows are in the
+	// atlas (see ShadowAtlas.h).  A point light has six views, one
+	// per cube face in the order +X -X +Y -Y +Z -Z.
+	Light localLights[8];
+	float4 localShadowInfo[8];			// x: first view, y: view count (0 if unshadowed)
+	matrix localShadowViewProjection[24];
+	float4 localShadowRects[24];		// Atlas UV offset (xy) and scale (zw) of each view's tile
+	int localLightCount;
+
+	// How the cascades are filtered (SHADOW_FILTER_ in ShadowMoments.hlsli)
+	int shadowFilter;
+	int pcfRadius;					// Wide PCF takes (2r+1)^2 taps
+	float2 evsmExponents;
+	float evsmLightBleedReduction;
 }
 
-Texture2D Albedo			: register(t0);
-Texture2D NormalMap			: register(t1);
-Texture2D RoughnessMap	 	: register(t2);
-Texture2D MetalnessMap		: register(t3);
-Texture2D ShadowMap			: register(t4);
+// Set whenever the material changes
+cbuffer PerMaterial : register(b1)
+{
+	float4 colorTint;
+	float roughness;
+	uint materialIndex;		// Slice of the texture arrays below
+}
+
+// One slice per material
+Texture2DArray AlbedoArray		: register(t0);
+Texture2DArray NormalArray		: register(t1);
+Texture2DArray RoughMetalArray	: register(t2);	// Roughness in red, metalness in green
+Texture2DArray ShadowMap		: register(t4);	// One slice per cascade
+Texture2D ShadowAtlas			: register(t5);	// Tiles for point and spot lights
+Texture2DArray ShadowMoments	: register(t6);	// Prefiltered EVSM moments, one slice per cascade
 SamplerState BasicSampler	: register(s0);
 SamplerComparisonState ShadowSampler : register(s1);
+SamplerState MomentSampler	: register(s2);	// Linear, clamped
 
 struct PS_Output
 {
@@ -25,6 +74,52 @@ struct PS_Output
 	float depths			: SV_TARGET3;
 };
 
+#if FEATURE_SHADOWS
+// --------------------------------------------------------
+// How much of a point or spot light reaches the pixel, from
+// its tiles in the shadow atlas
+// --------------------------------------------------------
+float LocalShadowAmount(int light, float3 worldPos)
+{
+	int viewCount = (int)localShadowInfo[light].y;
+	if (viewCount == 0)
+		return 1.0f;
+
+	int view = (int)localShadowInfo[light].x;
+	if (viewCount == 6)
+	{
+		// The cube face the pixel is in
+		float3 toPixel = worldPos - localLights[light].Position;
+		float3 axis = abs(toPixel);
+		if (axis.x >= axis.y && axis.x >= axis.z)
+			view += toPixel.x > 0 ? 0 : 1;
+		else if (axis.y >= axis.z)
+			view += toPixel.y > 0 ? 2 : 3;
+		else
+			view += toPixel.z > 0 ? 4 : 5;
+	}
+
+	// Perspective, so this one does need the divide
+	float4 shadowPos = mul(localShadowViewProjection[view], float4(worldPos, 1.0f));
+	shadowPos.xyz /= shadowPos.w;
+	float2 shadowUV = shadowPos.xy * 0.5f + 0.5f;
+	shadowUV.y = 1 - shadowUV.y;
+
+	// Outside a spot light's cone
+	if (shadowPos.w <= 0.0f || any(shadowUV < 0.0f) || any(shadowUV > 1.0f))
+		return 1.0f;
+
+	// Half a texel inside the tile, so filtering never reads a neighbour
+	float2 atlasSize;
+	ShadowAtlas.GetDimensions(atlasSize.x, atlasSize.y);
+	float2 halfTexel = 0.5f / atlasSize;
+	float4 rect = localShadowRects[view];
+	float2 atlasUV = clamp(rect.xy + shadowUV * rect.zw, rect.xy + halfTexel, rect.xy + rect.zw - halfTexel);
+
+	return ShadowAtlas.SampleCmpLevelZero(ShadowSampler, atlasUV, shadowPos.z).r;
+}
+#endif
+
 // --------------------------------------------------------
 // The entry point (main method) for our pixel shader
 // 
@@ -36,34 +131,87 @@ struct PS_Output
 // --------------------------------------------------------
 PS_Output main(VertexToPixel input)
 {
-	// Perform the perspective divide (divide by W) ourselves
-	input.shadowMapPos /= input.shadowMapPos.w;
+#if FEATURE_SHADOWS
+	// The first cascade whose slice of the view contains this pixel
+	float viewDepth = dot(input.worldPos - cameraPos, cameraForward);
+	int cascade = 0;
+	[unroll]
+	for (int c = 0; c < 3; c++)
+		cascade += (c < cascadeCount - 1 && viewDepth > cascadeSplits[c]) ? 1 : 0;
+
+	// Orthographic, so no divide by W
+	float4 shadowMapPos = mul(cascadeViewProjection[cascade], float4(input.worldPos, 1.0f));
 
 	// Convert the normalized device coordinates to UVs for sampling
-	float2 shadowUV = input.shadowMapPos.xy * 0.5f + 0.5f;
+	float2 shadowUV = shadowMapPos.xy * 0.5f + 0.5f;
 	shadowUV.y = 1 - shadowUV.y; // Flip the Y
 
 	// Grab the distances we need: light-to-pixel and closest-surface
-	float distToLight = input.shadowMapPos.z;
+	float distToLight = shadowMapPos.z;
 	
-	// Get a ratio of comparison results using SampleCmpLevelZero()
-	float shadowAmount = ShadowMap.SampleCmpLevelZero(
-		ShadowSampler,
-		shadowUV,
-		distToLight).r;
+	float shadowAmount;
+	if (shadowFilter == SHADOW_FILTER_EVSM)
+	{
+		// Already blurred, so one bilinear fetch is a soft edge
+		float4 moments = ShadowMoments.SampleLevel(MomentSampler, float3(shadowUV, cascade), 0);
+		shadowAmount = EVSMVisibility(moments, distToLight, evsmExponents, evsmLightBleedReduction);
+	}
+	else if (shadowFilter == SHADOW_FILTER_WIDE_PCF)
+	{
+		float2 shadowSize;
+		float shadowSlices;
+		ShadowMap.GetDimensions(shadowSize.x, shadowSize.y, shadowSlices);
+		float2 texel = 1.0f / shadowSize;
 
+		shadowAmount = 0.0f;
+		for (int x = -pcfRadius; x <= pcfRadius; x++)
+		{
+			for (int y = -pcfRadius; y <= pcfRadius; y++)
+			{
+				shadowAmount += ShadowMap.SampleCmpLevelZero(
+					ShadowSampler,
+					float3(shadowUV + float2(x, y) * texel, cascade),
+					distToLight).r;
+			}
+		}
+		shadowAmount /= (2 * pcfRadius + 1) * (2 * pcfRadius + 1);
+	}
+	else
+	{
+		// Get a ratio of comparison results using SampleCmpLevelZero()
+		shadowAmount = ShadowMap.SampleCmpLevelZero(
+			ShadowSampler,
+			float3(shadowUV, cascade),
+			distToLight).r;
+	}
 
+	// Nothing past the last cascade is shadowed
+	if (viewDepth > cascadeSplits[cascadeCount - 1])
+		shadowAmount = 1.0f;
+#else
+	float shadowAmount = 1.0f;
+#endif
 
-	float3 surfaceColor = pow(Albedo.Sample(BasicSampler, input.uv).rgb, 2.2f);
+	float3 materialUV = float3(input.uv, materialIndex);
+	float3 surfaceColor = pow(AlbedoArray.Sample(BasicSampler, materialUV).rgb, 2.2f);
 
-	float3 unpackedNormal = NormalMap.Sample(BasicSampler, input.uv).rgb * 2 - 1;
+#if FEATURE_NORMAL_MAP
+	float3 unpackedNormal = NormalArray.Sample(BasicSampler, materialUV).rgb * 2 - 1;
 	unpackedNormal = normalize(unpackedNormal);
+#endif
 
-	float roughness = RoughnessMap.Sample(BasicSampler, input.uv).r;
-	float metalness = MetalnessMap.Sample(BasicSampler, input.uv).r;
+#if FEATURE_METALNESS_MAP
+	float2 roughMetal = RoughMetalArray.Sample(BasicSampler, materialUV).rg;
+	float roughness = roughMetal.r;
+	float metalness = roughMetal.g;
+#else
+	// Roughness comes from the material instead
+	float metalness = 0.0f;
+#endif
 
 	float3 specularColor = lerp(F0_NON_METAL, surfaceColor.rgb, metalness);
 
+#if FEATURE_NORMAL_MAP
 	float3 N = normalize(input.normal);
 	float3 T = normalize(input.tangent);
 	T = normalize(T - N * dot(T, N));;
@@ -71,6 +219,9 @@ PS_Output main(VertexToPixel input)
 	float3x3 TBN = float3x3(T, B, N);
 
 	input.normal = mul(unpackedNormal, TBN);
+#else
+	input.normal = normalize(input.normal);
+#endif
 
 	float3 total = surfaceColor * ambient;
 
@@ -86,13 +237,44 @@ PS_Output main(VertexToPixel input)
 
 	lightResult *= shadowAmount;
 
+	// Point and spot lights
+	float3 toCamera = normalize(cameraPos - input.worldPos);
+	for (int i = 0; i < localLightCount; i++)
+	{
+		float3 dirToLight = normalize(localLights[i].Position - input.worldPos);
+		float attenuation = Attenuate(localLights[i], input.worldPos);
+		if (localLights[i].Type == LIGHT_TYPE_SPOT)
+			attenuation *= pow(saturate(dot(-dirToLight, normalize(localLights[i].Direction))), localLights[i].SpotFalloff);
+
+		float3 localDiffuse = Diffuse(input.normal, dirToLight);
+		float3 localF;
+		float3 localSpecular = MicrofacetBRDF(input.normal, dirToLight, toCamera, roughness, specularColor, localF);
+		float3 localBalanceDiff = DiffuseEnergyConserve(localDiffuse, localF, metalness);
+		float3 localResult = (localBalanceDiff * surfaceColor + localSpecular) * localLights[i].Intensity * localLights[i].Color * attenuation;
+#if FEATURE_SHADOWS
+		localResult *= LocalShadowAmount(i, input.worldPos);
+#endif
+		lightResult += localResult;
+	}
+
 	total += lightResult;
 
+	// The lit (and shadowed) result is what goes out; ambient is
+	// added back after SSAO
 	PS_Output output;
-	output.colorNoAmbient = float4(pow(surfaceColor + specular, 1.0f / 2.2f), 1);
+#if FEATURE_SSAO_OUTPUTS
+	output.colorNoAmbient = float4(pow(lightResult, 1.0f / 2.2f), 1);
 	output.ambient = float4(ambient,1);
 	output.normals = float4(input.normal * 0.5 + 0.5f, 1);
 	output.depths = input.screenPosition.z;
+#else
+	// Opted out of SSAO: ambient goes straight into the color, and a
+	// far-plane depth makes the SSAO pass skip these pixels
+	output.colorNoAmbient = float4(pow(lightResult, 1.0f / 2.2f) + ambient, 1);
+	output.ambient = float4(0, 0, 0, 1);
+	output.normals = float4(0, 0, 0, 1);
+	output.depths = 1.0f;
+#endif
 
 	return output;
 }
\ No newline at end of file
@@ -0,0 +1,302 @@
+#include "RenderGraph.h"
+#include <algorithm>
+
+static const uint32_t NoIndex = 0xFFFFFFFF;
+
+RenderGraph::RenderGraph()
+{
+	Reset();
+}
+
+void RenderGraph::Reset()
+{
+	resources.clear();
+	passes.clear();
+	physicals.clear();
+	schedule.clear();
+	output = NoResource;
+	error.clear();
+	transientCount = 0;
+	transientPhysicalCount = 0;
+}
+
+RenderGraphResource RenderGraph::CreateTexture(const std::string& name, const RenderGraphTextureDesc& desc)
+{
+	Resource resource = { name, desc, false, NoPhysical, NoIndex, NoIndex };
+	resources.push_back(resource);
+	return (RenderGraphResource)(resources.size() - 1);
+}
+
+RenderGraphResource RenderGraph::ImportTexture(const std::string& name)
+{
+	Resource resource = { name, {}, true, NoPhysical, NoIndex, NoIndex };
+	resources.push_back(resource);
+	return (RenderGraphResource)(resources.size() - 1);
+}
+
+RenderGraphPass RenderGraph::AddPass(const std::string& name, std::function<void()> execute)
+{
+	Pass pass;
+	pass.Name = name;
+	pass.Execute = execute;
+	pass.Kept = false;
+	passes.push_back(pass);
+	return (RenderGraphPass)(passes.size() - 1);
+}
+
+void RenderGraph::Read(RenderGraphPass pass, RenderGraphResource resource)
+{
+	Access access = { resource, RENDER_GRAPH_READ, false };
+	passes[pass].Accesses.push_back(access);
+}
+
+void RenderGraph::Write(RenderGraphPass pass, RenderGraphResource resource, RenderGraphAccess kind, bool clear)
+{
+	Access access = { resource, kind, clear };
+	passes[pass].Accesses.push_back(access);
+}
+
+void RenderGraph::SetOutput(RenderGraphResource resource)
+{
+	output = resource;
+}
+
+bool RenderGraph::Compile()
+{
+	error.clear();
+	schedule.clear();
+	physicals.clear();
+	for (Resource& resource : resources)
+	{
+		resource.Physical = NoPhysical;
+		resource.FirstUse = NoIndex;
+		resource.LastUse = NoIndex;
+	}
+
+	if (!FindDependencies())
+		return false;
+	Cull();
+	BuildSchedule();
+	AssignPhysicals();
+	FindHazards();
+	return true;
+}
+
+// --------------------------------------------------------
+// Links each pass to the passes whose results it uses
+// --------------------------------------------------------
+bool RenderGraph::FindDependencies()
+{
+	if (output == NoResource)
+	{
+		error = "The graph has no output";
+		return false;
+	}
+
+	std::vector<RenderGraphPass> lastWriter(resources.size(), NoIndex);
+	for (RenderGraphPass p = 0; p < passes.size(); p++)
+	{
+		Pass& pass = passes[p];
+		pass.Dependencies.clear();
+		pass.Kept = false;
+
+		for (const Access& access : pass.Accesses)
+		{
+			if (access.Kind != RENDER_GRAPH_READ)
+				continue;
+
+			for (const Access& other : pass.Accesses)
+			{
+				if (other.Resource == access.Resource && other.Kind != RENDER_GRAPH_READ)
+				{
+					error = pass.Name + " reads and writes " + resources[access.Resource].Name;
+					return false;
+				}
+			}
+
+			RenderGraphPass writer = lastWriter[access.Resource];
+			if (writer != NoIndex)
+				pass.Dependencies.push_back(writer);
+			else if (!resources[access.Resource].Imported)
+			{
+				error = pass.Name + " reads " + resources[access.Resource].Name + " before anything writes it";
+				return false;
+			}
+		}
+
+		for (const Access& access : pass.Accesses)
+		{
+			if (access.Kind == RENDER_GRAPH_READ)
+				continue;
+
+			RenderGraphPass writer = lastWriter[access.Resource];
+			if (writer != NoIndex && writer != p && !access.Clear)
+				pass.Dependencies.push_back(writer);
+			lastWriter[access.Resource] = p;
+		}
+	}
+
+	if (lastWriter[output] == NoIndex)
+	{
+		error = "Nothing writes the output, " + resources[output].Name;
+		return false;
+	}
+	return true;
+}
+
+// --------------------------------------------------------
+// Keeps the output's last writer and every pass writing an
+// imported resource, then everything those depend on
+// --------------------------------------------------------
+void RenderGraph::Cull()
+{
+	std::vector<RenderGraphPass> pending;
+	for (RenderGraphPass p = 0; p < passes.size(); p++)
+	{
+		for (const Access& access : passes[p].Accesses)
+		{
+			if (access.Kind != RENDER_GRAPH_READ && resources[access.Resource].Imported)
+			{
+				pending.push_back(p);
+				break;
+			}
+		}
+	}
+
+	// Only the last write of the output reaches the screen
+	for (RenderGraphPass p = (RenderGraphPass)passes.size(); p-- > 0; )
+	{
+		bool writesOutput = false;
+		for (const Access& access : passes[p].Accesses)
+			writesOutput |= access.Kind != RENDER_GRAPH_READ && access.Resource == output;
+		if (writesOutput)
+		{
+			pending.push_back(p);
+			break;
+		}
+	}
+
+	while (!pending.empty())
+	{
+		RenderGraphPass p = pending.back();
+		pending.pop_back();
+		if (passes[p].Kept)
+			continue;
+
+		passes[p].Kept = true;
+		for (RenderGraphPass dependency : passes[p].Dependencies)
+			pending.push_back(dependency);
+	}
+}
+
+void RenderGraph::BuildSchedule()
+{
+	for (RenderGraphPass p = 0; p < passes.size(); p++)
+	{
+		if (!passes[p].Kept)
+			continue;
+
+		uint32_t index = (uint32_t)schedule.size();
+		RenderGraphCompiledPass compiled;
+		compiled.Pass = p;
+		compiled.DepthStencil = NoResource;
+		for (const Access& access : passes[p].Accesses)
+		{
+			if (access.Kind == RENDER_GRAPH_RENDER_TARGET)
+				compiled.RenderTargets.push_back(access.Resource);
+			else if (access.Kind == RENDER_GRAPH_DEPTH_STENCIL)
+				compiled.DepthStencil = access.Resource;
+			if (access.Clear)
+				compiled.Clears.push_back(access.Resource);
+
+			Resource& resource = resources[access.Resource];
+			if (resource.FirstUse == NoIndex)
+				resource.FirstUse = index;
+			resource.LastUse = index;
+		}
+		schedule.push_back(compiled);
+	}
+}
+
+// --------------------------------------------------------
+// Gives imported resources and the output a physical texture
+// each, and packs transients into as few as possible: in
+// order of first use, each takes the first texture of the
+// same description whose previous tenant is done with it
+// --------------------------------------------------------
+void RenderGraph::AssignPhysicals()
+{
+	std::vector<RenderGraphResource> transients;
+	for (RenderGraphResource r = 0; r < resources.size(); r++)
+	{
+		Resource& resource = resources[r];
+		if (resource.FirstUse == NoIndex)
+			continue;
+
+		if (resource.Imported || r == output)
+		{
+			Physical physical = { resource.Desc, false, resource.LastUse };
+			resource.Physical = (uint32_t)physicals.size();
+			physicals.push_back(physical);
+		}
+		else
+			transients.push_back(r);
+	}
+
+	std::stable_sort(transients.begin(), transients.end(),
+		[&](RenderGraphResource a, RenderGraphResource b) { return resources[a].FirstUse < resources[b].FirstUse; });
+
+	for (RenderGraphResource r : transients)
+	{
+		Resource& resource = resources[r];
+		for (uint32_t p = 0; p < physicals.size() && resource.Physical == NoPhysical; p++)
+		{
+			Physical& physical = physicals[p];
+			if (physical.Transient &&
+				physical.LastUse < resource.FirstUse &&
+				physical.Desc.Width == resource.Desc.Width &&
+				physical.Desc.Height == resource.Desc.Height &&
+				physical.Desc.Format == resource.Desc.Format)
+			{
+				resource.Physical = p;
+				physical.LastUse = resource.LastUse;
+			}
+		}
+
+		if (resource.Physical == NoPhysical)
+		{
+			Physical physical = { resource.Desc, true, resource.LastUse };
+			resource.Physical = (uint32_t)physicals.size();
+			physicals.push_back(physical);
+			transientPhysicalCount++;
+		}
+		transientCount++;
+	}
+}
+
+// --------------------------------------------------------
+// A physical texture sampled by one pass and written by a
+// later one has to leave its shader resource slots first
+// --------------------------------------------------------
+void RenderGraph::FindHazards()
+{
+	std::vector<bool> sampled(physicals.size(), false);
+	for (RenderGraphCompiledPass& compiled : schedule)
+	{
+		const Pass& pass = passes[compiled.Pass];
+		for (const Access& access : pass.Accesses)
+		{
+			uint32_t physical = resources[access.Resource].Physical;
+			if (access.Kind != RENDER_GRAPH_READ && sampled[physical])
+			{
+				compiled.Unbinds.push_back(physical);
+				sampled[physical] = false;
+			}
+		}
+		for (const Access& access : pass.Accesses)
+		{
+			if (access.Kind == RENDER_GRAPH_READ)
+				sampled[resources[access.Resource].Physical] = true;
+		}
+	}
+}
@@ -0,0 +1,174 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+typedef uint32_t RenderGraphResource;
+typedef uint32_t RenderGraphPass;
+
+// --------------------------------------------------------
+// How a pass uses a resource it declared
+// --------------------------------------------------------
+enum RenderGraphAccess
+{
+	RENDER_GRAPH_READ,				// Sampled through a shader resource view
+	RENDER_GRAPH_RENDER_TARGET,		// Bound as a color target, in declaration order
+	RENDER_GRAPH_DEPTH_STENCIL,		// Bound as the depth target
+	RENDER_GRAPH_WRITE				// Written through views the pass binds itself
+};
+
+// --------------------------------------------------------
+// Size and format of a transient texture.  Format is the
+// backend's format value; the graph only compares it, so
+// two textures alias only when all three fields match.
+// --------------------------------------------------------
+struct RenderGraphTextureDesc
+{
+	uint32_t Width;
+	uint32_t Height;
+	uint32_t Format;
+};
+
+// --------------------------------------------------------
+// One pass of the compiled schedule, with what the backend
+// has to do before running it
+// --------------------------------------------------------
+struct RenderGraphCompiledPass
+{
+	RenderGraphPass Pass;
+	std::vector<RenderGraphResource> RenderTargets;		// Bound in this order
+	RenderGraphResource DepthStencil;					// RenderGraph::NoResource if none
+	std::vector<RenderGraphResource> Clears;			// Written with clear == true
+	std::vector<uint32_t> Unbinds;						// Physical textures to remove from shader resource slots
+};
+
+// --------------------------------------------------------
+// A frame's passes and the textures flowing between them,
+// declared up front so the frame can be planned before
+// anything is drawn.  Knows nothing about the graphics API:
+// a backend (RenderGraphExecutor) creates the textures and
+// runs the schedule.
+//
+// Every frame: Reset(), declare resources and passes in the
+// order they should run, SetOutput(), then Compile().
+//
+//  - Transient textures belong to the frame.  Their contents
+//    are undefined until a pass writes them, and textures
+//    whose lifetimes don't overlap share one physical texture
+//    when their descriptions match
+//  - Imported textures live outside the graph (shadow maps,
+//    the depth buffer).  They are never aliased, and a pass
+//    writing one is always kept
+//  - The output is the frame's final image.  Its last writer
+//    and everything feeding it are kept; passes nothing kept
+//    depends on are culled.  The backend gives the output the
+//    back buffer rather than a texture of its own.
+//
+// Passes run in declaration order, so a pass may only read
+// what an earlier pass wrote.  A write without clear builds
+// on the previous contents, so it keeps the previous writer.
+//
+// Hazards are tracked per physical texture: a pass writing a
+// texture an earlier pass sampled lists it in Unbinds.  The
+// opposite case needs nothing, as the backend binds every
+// pass's targets before it runs, replacing the previous ones.
+// --------------------------------------------------------
+class RenderGraph
+{
+public:
+	static const uint32_t NoResource = 0xFFFFFFFF;
+	static const uint32_t NoPhysical = 0xFFFFFFFF;
+
+	RenderGraph();
+
+	void Reset();
+
+	RenderGraphResource CreateTexture(const std::string& name, const RenderGraphTextureDesc& desc);
+	RenderGraphResource ImportTexture(const std::string& name);
+	RenderGraphPass AddPass(const std::string& name, std::function<void()> execute);
+	void Read(RenderGraphPass pass, RenderGraphResource resource);
+	void Write(RenderGraphPass pass, RenderGraphResource resource, RenderGraphAccess access, bool clear = false);
+	void SetOutput(RenderGraphResource resource);
+
+	// False (see GetError()) if the graph can't run: a transient
+	// read before anything wrote it, a pass reading and writing
+	// one resource, or no output
+	bool Compile();
+	const std::string& GetError() const { return error; }
+
+	const std::vector<RenderGraphCompiledPass>& GetSchedule() const { return schedule; }
+	void ExecutePass(RenderGraphPass pass) const { passes[pass].Execute(); }
+
+	// Resources
+	size_t GetResourceCount() const { return resources.size(); }
+	const std::string& GetName(RenderGraphResource resource) const { return resources[resource].Name; }
+	const RenderGraphTextureDesc& GetDesc(RenderGraphResource resource) const { return resources[resource].Desc; }
+	bool IsImported(RenderGraphResource resource) const { return resources[resource].Imported; }
+	RenderGraphResource GetOutput() const { return output; }
+
+	// Physical textures: one per imported resource and the
+	// output, plus the transient ones the others alias into.
+	// NoPhysical for a resource no kept pass touches.
+	uint32_t GetPhysical(RenderGraphResource resource) const { return resources[resource].Physical; }
+	size_t GetPhysicalCount() const { return physicals.size(); }
+	const RenderGraphTextureDesc& GetPhysicalDesc(uint32_t physical) const { return physicals[physical].Desc; }
+	bool IsPhysicalTransient(uint32_t physical) const { return physicals[physical].Transient; }
+
+	// Stats of the last Compile()
+	size_t GetPassCount() const { return passes.size(); }
+	const std::string& GetPassName(RenderGraphPass pass) const { return passes[pass].Name; }
+	bool IsCulled(RenderGraphPass pass) const { return !passes[pass].Kept; }
+	unsigned int GetCulledPassCount() const { return (unsigned int)(passes.size() - schedule.size()); }
+	unsigned int GetTransientCount() const { return transientCount; }
+	unsigned int GetTransientPhysicalCount() const { return transientPhysicalCount; }
+
+private:
+	struct Resource
+	{
+		std::string Name;
+		RenderGraphTextureDesc Desc;
+		bool Imported;
+		uint32_t Physical;
+		uint32_t FirstUse;		// Schedule indices
+		uint32_t LastUse;
+	};
+
+	struct Access
+	{
+		RenderGraphResource Resource;
+		RenderGraphAccess Kind;
+		bool Clear;
+	};
+
+	struct Pass
+	{
+		std::string Name;
+		std::function<void()> Execute;
+		std::vector<Access> Accesses;
+		std::vector<RenderGraphPass> Dependencies;
+		bool Kept;
+	};
+
+	struct Physical
+	{
+		RenderGraphTextureDesc Desc;
+		bool Transient;
+		uint32_t LastUse;		// Of the latest resource placed in it
+	};
+
+	std::vector<Resource> resources;
+	std::vector<Pass> passes;
+	std::vector<Physical> physicals;
+	std::vector<RenderGraphCompiledPass> schedule;
+	RenderGraphResource output;
+	std::string error;
+	unsigned int transientCount;
+	unsigned int transientPhysicalCount;
+
+	bool FindDependencies();
+	void Cull();
+	void BuildSchedule();
+	void AssignPhysicals();
+	void FindHazards();
+};
@@ -0,0 +1,160 @@
+#include "RenderGraphExecutor.h"
+
+RenderGraphExecutor::RenderGraphExecutor(Microsoft::WRL::ComPtr<ID3D11DeviceContext> _context,
+	std::shared_ptr<RenderTargetPool> _pool)
+	: context(_context), pool(_pool), graph(0)
+{
+}
+
+void RenderGraphExecutor::SetImported(RenderGraphResource resource, ID3D11RenderTargetView* rtv,
+	ID3D11DepthStencilView* dsv, ID3D11ShaderResourceView* srv)
+{
+	if (resource >= imported.size())
+		imported.resize(resource + 1);
+	imported[resource].RTV = rtv;
+	imported[resource].DSV = dsv;
+	imported[resource].SRV = srv;
+}
+
+void RenderGraphExecutor::SetOutput(ID3D11RenderTargetView* rtv)
+{
+	outputRTV = rtv;
+}
+
+void RenderGraphExecutor::Execute(const RenderGraph& graph)
+{
+	this->graph = &graph;
+	AcquireTextures();
+
+	const float clearColor[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	for (const RenderGraphCompiledPass& pass : graph.GetSchedule())
+	{
+		for (uint32_t physical : pass.Unbinds)
+			Unbind(physical);
+
+		// Binding every pass's targets, even none, also takes the
+		// previous pass's targets off before they're read
+		ID3D11RenderTargetView* targets[D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT] = {};
+		UINT targetCount = 0;
+		for (RenderGraphResource target : pass.RenderTargets)
+		{
+			if (targetCount < D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT)
+				targets[targetCount++] = GetRenderTargetView(target);
+		}
+		ID3D11DepthStencilView* depth = pass.DepthStencil == RenderGraph::NoResource ? 0 : GetDepthStencilView(pass.DepthStencil);
+		context->OMSetRenderTargets(targetCount, targets, depth);
+
+		// Imported targets have no size the graph knows of; passes
+		// drawing into them set their own viewport
+		if (targetCount > 0 && graph.GetDesc(pass.RenderTargets[0]).Width > 0)
+		{
+			const RenderGraphTextureDesc& desc = graph.GetDesc(pass.RenderTargets[0]);
+			D3D11_VIEWPORT viewport = {};
+			viewport.Width = (float)desc.Width;
+			viewport.Height = (float)desc.Height;
+			viewport.MaxDepth = 1.0f;
+			context->RSSetViewports(1, &viewport);
+		}
+
+		for (RenderGraphResource resource : pass.Clears)
+		{
+			if (ID3D11RenderTargetView* rtv = GetRenderTargetView(resource))
+				context->ClearRenderTargetView(rtv, clearColor);
+			else if (ID3D11DepthStencilView* dsv = GetDepthStencilView(resource))
+				context->ClearDepthStencilView(dsv, D3D11_CLEAR_DEPTH, 1.0f, 0);
+		}
+
+		graph.ExecutePass(pass.Pass);
+	}
+
+	UnbindAll();
+}
+
+void RenderGraphExecutor::BindShaderResource(SimplePixelShader* shader, const char* name, RenderGraphResource resource)
+{
+	SimpleShaderResourceHandle handle = shader->GetShaderResourceViewHandle(name);
+	if (!handle.IsValid())
+		return;
+
+	shader->SetShaderResourceView(handle, GetShaderResourceView(resource));
+	BoundSlot bound = { handle.BindIndex, graph->GetPhysical(resource) };
+	boundSlots.push_back(bound);
+}
+
+ID3D11RenderTargetView* RenderGraphExecutor::GetRenderTargetView(RenderGraphResource resource) const
+{
+	uint32_t physical = graph->GetPhysical(resource);
+	if (physical == RenderGraph::NoPhysical)
+		return 0;
+	if (graph->IsPhysicalTransient(physical))
+		return textures[physical]->RTV.Get();
+	if (graph->IsImported(resource))
+		return resource < imported.size() ? imported[resource].RTV.Get() : 0;
+	return outputRTV.Get();
+}
+
+ID3D11DepthStencilView* RenderGraphExecutor::GetDepthStencilView(RenderGraphResource resource) const
+{
+	if (!graph->IsImported(resource) || resource >= imported.size())
+		return 0;
+	return imported[resource].DSV.Get();
+}
+
+ID3D11ShaderResourceView* RenderGraphExecutor::GetShaderResourceView(RenderGraphResource resource) const
+{
+	if (!graph)
+		return 0;
+
+	uint32_t physical = graph->GetPhysical(resource);
+	if (physical == RenderGraph::NoPhysical)
+		return 0;
+	if (graph->IsPhysicalTransient(physical))
+		return textures[physical]->SRV.Get();
+	if (graph->IsImported(resource))
+		return resource < imported.size() ? imported[resource].SRV.Get() : 0;
+	return 0;
+}
+
+// --------------------------------------------------------
+// Takes a pooled texture for every transient physical
+// texture of the graph
+// --------------------------------------------------------
+void RenderGraphExecutor::AcquireTextures()
+{
+	pool->BeginFrame();
+	textures.assign(graph->GetPhysicalCount(), 0);
+	for (uint32_t p = 0; p < textures.size(); p++)
+	{
+		if (!graph->IsPhysicalTransient(p))
+			continue;
+
+		const RenderGraphTextureDesc& desc = graph->GetPhysicalDesc(p);
+		RenderTargetDesc targetDesc = { desc.Width, desc.Height, (DXGI_FORMAT)desc.Format,
+			D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE };
+		textures[p] = pool->Acquire(targetDesc);
+	}
+}
+
+void RenderGraphExecutor::Unbind(uint32_t physical)
+{
+	ID3D11ShaderResourceView* nullSRV = 0;
+	for (size_t i = 0; i < boundSlots.size(); )
+	{
+		if (boundSlots[i].Physical != physical)
+		{
+			i++;
+			continue;
+		}
+		context->PSSetShaderResources(boundSlots[i].Slot, 1, &nullSRV);
+		boundSlots[i] = boundSlots.back();
+		boundSlots.pop_back();
+	}
+}
+
+void RenderGraphExecutor::UnbindAll()
+{
+	ID3D11ShaderResourceView* nullSRV = 0;
+	for (const BoundSlot& bound : boundSlots)
+		context->PSSetShaderResources(bound.Slot, 1, &nullSRV);
+	boundSlots.clear();
+}
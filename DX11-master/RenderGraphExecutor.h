@@ -0,0 +1,75 @@
+#pragma once
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <memory>
+#include <vector>
+#include "RenderGraph.h"
+#include "RenderTargetPool.h"
+#include "SimpleShader.h"
+
+// --------------------------------------------------------
+// Runs a compiled RenderGraph on Direct3D 11.
+//
+// Each of the graph's transient physical textures comes out
+// of the RenderTargetPool every frame, so the same textures
+// come back as long as the graph asks for the same sizes
+// and formats.
+// Imported resources and the output (the back buffer) come
+// from the game, through SetImported() / SetOutput() after
+// the graph is declared each frame.
+//
+// Before each pass it unbinds what the graph says has to go,
+// binds the pass's targets with a viewport covering them and
+// clears the ones asked for.
+// Passes bind their inputs with BindShaderResource(), which
+// remembers the slots, so nothing else has to be unbound:
+// Execute() finishes by emptying exactly those slots.
+// --------------------------------------------------------
+class RenderGraphExecutor
+{
+public:
+	RenderGraphExecutor(Microsoft::WRL::ComPtr<ID3D11DeviceContext> _context,
+		std::shared_ptr<RenderTargetPool> _pool);
+
+	// Any view may be 0 if the graph never uses it that way
+	void SetImported(RenderGraphResource resource, ID3D11RenderTargetView* rtv,
+		ID3D11DepthStencilView* dsv, ID3D11ShaderResourceView* srv);
+	void SetOutput(ID3D11RenderTargetView* rtv);
+
+	void Execute(const RenderGraph& graph);
+
+	// For passes, to bind their inputs
+	void BindShaderResource(SimplePixelShader* shader, const char* name, RenderGraphResource resource);
+
+	// Views of the last executed graph's resources; 0 where the
+	// resource has none (or was culled)
+	ID3D11RenderTargetView* GetRenderTargetView(RenderGraphResource resource) const;
+	ID3D11DepthStencilView* GetDepthStencilView(RenderGraphResource resource) const;
+	ID3D11ShaderResourceView* GetShaderResourceView(RenderGraphResource resource) const;
+
+private:
+	struct ImportedViews
+	{
+		Microsoft::WRL::ComPtr<ID3D11RenderTargetView> RTV;
+		Microsoft::WRL::ComPtr<ID3D11DepthStencilView> DSV;
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> SRV;
+	};
+
+	struct BoundSlot
+	{
+		UINT Slot;
+		uint32_t Physical;
+	};
+
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context;
+	std::shared_ptr<RenderTargetPool> pool;
+	const RenderGraph* graph;
+	std::vector<const PooledRenderTarget*> textures;	// Indexed by physical texture; 0 unless transient
+	std::vector<ImportedViews> imported;		// Indexed by resource
+	Microsoft::WRL::ComPtr<ID3D11RenderTargetView> outputRTV;
+	std::vector<BoundSlot> boundSlots;
+
+	void AcquireTextures();
+	void Unbind(uint32_t physical);
+	void UnbindAll();
+};
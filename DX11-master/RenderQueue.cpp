@@ -0,0 +1,84 @@
+#include "RenderQueue.h"
+
+uint64_t RenderQueue::MakeKey(unsigned int pass, unsigned int shaderPair, unsigned int material, unsigned int mesh, float depth01)
+{
+	// Clamp and quantize the depth so closer draws get smaller keys
+	if (!(depth01 > 0.0f)) depth01 = 0.0f; // Also catches NaN
+	if (depth01 > 1.0f) depth01 = 1.0f;
+	uint64_t depth = (uint64_t)(depth01 * (float)((1u << DepthBits) - 1));
+
+	uint64_t key = 0;
+	key |= (uint64_t)(pass & ((1u << PassBits) - 1));
+	key = (key << ShaderBits) | (shaderPair & ((1u << ShaderBits) - 1));
+	key = (key << MaterialBits) | (material & ((1u << MaterialBits) - 1));
+	key = (key << MeshBits) | (mesh & ((1u << MeshBits) - 1));
+	key = (key << DepthBits) | depth;
+	return key;
+}
+
+unsigned int RenderQueue::MakeShaderPair(unsigned int vertexShaderID, unsigned int pixelShaderID)
+{
+	// Half of the shader field for each stage
+	const unsigned int half = ShaderBits / 2;
+	const unsigned int mask = (1u << half) - 1;
+	return ((vertexShaderID & mask) << half) | (pixelShaderID & mask);
+}
+
+void RenderQueue::Clear()
+{
+	// Keeps capacity, so steady-state frames don't allocate
+	items.clear();
+}
+
+void RenderQueue::Push(uint64_t key, unsigned int index)
+{
+	items.push_back({ key, index });
+}
+
+// --------------------------------------------------------
+// LSD radix sort, one byte per pass.  Passes where every
+// key has the same byte (common for the pass/shader bits)
+// are skipped entirely.  The sort is stable, so draws with
+// identical keys keep their submission order.
+// --------------------------------------------------------
+void RenderQueue::Sort()
+{
+	const size_t count = items.size();
+	if (count < 2)
+		return;
+
+	scratch.resize(count);
+	RenderItem* src = items.data();
+	RenderItem* dst = scratch.data();
+
+	for (unsigned int shift = 0; shift < 64; shift += 8)
+	{
+		size_t histogram[256] = {};
+		for (size_t i = 0; i < count; i++)
+			histogram[(src[i].Key >> shift) & 0xFF]++;
+
+		// All keys share this byte?  Nothing to reorder.
+		if (histogram[(src[0].Key >> shift) & 0xFF] == count)
+			continue;
+
+		// Turn counts into starting offsets
+		size_t offset = 0;
+		for (unsigned int b = 0; b < 256; b++)
+		{
+			size_t c = histogram[b];
+			histogram[b] = offset;
+			offset += c;
+		}
+
+		for (size_t i = 0; i < count; i++)
+			dst[histogram[(src[i].Key >> shift) & 0xFF]++] = src[i];
+
+		RenderItem* temp = src;
+		src = dst;
+		dst = temp;
+	}
+
+	// Odd number of real passes leaves the result in scratch
+	if (src != items.data())
+		items.swap(scratch);
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// --------------------------------------------------------
+// Passes occupy the top bits of the sort key, so every
+// draw of an earlier pass is submitted before any later one
+// --------------------------------------------------------
+enum RenderPass
+{
+	RENDER_PASS_OPAQUE = 0,
+	RENDER_PASS_COUNT
+};
+
+// --------------------------------------------------------
+// A single queued draw.  The index refers back into whatever
+// list the caller built the queue from (entities, etc.)
+// --------------------------------------------------------
+struct RenderItem
+{
+	uint64_t Key;
+	unsigned int Index;
+};
+
+// --------------------------------------------------------
+// Per-frame counters for the scene pass.  "Naive" is the
+// number of binds the old one-draw-at-a-time path would
+// have issued for the same draws, for comparison.
+// --------------------------------------------------------
+struct RenderStats
+{
+	unsigned int DrawCalls = 0;
+	unsigned int ShaderBinds = 0;
+	unsigned int MaterialBinds = 0;
+	unsigned int BindingTableBinds = 0;
+	unsigned int MeshBinds = 0;
+	unsigned int InstancedBatches = 0;
+	unsigned int InstancesDrawn = 0;
+	unsigned int CulledDraws = 0;
+	unsigned int ShadowDrawCalls = 0;
+	unsigned int ShadowCacheRebuilds = 0;
+	unsigned int StateChanges = 0;
+	unsigned int NaiveStateChanges = 0;
+	float SubmitMilliseconds = 0.0f;
+	float ShadowMilliseconds = 0.0f;
+
+	void Reset() { *this = RenderStats(); }
+};
+
+// --------------------------------------------------------
+// Collects draws with packed 64-bit sort keys and orders
+// them with a radix sort so consecutive draws share as much
+// pipeline state as possible.
+//
+// Key layout, most significant bits first:
+//  pass (4) | shader pair (12) | material (16) | mesh (12) | depth (20)
+// --------------------------------------------------------
+class RenderQueue
+{
+public:
+	static const unsigned int PassBits = 4;
+	static const unsigned int ShaderBits = 12;
+	static const unsigned int MaterialBits = 16;
+	static const unsigned int MeshBits = 12;
+	static const unsigned int DepthBits = 20;
+
+	// depth01 is the normalized front-to-back distance, clamped to [0,1]
+	static uint64_t MakeKey(unsigned int pass, unsigned int shaderPair, unsigned int material, unsigned int mesh, float depth01);
+	static unsigned int MakeShaderPair(unsigned int vertexShaderID, unsigned int pixelShaderID);
+
+	void Clear();
+	void Push(uint64_t key, unsigned int index);
+	void Sort();
+
+	const std::vector<RenderItem>& GetItems() const { return items; }
+	size_t Size() const { return items.size(); }
+
+private:
+	std::vector<RenderItem> items;
+	std::vector<RenderItem> scratch;
+};
@@ -0,0 +1,85 @@
+#include "RenderTargetPool.h"
+
+RenderTargetPool::RenderTargetPool(Microsoft::WRL::ComPtr<ID3D11Device> _device, unsigned int _idleFrames)
+	: device(_device), idleFrames(_idleFrames), frame(0), stats()
+{
+}
+
+void RenderTargetPool::BeginFrame()
+{
+	frame++;
+	for (size_t i = 0; i < targets.size(); )
+	{
+		if (frame - targets[i]->LastUsedFrame <= idleFrames)
+		{
+			i++;
+			continue;
+		}
+		targets[i] = std::move(targets.back());
+		targets.pop_back();
+		stats.Releases++;
+	}
+}
+
+const PooledRenderTarget* RenderTargetPool::Acquire(const RenderTargetDesc& desc)
+{
+	for (const std::unique_ptr<PooledRenderTarget>& target : targets)
+	{
+		if (target->LastUsedFrame != frame &&
+			target->Desc.Width == desc.Width &&
+			target->Desc.Height == desc.Height &&
+			target->Desc.Format == desc.Format &&
+			target->Desc.BindFlags == desc.BindFlags)
+		{
+			if (frame - target->LastUsedFrame > 1)
+				stats.Reuses++;
+			target->LastUsedFrame = frame;
+			return target.get();
+		}
+	}
+
+	D3D11_TEXTURE2D_DESC textureDesc = {};
+	textureDesc.Width = desc.Width;
+	textureDesc.Height = desc.Height;
+	textureDesc.ArraySize = 1;
+	textureDesc.BindFlags = desc.BindFlags;
+	textureDesc.Format = desc.Format;
+	textureDesc.MipLevels = 1;
+	textureDesc.SampleDesc.Count = 1;
+	textureDesc.Usage = D3D11_USAGE_DEFAULT;
+
+	std::unique_ptr<PooledRenderTarget> target(new PooledRenderTarget());
+	target->Desc = desc;
+	target->LastUsedFrame = frame;
+	device->CreateTexture2D(&textureDesc, 0, target->Texture.GetAddressOf());
+	if (desc.BindFlags & D3D11_BIND_RENDER_TARGET)
+		device->CreateRenderTargetView(target->Texture.Get(), 0, target->RTV.GetAddressOf());
+	if (desc.BindFlags & D3D11_BIND_SHADER_RESOURCE)
+		device->CreateShaderResourceView(target->Texture.Get(), 0, target->SRV.GetAddressOf());
+
+	targets.push_back(std::move(target));
+	stats.Allocations++;
+	return targets.back().get();
+}
+
+size_t RenderTargetPool::GetBytes() const
+{
+	size_t bytes = 0;
+	for (const std::unique_ptr<PooledRenderTarget>& target : targets)
+		bytes += (size_t)target->Desc.Width * target->Desc.Height * BytesPerPixel(target->Desc.Format);
+	return bytes;
+}
+
+// Only the formats the game asks for; others count as 4 bytes
+size_t RenderTargetPool::BytesPerPixel(DXGI_FORMAT format)
+{
+	switch (format)
+	{
+	case DXGI_FORMAT_R8_UNORM:				return 1;
+	case DXGI_FORMAT_R16_FLOAT:				return 2;
+	case DXGI_FORMAT_R16G16_FLOAT:			return 4;
+	case DXGI_FORMAT_R16G16B16A16_FLOAT:	return 8;
+	case DXGI_FORMAT_R32G32B32A32_FLOAT:	return 16;
+	default:								return 4;
+	}
+}
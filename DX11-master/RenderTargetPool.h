@@ -0,0 +1,73 @@
+#pragma once
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <memory>
+#include <vector>
+
+// --------------------------------------------------------
+// What a pooled texture is keyed by.  Compared field by
+// field, so two requests share a texture only when size,
+// format and bind flags all match.
+// --------------------------------------------------------
+struct RenderTargetDesc
+{
+	UINT Width;
+	UINT Height;
+	DXGI_FORMAT Format;
+	UINT BindFlags;		// D3D11_BIND_RENDER_TARGET and/or D3D11_BIND_SHADER_RESOURCE
+};
+
+struct PooledRenderTarget
+{
+	RenderTargetDesc Desc;
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> Texture;
+	Microsoft::WRL::ComPtr<ID3D11RenderTargetView> RTV;		// If bound as a render target
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> SRV;	// If bound as a shader resource
+	unsigned int LastUsedFrame;
+};
+
+// --------------------------------------------------------
+// Single-mip 2D textures handed out by description, so
+// frame-sized targets are created once and then reused
+// rather than recreated whenever whoever needs them does.
+//
+// A texture Acquire()d this frame belongs to the caller
+// until the next BeginFrame().  One nobody has acquired for
+// more than idleFrames frames is released then, so the
+// textures of an old window size go away shortly after a
+// resize instead of piling up.
+//
+// Handing out last frame's texture again for the same
+// request is no saving over keeping it, so a reuse is only
+// counted when the texture sat out at least one frame: an
+// SSAO resolution switched back, say, which recreating
+// textures on every change would have allocated again.
+// --------------------------------------------------------
+class RenderTargetPool
+{
+public:
+	struct Stats
+	{
+		unsigned int Allocations;	// Textures created
+		unsigned int Reuses;		// Idle textures handed out again instead of created
+		unsigned int Releases;		// Textures released for going unused
+	};
+
+	RenderTargetPool(Microsoft::WRL::ComPtr<ID3D11Device> _device, unsigned int _idleFrames);
+
+	void BeginFrame();
+	const PooledRenderTarget* Acquire(const RenderTargetDesc& desc);
+
+	size_t GetCount() const { return targets.size(); }
+	size_t GetBytes() const;
+	const Stats& GetStats() const { return stats; }
+
+private:
+	Microsoft::WRL::ComPtr<ID3D11Device> device;
+	unsigned int idleFrames;
+	unsigned int frame;
+	std::vector<std::unique_ptr<PooledRenderTarget>> targets;
+	Stats stats;
+
+	static size_t BytesPerPixel(DXGI_FORMAT format);
+};
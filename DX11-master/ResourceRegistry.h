@@ -0,0 +1,172 @@
+#pragma once
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <d3d11.h>
+#include <wrl/client.h>
+#include "Mesh.h"
+#include "material.h"
+#include "SimpleShader.h"
+
+// --------------------------------------------------------
+// 32-bit handle to a resource in a ResourcePool.
+//  - Low bits: slot index into the pool
+//  - High bits: generation of that slot when the handle was made
+//
+// Removing a resource bumps its slot's generation, so any
+// handle still pointing at the slot can be detected as stale.
+// A value of 0 is the null handle (generation 0 is never used).
+// --------------------------------------------------------
+template<typename T>
+struct Handle
+{
+	static const uint32_t IndexBits = 20;
+	static const uint32_t IndexMask = (1u << IndexBits) - 1;
+	static const uint32_t GenerationMask = (1u << (32 - IndexBits)) - 1;
+
+	uint32_t Value = 0;
+
+	uint32_t GetIndex() const { return Value & IndexMask; }
+	uint32_t GetGeneration() const { return Value >> IndexBits; }
+	bool IsNull() const { return Value == 0; }
+
+	bool operator==(const Handle& other) const { return Value == other.Value; }
+	bool operator!=(const Handle& other) const { return Value != other.Value; }
+};
+
+// Raw pointer from whatever owns the resource
+template<typename T>
+inline T* GetRawPointer(const std::shared_ptr<T>& owner) { return owner.get(); }
+template<typename T>
+inline T* GetRawPointer(const Microsoft::WRL::ComPtr<T>& owner) { return owner.Get(); }
+
+// --------------------------------------------------------
+// Dense pool of one kind of resource.  The pool keeps the
+// owning pointer alive; handles resolve to a plain raw
+// pointer with a single indexed load, so code holding
+// handles never touches a reference count.
+// --------------------------------------------------------
+template<typename T, typename Owner>
+class ResourcePool
+{
+public:
+	Handle<T> Add(Owner resource)
+	{
+		uint32_t index;
+		if (!freeSlots.empty())
+		{
+			index = freeSlots.back();
+			freeSlots.pop_back();
+		}
+		else
+		{
+			index = (uint32_t)resources.size();
+			assert(index <= Handle<T>::IndexMask && "Resource pool is full");
+			resources.push_back(0);
+			owners.push_back(Owner());
+			generations.push_back(1);
+		}
+
+		resources[index] = GetRawPointer(resource);
+		owners[index] = resource;
+		live++;
+
+		Handle<T> handle;
+		handle.Value = ((uint32_t)generations[index] << Handle<T>::IndexBits) | index;
+		return handle;
+	}
+
+	void Remove(Handle<T> handle)
+	{
+		if (!IsValid(handle))
+			return;
+
+		uint32_t index = handle.GetIndex();
+		resources[index] = 0;
+		owners[index] = Owner();
+
+		// Invalidate every outstanding handle to this slot, skipping 0
+		uint32_t generation = (generations[index] + 1) & Handle<T>::GenerationMask;
+		generations[index] = (uint16_t)(generation == 0 ? 1 : generation);
+
+		freeSlots.push_back(index);
+		live--;
+	}
+
+	// The hot path: one indexed load, checked in debug builds only
+	T* Get(Handle<T> handle) const
+	{
+#if defined(DEBUG) || defined(_DEBUG)
+		assert(IsValid(handle) && "Null or stale resource handle");
+#endif
+		return resources[handle.GetIndex()];
+	}
+
+	// The owning pointer, for code that needs to share ownership
+	const Owner& GetOwner(Handle<T> handle) const
+	{
+#if defined(DEBUG) || defined(_DEBUG)
+		assert(IsValid(handle) && "Null or stale resource handle");
+#endif
+		return owners[handle.GetIndex()];
+	}
+
+	bool IsValid(Handle<T> handle) const
+	{
+		uint32_t index = handle.GetIndex();
+		return !handle.IsNull() &&
+			index < generations.size() &&
+			generations[index] == handle.GetGeneration() &&
+			resources[index] != 0;
+	}
+
+	size_t Size() const { return live; }
+
+	void Clear()
+	{
+		resources.clear();
+		owners.clear();
+		generations.clear();
+		freeSlots.clear();
+		live = 0;
+	}
+
+private:
+	// All indexed by a handle's slot index
+	std::vector<T*> resources;
+	std::vector<uint16_t> generations;
+	std::vector<Owner> owners;
+
+	std::vector<uint32_t> freeSlots;
+	size_t live = 0;
+};
+
+typedef Handle<Mesh> MeshHandle;
+typedef Handle<Material> MaterialHandle;
+typedef Handle<SimpleVertexShader> VertexShaderHandle;
+typedef Handle<SimplePixelShader> PixelShaderHandle;
+typedef Handle<ID3D11ShaderResourceView> TextureHandle;
+
+// --------------------------------------------------------
+// Central owner of every loaded resource.  Everything else
+// refers to resources through the handles it hands out.
+// --------------------------------------------------------
+class ResourceRegistry
+{
+public:
+	ResourcePool<Mesh, std::shared_ptr<Mesh>> Meshes;
+	ResourcePool<Material, std::shared_ptr<Material>> Materials;
+	ResourcePool<SimpleVertexShader, std::shared_ptr<SimpleVertexShader>> VertexShaders;
+	ResourcePool<SimplePixelShader, std::shared_ptr<SimplePixelShader>> PixelShaders;
+	ResourcePool<ID3D11ShaderResourceView, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>> Textures;
+
+	void Clear()
+	{
+		Meshes.Clear();
+		Materials.Clear();
+		VertexShaders.Clear();
+		PixelShaders.Clear();
+		Textures.Clear();
+	}
+};
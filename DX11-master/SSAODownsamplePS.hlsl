@@ -0,0 +1,52 @@
+cbuffer externalData : register(b0)
+{
+	int scale;
+}
+struct VertexToPixel
+{
+	float4 position : SV_POSITION;
+	float2 uv : TEXCOORD0;
+};
+struct PS_Output
+{
+	float depth : SV_TARGET0;
+	float4 normal : SV_TARGET1;
+};
+Texture2D Depths : register(t0);
+Texture2D Normals : register(t1);
+
+// Shrinks the G-buffer's depths and normals for a low resolution
+// SSAO pass.  Each texel keeps one texel of its scale x scale
+// block, alternating in a checkerboard between the nearest and
+// the farthest, so both sides of a depth edge keep AO samples.
+// The normal comes from the same texel as the depth, never an
+// average across the edge.  See SSAOResample.h.
+PS_Output main(VertexToPixel input)
+{
+	uint width, height;
+	Depths.GetDimensions(width, height);
+	int2 lowPixel = int2(input.position.xy);
+	bool takeMax = ((lowPixel.x + lowPixel.y) & 1) != 0;
+
+	float best = takeMax ? -1.0f : 2.0f;
+	int2 bestPixel = 0;
+	for (int y = 0; y < scale; y++)
+	{
+		for (int x = 0; x < scale; x++)
+		{
+			// Blocks hanging off the edge repeat the last row and column
+			int2 pixel = min(lowPixel * scale + int2(x, y), int2(width, height) - 1);
+			float depth = Depths.Load(int3(pixel, 0)).r;
+			if (takeMax ? depth > best : depth < best)
+			{
+				best = depth;
+				bestPixel = pixel;
+			}
+		}
+	}
+
+	PS_Output output;
+	output.depth = best;
+	output.normal = Normals.Load(int3(bestPixel, 0));
+	return output;
+}
@@ -0,0 +1,97 @@
+#include "SSAOResample.h"
+#include <cmath>
+
+static int Clamp(int value, int low, int high)
+{
+	return value < low ? low : (value > high ? high : value);
+}
+
+void SSAOResample::Downsample(const float* depths, const float* normals, uint32_t width, uint32_t height, int scale,
+	float* lowDepths, float* lowNormals)
+{
+	uint32_t lowWidth = LowSize(width, scale);
+	uint32_t lowHeight = LowSize(height, scale);
+	for (uint32_t ly = 0; ly < lowHeight; ly++)
+	{
+		for (uint32_t lx = 0; lx < lowWidth; lx++)
+		{
+			bool takeMax = ((lx + ly) & 1) != 0;
+			float best = takeMax ? -1.0f : 2.0f;
+			size_t bestTexel = 0;
+			for (int y = 0; y < scale; y++)
+			{
+				for (int x = 0; x < scale; x++)
+				{
+					// Blocks hanging off the edge repeat the last row and column
+					int tx = Clamp((int)lx * scale + x, 0, (int)width - 1);
+					int ty = Clamp((int)ly * scale + y, 0, (int)height - 1);
+					size_t texel = (size_t)ty * width + tx;
+					float depth = depths[texel];
+					if (takeMax ? depth > best : depth < best)
+					{
+						best = depth;
+						bestTexel = texel;
+					}
+				}
+			}
+
+			size_t low = (size_t)ly * lowWidth + lx;
+			lowDepths[low] = best;
+			for (int c = 0; c < 4; c++)
+				lowNormals[low * 4 + c] = normals[bestTexel * 4 + c];
+		}
+	}
+}
+
+float SSAOResample::UpsamplePixel(const float* lowAO, const float* lowViewDepths, uint32_t lowWidth, uint32_t lowHeight,
+	float viewDepth, uint32_t x, uint32_t y, int scale, float tolerance)
+{
+	// Position among the low resolution texel centers
+	float lowX = (x + 0.5f) / scale - 0.5f;
+	float lowY = (y + 0.5f) / scale - 0.5f;
+	float x0 = floorf(lowX);
+	float y0 = floorf(lowY);
+	float fx = lowX - x0;
+	float fy = lowY - y0;
+
+	float total = 0.0f;
+	float totalWeight = 0.0f;
+	float nearestAO = 1.0f;
+	float nearestDifference = 0.0f;
+	for (int j = 0; j < 2; j++)
+	{
+		for (int i = 0; i < 2; i++)
+		{
+			int tx = Clamp((int)x0 + i, 0, (int)lowWidth - 1);
+			int ty = Clamp((int)y0 + j, 0, (int)lowHeight - 1);
+			size_t texel = (size_t)ty * lowWidth + tx;
+
+			float difference = fabsf(viewDepth - lowViewDepths[texel]);
+			float relative = difference / (viewDepth * tolerance);
+			float bilinear = (i ? fx : 1.0f - fx) * (j ? fy : 1.0f - fy);
+			float weight = bilinear / (1.0f + relative * relative);
+			total += lowAO[texel] * weight;
+			totalWeight += weight;
+
+			if ((i == 0 && j == 0) || difference < nearestDifference)
+			{
+				nearestDifference = difference;
+				nearestAO = lowAO[texel];
+			}
+		}
+	}
+	return totalWeight > 0.001f ? total / totalWeight : nearestAO;
+}
+
+void SSAOResample::Upsample(const float* lowAO, const float* lowViewDepths, uint32_t lowWidth, uint32_t lowHeight,
+	const float* viewDepths, uint32_t width, uint32_t height, int scale, float tolerance, float* ao)
+{
+	for (uint32_t y = 0; y < height; y++)
+	{
+		for (uint32_t x = 0; x < width; x++)
+		{
+			size_t pixel = (size_t)y * width + x;
+			ao[pixel] = UpsamplePixel(lowAO, lowViewDepths, lowWidth, lowHeight, viewDepths[pixel], x, y, scale, tolerance);
+		}
+	}
+}
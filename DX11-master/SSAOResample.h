@@ -0,0 +1,41 @@
+#pragma once
+#include <cstdint>
+
+// --------------------------------------------------------
+// CPU reference for the low resolution SSAO path, matching
+// SSAODownsamplePS.hlsl and SSAOUpsamplePS.hlsl step for step.
+//
+// Downsample: each low resolution texel covers a scale x scale
+// block of the G-buffer and keeps one of its texels, with that
+// texel's normal.  Texels alternate in a checkerboard between
+// the block's nearest and farthest depth, so both sides of a
+// depth edge keep some AO samples.
+//
+// Upsample: a joint bilateral filter.  A full resolution pixel
+// blends the four low resolution AO texels around it by their
+// bilinear weights, each scaled down by how far its depth is
+// from the pixel's, relative to the pixel's depth:
+//
+//   weight = bilinear / (1 + (|z - zLow| / (z * tolerance))^2)
+//
+// If every weight is next to nothing (none of the four is on
+// the pixel's surface) it takes the nearest in depth.
+//
+// Images are row by row; normals are 4 floats per texel.
+// The upsample takes view space depths, which the shader
+// gets from the G-buffer's depths with the inverse projection.
+// --------------------------------------------------------
+class SSAOResample
+{
+public:
+	static uint32_t LowSize(uint32_t size, int scale) { return (size + scale - 1) / scale; }
+
+	static void Downsample(const float* depths, const float* normals, uint32_t width, uint32_t height, int scale,
+		float* lowDepths, float* lowNormals);
+
+	static void Upsample(const float* lowAO, const float* lowViewDepths, uint32_t lowWidth, uint32_t lowHeight,
+		const float* viewDepths, uint32_t width, uint32_t height, int scale, float tolerance, float* ao);
+
+	static float UpsamplePixel(const float* lowAO, const float* lowViewDepths, uint32_t lowWidth, uint32_t lowHeight,
+		float viewDepth, uint32_t x, uint32_t y, int scale, float tolerance);
+};
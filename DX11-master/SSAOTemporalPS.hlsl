@@ -0,0 +1,53 @@
+cbuffer externalData : register(b0)
+{
+	matrix currentToPreviousView;
+	matrix previousProjection;
+	matrix invProjMatrix;
+	float depthTolerance;
+	int historyValid;
+	int maxHistory;
+}
+struct VertexToPixel
+{
+	float4 position : SV_POSITION;
+	float2 uv : TEXCOORD0;
+};
+Texture2D SSAO : register(t0);
+Texture2D Depths : register(t1);
+Texture2D History : register(t2);
+
+// Blends this frame's AO into the previous frame's history,
+// found by reprojecting the pixel's position with the previous
+// view and projection.  The history is (AO, view depth, frame
+// count); it's dropped where the pixel was off screen or its
+// depth there doesn't match.  See TemporalAO.h.
+float4 main(VertexToPixel input) : SV_TARGET
+{
+	int2 pixel = int2(input.position.xy);
+	float ao = SSAO.Load(int3(pixel, 0)).r;
+	float depth = Depths.Load(int3(pixel, 0)).r;
+	float4 viewPos = mul(invProjMatrix, float4(0, 0, depth, 1));
+	float viewDepth = viewPos.z / viewPos.w;
+
+	// Back to NDCs, flipping y, then to the previous view
+	float2 ndc = float2(input.uv.x * 2 - 1, 1 - input.uv.y * 2);
+	float4 previousView = mul(currentToPreviousView, float4(ndc, depth, 1));
+	previousView /= previousView.w;
+	float4 clip = mul(previousProjection, float4(previousView.xyz, 1));
+	float2 previousUV = float2(clip.x / clip.w * 0.5f + 0.5f, 0.5f - clip.y / clip.w * 0.5f);
+
+	bool onScreen = clip.w > 0 && all(previousUV >= 0) && all(previousUV <= 1);
+	if (historyValid && onScreen)
+	{
+		uint width, height;
+		History.GetDimensions(width, height);
+		int2 previousPixel = min(int2(previousUV * float2(width, height)), int2(width, height) - 1);
+		float3 history = History.Load(int3(previousPixel, 0)).rgb;
+		if (abs(previousView.z - history.g) <= abs(previousView.z) * depthTolerance)
+		{
+			float count = min(history.b + 1, maxHistory);
+			return float4(lerp(history.r, ao, 1 / count), viewDepth, count, 1);
+		}
+	}
+	return float4(ao, viewDepth, 1, 1);
+}
@@ -0,0 +1,69 @@
+cbuffer externalData : register(b0)
+{
+	matrix invProjMatrix;
+	int scale;
+	float depthTolerance;
+}
+struct VertexToPixel
+{
+	float4 position : SV_POSITION;
+	float2 uv : TEXCOORD0;
+};
+Texture2D SSAO : register(t0);
+Texture2D LowDepths : register(t1);
+Texture2D Depths : register(t2);
+
+// View space z of a post-projection depth
+float ViewDepth(float depth)
+{
+	float4 viewPos = mul(invProjMatrix, float4(0, 0, depth, 1));
+	return viewPos.z / viewPos.w;
+}
+
+// Joint bilateral upsample of the low resolution AO: the four
+// low resolution texels around the pixel are blended by their
+// bilinear weights, each scaled down by how far its depth is
+// from the pixel's (relative to the pixel's depth), so AO
+// doesn't bleed across depth edges.  See SSAOResample.h.
+float4 main(VertexToPixel input) : SV_TARGET
+{
+	uint lowWidth, lowHeight;
+	SSAO.GetDimensions(lowWidth, lowHeight);
+	int2 pixel = int2(input.position.xy);
+	float viewDepth = ViewDepth(Depths.Load(int3(pixel, 0)).r);
+
+	// Position among the low resolution texel centers
+	float2 lowPosition = (pixel + 0.5f) / scale - 0.5f;
+	float2 base = floor(lowPosition);
+	float2 f = lowPosition - base;
+
+	float total = 0;
+	float totalWeight = 0;
+	float nearestAO = 1;
+	float nearestDifference = 0;
+	for (int j = 0; j < 2; j++)
+	{
+		for (int i = 0; i < 2; i++)
+		{
+			int2 texel = clamp(int2(base) + int2(i, j), 0, int2(lowWidth, lowHeight) - 1);
+			float ao = SSAO.Load(int3(texel, 0)).r;
+
+			float difference = abs(viewDepth - ViewDepth(LowDepths.Load(int3(texel, 0)).r));
+			float relative = difference / (viewDepth * depthTolerance);
+			float bilinear = (i ? f.x : 1 - f.x) * (j ? f.y : 1 - f.y);
+			float weight = bilinear / (1 + relative * relative);
+			total += ao * weight;
+			totalWeight += weight;
+
+			if ((i == 0 && j == 0) || difference < nearestDifference)
+			{
+				nearestDifference = difference;
+				nearestAO = ao;
+			}
+		}
+	}
+
+	// None of the four is on this pixel's surface
+	float result = totalWeight > 0.001f ? total / totalWeight : nearestAO;
+	return float4(result.rrr, 1);
+}
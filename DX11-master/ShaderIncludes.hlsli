@@ -27,7 +27,6 @@ struct VertexToPixel
 	float3 normal			: NORMAL;
 	float3 worldPos			: POSITION;
 	float3 tangent			: TANGENT;
-	float4 shadowMapPos		: SHADOW_POSITION;
 };
 
 struct Light
@@ -0,0 +1,117 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+#include <cwchar>
+
+// --------------------------------------------------------
+// Optional features of the scene pixel shader.  Each
+// combination is compiled offline into its own variant
+// (Tools/GenerateShaderPermutations.py), so a material only
+// pays for the features it asks for.
+//
+// Bit order must match FEATURES in the generator script.
+// --------------------------------------------------------
+enum ShaderFeature
+{
+	SHADER_FEATURE_SHADOWS			= 1 << 0,
+	SHADER_FEATURE_NORMAL_MAP		= 1 << 1,
+	SHADER_FEATURE_METALNESS_MAP	= 1 << 2,	// Roughness and metalness maps
+	SHADER_FEATURE_SSAO_OUTPUTS		= 1 << 3,	// Without it the pixel opts out of SSAO
+
+	SHADER_FEATURE_COUNT = 4,
+	SHADER_FEATURE_ALL = (1 << SHADER_FEATURE_COUNT) - 1
+};
+
+// --------------------------------------------------------
+// Compiled file for one variant: "PixelShader" and
+// SHADER_FEATURE_SHADOWS give "PixelShader_01.cso".  With
+// every feature on it's just the shader itself.
+// --------------------------------------------------------
+inline std::wstring GetPermutationFileName(const std::wstring& shaderName, unsigned int features)
+{
+	features &= SHADER_FEATURE_ALL;
+	if (features == SHADER_FEATURE_ALL)
+		return shaderName + L".cso";
+
+	wchar_t suffix[16];
+	swprintf(suffix, 16, L"_%02X.cso", features);
+	return shaderName + suffix;
+}
+
+// --------------------------------------------------------
+// Every variant of one shader, indexed directly by its
+// feature bits.
+//
+// Resolve() never fails as long as the full variant is
+// loaded: a missing variant falls back to the loaded one
+// with the fewest extra features, which is what every
+// material drew with before permutations existed.  The
+// fallbacks are worked out whenever a variant is set, so
+// lookups are a single index.
+// --------------------------------------------------------
+template<typename T>
+class ShaderPermutationTable
+{
+public:
+	ShaderPermutationTable()
+		: variants(1 << SHADER_FEATURE_COUNT), resolved(1 << SHADER_FEATURE_COUNT)
+	{
+	}
+
+	void Set(unsigned int features, std::shared_ptr<T> shader)
+	{
+		variants[features & SHADER_FEATURE_ALL] = shader;
+		BuildFallbacks();
+	}
+
+	// The exact variant, or null if it isn't loaded
+	const std::shared_ptr<T>& Get(unsigned int features) const { return variants[features & SHADER_FEATURE_ALL]; }
+
+	// The variant to draw with
+	const std::shared_ptr<T>& Resolve(unsigned int features) const { return resolved[features & SHADER_FEATURE_ALL]; }
+
+	// Indexed by feature bits; unloaded ones are null
+	const std::vector<std::shared_ptr<T>>& GetVariants() const { return variants; }
+
+	unsigned int GetLoadedCount() const
+	{
+		unsigned int count = 0;
+		for (const std::shared_ptr<T>& v : variants)
+			count += v ? 1 : 0;
+		return count;
+	}
+
+private:
+	std::vector<std::shared_ptr<T>> variants;
+	std::vector<std::shared_ptr<T>> resolved;
+
+	static unsigned int CountBits(unsigned int bits)
+	{
+		unsigned int count = 0;
+		for (; bits; bits &= bits - 1)
+			count++;
+		return count;
+	}
+
+	void BuildFallbacks()
+	{
+		for (unsigned int wanted = 0; wanted < variants.size(); wanted++)
+		{
+			resolved[wanted] = 0;
+			unsigned int fewestExtra = SHADER_FEATURE_COUNT + 1;
+			for (unsigned int have = 0; have < variants.size(); have++)
+			{
+				if (!variants[have] || (have & wanted) != wanted)
+					continue;
+
+				unsigned int extra = CountBits(have & ~wanted);
+				if (extra < fewestExtra)
+				{
+					resolved[wanted] = variants[have];
+					fewestExtra = extra;
+				}
+			}
+		}
+	}
+};
@@ -0,0 +1,177 @@
+#include "ShaderReflectionCache.h"
+#include <cstring>
+
+namespace
+{
+	const uint32_t Magic = 0x4C464552; // "REFL"
+	const uint32_t Version = 1;
+
+	// Fixed-size values are written in the machine's own byte order;
+	// the sidecar is only ever read back on the machine that wrote it
+	struct Writer
+	{
+		std::vector<unsigned char>& Out;
+
+		void U32(uint32_t v) { Bytes(&v, sizeof(v)); }
+		void U64(uint64_t v) { Bytes(&v, sizeof(v)); }
+		void String(const std::string& s)
+		{
+			U32((uint32_t)s.size());
+			Bytes(s.data(), s.size());
+		}
+		void Bytes(const void* data, size_t size)
+		{
+			const unsigned char* bytes = (const unsigned char*)data;
+			Out.insert(Out.end(), bytes, bytes + size);
+		}
+	};
+
+	// Every read is bounds checked; after the first failure all
+	// reads fail and Ok stays false
+	struct Reader
+	{
+		const unsigned char* Data;
+		size_t Size;
+		size_t Position;
+		bool Ok;
+
+		bool Bytes(void* out, size_t size)
+		{
+			if (!Ok || size > Size - Position)
+				return Ok = false;
+			memcpy(out, Data + Position, size);
+			Position += size;
+			return true;
+		}
+		uint32_t U32() { uint32_t v = 0; Bytes(&v, sizeof(v)); return v; }
+		uint64_t U64() { uint64_t v = 0; Bytes(&v, sizeof(v)); return v; }
+		std::string String()
+		{
+			uint32_t length = U32();
+			if (!Ok || length > Size - Position)
+			{
+				Ok = false;
+				return std::string();
+			}
+			std::string s((const char*)Data + Position, length);
+			Position += length;
+			return s;
+		}
+
+		// Guards the vector sizes read from the file; every element
+		// takes at least minimumSize bytes
+		bool Count(uint32_t& count, size_t minimumSize)
+		{
+			count = U32();
+			if (Ok && count > (Size - Position) / minimumSize)
+				Ok = false;
+			return Ok;
+		}
+	};
+
+	void WriteResources(Writer& w, const std::vector<ReflectedResource>& resources)
+	{
+		w.U32((uint32_t)resources.size());
+		for (const ReflectedResource& r : resources)
+		{
+			w.String(r.Name);
+			w.U32(r.BindIndex);
+		}
+	}
+
+	void ReadResources(Reader& r, std::vector<ReflectedResource>& resources)
+	{
+		uint32_t count;
+		if (!r.Count(count, 8))
+			return;
+
+		resources.resize(count);
+		for (ReflectedResource& res : resources)
+		{
+			res.Name = r.String();
+			res.BindIndex = r.U32();
+		}
+	}
+}
+
+uint64_t ShaderReflectionCache::HashBytecode(const void* data, size_t size)
+{
+	const unsigned char* bytes = (const unsigned char*)data;
+	uint64_t hash = 14695981039346656037ull;
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+void ShaderReflectionCache::Serialize(const ShaderReflectionData& reflection, uint64_t bytecodeHash, std::vector<unsigned char>& out)
+{
+	out.clear();
+	Writer w = { out };
+	w.U32(Magic);
+	w.U32(Version);
+	w.U64(bytecodeHash);
+
+	w.U32((uint32_t)reflection.Buffers.size());
+	for (const ReflectedBuffer& b : reflection.Buffers)
+	{
+		w.String(b.Name);
+		w.U32(b.Type);
+		w.U32(b.BindIndex);
+		w.U32(b.Size);
+		w.U32((uint32_t)b.Variables.size());
+		for (const ReflectedVariable& v : b.Variables)
+		{
+			w.String(v.Name);
+			w.U32(v.ByteOffset);
+			w.U32(v.Size);
+		}
+	}
+
+	WriteResources(w, reflection.Textures);
+	WriteResources(w, reflection.Samplers);
+}
+
+bool ShaderReflectionCache::Deserialize(const unsigned char* data, size_t size, uint64_t bytecodeHash, ShaderReflectionData& out)
+{
+	Reader r = { data, size, 0, true };
+	if (r.U32() != Magic || r.U32() != Version || r.U64() != bytecodeHash || !r.Ok)
+		return false;
+
+	ShaderReflectionData result;
+
+	uint32_t bufferCount;
+	if (!r.Count(bufferCount, 20))
+		return false;
+	result.Buffers.resize(bufferCount);
+	for (ReflectedBuffer& b : result.Buffers)
+	{
+		b.Name = r.String();
+		b.Type = r.U32();
+		b.BindIndex = r.U32();
+		b.Size = r.U32();
+
+		uint32_t variableCount;
+		if (!r.Count(variableCount, 12))
+			return false;
+		b.Variables.resize(variableCount);
+		for (ReflectedVariable& v : b.Variables)
+		{
+			v.Name = r.String();
+			v.ByteOffset = r.U32();
+			v.Size = r.U32();
+		}
+	}
+
+	ReadResources(r, result.Textures);
+	ReadResources(r, result.Samplers);
+
+	// Anything left over means the file isn't what we wrote
+	if (!r.Ok || r.Position != size)
+		return false;
+
+	out = std::move(result);
+	return true;
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// --------------------------------------------------------
+// Everything SimpleShader needs from shader reflection, in
+// plain types so it can be saved next to the compiled shader
+// and loaded back without calling D3DReflect
+// --------------------------------------------------------
+struct ReflectedVariable
+{
+	std::string Name;
+	uint32_t ByteOffset;
+	uint32_t Size;
+};
+
+struct ReflectedBuffer
+{
+	std::string Name;
+	uint32_t Type;		// D3D_CBUFFER_TYPE
+	uint32_t BindIndex;
+	uint32_t Size;
+	std::vector<ReflectedVariable> Variables;
+};
+
+struct ReflectedResource
+{
+	std::string Name;
+	uint32_t BindIndex;
+};
+
+struct ShaderReflectionData
+{
+	std::vector<ReflectedBuffer> Buffers;
+	std::vector<ReflectedResource> Textures;	// In reflection order
+	std::vector<ReflectedResource> Samplers;	// In reflection order
+};
+
+// --------------------------------------------------------
+// Binary sidecar format for ShaderReflectionData.  The file
+// records a hash of the shader bytecode it was made from, and
+// is rejected if the shader no longer matches (or the file is
+// truncated or from another version of this format).
+// --------------------------------------------------------
+class ShaderReflectionCache
+{
+public:
+	// 64-bit FNV-1a
+	static uint64_t HashBytecode(const void* data, size_t size);
+
+	static void Serialize(const ShaderReflectionData& reflection, uint64_t bytecodeHash, std::vector<unsigned char>& out);
+	static bool Deserialize(const unsigned char* data, size_t size, uint64_t bytecodeHash, ShaderReflectionData& out);
+};
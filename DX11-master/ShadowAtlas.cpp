@@ -0,0 +1,308 @@
+#include "ShadowAtlas.h"
+#include <algorithm>
+#include <cmath>
+
+static const uint32_t NoLevel = 0xFFFFFFFF;
+
+// --------------------------------------------------------
+// Allocator
+// --------------------------------------------------------
+ShadowAtlasAllocator::ShadowAtlasAllocator(uint32_t atlasSize, uint32_t minTileSize)
+	: atlasSize(atlasSize), minTileSize(minTileSize), usedArea(0)
+{
+	levelCount = LevelOf(minTileSize) + 1;
+	uint32_t nodeCount = 0;
+	for (uint32_t level = 0; level < levelCount; level++)
+	{
+		levelStart.push_back(nodeCount);
+		nodeCount += 1u << (2 * level);
+	}
+	nodes.resize(nodeCount, NODE_FREE);
+}
+
+uint32_t ShadowAtlasAllocator::RoundUpToPowerOfTwo(uint32_t value)
+{
+	uint32_t power = 1;
+	while (power < value)
+		power <<= 1;
+	return power;
+}
+
+bool ShadowAtlasAllocator::Allocate(uint32_t size, AtlasTile& tile)
+{
+	size = RoundUpToPowerOfTwo(size);
+	if (size < minTileSize)
+		size = minTileSize;
+	if (size > atlasSize)
+		return false;
+
+	uint32_t targetLevel = LevelOf(size);
+	uint32_t bestLevel = NoLevel;
+	uint32_t bestIndex = 0;
+	FindFreeNode(0, 0, targetLevel, bestLevel, bestIndex);
+	if (bestLevel == NoLevel)
+		return false;
+
+	// Split down to the tile's size; the first child of a fresh
+	// split is always free
+	while (bestLevel < targetLevel)
+	{
+		Node(bestLevel, bestIndex) = NODE_SPLIT;
+		bestLevel++;
+		bestIndex *= 4;
+	}
+	Node(targetLevel, bestIndex) = NODE_USED;
+	usedArea += (uint64_t)size * size;
+	tile = TileOf(targetLevel, bestIndex);
+	return true;
+}
+
+void ShadowAtlasAllocator::Free(const AtlasTile& tile)
+{
+	uint32_t level = LevelOf(tile.Size);
+	uint32_t index = IndexOf(tile, level);
+	Node(level, index) = NODE_FREE;
+	usedArea -= (uint64_t)tile.Size * tile.Size;
+
+	// Merge while all four siblings are free
+	while (level > 0)
+	{
+		uint32_t parent = index / 4;
+		for (uint32_t c = 0; c < 4; c++)
+		{
+			if (Node(level, parent * 4 + c) != NODE_FREE)
+				return;
+		}
+		level--;
+		index = parent;
+		Node(level, index) = NODE_FREE;
+	}
+}
+
+void ShadowAtlasAllocator::Clear()
+{
+	std::fill(nodes.begin(), nodes.end(), (uint8_t)NODE_FREE);
+	usedArea = 0;
+}
+
+uint32_t ShadowAtlasAllocator::LevelOf(uint32_t size) const
+{
+	uint32_t level = 0;
+	for (uint32_t s = atlasSize; s > size; s >>= 1)
+		level++;
+	return level;
+}
+
+void ShadowAtlasAllocator::FindFreeNode(uint32_t level, uint32_t index, uint32_t targetLevel, uint32_t& bestLevel, uint32_t& bestIndex)
+{
+	uint8_t state = Node(level, index);
+	if (state == NODE_USED)
+		return;
+
+	// Deeper free nodes are smaller, so a tighter fit
+	if (state == NODE_FREE)
+	{
+		if (bestLevel == NoLevel || level > bestLevel)
+		{
+			bestLevel = level;
+			bestIndex = index;
+		}
+		return;
+	}
+
+	// A split node at the target size has no room for the whole tile
+	if (level == targetLevel)
+		return;
+
+	for (uint32_t c = 0; c < 4 && bestLevel != targetLevel; c++)
+		FindFreeNode(level + 1, index * 4 + c, targetLevel, bestLevel, bestIndex);
+}
+
+// Each pair of index bits picks a quadrant: bit 0 is right, bit 1 is down
+AtlasTile ShadowAtlasAllocator::TileOf(uint32_t level, uint32_t index) const
+{
+	AtlasTile tile = {};
+	tile.Size = atlasSize >> level;
+	for (uint32_t k = 0; k < level; k++)
+	{
+		uint32_t quadrant = (index >> (2 * k)) & 3;
+		uint32_t cell = tile.Size << k;
+		tile.X += (quadrant & 1) * cell;
+		tile.Y += (quadrant >> 1) * cell;
+	}
+	return tile;
+}
+
+uint32_t ShadowAtlasAllocator::IndexOf(const AtlasTile& tile, uint32_t level) const
+{
+	uint32_t index = 0;
+	for (uint32_t k = 0; k < level; k++)
+	{
+		uint32_t cell = tile.Size << k;
+		uint32_t quadrant = ((tile.X / cell) & 1) | (((tile.Y / cell) & 1) << 1);
+		index |= quadrant << (2 * k);
+	}
+	return index;
+}
+
+// --------------------------------------------------------
+// Atlas
+// --------------------------------------------------------
+ShadowAtlas::ShadowAtlas(uint32_t atlasSize, uint32_t minTileSize, uint32_t maxTileSize)
+	: allocator(atlasSize, minTileSize), maxTileSize(maxTileSize), frame(0), evictions(0)
+{
+}
+
+void ShadowAtlas::BeginFrame()
+{
+	frame++;
+	evictions = 0;
+}
+
+bool ShadowAtlas::Request(uint64_t key, uint32_t size, AtlasTile& tile, bool& fresh)
+{
+	size = ShadowAtlasAllocator::RoundUpToPowerOfTwo(size);
+	if (size < allocator.GetMinTileSize())
+		size = allocator.GetMinTileSize();
+	if (size > maxTileSize)
+		size = maxTileSize;
+
+	fresh = false;
+	auto found = entries.find(key);
+	if (found != entries.end())
+	{
+		Entry& entry = found->second;
+		Touch(entry);
+
+		// Only shrink once the view wants a quarter of its tile, so
+		// a light sitting on a size boundary doesn't flip every frame
+		if (size * 2 < entry.Tile.Size)
+		{
+			// The old tile's space is always enough for the new one
+			allocator.Free(entry.Tile);
+			allocator.Allocate(size, entry.Tile);
+			fresh = true;
+		}
+		else if (size > entry.Tile.Size)
+		{
+			AtlasTile bigger;
+			if (AllocateWithEviction(size, size, bigger))
+			{
+				allocator.Free(entry.Tile);
+				entry.Tile = bigger;
+				fresh = true;
+			}
+		}
+		tile = entry.Tile;
+		return true;
+	}
+
+	AtlasTile allocated;
+	if (!AllocateWithEviction(size, allocator.GetMinTileSize(), allocated))
+		return false;
+
+	lru.push_front(key);
+	Entry& entry = entries[key];
+	entry.Tile = allocated;
+	entry.LastFrame = frame;
+	entry.LruPosition = lru.begin();
+	tile = allocated;
+	fresh = true;
+	return true;
+}
+
+void ShadowAtlas::Release(uint64_t key)
+{
+	auto found = entries.find(key);
+	if (found == entries.end())
+		return;
+
+	allocator.Free(found->second.Tile);
+	lru.erase(found->second.LruPosition);
+	entries.erase(found);
+}
+
+void ShadowAtlas::Clear()
+{
+	allocator.Clear();
+	entries.clear();
+	lru.clear();
+}
+
+void ShadowAtlas::Touch(Entry& entry)
+{
+	entry.LastFrame = frame;
+	lru.splice(lru.begin(), lru, entry.LruPosition);
+}
+
+bool ShadowAtlas::AllocateWithEviction(uint32_t size, uint32_t smallestSize, AtlasTile& tile)
+{
+	for (uint32_t s = size; s >= smallestSize; s /= 2)
+	{
+		// Stale tiles go, oldest first, until this size fits or
+		// there are none left
+		do
+		{
+			if (allocator.Allocate(s, tile))
+				return true;
+		} while (EvictOldest());
+	}
+	return false;
+}
+
+bool ShadowAtlas::EvictOldest()
+{
+	if (lru.empty())
+		return false;
+
+	// Everything after a tile requested this frame was too
+	uint64_t key = lru.back();
+	auto found = entries.find(key);
+	if (found->second.LastFrame == frame)
+		return false;
+
+	allocator.Free(found->second.Tile);
+	entries.erase(found);
+	lru.pop_back();
+	evictions++;
+	return true;
+}
+
+// --------------------------------------------------------
+// Heuristics
+// --------------------------------------------------------
+float ShadowAtlas::ScreenCoverage(const CascadeVector& lightPosition, float range,
+	const CascadeVector& cameraPosition, float tanHalfFovY)
+{
+	float dx = lightPosition.X - cameraPosition.X;
+	float dy = lightPosition.Y - cameraPosition.Y;
+	float dz = lightPosition.Z - cameraPosition.Z;
+	float distanceSquared = dx * dx + dy * dy + dz * dz;
+	if (distanceSquared <= range * range)
+		return 1.0f;
+
+	// Tangent of the sphere's angular radius, against the half FOV's
+	float coverage = range / (sqrtf(distanceSquared - range * range) * tanHalfFovY);
+	return coverage < 1.0f ? coverage : 1.0f;
+}
+
+uint32_t ShadowAtlas::TileSizeFor(float coverage) const
+{
+	uint32_t size = ShadowAtlasAllocator::RoundUpToPowerOfTwo((uint32_t)(coverage * maxTileSize));
+	if (size < allocator.GetMinTileSize())
+		return allocator.GetMinTileSize();
+	return size < maxTileSize ? size : maxTileSize;
+}
+
+float ShadowAtlas::UpdatePriority(float coverage, unsigned int framesWaiting)
+{
+	return coverage * (1.0f + framesWaiting);
+}
+
+void ShadowAtlas::SelectUpdates(std::vector<ShadowUpdateCandidate>& candidates, unsigned int budget)
+{
+	size_t kept = candidates.size() < budget ? candidates.size() : budget;
+	std::partial_sort(candidates.begin(), candidates.begin() + kept, candidates.end(),
+		[](const ShadowUpdateCandidate& a, const ShadowUpdateCandidate& b) { return a.Priority > b.Priority; });
+	candidates.resize(kept);
+}
@@ -0,0 +1,153 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <vector>
+#include "ShadowCascades.h"
+
+// --------------------------------------------------------
+// A square region of the atlas, in texels
+// --------------------------------------------------------
+struct AtlasTile
+{
+	uint32_t X;
+	uint32_t Y;
+	uint32_t Size;
+};
+
+// --------------------------------------------------------
+// Quad-tree allocator for square, power-of-two tiles of one
+// square atlas.  Each node is free, split into four
+// children or in use, and freeing the last used child of a
+// node merges it back into one free node.
+//
+// A tile comes from the smallest free node that fits it, so
+// small tiles pack together and large free areas stay whole.
+// --------------------------------------------------------
+class ShadowAtlasAllocator
+{
+public:
+	// Both sizes are powers of two
+	ShadowAtlasAllocator(uint32_t atlasSize, uint32_t minTileSize);
+
+	// size is rounded up to a power of two, at least the minimum
+	bool Allocate(uint32_t size, AtlasTile& tile);
+	void Free(const AtlasTile& tile);
+	void Clear();
+
+	uint32_t GetAtlasSize() const { return atlasSize; }
+	uint32_t GetMinTileSize() const { return minTileSize; }
+	uint64_t GetUsedArea() const { return usedArea; }
+
+	static uint32_t RoundUpToPowerOfTwo(uint32_t value);
+
+private:
+	enum NodeState : uint8_t
+	{
+		NODE_FREE,
+		NODE_SPLIT,
+		NODE_USED
+	};
+
+	uint32_t atlasSize;
+	uint32_t minTileSize;
+	uint32_t levelCount;
+	uint64_t usedArea;
+
+	// Level by level from the root, 4^level nodes each.  Children
+	// of node i are 4i to 4i+3 on the next level, and everything
+	// below a node that isn't split is free.
+	std::vector<uint8_t> nodes;
+	std::vector<uint32_t> levelStart;
+
+	uint8_t& Node(uint32_t level, uint32_t index) { return nodes[levelStart[level] + index]; }
+	uint32_t LevelOf(uint32_t size) const;
+	void FindFreeNode(uint32_t level, uint32_t index, uint32_t targetLevel, uint32_t& bestLevel, uint32_t& bestIndex);
+	AtlasTile TileOf(uint32_t level, uint32_t index) const;
+	uint32_t IndexOf(const AtlasTile& tile, uint32_t level) const;
+};
+
+// --------------------------------------------------------
+// One light that wants its shadow re-rendered this frame
+// --------------------------------------------------------
+struct ShadowUpdateCandidate
+{
+	unsigned int Light;
+	float Priority;
+};
+
+// --------------------------------------------------------
+// Tiles of the shadow atlas owned by shadow views (one per
+// spot light, six per point light), kept between frames so
+// unchanged shadows don't need re-rendering.
+//
+//  - When the atlas is full, the tiles that went unrequested
+//    the longest are evicted first.  Tiles requested this
+//    frame are never evicted
+//  - If nothing more can be evicted, smaller tiles are tried
+//    down to the minimum size
+//  - A view that asks for a bigger tile keeps its old one
+//    until the bigger one is found
+//
+// The heuristics that decide how big a tile a light gets and
+// which lights are re-rendered are here too.
+// --------------------------------------------------------
+class ShadowAtlas
+{
+public:
+	ShadowAtlas(uint32_t atlasSize, uint32_t minTileSize, uint32_t maxTileSize);
+
+	// Starts a new frame for the LRU
+	void BeginFrame();
+
+	// Finds or allocates a tile for the view.  fresh is set when the
+	// tile is new to this view, so it holds nothing useful yet.
+	// Returns false if no tile could be found at all.
+	bool Request(uint64_t key, uint32_t size, AtlasTile& tile, bool& fresh);
+	void Release(uint64_t key);
+	void Clear();
+
+	const ShadowAtlasAllocator& GetAllocator() const { return allocator; }
+	size_t GetTileCount() const { return entries.size(); }
+	uint32_t GetMaxTileSize() const { return maxTileSize; }
+	unsigned int GetEvictions() const { return evictions; }	// This frame
+
+	// Fraction of the screen height a light's sphere of influence
+	// covers, up to 1 when the camera is inside it
+	static float ScreenCoverage(const CascadeVector& lightPosition, float range,
+		const CascadeVector& cameraPosition, float tanHalfFovY);
+
+	// Tile size for a light covering that much of the screen; a
+	// light filling the screen gets the maximum tile size
+	uint32_t TileSizeFor(float coverage) const;
+
+	// Bigger lights first, but every frame a changed light waits
+	// raises its priority so none is starved
+	static float UpdatePriority(float coverage, unsigned int framesWaiting);
+
+	// Keeps the budget highest priority candidates, in priority order
+	static void SelectUpdates(std::vector<ShadowUpdateCandidate>& candidates, unsigned int budget);
+
+private:
+	struct Entry
+	{
+		AtlasTile Tile;
+		uint64_t LastFrame;
+		std::list<uint64_t>::iterator LruPosition;
+	};
+
+	ShadowAtlasAllocator allocator;
+	uint32_t maxTileSize;
+	uint64_t frame;
+	unsigned int evictions;
+
+	std::unordered_map<uint64_t, Entry> entries;
+	std::list<uint64_t> lru;	// Most recently requested first
+
+	void Touch(Entry& entry);
+
+	// Allocates size or smaller, evicting stale tiles as needed
+	bool AllocateWithEviction(uint32_t size, uint32_t smallestSize, AtlasTile& tile);
+	bool EvictOldest();
+};
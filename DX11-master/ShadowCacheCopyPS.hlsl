@@ -0,0 +1,21 @@
+cbuffer externalData : register(b0)
+{
+	int2 offset;
+	int cascade;
+}
+struct VertexToPixel
+{
+	float4 position : SV_POSITION;
+	float2 uv : TEXCOORD0;
+};
+Texture2DArray CachedDepth : register(t0);
+
+// Starts a cascade's shadow map as a copy of its static caster
+// cache.  The cache covers a wider region than the cascade, so
+// this reads the cascade's window of it at a texel offset (a
+// plain CopySubresourceRegion can't take a box on depth).
+float main(VertexToPixel input) : SV_DEPTH
+{
+	int2 pixel = int2(input.position.xy) + offset;
+	return CachedDepth.Load(int4(pixel, cascade, 0)).r;
+}
@@ -0,0 +1,213 @@
+#include "ShadowCascades.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+static CascadeVector Add(const CascadeVector& a, const CascadeVector& b) { return { a.X + b.X, a.Y + b.Y, a.Z + b.Z }; }
+static CascadeVector Scale(const CascadeVector& v, float s) { return { v.X * s, v.Y * s, v.Z * s }; }
+static float Dot(const CascadeVector& a, const CascadeVector& b) { return a.X * b.X + a.Y * b.Y + a.Z * b.Z; }
+
+static CascadeVector Cross(const CascadeVector& a, const CascadeVector& b)
+{
+	return { a.Y * b.Z - a.Z * b.Y, a.Z * b.X - a.X * b.Z, a.X * b.Y - a.Y * b.X };
+}
+
+static CascadeVector Normalize(const CascadeVector& v)
+{
+	float length = sqrtf(Dot(v, v));
+	return length > 0.0f ? Scale(v, 1.0f / length) : v;
+}
+
+void ShadowCascades::ComputeSplits(float nearDepth, float farDepth, unsigned int count, float lambda, float* splits)
+{
+	for (unsigned int i = 1; i <= count; i++)
+	{
+		float t = (float)i / count;
+		float logSplit = nearDepth * powf(farDepth / nearDepth, t);
+		float uniformSplit = nearDepth + (farDepth - nearDepth) * t;
+		splits[i - 1] = lambda * logSplit + (1.0f - lambda) * uniformSplit;
+	}
+
+	// Exactly the far depth, whatever the rounding above did
+	if (count > 0)
+		splits[count - 1] = farDepth;
+}
+
+ShadowCascade ShadowCascades::FitCascade(const CascadeCamera& camera, float nearDepth, float farDepth,
+	const CascadeVector& lightDirection, uint32_t resolutionX, uint32_t resolutionY, float casterDistance)
+{
+	ShadowCascade cascade = {};
+	cascade.NearDepth = nearDepth;
+	cascade.FarDepth = farDepth;
+
+	// Distance from the view axis to the slice's corners, at each end
+	float cornerScale = camera.TanHalfFovY * sqrtf(1.0f + camera.AspectRatio * camera.AspectRatio);
+	float nearCorner = nearDepth * cornerScale;
+	float farCorner = farDepth * cornerScale;
+
+	// Smallest sphere centered on the view axis touching all eight
+	// corners; wide slices put the center past the far end
+	float centerDepth = (farDepth * farDepth + farCorner * farCorner - nearDepth * nearDepth - nearCorner * nearCorner) /
+		(2.0f * (farDepth - nearDepth));
+	centerDepth = std::min(std::max(centerDepth, nearDepth), farDepth);
+	float radius = std::max(
+		sqrtf((centerDepth - nearDepth) * (centerDepth - nearDepth) + nearCorner * nearCorner),
+		sqrtf((farDepth - centerDepth) * (farDepth - centerDepth) + farCorner * farCorner));
+	cascade.Radius = radius;
+	CascadeVector center = Add(camera.Position, Scale(camera.Forward, centerDepth));
+
+	// Light space basis; any up vector that isn't parallel to the light works
+	CascadeVector zAxis = Normalize(lightDirection);
+	CascadeVector up = fabsf(zAxis.Y) > 0.99f ? CascadeVector{ 1, 0, 0 } : CascadeVector{ 0, 1, 0 };
+	CascadeVector xAxis = Normalize(Cross(up, zAxis));
+	CascadeVector yAxis = Cross(zAxis, xAxis);
+
+	// Rotation only, so light space has a fixed origin to snap against
+	float* v = cascade.View;
+	v[0] = xAxis.X;	v[1] = yAxis.X;	v[2] = zAxis.X;		v[3] = 0;
+	v[4] = xAxis.Y;	v[5] = yAxis.Y;	v[6] = zAxis.Y;		v[7] = 0;
+	v[8] = xAxis.Z;	v[9] = yAxis.Z;	v[10] = zAxis.Z;	v[11] = 0;
+	v[12] = 0;		v[13] = 0;		v[14] = 0;			v[15] = 1;
+
+	float texelX = 2.0f * radius / resolutionX;
+	float texelY = 2.0f * radius / resolutionY;
+	float centerX = floorf(Dot(center, xAxis) / texelX) * texelX;
+	float centerY = floorf(Dot(center, yAxis) / texelY) * texelY;
+	// Depth too, so a camera that hasn't moved a whole texel gives
+	// exactly the same matrices (and cached shadows stay valid)
+	float centerZ = floorf(Dot(center, zAxis) / texelX) * texelX;
+
+	// Orthographic off-center projection (left handed, depth 0 to 1)
+	float left = centerX - radius;
+	float right = centerX + radius;
+	float bottom = centerY - radius;
+	float top = centerY + radius;
+	float zNear = centerZ - radius - casterDistance;
+	float zFar = centerZ + radius;
+
+	float* p = cascade.Projection;
+	p[0] = 2.0f / (right - left);
+	p[5] = 2.0f / (top - bottom);
+	p[10] = 1.0f / (zFar - zNear);
+	p[12] = (left + right) / (left - right);
+	p[13] = (top + bottom) / (bottom - top);
+	p[14] = zNear / (zNear - zFar);
+	p[15] = 1.0f;
+	return cascade;
+}
+
+unsigned int ShadowCascades::Fit(const CascadeCamera& camera, float nearDepth, float farDepth, unsigned int count, float lambda,
+	const CascadeVector& lightDirection, uint32_t resolutionX, uint32_t resolutionY, float casterDistance, ShadowCascade* cascades)
+{
+	if (count < 1) count = 1;
+	if (count > MaxCascades) count = MaxCascades;
+
+	float splits[MaxCascades];
+	ComputeSplits(nearDepth, farDepth, count, lambda, splits);
+	for (unsigned int i = 0; i < count; i++)
+	{
+		float sliceNear = i == 0 ? nearDepth : splits[i - 1];
+		cascades[i] = FitCascade(camera, sliceNear, splits[i], lightDirection, resolutionX, resolutionY, casterDistance);
+	}
+	return count;
+}
+
+CascadeVector ShadowCascades::Transform(const ShadowCascade& cascade, const CascadeVector& point)
+{
+	const float* v = cascade.View;
+	const float* p = cascade.Projection;
+	CascadeVector light = {
+		point.X * v[0] + point.Y * v[4] + point.Z * v[8] + v[12],
+		point.X * v[1] + point.Y * v[5] + point.Z * v[9] + v[13],
+		point.X * v[2] + point.Y * v[6] + point.Z * v[10] + v[14] };
+
+	// Orthographic, so w stays 1
+	return {
+		light.X * p[0] + p[12],
+		light.Y * p[5] + p[13],
+		light.Z * p[10] + p[14] };
+}
+
+bool ShadowCascades::Overlaps(const ShadowCascade& cascade, const CascadeVector& center, float radius)
+{
+	CascadeVector ndc = Transform(cascade, center);
+	float radiusX = radius * cascade.Projection[0];
+	float radiusY = radius * cascade.Projection[5];
+	float radiusZ = radius * cascade.Projection[10];
+
+	// Anything nearer the light than the near plane still casts
+	// (the shadow pass clamps it to the near plane), so only the
+	// far side counts in depth
+	return fabsf(ndc.X) <= 1.0f + radiusX &&
+		fabsf(ndc.Y) <= 1.0f + radiusY &&
+		ndc.Z - radiusZ <= 1.0f;
+}
+
+// --------------------------------------------------------
+// Light-space extents, read back from an orthographic
+// projection built by FitCascade()
+// --------------------------------------------------------
+static float CenterX(const ShadowCascade& c) { return -c.Projection[12] / c.Projection[0]; }
+static float CenterY(const ShadowCascade& c) { return -c.Projection[13] / c.Projection[5]; }
+static float NearZ(const ShadowCascade& c) { return -c.Projection[14] / c.Projection[10]; }
+static float FarZ(const ShadowCascade& c) { return NearZ(c) + 1.0f / c.Projection[10]; }
+
+static float CacheRegionRadius(float cascadeRadius, uint32_t resolution, uint32_t margin)
+{
+	return cascadeRadius + margin * (2.0f * cascadeRadius / resolution);
+}
+
+ShadowCascade ShadowCascades::FitCacheRegion(const ShadowCascade& cascade, uint32_t resolution, uint32_t margin)
+{
+	// Same center, so the region's edges stay on the cascade's texel grid
+	ShadowCascade region = cascade;
+	region.Radius = CacheRegionRadius(cascade.Radius, resolution, margin);
+
+	float extra = region.Radius - cascade.Radius;
+	float zNear = NearZ(cascade) - extra;
+	float zFar = FarZ(cascade) + extra;
+
+	float* p = region.Projection;
+	p[0] = 1.0f / region.Radius;
+	p[5] = 1.0f / region.Radius;
+	p[10] = 1.0f / (zFar - zNear);
+	p[12] = -CenterX(cascade) * p[0];
+	p[13] = -CenterY(cascade) * p[5];
+	p[14] = zNear / (zNear - zFar);
+	return region;
+}
+
+bool ShadowCascades::CacheRegionCovers(const ShadowCascade& region, const ShadowCascade& cascade, uint32_t resolution, uint32_t margin)
+{
+	// A turned light or a resized cascade needs a new region
+	if (memcmp(region.View, cascade.View, sizeof(cascade.View)) != 0 ||
+		region.Radius != CacheRegionRadius(cascade.Radius, resolution, margin))
+		return false;
+
+	// Both centers are on the same texel grid, so they're a whole
+	// number of texels apart
+	float texel = 2.0f * cascade.Radius / resolution;
+	float dx = roundf((CenterX(cascade) - CenterX(region)) / texel);
+	float dy = roundf((CenterY(cascade) - CenterY(region)) / texel);
+	if (fabsf(dx) > margin || fabsf(dy) > margin)
+		return false;
+
+	// Depth isn't snapped to the grid as finely, so allow for rounding
+	float slack = texel * 0.01f;
+	return NearZ(cascade) >= NearZ(region) - slack && FarZ(cascade) <= FarZ(region) + slack;
+}
+
+void ShadowCascades::PlaceInCacheRegion(ShadowCascade& cascade, const ShadowCascade& region, uint32_t resolution, uint32_t margin,
+	uint32_t& offsetX, uint32_t& offsetY)
+{
+	float texel = 2.0f * cascade.Radius / resolution;
+	int dx = (int)roundf((CenterX(cascade) - CenterX(region)) / texel);
+	int dy = (int)roundf((CenterY(cascade) - CenterY(region)) / texel);
+
+	// Texture rows run top down, light-space y runs bottom up
+	offsetX = (uint32_t)((int)margin + dx);
+	offsetY = (uint32_t)((int)margin - dy);
+
+	cascade.Projection[10] = region.Projection[10];
+	cascade.Projection[14] = region.Projection[14];
+}
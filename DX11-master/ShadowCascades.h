@@ -0,0 +1,99 @@
+#pragma once
+#include <cstdint>
+
+// --------------------------------------------------------
+// Just enough vector for the cascade math, so this module
+// doesn't depend on DirectXMath
+// --------------------------------------------------------
+struct CascadeVector
+{
+	float X, Y, Z;
+};
+
+// --------------------------------------------------------
+// What cascade fitting needs to know about the camera.
+// Forward, Right and Up are unit length.
+// --------------------------------------------------------
+struct CascadeCamera
+{
+	CascadeVector Position;
+	CascadeVector Forward;
+	CascadeVector Right;
+	CascadeVector Up;
+	float TanHalfFovY;
+	float AspectRatio;
+};
+
+// --------------------------------------------------------
+// One cascade: the slice of view depth it covers and the
+// light matrices that render it.  Matrices are row-major
+// and meant for row vectors, the same layout as XMFLOAT4X4.
+// --------------------------------------------------------
+struct ShadowCascade
+{
+	float NearDepth;
+	float FarDepth;
+	float Radius;		// World-space half width of its square
+	float View[16];
+	float Projection[16];
+};
+
+// --------------------------------------------------------
+// Cascaded shadow map math for a directional light.
+//
+//  - Splits blend logarithmic (lambda 1) and uniform
+//    (lambda 0) spacing between the near and far distances
+//  - Each cascade is the bounding sphere of its slice of the
+//    camera frustum.  The sphere only depends on the split
+//    distances, not the camera's orientation, so turning the
+//    camera never changes the cascade's size
+//  - The sphere's center is snapped to whole shadow map
+//    texels in light space, so moving the camera slides the
+//    cascade by whole texels and edges don't shimmer.
+//    Moves within a texel give bit-identical matrices.
+//  - casterDistance extends each cascade towards the light,
+//    so casters outside the slice still land in the map
+// --------------------------------------------------------
+class ShadowCascades
+{
+public:
+	static const unsigned int MaxCascades = 4;
+
+	// splits[i] is the far depth of cascade i
+	static void ComputeSplits(float nearDepth, float farDepth, unsigned int count, float lambda, float* splits);
+
+	static ShadowCascade FitCascade(const CascadeCamera& camera, float nearDepth, float farDepth,
+		const CascadeVector& lightDirection, uint32_t resolutionX, uint32_t resolutionY, float casterDistance);
+
+	// Splits and fits all of them in one go; returns how many were made
+	static unsigned int Fit(const CascadeCamera& camera, float nearDepth, float farDepth, unsigned int count, float lambda,
+		const CascadeVector& lightDirection, uint32_t resolutionX, uint32_t resolutionY, float casterDistance, ShadowCascade* cascades);
+
+	// Whether a sphere could cast into or be inside the cascade
+	static bool Overlaps(const ShadowCascade& cascade, const CascadeVector& center, float radius);
+
+	// Row vector times View then Projection
+	static CascadeVector Transform(const ShadowCascade& cascade, const CascadeVector& point);
+
+	// --------------------------------------------------------
+	// Static caster caches.  A cache covers a region margin
+	// texels wider than its cascade on every side (and deeper by
+	// the same distance along the light), at the cascade's texel
+	// size.  The cascade slides around inside it as the camera
+	// moves, so the cache is only rebuilt when the cascade leaves
+	// the region, the light turns or the cascade changes size.
+	// --------------------------------------------------------
+
+	// The region is (resolution + 2 * margin) texels across
+	static ShadowCascade FitCacheRegion(const ShadowCascade& cascade, uint32_t resolution, uint32_t margin);
+
+	// Whether a region fit with the same resolution and margin
+	// still holds all of cascade
+	static bool CacheRegionCovers(const ShadowCascade& region, const ShadowCascade& cascade, uint32_t resolution, uint32_t margin);
+
+	// Where the cascade's square starts in the region's texels (x
+	// right, y down).  Also gives the cascade the region's depth
+	// range, so cached depths can be copied without converting.
+	static void PlaceInCacheRegion(ShadowCascade& cascade, const ShadowCascade& region, uint32_t resolution, uint32_t margin,
+		uint32_t& offsetX, uint32_t& offsetY);
+};
@@ -0,0 +1,103 @@
+#include "ShadowMoments.h"
+#include <cmath>
+
+const float ShadowMoments::MaxExponent16 = 5.54f;
+
+EVSMMoments ShadowMoments::Warp(float depth, float positiveExponent, float negativeExponent)
+{
+	depth = 2.0f * depth - 1.0f;
+	float positive = expf(positiveExponent * depth);
+	float negative = -expf(-negativeExponent * depth);
+	EVSMMoments moments = { positive, positive * positive, negative, negative * negative };
+	return moments;
+}
+
+void ShadowMoments::Convert(const float* depths, uint32_t width, uint32_t height,
+	float positiveExponent, float negativeExponent, EVSMMoments* moments)
+{
+	for (uint32_t i = 0; i < width * height; i++)
+		moments[i] = Warp(depths[i], positiveExponent, negativeExponent);
+}
+
+static void Accumulate(EVSMMoments& total, const EVSMMoments& m)
+{
+	total.Positive += m.Positive;
+	total.PositiveSquared += m.PositiveSquared;
+	total.Negative += m.Negative;
+	total.NegativeSquared += m.NegativeSquared;
+}
+
+static EVSMMoments Average(const EVSMMoments& total, int count)
+{
+	float scale = 1.0f / count;
+	EVSMMoments m = { total.Positive * scale, total.PositiveSquared * scale, total.Negative * scale, total.NegativeSquared * scale };
+	return m;
+}
+
+static int Clamp(int value, int low, int high)
+{
+	return value < low ? low : (value > high ? high : value);
+}
+
+void ShadowMoments::BlurHorizontal(const EVSMMoments* source, uint32_t width, uint32_t height, int radius, EVSMMoments* destination)
+{
+	for (uint32_t y = 0; y < height; y++)
+	{
+		const EVSMMoments* row = source + (size_t)y * width;
+		for (uint32_t x = 0; x < width; x++)
+		{
+			EVSMMoments total = {};
+			for (int t = -radius; t <= radius; t++)
+				Accumulate(total, row[Clamp((int)x + t, 0, (int)width - 1)]);
+			destination[(size_t)y * width + x] = Average(total, 2 * radius + 1);
+		}
+	}
+}
+
+void ShadowMoments::BlurVertical(const EVSMMoments* source, uint32_t width, uint32_t height, int radius, EVSMMoments* destination)
+{
+	for (uint32_t y = 0; y < height; y++)
+	{
+		for (uint32_t x = 0; x < width; x++)
+		{
+			EVSMMoments total = {};
+			for (int t = -radius; t <= radius; t++)
+				Accumulate(total, source[(size_t)Clamp((int)y + t, 0, (int)height - 1) * width + x]);
+			destination[(size_t)y * width + x] = Average(total, 2 * radius + 1);
+		}
+	}
+}
+
+void ShadowMoments::Prefilter(const float* depths, uint32_t width, uint32_t height,
+	float positiveExponent, float negativeExponent, int radius, EVSMMoments* moments)
+{
+	std::vector<EVSMMoments> warped((size_t)width * height);
+	std::vector<EVSMMoments> horizontal((size_t)width * height);
+	Convert(depths, width, height, positiveExponent, negativeExponent, warped.data());
+	BlurHorizontal(warped.data(), width, height, radius, horizontal.data());
+	BlurVertical(horizontal.data(), width, height, radius, moments);
+}
+
+float ShadowMoments::ChebyshevUpperBound(float mean, float meanSquared, float value, float minVariance)
+{
+	float variance = meanSquared - mean * mean;
+	variance = variance > minVariance ? variance : minVariance;
+	float distance = value - mean;
+	return value <= mean ? 1.0f : variance / (variance + distance * distance);
+}
+
+float ShadowMoments::Visibility(const EVSMMoments& moments, float depth,
+	float positiveExponent, float negativeExponent, float lightBleedReduction)
+{
+	EVSMMoments warped = Warp(depth, positiveExponent, negativeExponent);
+
+	// The variance floor scales with the warp's slope at this depth
+	float positiveScale = 0.0001f * positiveExponent * warped.Positive;
+	float negativeScale = 0.0001f * negativeExponent * warped.Negative;
+	float positive = ChebyshevUpperBound(moments.Positive, moments.PositiveSquared, warped.Positive, positiveScale * positiveScale);
+	float negative = ChebyshevUpperBound(moments.Negative, moments.NegativeSquared, warped.Negative, negativeScale * negativeScale);
+	float visibility = positive < negative ? positive : negative;
+
+	visibility = (visibility - lightBleedReduction) / (1.0f - lightBleedReduction);
+	return visibility < 0.0f ? 0.0f : (visibility > 1.0f ? 1.0f : visibility);
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+// --------------------------------------------------------
+// Shadow lookups the scene pixel shader can use.  Must match
+// SHADOW_FILTER_ in ShadowMoments.hlsli.
+// --------------------------------------------------------
+enum ShadowFilter
+{
+	SHADOW_FILTER_PCF,			// One hardware 2x2 PCF tap
+	SHADOW_FILTER_WIDE_PCF,		// A square kernel of PCF taps
+	SHADOW_FILTER_EVSM,			// One filtered fetch of prefiltered moments
+	SHADOW_FILTER_COUNT
+};
+
+// --------------------------------------------------------
+// Exponential variance shadow map moments of one texel: the
+// depth warped by a positive and a negative exponential,
+// each with its square.  Same order as the float4 the
+// shaders store.
+// --------------------------------------------------------
+struct EVSMMoments
+{
+	float Positive;
+	float PositiveSquared;
+	float Negative;
+	float NegativeSquared;
+};
+
+// --------------------------------------------------------
+// CPU reference for the EVSM shadow filter, written to match
+// ShadowMoments.hlsli and the EVSMConvertPS / EVSMBlurPS
+// prefilter passes step for step, so GPU results can be
+// checked against it (the GPU stores moments as 16-bit
+// floats, so compare with a tolerance).
+//
+//  - Depths are in [0, 1] and are moved to [-1, 1] before
+//    warping
+//  - The prefilter is a box blur of 2 * radius + 1 texels,
+//    horizontal (fused with the conversion) then vertical,
+//    clamping at the map's edges
+// --------------------------------------------------------
+class ShadowMoments
+{
+public:
+	// Largest exponent whose squared warp still fits in a 16-bit float
+	static const float MaxExponent16;
+
+	static EVSMMoments Warp(float depth, float positiveExponent, float negativeExponent);
+
+	// depths and moments are width * height, row by row
+	static void Convert(const float* depths, uint32_t width, uint32_t height,
+		float positiveExponent, float negativeExponent, EVSMMoments* moments);
+	static void BlurHorizontal(const EVSMMoments* source, uint32_t width, uint32_t height, int radius, EVSMMoments* destination);
+	static void BlurVertical(const EVSMMoments* source, uint32_t width, uint32_t height, int radius, EVSMMoments* destination);
+
+	// The whole prefilter, as the GPU runs it
+	static void Prefilter(const float* depths, uint32_t width, uint32_t height,
+		float positiveExponent, float negativeExponent, int radius, EVSMMoments* moments);
+
+	// Fraction of light reaching a receiver at depth, from filtered
+	// moments.  lightBleedReduction in [0, 1) cuts off the low end
+	// of the Chebyshev bound, where light bleeding shows up.
+	static float Visibility(const EVSMMoments& moments, float depth,
+		float positiveExponent, float negativeExponent, float lightBleedReduction);
+
+	static float ChebyshevUpperBound(float mean, float meanSquared, float value, float minVariance);
+};
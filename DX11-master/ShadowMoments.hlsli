@@ -0,0 +1,44 @@
+#ifndef __GGP_SHADOW_MOMENTS__
+#define __GGP_SHADOW_MOMENTS__
+
+// Exponential variance shadow maps.  ShadowMoments.cpp is a
+// CPU reference for everything here and must stay in step.
+
+// Shadow lookups the scene pixel shader can use
+#define SHADOW_FILTER_PCF		0	// One hardware 2x2 PCF tap
+#define SHADOW_FILTER_WIDE_PCF	1	// A square kernel of PCF taps
+#define SHADOW_FILTER_EVSM		2	// One filtered fetch of prefiltered moments
+
+// Depth in [0,1] to moments: positive and negative exponential
+// warps of it, and their squares
+float4 WarpDepth(float depth, float2 exponents)
+{
+	depth = 2.0f * depth - 1.0f;
+	float positive = exp(exponents.x * depth);
+	float negative = -exp(-exponents.y * depth);
+	return float4(positive, positive * positive, negative, negative * negative);
+}
+
+float ChebyshevUpperBound(float2 moments, float value, float minVariance)
+{
+	float variance = max(moments.y - moments.x * moments.x, minVariance);
+	float distance = value - moments.x;
+	return value <= moments.x ? 1.0f : variance / (variance + distance * distance);
+}
+
+// Fraction of light reaching a receiver at depth.  Light bleed
+// reduction cuts off the low end of the bound.
+float EVSMVisibility(float4 moments, float depth, float2 exponents, float lightBleedReduction)
+{
+	float4 warped = WarpDepth(depth, exponents);
+
+	// The variance floor scales with the warp's slope at this depth
+	float2 depthScale = 0.0001f * exponents * warped.xz;
+	float2 minVariance = depthScale * depthScale;
+	float positive = ChebyshevUpperBound(moments.xy, warped.x, minVariance.x);
+	float negative = ChebyshevUpperBound(moments.zw, warped.z, minVariance.y);
+
+	return saturate((min(positive, negative) - lightBleedReduction) / (1.0f - lightBleedReduction));
+}
+
+#endif
@@ -1,10 +1,16 @@
-cbuffer externalData : register(b0)
+// Set once per shadow cascade
+cbuffer PerFrame : register(b0)
 {
-	matrix world;
 	matrix view;
 	matrix projection;
 };
 
+// Set for every caster
+cbuffer PerObject : register(b1)
+{
+	matrix world;
+};
+
 struct VertexShaderInput
 {
 	// Data type
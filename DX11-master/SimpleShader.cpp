@@ -3,6 +3,12 @@
 // Default error reporting state
 bool ISimpleShader::ReportErrors = false;
 bool ISimpleShader::ReportWarnings = false;
+unsigned int ISimpleShader::nextShaderID = 0;
+SimpleShaderUploadStats ISimpleShader::UploadStats;
+ConstantBufferRing* ISimpleShader::PerDrawRing = 0;
+bool ISimpleShader::UseReflectionCache = true;
+unsigned int ISimpleShader::ReflectionCacheHits = 0;
+unsigned int ISimpleShader::ReflectionCacheMisses = 0;
 
 // To enable error reporting, use either or both 
 // of the following lines somewhere in your program, 
@@ -29,6 +35,14 @@ ISimpleShader::ISimpleShader(Microsoft::WRL::ComPtr<ID3D11Device> device, Micros
 	this->constantBufferCount = 0;
 	this->constantBuffers = 0;
 	this->shaderValid = false;
+	this->shaderID = nextShaderID++;
+
+	// Partial constant buffer updates need D3D11.1 and driver support
+	context.As(&deviceContext1);
+	D3D11_FEATURE_DATA_D3D11_OPTIONS options = {};
+	partialUpdates = deviceContext1.Get() != 0 &&
+		SUCCEEDED(device->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options))) &&
+		options.ConstantBufferPartialUpdate;
 }
 
 // --------------------------------------------------------
@@ -109,8 +123,40 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 		return false;
 	}
 
-	// Set up shader reflection to get information about
-	// this shader and its variables,  buffers, etc.
+	// Get the reflection data from the sidecar next to the shader if it
+	// still matches the bytecode, or from D3DReflect (saving a new
+	// sidecar for next time) if it doesn't
+	ShaderReflectionData reflection;
+	std::wstring cachePath = std::wstring(shaderFile) + L".refl";
+	uint64_t bytecodeHash = ShaderReflectionCache::HashBytecode(
+		shaderBlob->GetBufferPointer(),
+		shaderBlob->GetBufferSize());
+
+	if (UseReflectionCache && LoadReflectionCache(cachePath, bytecodeHash, reflection))
+	{
+		ReflectionCacheHits++;
+	}
+	else
+	{
+		ReflectShader(reflection);
+		if (UseReflectionCache)
+			SaveReflectionCache(cachePath, bytecodeHash, reflection);
+		ReflectionCacheMisses++;
+	}
+
+	// Set up the tables and buffers
+	BuildTables(reflection);
+
+	// All set
+	return true;
+}
+
+// --------------------------------------------------------
+// Uses shader reflection to get information about this
+// shader's buffers, variables and resources
+// --------------------------------------------------------
+void ISimpleShader::ReflectShader(ShaderReflectionData& reflection)
+{
 	Microsoft::WRL::ComPtr<ID3D11ShaderReflection> refl;
 	D3DReflect(
 		shaderBlob->GetBufferPointer(),
@@ -122,10 +168,6 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 	D3D11_SHADER_DESC shaderDesc;
 	refl->GetDesc(&shaderDesc);
 
-	// Create resource arrays
-	constantBufferCount = shaderDesc.ConstantBuffers;
-	constantBuffers = new SimpleConstantBuffer[constantBufferCount];
-	
 	// Handle bound resources (like shaders and samplers)
 	unsigned int resourceCount = shaderDesc.BoundResources;
 	for (unsigned int r = 0; r < resourceCount; r++)
@@ -139,33 +181,18 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 		{
 		case D3D_SIT_STRUCTURED: // Treat structured buffers as texture resources
 		case D3D_SIT_TEXTURE: // A texture resource
-		{
-			// Create the SRV wrapper
-			SimpleSRV* srv = new SimpleSRV();
-			srv->BindIndex = resourceDesc.BindPoint;				// Shader bind point
-			srv->Index = (unsigned int)shaderResourceViews.size();	// Raw index
-
-			textureTable.insert(std::pair<std::string, SimpleSRV*>(resourceDesc.Name, srv));
-			shaderResourceViews.push_back(srv);
-		}
+			reflection.Textures.push_back({ resourceDesc.Name, resourceDesc.BindPoint });
 			break;
 
 		case D3D_SIT_SAMPLER: // A sampler resource
-		{
-			// Create the sampler wrapper
-			SimpleSampler* samp = new SimpleSampler();
-			samp->BindIndex = resourceDesc.BindPoint;			// Shader bind point
-			samp->Index = (unsigned int)samplerStates.size();	// Raw index
-
-			samplerTable.insert(std::pair<std::string, SimpleSampler*>(resourceDesc.Name, samp));
-			samplerStates.push_back(samp);
-		}
+			reflection.Samplers.push_back({ resourceDesc.Name, resourceDesc.BindPoint });
 			break;
 		}
 	}
 
 	// Loop through all constant buffers
-	for (unsigned int b = 0; b < constantBufferCount; b++)
+	reflection.Buffers.resize(shaderDesc.ConstantBuffers);
+	for (unsigned int b = 0; b < shaderDesc.ConstantBuffers; b++)
 	{
 		// Get this buffer
 		ID3D11ShaderReflectionConstantBuffer* cb =
@@ -175,23 +202,78 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 		D3D11_SHADER_BUFFER_DESC bufferDesc;
 		cb->GetDesc(&bufferDesc);
 
-		// Save the type, which we reference when setting these buffers
-		constantBuffers[b].Type = bufferDesc.Type;
-		
 		// Get the description of the resource binding, so
 		// we know exactly how it's bound in the shader
 		D3D11_SHADER_INPUT_BIND_DESC bindDesc;
 		refl->GetResourceBindingDescByName(bufferDesc.Name, &bindDesc);
-		
+
+		ReflectedBuffer& buffer = reflection.Buffers[b];
+		buffer.Name = bufferDesc.Name;
+		buffer.Type = bufferDesc.Type;
+		buffer.BindIndex = bindDesc.BindPoint;
+		buffer.Size = bufferDesc.Size;
+
+		// Loop through all variables in this buffer
+		for (unsigned int v = 0; v < bufferDesc.Variables; v++)
+		{
+			// Get the description of the variable
+			D3D11_SHADER_VARIABLE_DESC varDesc;
+			cb->GetVariableByIndex(v)->GetDesc(&varDesc);
+
+			buffer.Variables.push_back({ varDesc.Name, varDesc.StartOffset, varDesc.Size });
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Builds the variable, buffer and resource tables (and the
+// constant buffers themselves) from reflection data
+// --------------------------------------------------------
+void ISimpleShader::BuildTables(const ShaderReflectionData& reflection)
+{
+	for (const ReflectedResource& t : reflection.Textures)
+	{
+		// Create the SRV wrapper
+		SimpleSRV* srv = new SimpleSRV();
+		srv->BindIndex = t.BindIndex;							// Shader bind point
+		srv->Index = (unsigned int)shaderResourceViews.size();	// Raw index
+
+		textureTable.insert(std::pair<std::string, SimpleSRV*>(t.Name, srv));
+		shaderResourceViews.push_back(srv);
+	}
+
+	for (const ReflectedResource& s : reflection.Samplers)
+	{
+		// Create the sampler wrapper
+		SimpleSampler* samp = new SimpleSampler();
+		samp->BindIndex = s.BindIndex;						// Shader bind point
+		samp->Index = (unsigned int)samplerStates.size();	// Raw index
+
+		samplerTable.insert(std::pair<std::string, SimpleSampler*>(s.Name, samp));
+		samplerStates.push_back(samp);
+	}
+
+	// Create resource arrays
+	constantBufferCount = (unsigned int)reflection.Buffers.size();
+	constantBuffers = new SimpleConstantBuffer[constantBufferCount];
+
+	for (unsigned int b = 0; b < constantBufferCount; b++)
+	{
+		const ReflectedBuffer& buffer = reflection.Buffers[b];
+
+		// Save the type, which we reference when setting these buffers
+		constantBuffers[b].Type = (D3D_CBUFFER_TYPE)buffer.Type;
+
 		// Set up the buffer and put its pointer in the table
-		constantBuffers[b].BindIndex = bindDesc.BindPoint;
-		constantBuffers[b].Name = bufferDesc.Name;
-		cbTable.insert(std::pair<std::string, SimpleConstantBuffer*>(bufferDesc.Name, &constantBuffers[b]));
+		constantBuffers[b].BindIndex = buffer.BindIndex;
+		constantBuffers[b].Name = buffer.Name;
+		cbTable.insert(std::pair<std::string, SimpleConstantBuffer*>(buffer.Name, &constantBuffers[b]));
 
 		// Create this constant buffer
+		unsigned int alignedSize = ((buffer.Size + 15) / 16) * 16; // Quick and dirty 16-byte alignment using integer division
 		D3D11_BUFFER_DESC newBuffDesc = {};
 		newBuffDesc.Usage = D3D11_USAGE_DEFAULT;
-		newBuffDesc.ByteWidth = ((bufferDesc.Size + 15) / 16) * 16; // Quick and dirty 16-byte alignment using integer division
+		newBuffDesc.ByteWidth = alignedSize;
 		newBuffDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
 		newBuffDesc.CPUAccessFlags = 0;
 		newBuffDesc.MiscFlags = 0;
@@ -199,38 +281,53 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 		device->CreateBuffer(&newBuffDesc, 0, constantBuffers[b].ConstantBuffer.GetAddressOf());
 
 		// Set up the data buffer for this constant buffer
-		constantBuffers[b].Size = bufferDesc.Size;
-		constantBuffers[b].LocalDataBuffer = new unsigned char[bufferDesc.Size];
-		ZeroMemory(constantBuffers[b].LocalDataBuffer, bufferDesc.Size);
-
-		// Loop through all variables in this buffer
-		for (unsigned int v = 0; v < bufferDesc.Variables; v++)
+		// - Sized to match the GPU buffer, so aligned partial uploads stay in bounds
+		// - The GPU copy starts out undefined, so the whole thing is dirty
+		constantBuffers[b].Size = buffer.Size;
+		constantBuffers[b].LocalDataBuffer = new unsigned char[alignedSize];
+		ZeroMemory(constantBuffers[b].LocalDataBuffer, alignedSize);
+		constantBuffers[b].Dirty.Mark(0, alignedSize);
+
+		// Add each variable to the table and the constant buffer
+		for (const ReflectedVariable& v : buffer.Variables)
 		{
-			// Get this variable
-			ID3D11ShaderReflectionVariable* var =
-				cb->GetVariableByIndex(v);
-			
-			// Get the description of the variable and its type
-			D3D11_SHADER_VARIABLE_DESC varDesc;
-			var->GetDesc(&varDesc);
-
-			// Create the variable struct
 			SimpleShaderVariable varStruct = {};
 			varStruct.ConstantBufferIndex = b;
-			varStruct.ByteOffset = varDesc.StartOffset;
-			varStruct.Size = varDesc.Size;
-			
-			// Get a string version
-			std::string varName(varDesc.Name);
-
-			// Add this variable to the table and the constant buffer
-			varTable.insert(std::pair<std::string, SimpleShaderVariable>(varName, varStruct));
+			varStruct.ByteOffset = v.ByteOffset;
+			varStruct.Size = v.Size;
+
+			varTable.insert(std::pair<std::string, SimpleShaderVariable>(v.Name, varStruct));
 			constantBuffers[b].Variables.push_back(varStruct);
 		}
 	}
+}
 
-	// All set
-	return true;
+// --------------------------------------------------------
+// Reads a reflection sidecar, failing if it's missing, damaged
+// or was made from different bytecode
+// --------------------------------------------------------
+bool ISimpleShader::LoadReflectionCache(const std::wstring& path, uint64_t bytecodeHash, ShaderReflectionData& reflection)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file)
+		return false;
+
+	std::vector<unsigned char> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	return ShaderReflectionCache::Deserialize(bytes.data(), bytes.size(), bytecodeHash, reflection);
+}
+
+// --------------------------------------------------------
+// Writes a reflection sidecar; failing to (say, from a
+// read-only folder) just means reflecting again next time
+// --------------------------------------------------------
+void ISimpleShader::SaveReflectionCache(const std::wstring& path, uint64_t bytecodeHash, const ShaderReflectionData& reflection)
+{
+	std::vector<unsigned char> bytes;
+	ShaderReflectionCache::Serialize(reflection, bytecodeHash, bytes);
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (file)
+		file.write((const char*)bytes.data(), bytes.size());
 }
 
 // --------------------------------------------------------
@@ -345,14 +442,9 @@ void ISimpleShader::CopyAllBufferData()
 	// Ensure the shader is valid
 	if (!shaderValid) return;
 
-	// Loop through the constant buffers and copy all data
+	// Loop through the constant buffers and copy any changed data
 	for (unsigned int i = 0; i < constantBufferCount; i++)
-	{
-		// Copy the entire local data buffer
-		deviceContext->UpdateSubresource(
-			constantBuffers[i].ConstantBuffer.Get(), 0, 0,
-			constantBuffers[i].LocalDataBuffer, 0, 0);
-	}
+		UploadBuffer(&constantBuffers[i]);
 }
 
 // --------------------------------------------------------
@@ -380,9 +472,7 @@ void ISimpleShader::CopyBufferData(unsigned int index)
 	if (!cb) return;
 
 	// Copy the data and get out
-	deviceContext->UpdateSubresource(
-		cb->ConstantBuffer.Get(), 0, 0, 
-		cb->LocalDataBuffer, 0, 0);
+	UploadBuffer(cb);
 }
 
 // --------------------------------------------------------
@@ -402,9 +492,159 @@ void ISimpleShader::CopyBufferData(std::string bufferName)
 	if (!cb) return;
 
 	// Copy the data and get out
-	deviceContext->UpdateSubresource(
-		cb->ConstantBuffer.Get(), 0, 0, 
-		cb->LocalDataBuffer, 0, 0);
+	UploadBuffer(cb);
+}
+
+// --------------------------------------------------------
+// Copies the dirty part of a buffer's local data to the GPU
+//
+//  - Clean buffers are skipped entirely
+//  - Dynamic buffers are rewritten in full with Map/WRITE_DISCARD,
+//    which gives the driver a fresh buffer instead of stalling
+//  - Otherwise, only the dirty range (widened to 16 bytes) is
+//    copied when the driver supports partial updates, or the
+//    whole buffer when it doesn't
+// --------------------------------------------------------
+void ISimpleShader::UploadBuffer(SimpleConstantBuffer* cb)
+{
+	// Per-draw buffers get a fresh slice of the ring, unless this
+	// frame's slice already holds the current data
+	if (cb->PerDraw && PerDrawRing && PerDrawRing->IsSupported())
+	{
+		if (cb->Dirty.IsEmpty() && IsBoundToRing(*cb))
+		{
+			UploadStats.UploadsSkipped++;
+			BindConstantBuffer(*cb);
+			return;
+		}
+
+		if (PerDrawRing->Upload(cb->LocalDataBuffer, cb->Size, cb->RingRange))
+		{
+			cb->RingFrame = PerDrawRing->GetFrameIndex();
+			BindConstantBuffer(*cb);
+
+			UploadStats.Uploads++;
+			UploadStats.RingUploads++;
+			UploadStats.BytesUploaded += cb->Size;
+			cb->Dirty.Clear();
+			return;
+		}
+
+		// Ring is full, so fall back to the shader's own buffer,
+		// which has to be rebound over any earlier ring slice
+		cb->RingFrame = 0;
+		cb->Dirty.Mark(0, cb->Size);
+		BindConstantBuffer(*cb);
+	}
+	else if (cb->RingFrame != 0)
+	{
+		// The ring was in use last time, so the shader's own copy is stale
+		cb->RingFrame = 0;
+		cb->Dirty.Mark(0, cb->Size);
+		BindConstantBuffer(*cb);
+	}
+
+	if (cb->Dynamic)
+	{
+		if (cb->Dirty.IsEmpty())
+		{
+			UploadStats.UploadsSkipped++;
+			return;
+		}
+
+		D3D11_BUFFER_DESC desc = {};
+		cb->ConstantBuffer->GetDesc(&desc);
+
+		D3D11_MAPPED_SUBRESOURCE mapped = {};
+		if (SUCCEEDED(deviceContext->Map(cb->ConstantBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped)))
+		{
+			memcpy(mapped.pData, cb->LocalDataBuffer, desc.ByteWidth);
+			deviceContext->Unmap(cb->ConstantBuffer.Get(), 0);
+			UploadStats.BytesUploaded += desc.ByteWidth;
+		}
+		UploadStats.Uploads++;
+		cb->Dirty.Clear();
+		return;
+	}
+
+	// The GPU buffer is the cbuffer's size rounded up to 16 bytes
+	unsigned int byteWidth = ((cb->Size + 15) / 16) * 16;
+	bool uploaded = UploadDirtyRange(cb->Dirty, byteWidth, partialUpdates,
+		[&](unsigned int begin, unsigned int end)
+		{
+			D3D11_BOX box = { begin, 0, 0, end, 1, 1 };
+			deviceContext1->UpdateSubresource1(
+				cb->ConstantBuffer.Get(), 0, &box,
+				cb->LocalDataBuffer + begin, 0, 0, 0);
+			UploadStats.BytesUploaded += end - begin;
+		},
+		[&]()
+		{
+			deviceContext->UpdateSubresource(
+				cb->ConstantBuffer.Get(), 0, 0,
+				cb->LocalDataBuffer, 0, 0);
+			UploadStats.BytesUploaded += byteWidth;
+		});
+
+	if (uploaded)
+		UploadStats.Uploads++;
+	else
+		UploadStats.UploadsSkipped++;
+}
+
+// --------------------------------------------------------
+// Whether a buffer's current binding is its slice of the ring
+// --------------------------------------------------------
+bool ISimpleShader::IsBoundToRing(const SimpleConstantBuffer& cb)
+{
+	return cb.PerDraw && cb.RingFrame != 0 &&
+		PerDrawRing && cb.RingFrame == PerDrawRing->GetFrameIndex();
+}
+
+// --------------------------------------------------------
+// Marks a constant buffer as rewritten every draw, so it is
+// bump-allocated out of PerDrawRing (when set) rather than
+// overwriting the same buffer draw after draw
+//
+// bufferName - The name of the cbuffer in the shader
+// perDraw - True to upload to the ring
+//
+// Returns true if the buffer was found
+// --------------------------------------------------------
+bool ISimpleShader::SetBufferPerDraw(std::string bufferName, bool perDraw)
+{
+	SimpleConstantBuffer* cb = this->FindConstantBuffer(bufferName);
+	if (!cb) return false;
+
+	cb->PerDraw = perDraw;
+	cb->RingFrame = 0;
+	return true;
+}
+
+// --------------------------------------------------------
+// Recreates a constant buffer as dynamic (or default) usage
+//
+// bufferName - The name of the cbuffer in the shader
+// dynamic - True to upload with Map/WRITE_DISCARD
+//
+// Returns true if the buffer was found
+// --------------------------------------------------------
+bool ISimpleShader::SetBufferDynamic(std::string bufferName, bool dynamic)
+{
+	SimpleConstantBuffer* cb = this->FindConstantBuffer(bufferName);
+	if (!cb) return false;
+	if (cb->Dynamic == dynamic) return true;
+
+	D3D11_BUFFER_DESC desc = {};
+	cb->ConstantBuffer->GetDesc(&desc);
+	desc.Usage = dynamic ? D3D11_USAGE_DYNAMIC : D3D11_USAGE_DEFAULT;
+	desc.CPUAccessFlags = dynamic ? D3D11_CPU_ACCESS_WRITE : 0;
+	device->CreateBuffer(&desc, 0, cb->ConstantBuffer.ReleaseAndGetAddressOf());
+
+	// The new buffer has no contents yet
+	cb->Dynamic = dynamic;
+	cb->Dirty.Mark(0, desc.ByteWidth);
+	return true;
 }
 
 
@@ -445,16 +685,107 @@ bool ISimpleShader::SetData(std::string name, const void* data, unsigned int siz
 		return false;
 	}
 
-	// Set the data in the local data buffer
-	memcpy(
-		constantBuffers[var->ConstantBufferIndex].LocalDataBuffer + var->ByteOffset,
-		data,
-		size);
+	// Set it through the handle path
+	SimpleShaderVariableHandle handle;
+	handle.ByteOffset = var->ByteOffset;
+	handle.Size = var->Size;
+	handle.ConstantBufferIndex = var->ConstantBufferIndex;
+	return SetData(handle, data, size);
+}
 
-	// Success
+// --------------------------------------------------------
+// Sets a variable by handle in the local data buffer, with
+// no name lookup
+//
+// handle - From GetVariableHandle()
+// data - The data to set in the buffer
+// size - The size of the data (this must be less than or equal to the variable's size)
+//
+// Returns true if data is copied, false if the handle is invalid
+// or the data is too large
+// --------------------------------------------------------
+bool ISimpleShader::SetData(SimpleShaderVariableHandle handle, const void* data, unsigned int size)
+{
+	if (!handle.IsValid() || size > handle.Size)
+		return false;
+
+	// Only changed bytes mark the buffer dirty
+	SimpleConstantBuffer& cb = constantBuffers[handle.ConstantBufferIndex];
+	cb.Dirty.Write(cb.LocalDataBuffer, handle.ByteOffset, data, size);
 	return true;
 }
 
+bool ISimpleShader::SetInt(SimpleShaderVariableHandle handle, int data)
+{
+	return SetData(handle, &data, sizeof(int));
+}
+
+bool ISimpleShader::SetFloat(SimpleShaderVariableHandle handle, float data)
+{
+	return SetData(handle, &data, sizeof(float));
+}
+
+bool ISimpleShader::SetFloat2(SimpleShaderVariableHandle handle, const DirectX::XMFLOAT2& data)
+{
+	return SetData(handle, &data, sizeof(float) * 2);
+}
+
+bool ISimpleShader::SetFloat3(SimpleShaderVariableHandle handle, const DirectX::XMFLOAT3& data)
+{
+	return SetData(handle, &data, sizeof(float) * 3);
+}
+
+bool ISimpleShader::SetFloat4(SimpleShaderVariableHandle handle, const DirectX::XMFLOAT4& data)
+{
+	return SetData(handle, &data, sizeof(float) * 4);
+}
+
+bool ISimpleShader::SetMatrix4x4(SimpleShaderVariableHandle handle, const DirectX::XMFLOAT4X4& data)
+{
+	return SetData(handle, &data, sizeof(float) * 16);
+}
+
+// --------------------------------------------------------
+// Resolves a variable name to a handle.  The handle is
+// invalid (see IsValid()) if the variable doesn't exist.
+// --------------------------------------------------------
+SimpleShaderVariableHandle ISimpleShader::GetVariableHandle(std::string name)
+{
+	SimpleShaderVariableHandle handle;
+	SimpleShaderVariable* var = FindVariable(name, -1);
+	if (var != 0)
+	{
+		handle.ByteOffset = var->ByteOffset;
+		handle.Size = var->Size;
+		handle.ConstantBufferIndex = var->ConstantBufferIndex;
+	}
+	return handle;
+}
+
+// --------------------------------------------------------
+// Resolves an SRV name to a handle (invalid if not found)
+// --------------------------------------------------------
+SimpleShaderResourceHandle ISimpleShader::GetShaderResourceViewHandle(std::string name)
+{
+	SimpleShaderResourceHandle handle;
+	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(name);
+	if (srvInfo != 0)
+		handle.BindIndex = srvInfo->BindIndex;
+	return handle;
+}
+
+// --------------------------------------------------------
+// Resolves a sampler name to a handle (invalid if not found)
+// --------------------------------------------------------
+SimpleShaderResourceHandle ISimpleShader::GetSamplerHandle(std::string name)
+{
+	SimpleShaderResourceHandle handle;
+	const SimpleSampler* sampInfo = GetSamplerInfo(name);
+	if (sampInfo != 0)
+		handle.BindIndex = sampInfo->BindIndex;
+	return handle;
+}
+
 // --------------------------------------------------------
 // Sets INTEGER data
 // --------------------------------------------------------
@@ -680,6 +1011,41 @@ const SimpleConstantBuffer * ISimpleShader::GetBufferInfo(unsigned int index)
 	return &constantBuffers[index];
 }
 
+// --------------------------------------------------------
+// Gets the index of a constant buffer for the index-based
+// methods, or -1 if it doesn't exist
+// --------------------------------------------------------
+unsigned int ISimpleShader::GetBufferIndex(std::string name)
+{
+	SimpleConstantBuffer* cb = FindConstantBuffer(name);
+	if (!cb) return -1;
+
+	return (unsigned int)(cb - constantBuffers);
+}
+
+// --------------------------------------------------------
+// Copies data over the start of a constant buffer's local
+// data, without any per-variable lookups
+//
+// index - the index of the constant buffer
+// data - the data to copy, laid out like the cbuffer
+// size - bytes to copy, up to the buffer's (16-byte aligned) size
+//
+// Returns true if the data fit in the buffer
+// --------------------------------------------------------
+bool ISimpleShader::SetBufferData(unsigned int index, const void* data, unsigned int size)
+{
+	if (index >= constantBufferCount)
+		return false;
+
+	SimpleConstantBuffer& cb = constantBuffers[index];
+	if (size > ((cb.Size + 15) / 16) * 16)
+		return false;
+
+	cb.Dirty.Write(cb.LocalDataBuffer, 0, data, size);
+	return true;
+}
+
 
 
 
@@ -880,11 +1246,24 @@ void SimpleVertexShader::SetShaderAndCBs()
 			continue;
 
 		// This is a real constant buffer, so set it
-		deviceContext->VSSetConstantBuffers(
-			constantBuffers[i].BindIndex,
-			1,
-			constantBuffers[i].ConstantBuffer.GetAddressOf());
+		BindConstantBuffer(constantBuffers[i]);
+	}
+}
+
+// --------------------------------------------------------
+// Binds one constant buffer to the vertex shader stage, either
+// the shader's own buffer or its range of the per-draw ring
+// --------------------------------------------------------
+void SimpleVertexShader::BindConstantBuffer(const SimpleConstantBuffer& cb)
+{
+	if (IsBoundToRing(cb))
+	{
+		ID3D11Buffer* ring = PerDrawRing->GetBuffer();
+		deviceContext1->VSSetConstantBuffers1(cb.BindIndex, 1, &ring, &cb.RingRange.FirstConstant, &cb.RingRange.NumConstants);
+		return;
 	}
+
+	deviceContext->VSSetConstantBuffers(cb.BindIndex, 1, cb.ConstantBuffer.GetAddressOf());
 }
 
 // --------------------------------------------------------
@@ -895,7 +1274,7 @@ void SimpleVertexShader::SetShaderAndCBs()
 //
 // Returns true if a texture of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleVertexShader::SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
+bool SimpleVertexShader::SetShaderResourceView(std::string name, const Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>& srv)
 {
 	// Look for the variable and verify
 	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(name);
@@ -910,10 +1289,26 @@ bool SimpleVertexShader::SetShaderResourceView(std::string name, Microsoft::WRL:
 		return false;
 	}
 
-	// Set the shader resource view
-	deviceContext->VSSetShaderResources(srvInfo->BindIndex, 1, srv.GetAddressOf());
+	// Set it through the handle path
+	SimpleShaderResourceHandle handle;
+	handle.BindIndex = srvInfo->BindIndex;
+	return SetShaderResourceView(handle, srv);
+}
 
-	// Success
+// --------------------------------------------------------
+// Sets a shader resource view by handle, with no name lookup
+//
+// handle - From GetShaderResourceViewHandle()
+// srv - The shader resource view of the texture in GPU memory
+//
+// Returns false if the handle is invalid
+// --------------------------------------------------------
+bool SimpleVertexShader::SetShaderResourceView(SimpleShaderResourceHandle handle, const Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>& srv)
+{
+	if (!handle.IsValid())
+		return false;
+
+	deviceContext->VSSetShaderResources(handle.BindIndex, 1, srv.GetAddressOf());
 	return true;
 }
 
@@ -925,7 +1320,7 @@ bool SimpleVertexShader::SetShaderResourceView(std::string name, Microsoft::WRL:
 //
 // Returns true if a sampler of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleVertexShader::SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState)
+bool SimpleVertexShader::SetSamplerState(std::string name, const Microsoft::WRL::ComPtr<ID3D11SamplerState>& samplerState)
 {
 	// Look for the variable and verify
 	const SimpleSampler* sampInfo = GetSamplerInfo(name);
@@ -940,13 +1335,55 @@ bool SimpleVertexShader::SetSamplerState(std::string name, Microsoft::WRL::ComPt
 		return false;
 	}
 
-	// Set the shader resource view
-	deviceContext->VSSetSamplers(sampInfo->BindIndex, 1, samplerState.GetAddressOf());
+	// Set it through the handle path
+	SimpleShaderResourceHandle handle;
+	handle.BindIndex = sampInfo->BindIndex;
+	return SetSamplerState(handle, samplerState);
+}
 
-	// Success
+// --------------------------------------------------------
+// Sets a sampler state by handle, with no name lookup
+//
+// handle - From GetSamplerHandle()
+// samplerState - The sampler state in GPU memory
+//
+// Returns false if the handle is invalid
+// --------------------------------------------------------
+bool SimpleVertexShader::SetSamplerState(SimpleShaderResourceHandle handle, const Microsoft::WRL::ComPtr<ID3D11SamplerState>& samplerState)
+{
+	if (!handle.IsValid())
+		return false;
+
+	deviceContext->VSSetSamplers(handle.BindIndex, 1, samplerState.GetAddressOf());
 	return true;
 }
 
+// --------------------------------------------------------
+// Sets a contiguous range of shader resource views in one call
+//
+// startSlot - The first register (t#) to set
+// count - How many views (null entries unbind their slot)
+// srvs - The views themselves
+// --------------------------------------------------------
+void SimpleVertexShader::SetShaderResourceViews(unsigned int startSlot, unsigned int count, ID3D11ShaderResourceView* const* srvs)
+{
+	if (count > 0)
+		deviceContext->VSSetShaderResources(startSlot, count, srvs);
+}
+
+// --------------------------------------------------------
+// Sets a contiguous range of sampler states in one call
+//
+// startSlot - The first register (s#) to set
+// count - How many samplers (null entries unbind their slot)
+// samplerStates - The samplers themselves
+// --------------------------------------------------------
+void SimpleVertexShader::SetSamplerStates(unsigned int startSlot, unsigned int count, ID3D11SamplerState* const* samplerStates)
+{
+	if (count > 0)
+		deviceContext->VSSetSamplers(startSlot, count, samplerStates);
+}
+
 
 ///////////////////////////////////////////////////////////////////////////////
 // ------ SIMPLE PIXEL SHADER -------------------------------------------------
@@ -1022,11 +1459,24 @@ void SimplePixelShader::SetShaderAndCBs()
 			continue;
 
 		// This is a real constant buffer, so set it
-		deviceContext->PSSetConstantBuffers(
-			constantBuffers[i].BindIndex,
-			1,
-			constantBuffers[i].ConstantBuffer.GetAddressOf());
+		BindConstantBuffer(constantBuffers[i]);
+	}
+}
+
+// --------------------------------------------------------
+// Binds one constant buffer to the pixel shader stage, either
+// the shader's own buffer or its range of the per-draw ring
+// --------------------------------------------------------
+void SimplePixelShader::BindConstantBuffer(const SimpleConstantBuffer& cb)
+{
+	if (IsBoundToRing(cb))
+	{
+		ID3D11Buffer* ring = PerDrawRing->GetBuffer();
+		deviceContext1->PSSetConstantBuffers1(cb.BindIndex, 1, &ring, &cb.RingRange.FirstConstant, &cb.RingRange.NumConstants);
+		return;
 	}
+
+	deviceContext->PSSetConstantBuffers(cb.BindIndex, 1, cb.ConstantBuffer.GetAddressOf());
 }
 
 // --------------------------------------------------------
@@ -1037,7 +1487,7 @@ void SimplePixelShader::SetShaderAndCBs()
 //
 // Returns true if a texture of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimplePixelShader::SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
+bool SimplePixelShader::SetShaderResourceView(std::string name, const Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>& srv)
 {
 	// Look for the variable and verify
 	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(name);
@@ -1052,10 +1502,26 @@ bool SimplePixelShader::SetShaderResourceView(std::string name, Microsoft::WRL::
 		return false;
 	}
 
-	// Set the shader resource view
-	deviceContext->PSSetShaderResources(srvInfo->BindIndex, 1, srv.GetAddressOf());
+	// Set it through the handle path
+	SimpleShaderResourceHandle handle;
+	handle.BindIndex = srvInfo->BindIndex;
+	return SetShaderResourceView(handle, srv);
+}
 
-	// Success
+// --------------------------------------------------------
+// Sets a shader resource view by handle, with no name lookup
+//
+// handle - From GetShaderResourceViewHandle()
+// srv - The shader resource view of the texture in GPU memory
+//
+// Returns false if the handle is invalid
+// --------------------------------------------------------
+bool SimplePixelShader::SetShaderResourceView(SimpleShaderResourceHandle handle, const Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>& srv)
+{
+	if (!handle.IsValid())
+		return false;
+
+	deviceContext->PSSetShaderResources(handle.BindIndex, 1, srv.GetAddressOf());
 	return true;
 }
 
@@ -1067,7 +1533,7 @@ bool SimplePixelShader::SetShaderResourceView(std::string name, Microsoft::WRL::
 //
 // Returns true if a sampler of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimplePixelShader::SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState)
+bool SimplePixelShader::SetSamplerState(std::string name, const Microsoft::WRL::ComPtr<ID3D11SamplerState>& samplerState)
 {
 	// Look for the variable and verify
 	const SimpleSampler* sampInfo = GetSamplerInfo(name);
@@ -1082,13 +1548,55 @@ bool SimplePixelShader::SetSamplerState(std::string name, Microsoft::WRL::ComPtr
 		return false;
 	}
 
-	// Set the shader resource view
-	deviceContext->PSSetSamplers(sampInfo->BindIndex, 1, samplerState.GetAddressOf());
+	// Set it through the handle path
+	SimpleShaderResourceHandle handle;
+	handle.BindIndex = sampInfo->BindIndex;
+	return SetSamplerState(handle, samplerState);
+}
 
-	// Success
+// --------------------------------------------------------
+// Sets a sampler state by handle, with no name lookup
+//
+// handle - From GetSamplerHandle()
+// samplerState - The sampler state in GPU memory
+//
+// Returns false if the handle is invalid
+// --------------------------------------------------------
+bool SimplePixelShader::SetSamplerState(SimpleShaderResourceHandle handle, const Microsoft::WRL::ComPtr<ID3D11SamplerState>& samplerState)
+{
+	if (!handle.IsValid())
+		return false;
+
+	deviceContext->PSSetSamplers(handle.BindIndex, 1, samplerState.GetAddressOf());
 	return true;
 }
 
+// --------------------------------------------------------
+// Sets a contiguous range of shader resource views in one call
+//
+// startSlot - The first register (t#) to set
+// count - How many views (null entries unbind their slot)
+// srvs - The views themselves
+// --------------------------------------------------------
+void SimplePixelShader::SetShaderResourceViews(unsigned int startSlot, unsigned int count, ID3D11ShaderResourceView* const* srvs)
+{
+	if (count > 0)
+		deviceContext->PSSetShaderResources(startSlot, count, srvs);
+}
+
+// --------------------------------------------------------
+// Sets a contiguous range of sampler states in one call
+//
+// startSlot - The first register (s#) to set
+// count - How many samplers (null entries unbind their slot)
+// samplerStates - The samplers themselves
+// --------------------------------------------------------
+void SimplePixelShader::SetSamplerStates(unsigned int startSlot, unsigned int count, ID3D11SamplerState* const* samplerStates)
+{
+	if (count > 0)
+		deviceContext->PSSetSamplers(startSlot, count, samplerStates);
+}
+
 
 
 
@@ -1166,13 +1674,26 @@ void SimpleDomainShader::SetShaderAndCBs()
 			continue;
 
 		// This is a real constant buffer, so set it
-		deviceContext->DSSetConstantBuffers(
-			constantBuffers[i].BindIndex,
-			1,
-			constantBuffers[i].ConstantBuffer.GetAddressOf());
+		BindConstantBuffer(constantBuffers[i]);
 	}
 }
 
+// --------------------------------------------------------
+// Binds one constant buffer to the domain shader stage, either
+// the shader's own buffer or its range of the per-draw ring
+// --------------------------------------------------------
+void SimpleDomainShader::BindConstantBuffer(const SimpleConstantBuffer& cb)
+{
+	if (IsBoundToRing(cb))
+	{
+		ID3D11Buffer* ring = PerDrawRing->GetBuffer();
+		deviceContext1->DSSetConstantBuffers1(cb.BindIndex, 1, &ring, &cb.RingRange.FirstConstant, &cb.RingRange.NumConstants);
+		return;
+	}
+
+	deviceContext->DSSetConstantBuffers(cb.BindIndex, 1, cb.ConstantBuffer.GetAddressOf());
+}
+
 // --------------------------------------------------------
 // Sets a shader resource view in the domain shader stage
 //
@@ -1181,7 +1702,7 @@ void SimpleDomainShader::SetShaderAndCBs()
 //
 // Returns true if a texture of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleDomainShader::SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
+bool SimpleDomainShader::SetShaderResourceView(std::string name, const Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>& srv)
 {
 	// Look for the variable and verify
 	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(name);
@@ -1196,10 +1717,26 @@ bool SimpleDomainShader::SetShaderResourceView(std::string name, Microsoft::WRL:
 		return false;
 	}
 
-	// Set the shader resource view
-	deviceContext->DSSetShaderResources(srvInfo->BindIndex, 1, srv.GetAddressOf());
+	// Set it through the handle path
+	SimpleShaderResourceHandle handle;
+	handle.BindIndex = srvInfo->BindIndex;
+	return SetShaderResourceView(handle, srv);
+}
 
-	// Success
+// --------------------------------------------------------
+// Sets a shader resource view by handle, with no name lookup
+//
+// handle - From GetShaderResourceViewHandle()
+// srv - The shader resource view of the texture in GPU memory
+//
+// Returns false if the handle is invalid
+// --------------------------------------------------------
+bool SimpleDomainShader::SetShaderResourceView(SimpleShaderResourceHandle handle, const Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>& srv)
+{
+	if (!handle.IsValid())
+		return false;
+
+	deviceContext->DSSetShaderResources(handle.BindIndex, 1, srv.GetAddressOf());
 	return true;
 }
 
@@ -1211,7 +1748,7 @@ bool SimpleDomainShader::SetShaderResourceView(std::string name, Microsoft::WRL:
 //
 // Returns true if a sampler of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleDomainShader::SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState)
+bool SimpleDomainShader::SetSamplerState(std::string name, const Microsoft::WRL::ComPtr<ID3D11SamplerState>& samplerState)
 {
 	// Look for the variable and verify
 	const SimpleSampler* sampInfo = GetSamplerInfo(name);
@@ -1226,13 +1763,55 @@ bool SimpleDomainShader::SetSamplerState(std::string name, Microsoft::WRL::ComPt
 		return false;
 	}
 
-	// Set the shader resource view
-	deviceContext->DSSetSamplers(sampInfo->BindIndex, 1, samplerState.GetAddressOf());
+	// Set it through the handle path
+	SimpleShaderResourceHandle handle;
+	handle.BindIndex = sampInfo->BindIndex;
+	return SetSamplerState(handle, samplerState);
+}
 
-	// Success
+// --------------------------------------------------------
+// Sets a sampler state by handle, with no name lookup
+//
+// handle - From GetSamplerHandle()
+// samplerState - The sampler state in GPU memory
+//
+// Returns false if the handle is invalid
+// --------------------------------------------------------
+bool SimpleDomainShader::SetSamplerState(SimpleShaderResourceHandle handle, const Microsoft::WRL::ComPtr<ID3D11SamplerState>& samplerState)
+{
+	if (!handle.IsValid())
+		return false;
+
+	deviceContext->DSSetSamplers(handle.BindIndex, 1, samplerState.GetAddressOf());
 	return true;
 }
 
+// --------------------------------------------------------
+// Sets a contiguous range of shader resource views in one call
+//
+// startSlot - The first register (t#) to set
+// count - How many views (null entries unbind their slot)
+// srvs - The views themselves
+// --------------------------------------------------------
+void SimpleDomainShader::SetShaderResourceViews(unsigned int startSlot, unsigned int count, ID3D11ShaderResourceView* const* srvs)
+{
+	if (count > 0)
+		deviceContext->DSSetShaderResources(startSlot, count, srvs);
+}
+
+// --------------------------------------------------------
+// Sets a contiguous range of sampler states in one call
+//
+// startSlot - The first register (s#) to set
+// count - How many samplers (null entries unbind their slot)
+// samplerStates - The samplers themselves
+// --------------------------------------------------------
+void SimpleDomainShader::SetSamplerStates(unsigned int startSlot, unsigned int count, ID3D11SamplerState* const* samplerStates)
+{
+	if (count > 0)
+		deviceContext->DSSetSamplers(startSlot, count, samplerStates);
+}
+
 
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -1309,13 +1888,26 @@ void SimpleHullShader::SetShaderAndCBs()
 			continue;
 
 		// This is a real constant buffer, so set it
-		deviceContext->HSSetConstantBuffers(
-			constantBuffers[i].BindIndex,
-			1,
-			constantBuffers[i].ConstantBuffer.GetAddressOf());
+		BindConstantBuffer(constantBuffers[i]);
 	}
 }
 
+// --------------------------------------------------------
+// Binds one constant buffer to the hull shader stage, either
+// the shader's own buffer or its range of the per-draw ring
+// --------------------------------------------------------
+void SimpleHullShader::BindConstantBuffer(const SimpleConstantBuffer& cb)
+{
+	if (IsBoundToRing(cb))
+	{
+		ID3D11Buffer* ring = PerDrawRing->GetBuffer();
+		deviceContext1->HSSetConstantBuffers1(cb.BindIndex, 1, &ring, &cb.RingRange.FirstConstant, &cb.RingRange.NumConstants);
+		return;
+	}
+
+	deviceContext->HSSetConstantBuffers(cb.BindIndex, 1, cb.ConstantBuffer.GetAddressOf());
+}
+
 // --------------------------------------------------------
 // Sets a shader resource view in the hull shader stage
 //
@@ -1324,7 +1916,7 @@ void SimpleHullShader::SetShaderAndCBs()
 //
 // Returns true if a texture of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleHullShader::SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
+bool SimpleHullShader::SetShaderResourceView(std::string name, const Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>& srv)
 {
 	// Look for the variable and verify
 	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(name);
@@ -1339,10 +1931,26 @@ bool SimpleHullShader::SetShaderResourceView(std::string name, Microsoft::WRL::C
 		return false;
 	}
 
-	// Set the shader resource view
-	deviceContext->HSSetShaderResources(srvInfo->BindIndex, 1, srv.GetAddressOf());
+	// Set it through the handle path
+	SimpleShaderResourceHandle handle;
+	handle.BindIndex = srvInfo->BindIndex;
+	return SetShaderResourceView(handle, srv);
+}
 
-	// Success
+// --------------------------------------------------------
+// Sets a shader resource view by handle, with no name lookup
+//
+// handle - From GetShaderResourceViewHandle()
+// srv - The shader resource view of the texture in GPU memory
+//
+// Returns false if the handle is invalid
+// --------------------------------------------------------
+bool SimpleHullShader::SetShaderResourceView(SimpleShaderResourceHandle handle, const Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>& srv)
+{
+	if (!handle.IsValid())
+		return false;
+
+	deviceContext->HSSetShaderResources(handle.BindIndex, 1, srv.GetAddressOf());
 	return true;
 }
 
@@ -1354,7 +1962,7 @@ bool SimpleHullShader::SetShaderResourceView(std::string name, Microsoft::WRL::C
 //
 // Returns true if a sampler of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleHullShader::SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState)
+bool SimpleHullShader::SetSamplerState(std::string name, const Microsoft::WRL::ComPtr<ID3D11SamplerState>& samplerState)
 {
 	// Look for the variable and verify
 	const SimpleSampler* sampInfo = GetSamplerInfo(name);
@@ -1369,13 +1977,55 @@ bool SimpleHullShader::SetSamplerState(std::string name, Microsoft::WRL::ComPtr<
 		return false;
 	}
 
-	// Set the shader resource view
-	deviceContext->HSSetSamplers(sampInfo->BindIndex, 1, samplerState.GetAddressOf());
+	// Set it through the handle path
+	SimpleShaderResourceHandle handle;
+	handle.BindIndex = sampInfo->BindIndex;
+	return SetSamplerState(handle, samplerState);
+}
 
-	// Success
+// --------------------------------------------------------
+// Sets a sampler state by handle, with no name lookup
+//
+// handle - From GetSamplerHandle()
+// samplerState - The sampler state in GPU memory
+//
+// Returns false if the handle is invalid
+// --------------------------------------------------------
+bool SimpleHullShader::SetSamplerState(SimpleShaderResourceHandle handle, const Microsoft::WRL::ComPtr<ID3D11SamplerState>& samplerState)
+{
+	if (!handle.IsValid())
+		return false;
+
+	deviceContext->HSSetSamplers(handle.BindIndex, 1, samplerState.GetAddressOf());
 	return true;
 }
 
+// --------------------------------------------------------
+// Sets a contiguous range of shader resource views in one call
+//
+// startSlot - The first register (t#) to set
+// count - How many views (null entries unbind their slot)
+// srvs - The views themselves
+// --------------------------------------------------------
+void SimpleHullShader::SetShaderResourceViews(unsigned int startSlot, unsigned int count, ID3D11ShaderResourceView* const* srvs)
+{
+	if (count > 0)
+		deviceContext->HSSetShaderResources(startSlot, count, srvs);
+}
+
+// --------------------------------------------------------
+// Sets a contiguous range of sampler states in one call
+//
+// startSlot - The first register (s#) to set
+// count - How many samplers (null entries unbind their slot)
+// samplerStates - The samplers themselves
+// --------------------------------------------------------
+void SimpleHullShader::SetSamplerStates(unsigned int startSlot, unsigned int count, ID3D11SamplerState* const* samplerStates)
+{
+	if (count > 0)
+		deviceContext->HSSetSamplers(startSlot, count, samplerStates);
+}
+
 
 
 
@@ -1583,13 +2233,26 @@ void SimpleGeometryShader::SetShaderAndCBs()
 			continue;
 
 		// This is a real constant buffer, so set it
-		deviceContext->GSSetConstantBuffers(
-			constantBuffers[i].BindIndex,
-			1,
-			constantBuffers[i].ConstantBuffer.GetAddressOf());
+		BindConstantBuffer(constantBuffers[i]);
 	}
 }
 
+// --------------------------------------------------------
+// Binds one constant buffer to the geometry shader stage, either
+// the shader's own buffer or its range of the per-draw ring
+// --------------------------------------------------------
+void SimpleGeometryShader::BindConstantBuffer(const SimpleConstantBuffer& cb)
+{
+	if (IsBoundToRing(cb))
+	{
+		ID3D11Buffer* ring = PerDrawRing->GetBuffer();
+		deviceContext1->GSSetConstantBuffers1(cb.BindIndex, 1, &ring, &cb.RingRange.FirstConstant, &cb.RingRange.NumConstants);
+		return;
+	}
+
+	deviceContext->GSSetConstantBuffers(cb.BindIndex, 1, cb.ConstantBuffer.GetAddressOf());
+}
+
 // --------------------------------------------------------
 // Sets a shader resource view in the Geometry shader stage
 //
@@ -1598,7 +2261,7 @@ void SimpleGeometryShader::SetShaderAndCBs()
 //
 // Returns true if a texture of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleGeometryShader::SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
+bool SimpleGeometryShader::SetShaderResourceView(std::string name, const Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>& srv)
 {
 	// Look for the variable and verify
 	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(name);
@@ -1613,10 +2276,26 @@ bool SimpleGeometryShader::SetShaderResourceView(std::string name, Microsoft::WR
 		return false;
 	}
 
-	// Set the shader resource view
-	deviceContext->GSSetShaderResources(srvInfo->BindIndex, 1, srv.GetAddressOf());
+	// Set it through the handle path
+	SimpleShaderResourceHandle handle;
+	handle.BindIndex = srvInfo->BindIndex;
+	return SetShaderResourceView(handle, srv);
+}
 
-	// Success
+// --------------------------------------------------------
+// Sets a shader resource view by handle, with no name lookup
+//
+// handle - From GetShaderResourceViewHandle()
+// srv - The shader resource view of the texture in GPU memory
+//
+// Returns false if the handle is invalid
+// --------------------------------------------------------
+bool SimpleGeometryShader::SetShaderResourceView(SimpleShaderResourceHandle handle, const Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>& srv)
+{
+	if (!handle.IsValid())
+		return false;
+
+	deviceContext->GSSetShaderResources(handle.BindIndex, 1, srv.GetAddressOf());
 	return true;
 }
 
@@ -1628,7 +2307,7 @@ bool SimpleGeometryShader::SetShaderResourceView(std::string name, Microsoft::WR
 //
 // Returns true if a sampler of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleGeometryShader::SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState)
+bool SimpleGeometryShader::SetSamplerState(std::string name, const Microsoft::WRL::ComPtr<ID3D11SamplerState>& samplerState)
 {
 	// Look for the variable and verify
 	const SimpleSampler* sampInfo = GetSamplerInfo(name);
@@ -1643,13 +2322,55 @@ bool SimpleGeometryShader::SetSamplerState(std::string name, Microsoft::WRL::Com
 		return false;
 	}
 
-	// Set the shader resource view
-	deviceContext->GSSetSamplers(sampInfo->BindIndex, 1, samplerState.GetAddressOf());
+	// Set it through the handle path
+	SimpleShaderResourceHandle handle;
+	handle.BindIndex = sampInfo->BindIndex;
+	return SetSamplerState(handle, samplerState);
+}
 
-	// Success
+// --------------------------------------------------------
+// Sets a sampler state by handle, with no name lookup
+//
+// handle - From GetSamplerHandle()
+// samplerState - The sampler state in GPU memory
+//
+// Returns false if the handle is invalid
+// --------------------------------------------------------
+bool SimpleGeometryShader::SetSamplerState(SimpleShaderResourceHandle handle, const Microsoft::WRL::ComPtr<ID3D11SamplerState>& samplerState)
+{
+	if (!handle.IsValid())
+		return false;
+
+	deviceContext->GSSetSamplers(handle.BindIndex, 1, samplerState.GetAddressOf());
 	return true;
 }
 
+// --------------------------------------------------------
+// Sets a contiguous range of shader resource views in one call
+//
+// startSlot - The first register (t#) to set
+// count - How many views (null entries unbind their slot)
+// srvs - The views themselves
+// --------------------------------------------------------
+void SimpleGeometryShader::SetShaderResourceViews(unsigned int startSlot, unsigned int count, ID3D11ShaderResourceView* const* srvs)
+{
+	if (count > 0)
+		deviceContext->GSSetShaderResources(startSlot, count, srvs);
+}
+
+// --------------------------------------------------------
+// Sets a contiguous range of sampler states in one call
+//
+// startSlot - The first register (s#) to set
+// count - How many samplers (null entries unbind their slot)
+// samplerStates - The samplers themselves
+// --------------------------------------------------------
+void SimpleGeometryShader::SetSamplerStates(unsigned int startSlot, unsigned int count, ID3D11SamplerState* const* samplerStates)
+{
+	if (count > 0)
+		deviceContext->GSSetSamplers(startSlot, count, samplerStates);
+}
+
 // --------------------------------------------------------
 // Calculates the number of components specified by a parameter description mask
 //
@@ -1793,13 +2514,26 @@ void SimpleComputeShader::SetShaderAndCBs()
 			continue;
 
 		// This is a real constant buffer, so set it
-		deviceContext->CSSetConstantBuffers(
-			constantBuffers[i].BindIndex,
-			1,
-			constantBuffers[i].ConstantBuffer.GetAddressOf());
+		BindConstantBuffer(constantBuffers[i]);
 	}
 }
 
+// --------------------------------------------------------
+// Binds one constant buffer to the compute shader stage, either
+// the shader's own buffer or its range of the per-draw ring
+// --------------------------------------------------------
+void SimpleComputeShader::BindConstantBuffer(const SimpleConstantBuffer& cb)
+{
+	if (IsBoundToRing(cb))
+	{
+		ID3D11Buffer* ring = PerDrawRing->GetBuffer();
+		deviceContext1->CSSetConstantBuffers1(cb.BindIndex, 1, &ring, &cb.RingRange.FirstConstant, &cb.RingRange.NumConstants);
+		return;
+	}
+
+	deviceContext->CSSetConstantBuffers(cb.BindIndex, 1, cb.ConstantBuffer.GetAddressOf());
+}
+
 // --------------------------------------------------------
 // Dispatches the compute shader with the specified amount 
 // of groups, using the number of threads per group
@@ -1869,7 +2603,7 @@ bool SimpleComputeShader::HasUnorderedAccessView(std::string name)
 //
 // Returns true if a texture of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleComputeShader::SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
+bool SimpleComputeShader::SetShaderResourceView(std::string name, const Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>& srv)
 {
 	// Look for the variable and verify
 	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(name);
@@ -1884,10 +2618,26 @@ bool SimpleComputeShader::SetShaderResourceView(std::string name, Microsoft::WRL
 		return false;
 	}
 
-	// Set the shader resource view
-	deviceContext->CSSetShaderResources(srvInfo->BindIndex, 1, srv.GetAddressOf());
+	// Set it through the handle path
+	SimpleShaderResourceHandle handle;
+	handle.BindIndex = srvInfo->BindIndex;
+	return SetShaderResourceView(handle, srv);
+}
 
-	// Success
+// --------------------------------------------------------
+// Sets a shader resource view by handle, with no name lookup
+//
+// handle - From GetShaderResourceViewHandle()
+// srv - The shader resource view of the texture in GPU memory
+//
+// Returns false if the handle is invalid
+// --------------------------------------------------------
+bool SimpleComputeShader::SetShaderResourceView(SimpleShaderResourceHandle handle, const Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>& srv)
+{
+	if (!handle.IsValid())
+		return false;
+
+	deviceContext->CSSetShaderResources(handle.BindIndex, 1, srv.GetAddressOf());
 	return true;
 }
 
@@ -1899,7 +2649,7 @@ bool SimpleComputeShader::SetShaderResourceView(std::string name, Microsoft::WRL
 //
 // Returns true if a sampler of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleComputeShader::SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState)
+bool SimpleComputeShader::SetSamplerState(std::string name, const Microsoft::WRL::ComPtr<ID3D11SamplerState>& samplerState)
 {
 	// Look for the variable and verify
 	const SimpleSampler* sampInfo = GetSamplerInfo(name);
@@ -1914,13 +2664,55 @@ bool SimpleComputeShader::SetSamplerState(std::string name, Microsoft::WRL::ComP
 		return false;
 	}
 
-	// Set the shader resource view
-	deviceContext->CSSetSamplers(sampInfo->BindIndex, 1, samplerState.GetAddressOf());
+	// Set it through the handle path
+	SimpleShaderResourceHandle handle;
+	handle.BindIndex = sampInfo->BindIndex;
+	return SetSamplerState(handle, samplerState);
+}
 
-	// Success
+// --------------------------------------------------------
+// Sets a sampler state by handle, with no name lookup
+//
+// handle - From GetSamplerHandle()
+// samplerState - The sampler state in GPU memory
+//
+// Returns false if the handle is invalid
+// --------------------------------------------------------
+bool SimpleComputeShader::SetSamplerState(SimpleShaderResourceHandle handle, const Microsoft::WRL::ComPtr<ID3D11SamplerState>& samplerState)
+{
+	if (!handle.IsValid())
+		return false;
+
+	deviceContext->CSSetSamplers(handle.BindIndex, 1, samplerState.GetAddressOf());
 	return true;
 }
 
+// --------------------------------------------------------
+// Sets a contiguous range of shader resource views in one call
+//
+// startSlot - The first register (t#) to set
+// count - How many views (null entries unbind their slot)
+// srvs - The views themselves
+// --------------------------------------------------------
+void SimpleComputeShader::SetShaderResourceViews(unsigned int startSlot, unsigned int count, ID3D11ShaderResourceView* const* srvs)
+{
+	if (count > 0)
+		deviceContext->CSSetShaderResources(startSlot, count, srvs);
+}
+
+// --------------------------------------------------------
+// Sets a contiguous range of sampler states in one call
+//
+// startSlot - The first register (s#) to set
+// count - How many samplers (null entries unbind their slot)
+// samplerStates - The samplers themselves
+// --------------------------------------------------------
+void SimpleComputeShader::SetSamplerStates(unsigned int startSlot, unsigned int count, ID3D11SamplerState* const* samplerStates)
+{
+	if (count > 0)
+		deviceContext->CSSetSamplers(startSlot, count, samplerStates);
+}
+
 // --------------------------------------------------------
 // Sets an unordered access view in the Compute shader stage
 //
@@ -2,7 +2,7 @@
 #pragma comment(lib, "dxguid.lib")
 #pragma comment(lib, "d3dcompiler.lib")
 
-#include <d3d11.h>
+#include <d3d11_1.h>
 #include <d3dcompiler.h>
 #include <DirectXMath.h>
 #include <wrl/client.h>
@@ -10,7 +10,11 @@
 #include <unordered_map>
 #include <vector>
 #include <string>
+#include <fstream>
 
+#include "DirtyRange.h"
+#include "ConstantBufferRing.h"
+#include "ShaderReflectionCache.h"
 
 // --------------------------------------------------------
 // Used by simple shaders to store information about
@@ -37,6 +41,30 @@ struct SimpleConstantBuffer
 	Microsoft::WRL::ComPtr<ID3D11Buffer> ConstantBuffer = 0;
 	unsigned char* LocalDataBuffer = 0;
 	std::vector<SimpleShaderVariable> Variables;
+
+	// Bytes of LocalDataBuffer changed since the last upload
+	DirtyRange Dirty;
+
+	// Dynamic buffers are uploaded with Map/WRITE_DISCARD instead of UpdateSubresource
+	bool Dynamic = false;
+
+	// Per-draw buffers are uploaded to ISimpleShader::PerDrawRing when
+	// there is one; RingRange is only valid during frame RingFrame
+	bool PerDraw = false;
+	ConstantBufferRange RingRange = {};
+	UINT64 RingFrame = 0;
+};
+
+// --------------------------------------------------------
+// Constant buffer upload counters, summed over every shader.
+// Reset them once a frame with ISimpleShader::ResetUploadStats().
+// --------------------------------------------------------
+struct SimpleShaderUploadStats
+{
+	unsigned int Uploads = 0;
+	unsigned int UploadsSkipped = 0;
+	unsigned int BytesUploaded = 0;
+	unsigned int RingUploads = 0;
 };
 
 // --------------------------------------------------------
@@ -57,6 +85,31 @@ struct SimpleSampler
 	unsigned int BindIndex; // The register of the Sampler
 };
 
+// --------------------------------------------------------
+// A constant buffer variable resolved once, up front, with
+// GetVariableHandle().  Setting data through a handle skips
+// the name lookup entirely.
+// --------------------------------------------------------
+struct SimpleShaderVariableHandle
+{
+	unsigned int ByteOffset = 0;
+	unsigned int Size = 0;
+	unsigned int ConstantBufferIndex = 0xFFFFFFFF;
+
+	bool IsValid() const { return ConstantBufferIndex != 0xFFFFFFFF; }
+};
+
+// --------------------------------------------------------
+// An SRV or sampler register resolved once, up front, with
+// GetShaderResourceViewHandle() or GetSamplerHandle()
+// --------------------------------------------------------
+struct SimpleShaderResourceHandle
+{
+	unsigned int BindIndex = 0xFFFFFFFF;
+
+	bool IsValid() const { return BindIndex != 0xFFFFFFFF; }
+};
+
 // --------------------------------------------------------
 // Base abstract class for simplifying shader handling
 // --------------------------------------------------------
@@ -68,6 +121,7 @@ public:
 
 	// Simple helpers
 	bool IsShaderValid() { return shaderValid; }
+	unsigned int GetShaderID() { return shaderID; }
 
 	// Activating the shader and copying data
 	void SetShader();
@@ -75,6 +129,16 @@ public:
 	void CopyBufferData(unsigned int index);
 	void CopyBufferData(std::string bufferName);
 
+	// Per-draw buffers are better off dynamic (Map/WRITE_DISCARD)
+	bool SetBufferDynamic(std::string bufferName, bool dynamic);
+
+	// Per-draw buffers go to this ring instead of their own buffer, when set
+	bool SetBufferPerDraw(std::string bufferName, bool perDraw);
+	static ConstantBufferRing* PerDrawRing;
+
+	static SimpleShaderUploadStats UploadStats;
+	static void ResetUploadStats() { UploadStats = SimpleShaderUploadStats(); }
+
 	// Sets arbitrary shader data
 	bool SetData(std::string name, const void* data, unsigned int size);
 
@@ -89,9 +153,28 @@ public:
 	bool SetMatrix4x4(std::string name, const float data[16]);
 	bool SetMatrix4x4(std::string name, const DirectX::XMFLOAT4X4 data);
 
+	// Resolving names to handles, so per-draw code can skip the lookups
+	SimpleShaderVariableHandle GetVariableHandle(std::string name);
+	SimpleShaderResourceHandle GetShaderResourceViewHandle(std::string name);
+	SimpleShaderResourceHandle GetSamplerHandle(std::string name);
+
+	// Sets shader data by handle
+	bool SetData(SimpleShaderVariableHandle handle, const void* data, unsigned int size);
+
+	bool SetInt(SimpleShaderVariableHandle handle, int data);
+	bool SetFloat(SimpleShaderVariableHandle handle, float data);
+	bool SetFloat2(SimpleShaderVariableHandle handle, const DirectX::XMFLOAT2& data);
+	bool SetFloat3(SimpleShaderVariableHandle handle, const DirectX::XMFLOAT3& data);
+	bool SetFloat4(SimpleShaderVariableHandle handle, const DirectX::XMFLOAT4& data);
+	bool SetMatrix4x4(SimpleShaderVariableHandle handle, const DirectX::XMFLOAT4X4& data);
+
 	// Setting shader resources
-	virtual bool SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv) = 0;
-	virtual bool SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState) = 0;
+	virtual bool SetShaderResourceView(std::string name, const Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>& srv) = 0;
+	virtual bool SetSamplerState(std::string name, const Microsoft::WRL::ComPtr<ID3D11SamplerState>& samplerState) = 0;
+	virtual bool SetShaderResourceView(SimpleShaderResourceHandle handle, const Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>& srv) = 0;
+	virtual bool SetSamplerState(SimpleShaderResourceHandle handle, const Microsoft::WRL::ComPtr<ID3D11SamplerState>& samplerState) = 0;
+	virtual void SetShaderResourceViews(unsigned int startSlot, unsigned int count, ID3D11ShaderResourceView* const* srvs) = 0;
+	virtual void SetSamplerStates(unsigned int startSlot, unsigned int count, ID3D11SamplerState* const* samplerStates) = 0;
 
 	// Simple resource checking
 	bool HasVariable(std::string name);
@@ -114,6 +197,11 @@ public:
 	unsigned int GetBufferSize(unsigned int index);
 	const SimpleConstantBuffer* GetBufferInfo(std::string name);
 	const SimpleConstantBuffer* GetBufferInfo(unsigned int index);
+	unsigned int GetBufferIndex(std::string name);
+
+	// Replaces a buffer's whole local copy in one go, typically
+	// with one of the generated structs in BufferStructs.h
+	bool SetBufferData(unsigned int index, const void* data, unsigned int size);
 	
 	// Misc getters
 	Microsoft::WRL::ComPtr<ID3DBlob> GetShaderBlob() { return shaderBlob; }
@@ -122,13 +210,25 @@ public:
 	static bool ReportErrors;
 	static bool ReportWarnings;
 
+	// Reflection is saved to a "<shader>.cso.refl" sidecar and reused
+	// on later runs, as long as the bytecode hasn't changed
+	static bool UseReflectionCache;
+	static unsigned int ReflectionCacheHits;
+	static unsigned int ReflectionCacheMisses;
+
 protected:
 	
 	bool shaderValid;
+	unsigned int shaderID; // Unique per shader object, used when sorting draws
+	static unsigned int nextShaderID;
 	Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob;
 	Microsoft::WRL::ComPtr<ID3D11Device> device;
 	Microsoft::WRL::ComPtr<ID3D11DeviceContext> deviceContext;
 
+	// D3D11.1 context, for partial updates and offset binding
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext1> deviceContext1;
+	bool partialUpdates;
+
 	// Resource counts
 	unsigned int constantBufferCount;
 	
@@ -141,12 +241,18 @@ protected:
 	std::unordered_map<std::string, SimpleSRV*> textureTable;
 	std::unordered_map<std::string, SimpleSampler*> samplerTable;
 
-	// Initialization method
+	// Initialization methods
 	bool LoadShaderFile(LPCWSTR shaderFile);
+	void ReflectShader(ShaderReflectionData& reflection);
+	void BuildTables(const ShaderReflectionData& reflection);
+	bool LoadReflectionCache(const std::wstring& path, uint64_t bytecodeHash, ShaderReflectionData& reflection);
+	void SaveReflectionCache(const std::wstring& path, uint64_t bytecodeHash, const ShaderReflectionData& reflection);
 
 	// Pure virtual functions for dealing with shader types
 	virtual bool CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob) = 0;
 	virtual void SetShaderAndCBs() = 0;
+	virtual void BindConstantBuffer(const SimpleConstantBuffer& cb) = 0;
+	bool IsBoundToRing(const SimpleConstantBuffer& cb);
 
 	virtual void CleanUp();
 
@@ -154,6 +260,9 @@ protected:
 	SimpleShaderVariable* FindVariable(std::string name, int size);
 	SimpleConstantBuffer* FindConstantBuffer(std::string name);
 
+	// Uploads whatever part of the buffer is dirty, if any
+	void UploadBuffer(SimpleConstantBuffer* cb);
+
 	// Error logging
 	void Log(std::string message, WORD color);
 	void LogW(std::wstring message, WORD color);
@@ -178,8 +287,12 @@ public:
 	Microsoft::WRL::ComPtr<ID3D11InputLayout> GetInputLayout() { return inputLayout; }
 	bool GetPerInstanceCompatible() { return perInstanceCompatible; }
 
-	bool SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
-	bool SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState);
+	bool SetShaderResourceView(std::string name, const Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>& srv);
+	bool SetSamplerState(std::string name, const Microsoft::WRL::ComPtr<ID3D11SamplerState>& samplerState);
+	bool SetShaderResourceView(SimpleShaderResourceHandle handle, const Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>& srv);
+	bool SetSamplerState(SimpleShaderResourceHandle handle, const Microsoft::WRL::ComPtr<ID3D11SamplerState>& samplerState);
+	void SetShaderResourceViews(unsigned int startSlot, unsigned int count, ID3D11ShaderResourceView* const* srvs);
+	void SetSamplerStates(unsigned int startSlot, unsigned int count, ID3D11SamplerState* const* samplerStates);
 
 protected:
 	bool perInstanceCompatible;
@@ -187,6 +300,7 @@ protected:
 	 Microsoft::WRL::ComPtr<ID3D11VertexShader> shader;
 	bool CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob);
 	void SetShaderAndCBs();
+	void BindConstantBuffer(const SimpleConstantBuffer& cb);
 	void CleanUp();
 };
 
@@ -201,13 +315,18 @@ public:
 	~SimplePixelShader();
 	Microsoft::WRL::ComPtr<ID3D11PixelShader> GetDirectXShader() { return shader; }
 
-	bool SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
-	bool SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState);
+	bool SetShaderResourceView(std::string name, const Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>& srv);
+	bool SetSamplerState(std::string name, const Microsoft::WRL::ComPtr<ID3D11SamplerState>& samplerState);
+	bool SetShaderResourceView(SimpleShaderResourceHandle handle, const Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>& srv);
+	bool SetSamplerState(SimpleShaderResourceHandle handle, const Microsoft::WRL::ComPtr<ID3D11SamplerState>& samplerState);
+	void SetShaderResourceViews(unsigned int startSlot, unsigned int count, ID3D11ShaderResourceView* const* srvs);
+	void SetSamplerStates(unsigned int startSlot, unsigned int count, ID3D11SamplerState* const* samplerStates);
 
 protected:
 	Microsoft::WRL::ComPtr<ID3D11PixelShader> shader;
 	bool CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob);
 	void SetShaderAndCBs();
+	void BindConstantBuffer(const SimpleConstantBuffer& cb);
 	void CleanUp();
 };
 
@@ -221,13 +340,18 @@ public:
 	~SimpleDomainShader();
 	Microsoft::WRL::ComPtr<ID3D11DomainShader> GetDirectXShader() { return shader; }
 
-	bool SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
-	bool SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState);
+	bool SetShaderResourceView(std::string name, const Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>& srv);
+	bool SetSamplerState(std::string name, const Microsoft::WRL::ComPtr<ID3D11SamplerState>& samplerState);
+	bool SetShaderResourceView(SimpleShaderResourceHandle handle, const Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>& srv);
+	bool SetSamplerState(SimpleShaderResourceHandle handle, const Microsoft::WRL::ComPtr<ID3D11SamplerState>& samplerState);
+	void SetShaderResourceViews(unsigned int startSlot, unsigned int count, ID3D11ShaderResourceView* const* srvs);
+	void SetSamplerStates(unsigned int startSlot, unsigned int count, ID3D11SamplerState* const* samplerStates);
 
 protected:
 	Microsoft::WRL::ComPtr<ID3D11DomainShader> shader;
 	bool CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob);
 	void SetShaderAndCBs();
+	void BindConstantBuffer(const SimpleConstantBuffer& cb);
 	void CleanUp();
 };
 
@@ -241,13 +365,18 @@ public:
 	~SimpleHullShader();
 	Microsoft::WRL::ComPtr<ID3D11HullShader> GetDirectXShader() { return shader; }
 
-	bool SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
-	bool SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState);
+	bool SetShaderResourceView(std::string name, const Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>& srv);
+	bool SetSamplerState(std::string name, const Microsoft::WRL::ComPtr<ID3D11SamplerState>& samplerState);
+	bool SetShaderResourceView(SimpleShaderResourceHandle handle, const Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>& srv);
+	bool SetSamplerState(SimpleShaderResourceHandle handle, const Microsoft::WRL::ComPtr<ID3D11SamplerState>& samplerState);
+	void SetShaderResourceViews(unsigned int startSlot, unsigned int count, ID3D11ShaderResourceView* const* srvs);
+	void SetSamplerStates(unsigned int startSlot, unsigned int count, ID3D11SamplerState* const* samplerStates);
 
 protected:
 	Microsoft::WRL::ComPtr<ID3D11HullShader> shader;
 	bool CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob);
 	void SetShaderAndCBs();
+	void BindConstantBuffer(const SimpleConstantBuffer& cb);
 	void CleanUp();
 };
 
@@ -261,8 +390,12 @@ public:
 	~SimpleGeometryShader();
 	Microsoft::WRL::ComPtr<ID3D11GeometryShader> GetDirectXShader() { return shader; }
 
-	bool SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
-	bool SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState);
+	bool SetShaderResourceView(std::string name, const Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>& srv);
+	bool SetSamplerState(std::string name, const Microsoft::WRL::ComPtr<ID3D11SamplerState>& samplerState);
+	bool SetShaderResourceView(SimpleShaderResourceHandle handle, const Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>& srv);
+	bool SetSamplerState(SimpleShaderResourceHandle handle, const Microsoft::WRL::ComPtr<ID3D11SamplerState>& samplerState);
+	void SetShaderResourceViews(unsigned int startSlot, unsigned int count, ID3D11ShaderResourceView* const* srvs);
+	void SetSamplerStates(unsigned int startSlot, unsigned int count, ID3D11SamplerState* const* samplerStates);
 
 	bool CreateCompatibleStreamOutBuffer(Microsoft::WRL::ComPtr<ID3D11Buffer> buffer, int vertexCount);
 
@@ -280,6 +413,7 @@ protected:
 	bool CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob);
 	bool CreateShaderWithStreamOut(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob);
 	void SetShaderAndCBs();
+	void BindConstantBuffer(const SimpleConstantBuffer& cb);
 	void CleanUp();
 
 	// Helpers
@@ -302,8 +436,12 @@ public:
 
 	bool HasUnorderedAccessView(std::string name);
 
-	bool SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
-	bool SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState);
+	bool SetShaderResourceView(std::string name, const Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>& srv);
+	bool SetSamplerState(std::string name, const Microsoft::WRL::ComPtr<ID3D11SamplerState>& samplerState);
+	bool SetShaderResourceView(SimpleShaderResourceHandle handle, const Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>& srv);
+	bool SetSamplerState(SimpleShaderResourceHandle handle, const Microsoft::WRL::ComPtr<ID3D11SamplerState>& samplerState);
+	void SetShaderResourceViews(unsigned int startSlot, unsigned int count, ID3D11ShaderResourceView* const* srvs);
+	void SetSamplerStates(unsigned int startSlot, unsigned int count, ID3D11SamplerState* const* samplerStates);
 	bool SetUnorderedAccessView(std::string name, Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> uav, unsigned int appendConsumeOffset = -1);
 
 	int GetUnorderedAccessViewIndex(std::string name);
@@ -319,5 +457,6 @@ protected:
 
 	bool CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob);
 	void SetShaderAndCBs();
+	void BindConstantBuffer(const SimpleConstantBuffer& cb);
 	void CleanUp();
 };
\ No newline at end of file
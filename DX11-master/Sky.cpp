@@ -10,6 +10,7 @@ Sky::Sky(std::shared_ptr<Mesh> _mesh,
 	std::shared_ptr<SimpleVertexShader> _vertexShader, 
 	std::shared_ptr<SimplePixelShader> _pixelShader, 
 	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
+	PipelineStateCache& pipelineStates,
 	const wchar_t* right,
 	const wchar_t* left,
 	const wchar_t* up,
@@ -24,44 +25,29 @@ Sky::Sky(std::shared_ptr<Mesh> _mesh,
 	skySrv = CreateCubemap(right, left, up,
 		down, front, back, context, device);
 
-	D3D11_RASTERIZER_DESC rastDesc = {};
-	rastDesc.CullMode = D3D11_CULL_FRONT;
-	rastDesc.FillMode = D3D11_FILL_SOLID;
-	rastDesc.DepthClipEnable = true;
-	device->CreateRasterizerState(&rastDesc, skyRasterState.GetAddressOf());
-
-	D3D11_DEPTH_STENCIL_DESC depthDesc = {};
-	depthDesc.DepthEnable = true;
-	depthDesc.DepthFunc = D3D11_COMPARISON_LESS_EQUAL;
-	depthDesc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ALL;
-	device->CreateDepthStencilState(&depthDesc, skyDepthState.GetAddressOf());
+	// Inside of the cube, drawn at the far plane
+	PipelineStateDesc psoDesc;
+	psoDesc.VertexShader = vs.get();
+	psoDesc.PixelShader = ps.get();
+	psoDesc.Rasterizer.CullMode = D3D11_CULL_FRONT;
+	psoDesc.DepthStencil.DepthFunc = D3D11_COMPARISON_LESS_EQUAL;
+	pipelineState = pipelineStates.Get(psoDesc);
 }
 
-void Sky::Draw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, std::shared_ptr<Camera> cam, Microsoft::WRL::ComPtr<ID3D11Device> device)
+void Sky::Draw(StateTracker& stateTracker, const std::shared_ptr<Camera>& cam)
 {
-	context->RSSetState(skyRasterState.Get());
-	context->OMSetDepthStencilState(skyDepthState.Get(), 0);
+	stateTracker.SetPipelineState(pipelineState);
 
+	vs->SetMatrix4x4("view", cam->GetViewMatrix());
+	vs->SetMatrix4x4("projection", cam->GetProjectionMatrix());
+	vs->CopyAllBufferData();
 
-	vs->SetShader();
-	ps->SetShader();
-
-
-	std::shared_ptr<SimpleVertexShader> vertS = vs;
-	vertS->SetMatrix4x4("view", cam->GetViewMatrix());
-	vertS->SetMatrix4x4("projection", cam->GetProjectionMatrix());
-	vertS->CopyAllBufferData();
-
-	std::shared_ptr<SimplePixelShader> pixS = ps;
-	pixS->SetShaderResourceView("SkyTexture", skySrv);
-	pixS->SetSamplerState("SkySampler", sampler);
-	pixS->CopyAllBufferData();
+	ps->SetShaderResourceView("SkyTexture", skySrv);
+	ps->SetSamplerState("SkySampler", sampler);
+	ps->CopyAllBufferData();
 
 
 	skyMesh->Draw();
-
-	context->OMGetDepthStencilState(0, 0);
-	context->RSSetState(0);
 }
 
 // --------------------------------------------------------
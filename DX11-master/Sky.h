@@ -4,6 +4,8 @@
 #include "Mesh.h"
 #include "SimpleShader.h"
 #include "Camera.h"
+#include "PipelineState.h"
+#include "StateTracker.h"
 #include "WICTextureLoader.h"
 
 class Sky
@@ -11,8 +13,7 @@ class Sky
 private:
 	Microsoft::WRL::ComPtr<ID3D11SamplerState> sampler;
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> skySrv;
-	Microsoft::WRL::ComPtr<ID3D11DepthStencilState> skyDepthState;
-	Microsoft::WRL::ComPtr<ID3D11RasterizerState> skyRasterState;
+	const PipelineState* pipelineState;
 	std::shared_ptr<Mesh> skyMesh;
 	std::shared_ptr<SimplePixelShader> ps;
 	std::shared_ptr<SimpleVertexShader> vs;
@@ -23,6 +24,7 @@ public:
 		std::shared_ptr<SimpleVertexShader> _vertexShader,
 		std::shared_ptr<SimplePixelShader> _pixelShader,
 		Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
+		PipelineStateCache& pipelineStates,
 		const wchar_t* right,
 		const wchar_t* left,
 		const wchar_t* up,
@@ -54,6 +56,6 @@ public:
 		Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
 		Microsoft::WRL::ComPtr<ID3D11Device> device);
 
-	void Draw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, std::shared_ptr<Camera> cam, Microsoft::WRL::ComPtr<ID3D11Device> device);
+	void Draw(StateTracker& stateTracker, const std::shared_ptr<Camera>& cam);
 };
 
@@ -0,0 +1,76 @@
+#include "StateTracker.h"
+
+StateTracker::StateTracker(Microsoft::WRL::ComPtr<ID3D11DeviceContext> _context,
+	VertexShaderBinder _bindVertexShader, PixelShaderBinder _bindPixelShader)
+{
+	context = _context;
+	bindVertexShader = _bindVertexShader;
+	bindPixelShader = _bindPixelShader;
+	current = 0;
+	valid = false;
+	ResetStats();
+}
+
+void StateTracker::SetPipelineState(const PipelineState* state)
+{
+	// Nothing is known to be bound, so compare against nothing
+	const PipelineStateDesc& desc = state->GetDesc();
+	unsigned int changed = state->GetChangedParts(valid ? current : 0);
+	unsigned int issued = 0;
+
+	if (changed & PIPELINE_PART_VERTEX_SHADER)
+	{
+		bindVertexShader(desc.VertexShader);
+		issued++;
+	}
+
+	if (changed & PIPELINE_PART_PIXEL_SHADER)
+	{
+		if (desc.PixelShader)
+			bindPixelShader(desc.PixelShader);
+		else
+			context->PSSetShader(0, 0, 0);
+		issued++;
+	}
+
+	if (changed & PIPELINE_PART_RASTERIZER)
+	{
+		context->RSSetState(state->GetRasterizerState());
+		issued++;
+	}
+
+	if (changed & PIPELINE_PART_DEPTH_STENCIL)
+	{
+		context->OMSetDepthStencilState(state->GetDepthStencilState(), 0);
+		issued++;
+	}
+
+	if (changed & PIPELINE_PART_BLEND)
+	{
+		context->OMSetBlendState(state->GetBlendState(), 0, 0xFFFFFFFF);
+		issued++;
+	}
+
+	if (changed & PIPELINE_PART_TOPOLOGY)
+	{
+		context->IASetPrimitiveTopology(desc.Topology);
+		issued++;
+	}
+
+	callsIssued += issued;
+	callsSkipped += PIPELINE_PART_COUNT - issued;
+	current = state;
+	valid = true;
+}
+
+void StateTracker::Invalidate()
+{
+	current = 0;
+	valid = false;
+}
+
+void StateTracker::ResetStats()
+{
+	callsIssued = 0;
+	callsSkipped = 0;
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <functional>
+#include "PipelineState.h"
+
+// --------------------------------------------------------
+// Binds PipelineStates through one context, remembering what
+// is currently bound so only the pieces that differ from the
+// previous state are actually set.
+//
+// Anything that changes pipeline state behind its back (ImGui,
+// say) must be followed by Invalidate().
+//
+// Shaders are bound through the given callbacks, which for
+// SimpleShader means SetShader() (it also binds the input
+// layout and constant buffers).  Unbinding the pixel shader
+// for depth-only states goes straight to the context.
+// --------------------------------------------------------
+class StateTracker
+{
+public:
+	typedef std::function<void(SimpleVertexShader*)> VertexShaderBinder;
+	typedef std::function<void(SimplePixelShader*)> PixelShaderBinder;
+
+	StateTracker(Microsoft::WRL::ComPtr<ID3D11DeviceContext> _context,
+		VertexShaderBinder _bindVertexShader, PixelShaderBinder _bindPixelShader);
+
+	void SetPipelineState(const PipelineState* state);
+	const PipelineState* GetPipelineState() const { return current; }
+	void Invalidate();
+
+	// Since the last ResetStats()
+	unsigned int GetCallsIssued() const { return callsIssued; }
+	unsigned int GetCallsSkipped() const { return callsSkipped; }
+	void ResetStats();
+
+private:
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context;
+	VertexShaderBinder bindVertexShader;
+	PixelShaderBinder bindPixelShader;
+
+	const PipelineState* current;
+	bool valid;
+
+	unsigned int callsIssued;
+	unsigned int callsSkipped;
+};
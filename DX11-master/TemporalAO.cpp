@@ -0,0 +1,144 @@
+#include "TemporalAO.h"
+#include <cmath>
+
+float TemporalAO::KernelAngle(uint32_t frame)
+{
+	// Fractional parts of multiples of the golden ratio spread
+	// out evenly whatever the run length
+	double turns = frame * 0.6180339887498949;
+	return (float)((turns - floor(turns)) * 6.283185307179586);
+}
+
+void TemporalAO::FrameKernel(const float* kernel, uint32_t frame, float* frameKernel)
+{
+	float angle = KernelAngle(frame);
+	float c = cosf(angle);
+	float s = sinf(angle);
+	int first = (int)(frame % FrameSamples);
+	for (int i = 0; i < FrameSamples; i++)
+	{
+		// Offsets are in tangent space, so z is along the normal
+		const float* offset = kernel + (first + i * FrameSamples) * 4;
+		frameKernel[i * 4 + 0] = offset[0] * c - offset[1] * s;
+		frameKernel[i * 4 + 1] = offset[0] * s + offset[1] * c;
+		frameKernel[i * 4 + 2] = offset[2];
+		frameKernel[i * 4 + 3] = offset[3];
+	}
+}
+
+bool TemporalAO::CurrentToPreviousView(const float* view, const float* projection, const float* previousView,
+	float* currentToPreviousView)
+{
+	float viewProjection[16];
+	float inverse[16];
+	Multiply(view, projection, viewProjection);
+	if (!Invert(viewProjection, inverse))
+		return false;
+	Multiply(inverse, previousView, currentToPreviousView);
+	return true;
+}
+
+TemporalAOPixel TemporalAO::Reproject(const float* currentToPreviousView, const float* previousProjection,
+	float u, float v, float depth)
+{
+	// UV to NDC, flipping y
+	float position[4] = { u * 2.0f - 1.0f, 1.0f - v * 2.0f, depth, 1.0f };
+	float previousView[4];
+	Transform(position, currentToPreviousView, previousView);
+	for (int i = 0; i < 3; i++)
+		previousView[i] /= previousView[3];
+	previousView[3] = 1.0f;
+
+	float clip[4];
+	Transform(previousView, previousProjection, clip);
+
+	TemporalAOPixel pixel = {};
+	pixel.PreviousViewDepth = previousView[2];
+	if (clip[3] <= 0.0f)
+		return pixel;
+	pixel.U = clip[0] / clip[3] * 0.5f + 0.5f;
+	pixel.V = 0.5f - clip[1] / clip[3] * 0.5f;
+	pixel.OnScreen = pixel.U >= 0.0f && pixel.U <= 1.0f && pixel.V >= 0.0f && pixel.V <= 1.0f;
+	return pixel;
+}
+
+float TemporalAO::ViewDepth(const float* inverseProjection, float depth)
+{
+	float position[4] = { 0.0f, 0.0f, depth, 1.0f };
+	float view[4];
+	Transform(position, inverseProjection, view);
+	return view[2] / view[3];
+}
+
+bool TemporalAO::Disoccluded(float expectedViewDepth, float historyViewDepth, float tolerance)
+{
+	return fabsf(expectedViewDepth - historyViewDepth) > fabsf(expectedViewDepth) * tolerance;
+}
+
+float TemporalAO::Accumulate(float historyAO, float historyCount, float currentAO, float& count)
+{
+	count = historyCount + 1.0f;
+	if (count > MaxHistory)
+		count = (float)MaxHistory;
+	return historyAO + (currentAO - historyAO) / count;
+}
+
+void TemporalAO::Transform(const float* v, const float* m, float* result)
+{
+	for (int c = 0; c < 4; c++)
+		result[c] = v[0] * m[c] + v[1] * m[4 + c] + v[2] * m[8 + c] + v[3] * m[12 + c];
+}
+
+void TemporalAO::Multiply(const float* a, const float* b, float* result)
+{
+	for (int r = 0; r < 4; r++)
+		Transform(a + r * 4, b, result + r * 4);
+}
+
+// --------------------------------------------------------
+// Inverse by cofactors; the determinant is along the first
+// row.  Done in doubles, as projections with a far away
+// far plane lose a lot to cancellation in floats.
+// --------------------------------------------------------
+bool TemporalAO::Invert(const float* m, float* result)
+{
+	double a[16];
+	for (int i = 0; i < 16; i++)
+		a[i] = m[i];
+
+	double s0 = a[0] * a[5] - a[1] * a[4];
+	double s1 = a[0] * a[6] - a[2] * a[4];
+	double s2 = a[0] * a[7] - a[3] * a[4];
+	double s3 = a[1] * a[6] - a[2] * a[5];
+	double s4 = a[1] * a[7] - a[3] * a[5];
+	double s5 = a[2] * a[7] - a[3] * a[6];
+	double c5 = a[10] * a[15] - a[11] * a[14];
+	double c4 = a[9] * a[15] - a[11] * a[13];
+	double c3 = a[9] * a[14] - a[10] * a[13];
+	double c2 = a[8] * a[15] - a[11] * a[12];
+	double c1 = a[8] * a[14] - a[10] * a[12];
+	double c0 = a[8] * a[13] - a[9] * a[12];
+
+	double determinant = s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+	if (determinant == 0.0)
+		return false;
+	double d = 1.0 / determinant;
+
+	result[0] = (float)((a[5] * c5 - a[6] * c4 + a[7] * c3) * d);
+	result[1] = (float)((-a[1] * c5 + a[2] * c4 - a[3] * c3) * d);
+	result[2] = (float)((a[13] * s5 - a[14] * s4 + a[15] * s3) * d);
+	result[3] = (float)((-a[9] * s5 + a[10] * s4 - a[11] * s3) * d);
+	result[4] = (float)((-a[4] * c5 + a[6] * c2 - a[7] * c1) * d);
+	result[5] = (float)((a[0] * c5 - a[2] * c2 + a[3] * c1) * d);
+	result[6] = (float)((-a[12] * s5 + a[14] * s2 - a[15] * s1) * d);
+	result[7] = (float)((a[8] * s5 - a[10] * s2 + a[11] * s1) * d);
+	result[8] = (float)((a[4] * c4 - a[5] * c2 + a[7] * c0) * d);
+	result[9] = (float)((-a[0] * c4 + a[1] * c2 - a[3] * c0) * d);
+	result[10] = (float)((a[12] * s4 - a[13] * s2 + a[15] * s0) * d);
+	result[11] = (float)((-a[8] * s4 + a[9] * s2 - a[11] * s0) * d);
+	result[12] = (float)((-a[4] * c3 + a[5] * c1 - a[6] * c0) * d);
+	result[13] = (float)((a[0] * c3 - a[1] * c1 + a[2] * c0) * d);
+	result[14] = (float)((-a[12] * s3 + a[13] * s1 - a[14] * s0) * d);
+	result[15] = (float)((a[8] * s3 - a[9] * s1 + a[10] * s0) * d);
+	return true;
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <cstdint>
+
+// --------------------------------------------------------
+// Where a pixel of this frame was in the previous one
+// --------------------------------------------------------
+struct TemporalAOPixel
+{
+	bool OnScreen;
+	float U, V;					// Previous frame's UV
+	float PreviousViewDepth;	// Its view space z in the previous frame
+};
+
+// --------------------------------------------------------
+// Temporal accumulation for SSAO, matching SSAOTemporalPS.hlsl.
+//
+// Each frame takes FrameSamples of the KernelSize hemisphere
+// offsets (every FrameSamples'th, starting at frame % FrameSamples,
+// so each frame covers every radius) and spins them about the
+// normal by a golden ratio sequence, so frames don't repeat.
+// That frame's AO is blended into a history that's carried
+// from the previous frame by reprojection: a pixel's position
+// is rebuilt from its depth and projected with the previous
+// view and projection.  The history holds up to MaxHistory
+// frames, so once full every kernel offset has been used
+// about once, at 1 / MaxHistory of the cost per frame.
+//
+// History is dropped where the pixel was off screen, or where
+// the depth it had last frame (stored with the history)
+// doesn't match where it should have been, relative to its
+// depth: something else was in front of it, or it's new.
+//
+// Matrices are row-major and meant for row vectors, the same
+// layout as XMFLOAT4X4.  Offsets are 4 floats each.
+// --------------------------------------------------------
+class TemporalAO
+{
+public:
+	static const int KernelSize = 64;	// Size of offsets[] in SSAOPixelShader.hlsl
+	static const int FrameSamples = 8;
+	static const int MaxHistory = KernelSize / FrameSamples;
+
+	static float KernelAngle(uint32_t frame);
+	static void FrameKernel(const float* kernel, uint32_t frame, float* frameKernel);
+
+	// inverse(view * projection) * previousView: from this frame's
+	// post projection position to the previous frame's view space
+	static bool CurrentToPreviousView(const float* view, const float* projection, const float* previousView,
+		float* currentToPreviousView);
+
+	static TemporalAOPixel Reproject(const float* currentToPreviousView, const float* previousProjection,
+		float u, float v, float depth);
+
+	// View space z of a post projection depth
+	static float ViewDepth(const float* inverseProjection, float depth);
+
+	static bool Disoccluded(float expectedViewDepth, float historyViewDepth, float tolerance);
+
+	// The blended AO; count becomes how many frames it holds
+	static float Accumulate(float historyAO, float historyCount, float currentAO, float& count);
+
+	// Row vector times matrix, and the 4x4 inverse (false if singular)
+	static void Transform(const float* v, const float* m, float* result);
+	static void Multiply(const float* a, const float* b, float* result);
+	static bool Invert(const float* m, float* result);
+};
@@ -0,0 +1,148 @@
+#include "ArenaAllocator.h"
+#include "Check.h"
+#include <cstdlib>
+#include <vector>
+
+// First-fit takes blocks from the front, and freeing merges
+// with whichever neighbours are free
+static void TestAllocateAndCoalesce()
+{
+	ArenaAllocator arena(100);
+	uint32_t a = arena.Allocate(10);
+	uint32_t b = arena.Allocate(20);
+	uint32_t c = arena.Allocate(30);
+	CHECK(a == 0 && b == 10 && c == 30);
+	CHECK(arena.GetUsedSize() == 60 && arena.GetFreeSize() == 40);
+	CHECK(arena.Allocate(0) == ArenaAllocator::InvalidOffset);
+
+	arena.Free(b);
+	CHECK(arena.GetFreeBlockCount() == 2);
+	arena.Free(a);
+	CHECK(arena.GetFreeBlockCount() == 2);
+	CHECK(arena.GetLargestFreeBlock() == 40);
+
+	// Freeing an unknown offset is ignored
+	arena.Free(5);
+	CHECK(arena.GetUsedSize() == 30);
+
+	// The hole at the front is reused first
+	CHECK(arena.Allocate(25) == 0);
+	arena.Free(0);
+	arena.Free(c);
+	CHECK(arena.GetFreeBlockCount() == 1 && arena.GetLargestFreeBlock() == 100);
+	CHECK(arena.GetAllocationCount() == 0);
+}
+
+// Defragment reports each block that moved, in offset order,
+// and leaves a single free block at the end
+static void TestDefragment()
+{
+	ArenaAllocator arena(100);
+	uint32_t a = arena.Allocate(10);
+	uint32_t b = arena.Allocate(20);
+	uint32_t c = arena.Allocate(30);
+	arena.Allocate(5);
+	arena.Free(a);
+	arena.Free(c);
+	CHECK(arena.Allocate(50) == ArenaAllocator::InvalidOffset);
+
+	std::vector<ArenaMove> moves;
+	arena.Defragment(moves);
+	CHECK(moves.size() == 2);
+	CHECK(moves[0].OldOffset == b && moves[0].NewOffset == 0 && moves[0].Size == 20);
+	CHECK(moves[1].OldOffset == 60 && moves[1].NewOffset == 20 && moves[1].Size == 5);
+	CHECK(arena.GetFreeBlockCount() == 1 && arena.GetLargestFreeBlock() == 75);
+	CHECK(arena.Allocate(50) == 25);
+
+	// Already packed: nothing to do
+	arena.Defragment(moves);
+	CHECK(moves.empty());
+}
+
+static void TestGrowAndReset()
+{
+	ArenaAllocator arena(50);
+	arena.Allocate(20);
+	arena.Grow(80);
+	CHECK(arena.GetCapacity() == 80);
+	CHECK(arena.GetFreeBlockCount() == 1 && arena.GetLargestFreeBlock() == 60);
+
+	// Growing past a full arena adds a fresh block at the end
+	CHECK(arena.Allocate(60) == 20);
+	arena.Grow(100);
+	CHECK(arena.GetFreeBlockCount() == 1 && arena.GetLargestFreeBlock() == 20);
+
+	// Shrinking isn't supported
+	arena.Grow(10);
+	CHECK(arena.GetCapacity() == 100);
+
+	arena.Reset();
+	CHECK(arena.GetUsedSize() == 0 && arena.GetAllocationCount() == 0);
+	CHECK(arena.GetLargestFreeBlock() == 100);
+}
+
+// Random allocate/free/defragment against a simple model:
+// live ranges must never overlap and the used size must match
+static void TestRandomAgainstModel()
+{
+	const uint32_t capacity = 4096;
+	struct Live { uint32_t Offset; uint32_t Size; };
+
+	ArenaAllocator arena(capacity);
+	std::vector<Live> live;
+	std::vector<ArenaMove> moves;
+	std::srand(1);
+	for (int step = 0; step < 5000; step++)
+	{
+		if (live.empty() || std::rand() % 3 != 0)
+		{
+			uint32_t size = 1 + std::rand() % 64;
+			uint32_t offset = arena.Allocate(size);
+			if (offset == ArenaAllocator::InvalidOffset)
+			{
+				CHECK(arena.GetLargestFreeBlock() < size);
+				arena.Defragment(moves);
+				for (const ArenaMove& move : moves)
+					for (Live& l : live)
+						if (l.Offset == move.OldOffset)
+							l.Offset = move.NewOffset;
+				continue;
+			}
+			CHECK(offset + size <= capacity);
+			live.push_back({ offset, size });
+		}
+		else
+		{
+			size_t index = std::rand() % live.size();
+			arena.Free(live[index].Offset);
+			live.erase(live.begin() + index);
+		}
+
+		uint32_t used = 0;
+		std::vector<char> occupied(capacity, 0);
+		bool overlap = false;
+		for (const Live& l : live)
+		{
+			used += l.Size;
+			for (uint32_t i = l.Offset; i < l.Offset + l.Size; i++)
+			{
+				overlap |= occupied[i] != 0;
+				occupied[i] = 1;
+			}
+		}
+		CHECK(!overlap);
+		CHECK(used == arena.GetUsedSize());
+		CHECK(live.size() == arena.GetAllocationCount());
+		if (overlap || used != arena.GetUsedSize())
+			return;
+	}
+}
+
+int main()
+{
+	TestAllocateAndCoalesce();
+	TestDefragment();
+	TestGrowAndReset();
+	TestRandomAgainstModel();
+	return CheckResult();
+}
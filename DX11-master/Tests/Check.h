@@ -0,0 +1,40 @@
+#pragma once
+#include <cmath>
+#include <cstdio>
+
+// --------------------------------------------------------
+// Just enough checking for the portable modules' tests.
+// Each test executable runs its checks, reports any that
+// fail with their file and line, and returns CheckResult()
+// from main, so CTest sees a failure as a non-zero exit.
+// --------------------------------------------------------
+static int checkFailures = 0;
+
+#define CHECK(condition) \
+	do \
+	{ \
+		if (!(condition)) \
+		{ \
+			std::printf("%s(%d): CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+			checkFailures++; \
+		} \
+	} while (0)
+
+#define CHECK_NEAR(a, b, tolerance) \
+	do \
+	{ \
+		double checkA = (double)(a); \
+		double checkB = (double)(b); \
+		if (!(std::fabs(checkA - checkB) <= (double)(tolerance))) \
+		{ \
+			std::printf("%s(%d): CHECK_NEAR(%s, %s) failed: %g vs %g\n", __FILE__, __LINE__, #a, #b, checkA, checkB); \
+			checkFailures++; \
+		} \
+	} while (0)
+
+inline int CheckResult()
+{
+	if (checkFailures > 0)
+		std::printf("%d check(s) failed\n", checkFailures);
+	return checkFailures > 0 ? 1 : 0;
+}
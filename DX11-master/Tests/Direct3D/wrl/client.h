@@ -0,0 +1,44 @@
+#pragma once
+
+// --------------------------------------------------------
+// Just enough of Microsoft::WRL::ComPtr for modules built
+// against the stub d3d11.h in this directory
+// --------------------------------------------------------
+namespace Microsoft
+{
+	namespace WRL
+	{
+		template <typename T>
+		class ComPtr
+		{
+		public:
+			ComPtr() : pointer(0) {}
+			ComPtr(T* p) : pointer(p) { if (pointer) pointer->AddRef(); }
+			ComPtr(const ComPtr& other) : ComPtr(other.pointer) {}
+			~ComPtr() { Reset(); }
+
+			ComPtr& operator=(const ComPtr& other)
+			{
+				if (other.pointer)
+					other.pointer->AddRef();
+				Reset();
+				pointer = other.pointer;
+				return *this;
+			}
+
+			T* Get() const { return pointer; }
+			T* operator->() const { return pointer; }
+			T** GetAddressOf() { return &pointer; }
+
+			void Reset()
+			{
+				if (pointer)
+					pointer->Release();
+				pointer = 0;
+			}
+
+		private:
+			T* pointer;
+		};
+	}
+}
@@ -0,0 +1,168 @@
+#include "DirtyRange.h"
+#include "Check.h"
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+// --------------------------------------------------------
+// Stands in for the device context on the upload path of
+// ISimpleShader::UploadBuffer(): it owns the "GPU" copy of
+// one constant buffer and records every upload it receives.
+// --------------------------------------------------------
+struct MockDeviceContext
+{
+	std::vector<unsigned char> gpuBuffer;
+	unsigned int uploads = 0;
+	unsigned int fullUploads = 0;
+	unsigned int bytesUploaded = 0;
+	unsigned int lastLeft = 0;
+	unsigned int lastRight = 0;
+
+	explicit MockDeviceContext(unsigned int size) : gpuBuffer(size, 0) {}
+
+	// UpdateSubresource1 with a box covering [left, right)
+	void UpdateSubresource1(unsigned int left, unsigned int right, const unsigned char* data)
+	{
+		CHECK(left % 16 == 0);
+		CHECK(right <= gpuBuffer.size());
+		CHECK(left < right);
+		memcpy(gpuBuffer.data() + left, data, right - left);
+		lastLeft = left;
+		lastRight = right;
+		uploads++;
+		bytesUploaded += right - left;
+	}
+
+	// UpdateSubresource of the whole buffer
+	void UpdateSubresource(const unsigned char* data)
+	{
+		memcpy(gpuBuffer.data(), data, gpuBuffer.size());
+		uploads++;
+		fullUploads++;
+		bytesUploaded += (unsigned int)gpuBuffer.size();
+	}
+};
+
+// UploadDirtyRange() wired to the mock the way UploadBuffer()
+// wires it to the real context
+static bool Upload(MockDeviceContext& context, DirtyRange& dirty, unsigned char* local, unsigned int size, bool partialUpdates)
+{
+	return UploadDirtyRange(dirty, size, partialUpdates,
+		[&](unsigned int begin, unsigned int end) { context.UpdateSubresource1(begin, end, local + begin); },
+		[&]() { context.UpdateSubresource(local); });
+}
+
+static void TestMarkWidens()
+{
+	DirtyRange dirty;
+	CHECK(dirty.IsEmpty() && dirty.GetSize() == 0);
+	dirty.Mark(40, 0);
+	CHECK(dirty.IsEmpty());
+	dirty.Mark(40, 8);
+	CHECK(dirty.Begin == 40 && dirty.End == 48);
+	dirty.Mark(4, 4);
+	dirty.Mark(44, 12);
+	CHECK(dirty.Begin == 4 && dirty.End == 56 && dirty.GetSize() == 52);
+
+	unsigned int begin, end;
+	dirty.GetAligned(16, 64, begin, end);
+	CHECK(begin == 0 && end == 64);
+	dirty.GetAligned(16, 60, begin, end);
+	CHECK(end == 60);
+
+	dirty.Clear();
+	CHECK(dirty.IsEmpty());
+}
+
+// Writing the same bytes again leaves the range clean, so the
+// next upload is skipped
+static void TestUnchangedWritesSkipUpload()
+{
+	unsigned char local[64] = {};
+	DirtyRange dirty;
+	MockDeviceContext context(64);
+
+	float value = 1.0f;
+	CHECK(dirty.Write(local, 20, &value, sizeof(value)));
+	CHECK(Upload(context, dirty, local, 64, true));
+	CHECK(context.uploads == 1 && context.bytesUploaded == 16);
+	CHECK(context.lastLeft == 16 && context.lastRight == 32);
+
+	CHECK(!dirty.Write(local, 20, &value, sizeof(value)));
+	CHECK(!Upload(context, dirty, local, 64, true));
+	CHECK(context.uploads == 1);
+
+	float zero = 0.0f;
+	CHECK(!dirty.Write(local, 40, &zero, sizeof(zero)));
+	CHECK(dirty.IsEmpty());
+}
+
+// Random writes over many frames: with either upload path the
+// mock GPU copy must always match the CPU copy, and partial
+// uploads must never send more than the full path would
+static void TestRandomFramesStayInSync(bool partialUpdates)
+{
+	const unsigned int size = 256;
+	unsigned char local[size] = {};
+	DirtyRange dirty;
+	MockDeviceContext context(size);
+
+	std::srand(partialUpdates ? 7 : 8);
+	unsigned int framesWithWrites = 0;
+	for (int frame = 0; frame < 500; frame++)
+	{
+		int writes = std::rand() % 4;
+		bool changed = false;
+		for (int w = 0; w < writes; w++)
+		{
+			unsigned int offset = (std::rand() % (size / 4)) * 4;
+			unsigned int value = std::rand() % 3;
+			changed |= dirty.Write(local, offset, &value, sizeof(value));
+		}
+		if (changed)
+			framesWithWrites++;
+
+		Upload(context, dirty, local, size, partialUpdates);
+		CHECK(dirty.IsEmpty());
+		CHECK(memcmp(context.gpuBuffer.data(), local, size) == 0);
+	}
+
+	CHECK(context.uploads == framesWithWrites);
+	CHECK(context.bytesUploaded <= framesWithWrites * size);
+	if (!partialUpdates)
+		CHECK(context.bytesUploaded == framesWithWrites * size);
+}
+
+// The box widens to 16 bytes but never past the buffer, and
+// without partial updates the whole buffer goes every time
+static void TestUploadPaths()
+{
+	unsigned char local[40] = {};
+	DirtyRange dirty;
+	MockDeviceContext context(40);
+
+	unsigned int value = 5;
+	dirty.Write(local, 36, &value, sizeof(value));
+	dirty.Write(local, 8, &value, sizeof(value));
+	CHECK(Upload(context, dirty, local, 40, true));
+	CHECK(context.lastLeft == 0 && context.lastRight == 40 && context.fullUploads == 0);
+	CHECK(dirty.IsEmpty());
+
+	value = 6;
+	dirty.Write(local, 4, &value, sizeof(value));
+	CHECK(Upload(context, dirty, local, 40, false));
+	CHECK(context.fullUploads == 1 && context.bytesUploaded == 80);
+	CHECK(!Upload(context, dirty, local, 40, false));
+	CHECK(context.uploads == 2);
+	CHECK(memcmp(context.gpuBuffer.data(), local, 40) == 0);
+}
+
+int main()
+{
+	TestMarkWidens();
+	TestUnchangedWritesSkipUpload();
+	TestUploadPaths();
+	TestRandomFramesStayInSync(true);
+	TestRandomFramesStayInSync(false);
+	return CheckResult();
+}
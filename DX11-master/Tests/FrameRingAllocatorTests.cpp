@@ -0,0 +1,112 @@
+#include "FrameRingAllocator.h"
+#include "Check.h"
+#include <random>
+#include <vector>
+
+static void TestAlignmentAndFull()
+{
+	FrameRingAllocator ring(1000, 256);
+	CHECK(ring.GetCapacity() == 1024);
+	CHECK(ring.Allocate(0) == FrameRingAllocator::InvalidOffset);
+	CHECK(ring.Allocate(2000) == FrameRingAllocator::InvalidOffset);
+
+	CHECK(ring.Allocate(1) == 0);
+	CHECK(ring.Allocate(300) == 256);
+	CHECK(ring.Allocate(256) == 768);
+	CHECK(ring.GetUsedSize() == 1024 && ring.GetFrameSize() == 1024);
+	CHECK(ring.Allocate(1) == FrameRingAllocator::InvalidOffset);
+}
+
+// Space comes back only once the frame's fence completes
+static void TestFencedRelease()
+{
+	FrameRingAllocator ring(1024, 256);
+	ring.Allocate(512);
+	ring.EndFrame(1);
+	ring.Allocate(256);
+	ring.EndFrame(2);
+	CHECK(ring.GetFramesInFlight() == 2 && ring.GetFrameSize() == 0);
+
+	ring.Release(0);
+	CHECK(ring.GetUsedSize() == 768);
+	ring.Release(1);
+	CHECK(ring.GetUsedSize() == 256 && ring.GetFramesInFlight() == 1);
+	ring.Release(5);
+	CHECK(ring.GetUsedSize() == 0 && ring.GetFramesInFlight() == 0);
+}
+
+// An allocation that doesn't fit before the end starts over at
+// 0, and the skipped tail stays used until its frame is released
+static void TestWrap()
+{
+	FrameRingAllocator ring(1024, 256);
+	CHECK(ring.Allocate(512) == 0);
+	ring.EndFrame(1);
+	CHECK(ring.Allocate(256) == 512);
+	ring.EndFrame(2);
+	ring.Release(1);
+
+	CHECK(ring.Allocate(512) == 0);
+	CHECK(ring.GetUsedSize() == 1024);
+	CHECK(ring.GetFrameSize() == 768);
+	CHECK(ring.Allocate(16) == FrameRingAllocator::InvalidOffset);
+	ring.EndFrame(3);
+
+	ring.Release(2);
+	CHECK(ring.Allocate(256) == 512);
+
+	ring.Reset();
+	CHECK(ring.GetUsedSize() == 0 && ring.GetFramesInFlight() == 0);
+	CHECK(ring.Allocate(256) == 0);
+}
+
+// Random sizes and frame lengths with up to three frames in
+// flight: live ranges must be aligned, inside the ring and
+// never overlap one another
+static void TestRandomNoOverlap()
+{
+	struct Live { uint32_t Offset; uint32_t Size; uint64_t Fence; };
+
+	std::mt19937 random(1);
+	FrameRingAllocator ring(1 << 16, 256);
+	std::vector<Live> live;
+	uint64_t fence = 0;
+	uint64_t completed = 0;
+	bool failed = false;
+	for (int step = 0; step < 100000 && !failed; step++)
+	{
+		uint32_t size = 1 + random() % 3000;
+		uint32_t offset = ring.Allocate(size);
+		if (offset != FrameRingAllocator::InvalidOffset)
+		{
+			failed |= offset % 256 != 0 || offset + size > ring.GetCapacity();
+			for (const Live& l : live)
+				failed |= !(offset + size <= l.Offset || l.Offset + l.Size <= offset);
+			live.push_back({ offset, size, fence + 1 });
+		}
+
+		if (random() % 20 == 0)
+		{
+			ring.EndFrame(++fence);
+			if (fence - completed > 3 || random() % 2)
+			{
+				ring.Release(++completed);
+				std::vector<Live> kept;
+				for (const Live& l : live)
+					if (l.Fence > completed)
+						kept.push_back(l);
+				live.swap(kept);
+			}
+		}
+	}
+	CHECK(!failed);
+}
+
+int main()
+{
+	TestAlignmentAndFull();
+	TestFencedRelease();
+	TestWrap();
+	TestRandomNoOverlap();
+	return CheckResult();
+}
@@ -0,0 +1,210 @@
+#include "GTAO.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+// --------------------------------------------------------
+// GTAO next to the renderer's hemisphere SSAO at equal fetch
+// budgets, on a ray cast corner (a floor and two walls): CPU
+// cost per pixel, and error against each method's converged
+// result (GTAO averaged over 16 noise offsets, SSAO with a
+// 1024 offset kernel).  The SSAO here mirrors
+// SSAOPixelShader.hlsl and Game::CreateSSAOResources().
+// The CPU times only rank the two; fetch counts are what
+// the GPU cost follows.
+// --------------------------------------------------------
+static const int Width = 320;
+static const int Height = 180;
+static const float Radius = 1.0f;
+static const int ReferenceSamples = 1024;
+
+static float projection[16];
+static std::vector<float> depths(Width * Height);
+static std::vector<float> normals(Width * Height * 3);
+static float kernel[ReferenceSamples * 4];
+static float randomDirections[16 * 2];
+
+// A plane n.p + d = 0 in view space
+struct Plane
+{
+	float X, Y, Z, D;
+};
+
+static void BuildCorner()
+{
+	float h = 1.0f / tanf(0.5f), q = 100.0f / (100.0f - 0.1f);
+	const float perspective[16] = { h / (16.0f / 9.0f), 0, 0, 0, 0, h, 0, 0, 0, 0, q, 1, 0, 0, -q * 0.1f, 0 };
+	std::copy(perspective, perspective + 16, projection);
+
+	// Floor at y = -1, back wall at z = 8, left wall at x = -2.5
+	const Plane planes[3] = { { 0, 1, 0, 1.0f }, { 0, 0, -1, 8.0f }, { 1, 0, 0, 2.5f } };
+	for (int y = 0; y < Height; y++)
+	{
+		for (int x = 0; x < Width; x++)
+		{
+			float rayX = ((x + 0.5f) / Width * 2 - 1) / projection[0];
+			float rayY = (1 - (y + 0.5f) / Height * 2) / projection[5];
+			float nearest = 1e30f;
+			const Plane* hit = 0;
+			for (const Plane& plane : planes)
+			{
+				float facing = plane.X * rayX + plane.Y * rayY + plane.Z;
+				float t = fabsf(facing) > 1e-6f ? -plane.D / facing : -1.0f;
+				if (t > 0 && t < nearest)
+				{
+					nearest = t;
+					hit = &plane;
+				}
+			}
+
+			size_t i = (size_t)y * Width + x;
+			if (!hit || nearest > 99.0f)
+			{
+				depths[i] = 1.0f;
+				normals[i * 3 + 2] = -1.0f;
+				continue;
+			}
+
+			depths[i] = projection[10] + projection[14] / nearest;
+			float side = hit->X * rayX + hit->Y * rayY + hit->Z > 0 ? -1.0f : 1.0f;
+			normals[i * 3 + 0] = hit->X * side;
+			normals[i * 3 + 1] = hit->Y * side;
+			normals[i * 3 + 2] = hit->Z * side;
+		}
+	}
+}
+
+static float Random01()
+{
+	return (float)rand() / RAND_MAX;
+}
+
+static void BuildSSAOKernel()
+{
+	srand(7);
+	for (int i = 0; i < ReferenceSamples; i++)
+	{
+		float* offset = kernel + i * 4;
+		offset[0] = Random01() * 2 - 1;
+		offset[1] = Random01() * 2 - 1;
+		offset[2] = Random01();
+		float length = sqrtf(offset[0] * offset[0] + offset[1] * offset[1] + offset[2] * offset[2]);
+		float scale = (float)(i % 64) / 64;
+		scale = 0.1f + 0.9f * scale * scale;
+		for (int c = 0; c < 3; c++)
+			offset[c] = offset[c] / length * scale;
+	}
+	for (int i = 0; i < 16; i++)
+	{
+		float angle = Random01() * 6.2831853f;
+		randomDirections[i * 2] = cosf(angle);
+		randomDirections[i * 2 + 1] = sinf(angle);
+	}
+}
+
+static void ViewPosition(float u, float v, float depth, float* position)
+{
+	float z = projection[14] / (depth - projection[10]);
+	position[0] = (u * 2 - 1) / projection[0] * z;
+	position[1] = (1 - v * 2) / projection[5] * z;
+	position[2] = z;
+}
+
+static float SSAO(int x, int y, int samples)
+{
+	size_t i = (size_t)y * Width + x;
+	if (depths[i] >= 1.0f)
+		return 1.0f;
+
+	float position[3];
+	ViewPosition((x + 0.5f) / Width, (y + 0.5f) / Height, depths[i], position);
+
+	// Tangent frame from the 4x4 random directions
+	const float* random = randomDirections + ((x % 4) + (y % 4) * 4) * 2;
+	const float* n = &normals[i * 3];
+	float along = random[0] * n[0] + random[1] * n[1];
+	float t[3] = { random[0] - n[0] * along, random[1] - n[1] * along, -n[2] * along };
+	float length = sqrtf(t[0] * t[0] + t[1] * t[1] + t[2] * t[2]);
+	for (float& c : t)
+		c /= length;
+	float b[3] = { t[1] * n[2] - t[2] * n[1], t[2] * n[0] - t[0] * n[2], t[0] * n[1] - t[1] * n[0] };
+
+	float ao = 0.0f;
+	for (int s = 0; s < samples; s++)
+	{
+		const float* o = kernel + s * 4;
+		float sample[3];
+		for (int c = 0; c < 3; c++)
+			sample[c] = position[c] + (o[0] * t[c] + o[1] * b[c] + o[2] * n[c]) * Radius;
+
+		float u = sample[0] * projection[0] / sample[2] * 0.5f + 0.5f;
+		float v = 0.5f - sample[1] * projection[5] / sample[2] * 0.5f;
+		int tx = std::min(std::max((int)(u * Width), 0), Width - 1);
+		int ty = std::min(std::max((int)(v * Height), 0), Height - 1);
+		float fetched[3];
+		ViewPosition((tx + 0.5f) / Width, (ty + 0.5f) / Height, depths[(size_t)ty * Width + tx], fetched);
+
+		float range = std::min(Radius / std::max(fabsf(position[2] - fetched[2]), 1e-9f), 1.0f);
+		range = range * range * (3 - 2 * range);
+		ao += fetched[2] < sample[2] ? range : 0.0f;
+	}
+	return 1.0f - ao / samples;
+}
+
+static float GTAOVisibility(int x, int y, int slices, int steps, float noiseOffset)
+{
+	static const GTAOProjection gtaoProjection = GTAO::FromProjection(projection);
+	return GTAO::Evaluate(depths.data(), normals.data(), Width, Height, x, y, gtaoProjection, Radius, slices, steps, noiseOffset).Visibility;
+}
+
+template <typename Method>
+static void Measure(const char* name, int fetches, const std::vector<float>& reference, Method method)
+{
+	std::vector<float> ao(Width * Height);
+	auto start = std::chrono::high_resolution_clock::now();
+	for (int y = 0; y < Height; y++)
+		for (int x = 0; x < Width; x++)
+			ao[(size_t)y * Width + x] = method(x, y);
+	std::chrono::duration<double, std::nano> elapsed = std::chrono::high_resolution_clock::now() - start;
+
+	double error = 0.0, squared = 0.0;
+	for (size_t i = 0; i < ao.size(); i++)
+	{
+		double difference = ao[i] - reference[i];
+		error += fabs(difference);
+		squared += difference * difference;
+	}
+	std::printf("  %-24s %3d fetches  %8.1f ns/px  mean |error| %.4f  rms %.4f\n", name, fetches,
+		elapsed.count() / ao.size(), error / ao.size(), sqrt(squared / ao.size()));
+}
+
+int main()
+{
+	BuildCorner();
+	BuildSSAOKernel();
+
+	std::vector<float> gtaoReference(Width * Height), ssaoReference(Width * Height);
+	for (int y = 0; y < Height; y++)
+	{
+		for (int x = 0; x < Width; x++)
+		{
+			float total = 0.0f;
+			for (int k = 0; k < 16; k++)
+				total += GTAOVisibility(x, y, GTAO::MaxSlices, GTAO::MaxSteps, k / 16.0f);
+			gtaoReference[(size_t)y * Width + x] = total / 16;
+			ssaoReference[(size_t)y * Width + x] = SSAO(x, y, ReferenceSamples);
+		}
+	}
+
+	std::printf("%dx%d corner scene, radius %.1f\n", Width, Height, Radius);
+	Measure("SSAO 64 samples", 64, ssaoReference, [](int x, int y) { return SSAO(x, y, 64); });
+	Measure("GTAO 4 slices x 8 steps", 64, gtaoReference, [](int x, int y) { return GTAOVisibility(x, y, 4, 8, 0.0f); });
+	Measure("SSAO 16 samples", 16, ssaoReference, [](int x, int y) { return SSAO(x, y, 16); });
+	Measure("GTAO 2 slices x 4 steps", 16, gtaoReference, [](int x, int y) { return GTAOVisibility(x, y, 2, 4, 0.0f); });
+	Measure("SSAO 8 samples", 8, ssaoReference, [](int x, int y) { return SSAO(x, y, 8); });
+	Measure("GTAO 1 slice x 4 steps", 8, gtaoReference, [](int x, int y) { return GTAOVisibility(x, y, 1, 4, 0.0f); });
+	return 0;
+}
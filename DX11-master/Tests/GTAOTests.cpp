@@ -0,0 +1,191 @@
+#include "GTAO.h"
+#include "Check.h"
+#include <cmath>
+#include <vector>
+
+// --------------------------------------------------------
+// Scenes of view space planes, ray cast into a post
+// projection depth buffer and view space normals the way
+// the G-buffer pass writes them
+// --------------------------------------------------------
+static const uint32_t Width = 320;
+static const uint32_t Height = 180;
+
+// A plane n.p + d = 0 in view space
+struct Plane
+{
+	float X, Y, Z, D;
+};
+
+struct Scene
+{
+	float Projection[16];
+	std::vector<float> Depths;
+	std::vector<float> Normals;
+
+	const float* Normal(uint32_t x, uint32_t y) const { return &Normals[((size_t)y * Width + x) * 3]; }
+
+	GTAOResult Evaluate(uint32_t x, uint32_t y, int slices, int steps) const
+	{
+		return GTAO::Evaluate(Depths.data(), Normals.data(), Width, Height, x, y,
+			GTAO::FromProjection(Projection), 1.0f, slices, steps, 0.0f);
+	}
+};
+
+static void Perspective(float fovY, float aspect, float nearZ, float farZ, float* m)
+{
+	float h = 1.0f / tanf(fovY * 0.5f);
+	float q = farZ / (farZ - nearZ);
+	const float projection[16] =
+	{
+		h / aspect, 0, 0, 0,
+		0, h, 0, 0,
+		0, 0, q, 1,
+		0, 0, -q * nearZ, 0,
+	};
+	for (int i = 0; i < 16; i++)
+		m[i] = projection[i];
+}
+
+static Scene Build(const std::vector<Plane>& planes)
+{
+	Scene scene;
+	Perspective(1.0f, 16.0f / 9.0f, 0.1f, 100.0f, scene.Projection);
+	scene.Depths.assign(Width * Height, 1.0f);
+	scene.Normals.assign(Width * Height * 3, 0.0f);
+	const float* projection = scene.Projection;
+	for (uint32_t y = 0; y < Height; y++)
+	{
+		for (uint32_t x = 0; x < Width; x++)
+		{
+			float rayX = ((x + 0.5f) / Width * 2 - 1) / projection[0];
+			float rayY = (1 - (y + 0.5f) / Height * 2) / projection[5];
+			float nearest = 1e30f;
+			const Plane* hit = 0;
+			for (const Plane& plane : planes)
+			{
+				float facing = plane.X * rayX + plane.Y * rayY + plane.Z;
+				float t = fabsf(facing) > 1e-6f ? -plane.D / facing : -1.0f;
+				if (t > 0 && t < nearest)
+				{
+					nearest = t;
+					hit = &plane;
+				}
+			}
+
+			size_t i = (size_t)y * Width + x;
+			scene.Normals[i * 3 + 2] = -1.0f;
+			if (!hit || nearest > 99.0f)
+				continue;
+
+			// Normals face the camera
+			scene.Depths[i] = projection[10] + projection[14] / nearest;
+			float side = hit->X * rayX + hit->Y * rayY + hit->Z > 0 ? -1.0f : 1.0f;
+			scene.Normals[i * 3 + 0] = hit->X * side;
+			scene.Normals[i * 3 + 1] = hit->Y * side;
+			scene.Normals[i * 3 + 2] = hit->Z * side;
+		}
+	}
+	return scene;
+}
+
+static float Dot(const float* a, const float* b)
+{
+	return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+// Depth to view depth and back, and the projection terms
+static void TestProjection()
+{
+	Scene scene = Build({});
+	GTAOProjection projection = GTAO::FromProjection(scene.Projection);
+	CHECK_NEAR(projection.ScaleX, 1.0f / scene.Projection[0], 1e-6f);
+	CHECK_NEAR(projection.ScaleY, 1.0f / scene.Projection[5], 1e-6f);
+
+	const float viewDepths[] = { 0.1f, 0.5f, 3.0f, 20.0f, 99.0f };
+	for (float z : viewDepths)
+	{
+		float depth = scene.Projection[10] + scene.Projection[14] / z;
+		CHECK_NEAR(GTAO::ViewDepth(projection, depth), z, z * 1e-3f);
+	}
+	CHECK_NEAR(GTAO::ViewDepth(projection, 0.0f), 0.1f, 1e-5f);
+}
+
+// Nothing occludes a plane: visibility near 1 and the bent
+// normal along the normal, facing the camera or tilted away
+static void TestPlanes()
+{
+	const Plane facing = { 0, 0, -1, 6.0f };
+	const Plane tilted = { 0, cosf(0.7f), -sinf(0.7f), 1.5f };
+	const Plane planes[] = { facing, tilted };
+	for (const Plane& plane : planes)
+	{
+		Scene scene = Build({ plane });
+		float lowest = 1.0f, worstBent = 1.0f;
+		int pixels = 0;
+		for (uint32_t y = 40; y < 140; y += 3)
+		{
+			for (uint32_t x = 60; x < 260; x += 3)
+			{
+				if (scene.Depths[(size_t)y * Width + x] >= 1.0f)
+					continue;
+				GTAOResult result = scene.Evaluate(x, y, 4, 8);
+				lowest = fminf(lowest, result.Visibility);
+				worstBent = fminf(worstBent, Dot(result.BentNormal, scene.Normal(x, y)));
+				pixels++;
+			}
+		}
+		CHECK(pixels > 1000);
+		CHECK(lowest > 0.95f);
+		CHECK(worstBent > 0.99f);
+	}
+}
+
+// Beside the floor and the left wall, each hides part of the
+// back wall's hemisphere; the open wall and floor are unoccluded
+static void TestCorner()
+{
+	// Floor at y = -1, back wall at z = 8, left wall at x = -2.5
+	Scene scene = Build({ { 0, 1, 0, 1.0f }, { 0, 0, -1, 8.0f }, { 1, 0, 0, 2.5f } });
+
+	// The back wall meets the floor at NDC y = -_22 / 8, and the
+	// left wall at NDC x = -2.5 * _11 / 8
+	uint32_t floorSeam = (uint32_t)((1.0f + scene.Projection[5] / 8.0f) * 0.5f * Height);
+	uint32_t wallSeam = (uint32_t)((1.0f - 2.5f * scene.Projection[0] / 8.0f) * 0.5f * Width);
+	uint32_t x = Width / 2, y = Height / 2;
+	CHECK(scene.Normal(x, floorSeam - 2)[2] < -0.99f);
+	CHECK(scene.Normal(x, floorSeam + 2)[1] > 0.99f);
+	CHECK(scene.Normal(wallSeam + 2, y)[2] < -0.99f);
+	CHECK(scene.Normal(wallSeam - 2, y)[0] > 0.99f);
+
+	GTAOResult aboveFloor = scene.Evaluate(x, floorSeam - 2, 4, 8);
+	GTAOResult besideWall = scene.Evaluate(wallSeam + 2, y, 4, 8);
+	CHECK(aboveFloor.Visibility < 0.9f);
+	CHECK(besideWall.Visibility < 0.9f);
+	CHECK(scene.Evaluate(x, y, 4, 8).Visibility > 0.95f);
+	CHECK(scene.Evaluate(x, Height - 5, 4, 8).Visibility > 0.95f);
+
+	// The bent normal leans away from the occluder
+	CHECK(aboveFloor.BentNormal[1] > 0.2f);
+	CHECK(besideWall.BentNormal[0] > 0.2f);
+	CHECK_NEAR(Dot(aboveFloor.BentNormal, aboveFloor.BentNormal), 1.0f, 1e-3f);
+}
+
+// Depth 1 is sky: unoccluded, whatever surrounds it
+static void TestSky()
+{
+	Scene scene = Build({ { 0, 1, 0, 1.0f } });
+	CHECK(scene.Depths[10 * Width + 10] == 1.0f);
+	GTAOResult sky = scene.Evaluate(10, 10, 4, 8);
+	CHECK(sky.Visibility == 1.0f);
+	CHECK(sky.BentNormal[2] == -1.0f);
+}
+
+int main()
+{
+	TestProjection();
+	TestPlanes();
+	TestCorner();
+	TestSky();
+	return CheckResult();
+}
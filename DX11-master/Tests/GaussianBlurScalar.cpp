@@ -0,0 +1,21 @@
+// Builds GaussianBlur.cpp a second time with the plain fallback,
+// under another name, so GaussianBlurTests can compare the two
+// builds in one executable
+#define GAUSSIAN_BLUR_SCALAR
+#define GaussianBlur ScalarGaussianBlur
+#include "GaussianBlur.cpp"
+
+void ScalarGaussianBlurPass(const float* source, uint32_t width, uint32_t height, int radius, bool horizontal, float* destination)
+{
+	std::vector<GaussianTap> taps;
+	ScalarGaussianBlur::Taps(radius, taps);
+	if (horizontal)
+		ScalarGaussianBlur::BlurHorizontal(source, width, height, taps, destination);
+	else
+		ScalarGaussianBlur::BlurVertical(source, width, height, taps, destination);
+}
+
+void ScalarGaussianBlurBlur(const float* source, uint32_t width, uint32_t height, int radius, float* destination)
+{
+	ScalarGaussianBlur::Blur(source, width, height, radius, destination);
+}
@@ -0,0 +1,152 @@
+#include "GaussianBlur.h"
+#include "Check.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+
+// The GAUSSIAN_BLUR_SCALAR build, from GaussianBlurScalar.cpp
+void ScalarGaussianBlurPass(const float* source, uint32_t width, uint32_t height, int radius, bool horizontal, float* destination);
+void ScalarGaussianBlurBlur(const float* source, uint32_t width, uint32_t height, int radius, float* destination);
+
+// Odd sizes so the clamped edges and every tap position get used
+static const uint32_t Width = 61;
+static const uint32_t Height = 37;
+
+static std::vector<float> RandomImage()
+{
+	std::mt19937 random(3);
+	std::vector<float> image(Width * Height * 4);
+	for (float& value : image)
+		value = (random() % 256) / 255.0f;
+	return image;
+}
+
+// The blur as written: every texel of the truncated Gaussian,
+// one pass then the other, clamped at the edges
+static void DirectConvolution(const float* source, int width, int height, int radius, float* destination)
+{
+	std::vector<float> weights;
+	GaussianBlur::Weights(radius, weights);
+
+	std::vector<float> horizontal((size_t)width * height * 4);
+	for (int y = 0; y < height; y++)
+		for (int x = 0; x < width; x++)
+			for (int c = 0; c < 4; c++)
+			{
+				float total = 0.0f;
+				for (int k = -radius; k <= radius; k++)
+				{
+					int sx = x + k < 0 ? 0 : (x + k > width - 1 ? width - 1 : x + k);
+					total += source[((size_t)y * width + sx) * 4 + c] * weights[abs(k)];
+				}
+				horizontal[((size_t)y * width + x) * 4 + c] = total;
+			}
+
+	for (int y = 0; y < height; y++)
+		for (int x = 0; x < width; x++)
+			for (int c = 0; c < 4; c++)
+			{
+				float total = 0.0f;
+				for (int k = -radius; k <= radius; k++)
+				{
+					int sy = y + k < 0 ? 0 : (y + k > height - 1 ? height - 1 : y + k);
+					total += horizontal[((size_t)sy * width + x) * 4 + c] * weights[abs(k)];
+				}
+				destination[((size_t)y * width + x) * 4 + c] = total;
+			}
+}
+
+static int EightBitSteps(float a, float b)
+{
+	return abs((int)lrintf(a * 255.0f) - (int)lrintf(b * 255.0f));
+}
+
+static void TestTaps()
+{
+	for (int radius = 0; radius <= GaussianBlur::MaxRadius; radius++)
+	{
+		std::vector<GaussianTap> taps;
+		GaussianBlur::Taps(radius, taps);
+		CHECK((int)taps.size() == 1 + (radius + 1) / 2 && (int)taps.size() <= GaussianBlur::MaxTaps);
+
+		float total = taps[0].Weight;
+		for (size_t i = 1; i < taps.size(); i++)
+		{
+			total += 2.0f * taps[i].Weight;
+			CHECK(taps[i].Offset >= 2 * i - 1 && taps[i].Offset <= 2 * i);
+		}
+		CHECK_NEAR(total, 1.0f, 1e-5f);
+	}
+
+	int levelRadius;
+	CHECK(GaussianBlur::PyramidLevels(8, levelRadius) == 0 && levelRadius == 8);
+	CHECK(GaussianBlur::PyramidLevels(9, levelRadius) == 1 && levelRadius == 5);
+	CHECK(GaussianBlur::PyramidLevels(32, levelRadius) == 2 && levelRadius == 8);
+}
+
+// The SSE2 build does the same float operations in the same order
+// as the scalar one, so both passes must match bit for bit
+static void TestSimdMatchesScalar()
+{
+	std::vector<float> source = RandomImage();
+	std::vector<float> simd(source.size()), scalar(source.size());
+	for (int radius = 0; radius <= GaussianBlur::MaxRadius; radius++)
+	{
+		std::vector<GaussianTap> taps;
+		GaussianBlur::Taps(radius, taps);
+
+		GaussianBlur::BlurHorizontal(source.data(), Width, Height, taps, simd.data());
+		ScalarGaussianBlurPass(source.data(), Width, Height, radius, true, scalar.data());
+		CHECK(memcmp(simd.data(), scalar.data(), simd.size() * sizeof(float)) == 0);
+
+		GaussianBlur::BlurVertical(source.data(), Width, Height, taps, simd.data());
+		ScalarGaussianBlurPass(source.data(), Width, Height, radius, false, scalar.data());
+		CHECK(memcmp(simd.data(), scalar.data(), simd.size() * sizeof(float)) == 0);
+
+		GaussianBlur::Blur(source.data(), Width, Height, radius, simd.data());
+		ScalarGaussianBlurBlur(source.data(), Width, Height, radius, scalar.data());
+		CHECK(memcmp(simd.data(), scalar.data(), simd.size() * sizeof(float)) == 0);
+	}
+}
+
+// Merging texel pairs into bilinear fetches, with the fraction
+// rounded to 8 bits, stays within one 8-bit step of the direct
+// convolution at every radius
+static void TestMatchesDirectConvolution()
+{
+	std::vector<float> source = RandomImage();
+	std::vector<float> blurred(source.size()), direct(source.size());
+	for (int radius = 0; radius <= GaussianBlur::MaxRadius; radius++)
+	{
+		ScalarGaussianBlurBlur(source.data(), Width, Height, radius, blurred.data());
+		DirectConvolution(source.data(), Width, Height, radius, direct.data());
+
+		int steps = 0;
+		for (size_t i = 0; i < blurred.size(); i++)
+			steps = std::max(steps, EightBitSteps(blurred[i], direct[i]));
+		CHECK(steps <= 1);
+	}
+
+	// Radius 0 is a copy
+	ScalarGaussianBlurBlur(source.data(), Width, Height, 0, blurred.data());
+	CHECK(blurred == source);
+}
+
+static void TestConstantImage()
+{
+	std::vector<float> constant(Width * Height * 4, 0.5f), blurred(constant.size());
+	GaussianBlur::Blur(constant.data(), Width, Height, 10, blurred.data());
+	for (float value : blurred)
+		CHECK_NEAR(value, 0.5f, 1e-5f);
+}
+
+int main()
+{
+	TestTaps();
+	TestSimdMatchesScalar();
+	TestMatchesDirectConvolution();
+	TestConstantImage();
+	return CheckResult();
+}
@@ -0,0 +1,84 @@
+#include "InstanceBatcher.h"
+#include "Check.h"
+
+static void AddDraw(InstanceBatcher& batcher, unsigned int mesh, unsigned int material, float tag, unsigned int userIndex)
+{
+	float world[16] = {};
+	float worldInverseTranspose[16] = {};
+	world[0] = tag;
+	worldInverseTranspose[0] = -tag;
+	batcher.Add(mesh, material, world, worldInverseTranspose, userIndex);
+}
+
+// Groups come out in the order their first draw went in, each a
+// contiguous range, with draws in their original order inside it
+static void TestGroupsInFirstSeenOrder()
+{
+	InstanceBatcher batcher;
+	unsigned int meshes[] = { 1, 2, 1, 3, 2, 1 };
+	unsigned int materials[] = { 5, 5, 5, 5, 5, 6 };
+	for (unsigned int i = 0; i < 6; i++)
+		AddDraw(batcher, meshes[i], materials[i], (float)i, i);
+	batcher.Build();
+
+	const std::vector<InstanceBatch>& batches = batcher.GetBatches();
+	CHECK(batches.size() == 4);
+	CHECK(batches[0].MeshID == 1 && batches[0].MaterialID == 5);
+	CHECK(batches[0].FirstInstance == 0 && batches[0].InstanceCount == 2);
+	CHECK(batches[1].MeshID == 2 && batches[1].MaterialID == 5);
+	CHECK(batches[1].FirstInstance == 2 && batches[1].InstanceCount == 2);
+	CHECK(batches[2].MeshID == 3 && batches[2].FirstInstance == 4 && batches[2].InstanceCount == 1);
+	CHECK(batches[3].MeshID == 1 && batches[3].MaterialID == 6);
+	CHECK(batches[3].FirstInstance == 5 && batches[3].InstanceCount == 1);
+
+	unsigned int expectedOrder[] = { 0, 2, 1, 4, 3, 5 };
+	const std::vector<InstanceData>& instances = batcher.GetInstances();
+	const std::vector<unsigned int>& userIndices = batcher.GetUserIndices();
+	CHECK(instances.size() == 6 && userIndices.size() == 6);
+	for (unsigned int i = 0; i < 6; i++)
+	{
+		CHECK(userIndices[i] == expectedOrder[i]);
+		CHECK(instances[i].World[0] == (float)expectedOrder[i]);
+		CHECK(instances[i].WorldInverseTranspose[0] == -(float)expectedOrder[i]);
+	}
+}
+
+// Mesh and material IDs are both 32 bits; neither may leak into the other
+static void TestKeysDontCollide()
+{
+	InstanceBatcher batcher;
+	AddDraw(batcher, 1, 0, 0, 0);
+	AddDraw(batcher, 0, 1, 1, 1);
+	AddDraw(batcher, 0xFFFFFFFF, 1, 2, 2);
+	AddDraw(batcher, 1, 0xFFFFFFFF, 3, 3);
+	batcher.Build();
+	CHECK(batcher.GetBatches().size() == 4);
+}
+
+static void TestClearStartsOver()
+{
+	InstanceBatcher batcher;
+	AddDraw(batcher, 1, 1, 0, 0);
+	AddDraw(batcher, 1, 1, 1, 1);
+	batcher.Build();
+	CHECK(batcher.GetBatches().size() == 1);
+
+	batcher.Clear();
+	batcher.Build();
+	CHECK(batcher.GetBatches().empty());
+	CHECK(batcher.GetInstances().empty());
+
+	AddDraw(batcher, 1, 1, 7, 9);
+	batcher.Build();
+	CHECK(batcher.GetBatches().size() == 1);
+	CHECK(batcher.GetBatches()[0].InstanceCount == 1);
+	CHECK(batcher.GetUserIndices()[0] == 9);
+}
+
+int main()
+{
+	TestGroupsInFirstSeenOrder();
+	TestKeysDontCollide();
+	TestClearStartsOver();
+	return CheckResult();
+}
@@ -0,0 +1,287 @@
+#include "PipelineState.h"
+#include "StateTracker.h"
+#include "Check.h"
+#include <cstring>
+#include <memory>
+#include <vector>
+
+// --------------------------------------------------------
+// A recording mock device: it logs every state object it is
+// asked to create and, like Direct3D, hands back the same
+// object for a description it has already seen.
+// --------------------------------------------------------
+template <typename Interface, typename Desc>
+struct MockStateObject : Interface
+{
+	Desc desc;
+	unsigned long references = 1;
+	unsigned long AddRef() override { return ++references; }
+	unsigned long Release() override { return --references; }
+};
+
+template <typename Interface, typename Desc>
+struct MockStateObjects
+{
+	std::vector<std::unique_ptr<MockStateObject<Interface, Desc>>> objects;
+	unsigned int createCalls = 0;
+
+	Interface* Create(const Desc* desc)
+	{
+		createCalls++;
+		for (auto& object : objects)
+			if (memcmp(&object->desc, desc, sizeof(Desc)) == 0)
+			{
+				object->AddRef();
+				return object.get();
+			}
+
+		objects.emplace_back(new MockStateObject<Interface, Desc>());
+		objects.back()->desc = *desc;
+		objects.back()->AddRef();
+		return objects.back().get();
+	}
+};
+
+struct MockDevice : ID3D11Device
+{
+	MockStateObjects<ID3D11RasterizerState, D3D11_RASTERIZER_DESC> rasterizers;
+	MockStateObjects<ID3D11DepthStencilState, D3D11_DEPTH_STENCIL_DESC> depthStencils;
+	MockStateObjects<ID3D11BlendState, D3D11_BLEND_DESC> blends;
+
+	unsigned long AddRef() override { return 1; }
+	unsigned long Release() override { return 1; }
+
+	HRESULT CreateRasterizerState(const D3D11_RASTERIZER_DESC* desc, ID3D11RasterizerState** state) override
+	{
+		*state = rasterizers.Create(desc);
+		return S_OK;
+	}
+
+	HRESULT CreateDepthStencilState(const D3D11_DEPTH_STENCIL_DESC* desc, ID3D11DepthStencilState** state) override
+	{
+		*state = depthStencils.Create(desc);
+		return S_OK;
+	}
+
+	HRESULT CreateBlendState(const D3D11_BLEND_DESC* desc, ID3D11BlendState** state) override
+	{
+		*state = blends.Create(desc);
+		return S_OK;
+	}
+};
+
+// Shaders are only compared by address, never called
+static char vertexShaderA, vertexShaderB, pixelShaderA;
+static SimpleVertexShader* VertexShaderA() { return reinterpret_cast<SimpleVertexShader*>(&vertexShaderA); }
+static SimpleVertexShader* VertexShaderB() { return reinterpret_cast<SimpleVertexShader*>(&vertexShaderB); }
+static SimplePixelShader* PixelShaderA() { return reinterpret_cast<SimplePixelShader*>(&pixelShaderA); }
+
+static PipelineStateDesc SceneDesc()
+{
+	PipelineStateDesc desc;
+	desc.VertexShader = VertexShaderA();
+	desc.PixelShader = PixelShaderA();
+	return desc;
+}
+
+// Equal descriptions share one PSO, and the device only sees
+// creation calls for descriptions the cache hasn't met
+static void TestCacheDeduplicates()
+{
+	MockDevice device;
+	PipelineStateCache cache(&device);
+
+	const PipelineState* first = cache.Get(SceneDesc());
+	const PipelineState* second = cache.Get(SceneDesc());
+	CHECK(first == second);
+	CHECK(cache.Size() == 1);
+	CHECK(device.rasterizers.createCalls == 1);
+	CHECK(device.depthStencils.createCalls == 1);
+	CHECK(device.blends.createCalls == 1);
+
+	PipelineStateDesc wireframe = SceneDesc();
+	wireframe.Rasterizer.FillMode = D3D11_FILL_WIREFRAME;
+	const PipelineState* third = cache.Get(wireframe);
+	CHECK(third != first && cache.Size() == 2);
+	CHECK(third->GetID() == 1);
+	CHECK(device.rasterizers.objects.size() == 2);
+
+	// Unchanged pieces come back as the device's shared objects
+	CHECK(third->GetDepthStencilState() == first->GetDepthStencilState());
+	CHECK(third->GetBlendState() == first->GetBlendState());
+	CHECK(device.depthStencils.objects.size() == 1);
+
+	cache.Clear();
+	CHECK(cache.Size() == 0);
+	cache.Get(SceneDesc());
+	CHECK(device.rasterizers.createCalls == 3);
+}
+
+// The defaults match Direct3D's own
+static void TestDefaults()
+{
+	PipelineStateDesc desc;
+	CHECK(desc.VertexShader == 0 && desc.PixelShader == 0);
+	CHECK(desc.Rasterizer.FillMode == D3D11_FILL_SOLID && desc.Rasterizer.CullMode == D3D11_CULL_BACK);
+	CHECK(desc.Rasterizer.DepthClipEnable);
+	CHECK(desc.DepthStencil.DepthEnable && desc.DepthStencil.DepthFunc == D3D11_COMPARISON_LESS);
+	CHECK(desc.DepthStencil.DepthWriteMask == D3D11_DEPTH_WRITE_MASK_ALL);
+	CHECK(!desc.Blend.RenderTarget[0].BlendEnable);
+	CHECK(desc.Blend.RenderTarget[7].RenderTargetWriteMask == D3D11_COLOR_WRITE_ENABLE_ALL);
+	CHECK(desc.Topology == D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+}
+
+static void TestChangedParts()
+{
+	MockDevice device;
+	PipelineStateCache cache(&device);
+	const PipelineState* scene = cache.Get(SceneDesc());
+	CHECK(scene->GetChangedParts(0) == PIPELINE_PART_ALL);
+	CHECK(scene->GetChangedParts(scene) == 0);
+
+	PipelineStateDesc depthOnly = SceneDesc();
+	depthOnly.PixelShader = 0;
+	CHECK(cache.Get(depthOnly)->GetChangedParts(scene) == PIPELINE_PART_PIXEL_SHADER);
+
+	PipelineStateDesc otherShader = SceneDesc();
+	otherShader.VertexShader = VertexShaderB();
+	CHECK(cache.Get(otherShader)->GetChangedParts(scene) == PIPELINE_PART_VERTEX_SHADER);
+
+	PipelineStateDesc sky = SceneDesc();
+	sky.Rasterizer.CullMode = D3D11_CULL_FRONT;
+	sky.DepthStencil.DepthFunc = D3D11_COMPARISON_LESS_EQUAL;
+	CHECK(cache.Get(sky)->GetChangedParts(scene) == (PIPELINE_PART_RASTERIZER | PIPELINE_PART_DEPTH_STENCIL));
+
+	PipelineStateDesc blended = SceneDesc();
+	blended.Blend.RenderTarget[0].BlendEnable = true;
+	blended.Topology = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP;
+	CHECK(cache.Get(blended)->GetChangedParts(scene) == (PIPELINE_PART_BLEND | PIPELINE_PART_TOPOLOGY));
+}
+
+// --------------------------------------------------------
+// A recording mock context.  Every bind StateTracker issues,
+// including the shader binds it routes through its callbacks,
+// lands in one log, in order.
+// --------------------------------------------------------
+struct ContextCall
+{
+	const char* Name;
+	const void* Value;
+};
+
+struct MockContext : ID3D11DeviceContext
+{
+	std::vector<ContextCall> calls;
+
+	unsigned long AddRef() override { return 1; }
+	unsigned long Release() override { return 1; }
+
+	void PSSetShader(ID3D11PixelShader* shader, ID3D11ClassInstance* const*, UINT) override { calls.push_back({ "PSSetShader", shader }); }
+	void RSSetState(ID3D11RasterizerState* state) override { calls.push_back({ "RSSetState", state }); }
+	void OMSetDepthStencilState(ID3D11DepthStencilState* state, UINT) override { calls.push_back({ "OMSetDepthStencilState", state }); }
+	void OMSetBlendState(ID3D11BlendState* state, const FLOAT*, UINT) override { calls.push_back({ "OMSetBlendState", state }); }
+	void IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology) override
+	{
+		calls.push_back({ "IASetPrimitiveTopology", reinterpret_cast<const void*>((size_t)topology) });
+	}
+};
+
+static StateTracker MakeTracker(MockContext& context)
+{
+	return StateTracker(&context,
+		[&context](SimpleVertexShader* shader) { context.calls.push_back({ "VertexShader", shader }); },
+		[&context](SimplePixelShader* shader) { context.calls.push_back({ "PixelShader", shader }); });
+}
+
+static bool Called(const MockContext& context, size_t index, const char* name, const void* value)
+{
+	return index < context.calls.size() && strcmp(context.calls[index].Name, name) == 0 && context.calls[index].Value == value;
+}
+
+// A frame's worth of binds through the real tracker: only the
+// pieces that differ from the previous PSO reach the context
+static void TestTrackerIssuesOnlyDifferences()
+{
+	MockDevice device;
+	MockContext context;
+	PipelineStateCache cache(&device);
+	StateTracker tracker = MakeTracker(context);
+
+	PipelineStateDesc shadowDesc = SceneDesc();
+	shadowDesc.VertexShader = VertexShaderB();
+	shadowDesc.PixelShader = 0;
+	shadowDesc.Rasterizer.DepthBias = 1000;
+	PipelineStateDesc skyDesc = SceneDesc();
+	skyDesc.Rasterizer.CullMode = D3D11_CULL_FRONT;
+	skyDesc.DepthStencil.DepthFunc = D3D11_COMPARISON_LESS_EQUAL;
+
+	const PipelineState* shadow = cache.Get(shadowDesc);
+	const PipelineState* scene = cache.Get(SceneDesc());
+	const PipelineState* sky = cache.Get(skyDesc);
+	const void* triangleList = reinterpret_cast<const void*>((size_t)D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+	// First bind: everything, in part order, with the pixel shader unbound
+	tracker.SetPipelineState(shadow);
+	CHECK(context.calls.size() == 6);
+	CHECK(Called(context, 0, "VertexShader", VertexShaderB()));
+	CHECK(Called(context, 1, "PSSetShader", 0));
+	CHECK(Called(context, 2, "RSSetState", shadow->GetRasterizerState()));
+	CHECK(Called(context, 3, "OMSetDepthStencilState", shadow->GetDepthStencilState()));
+	CHECK(Called(context, 4, "OMSetBlendState", shadow->GetBlendState()));
+	CHECK(Called(context, 5, "IASetPrimitiveTopology", triangleList));
+	CHECK(tracker.GetCallsIssued() == 6 && tracker.GetCallsSkipped() == 0);
+
+	// Rebinding the same PSO issues nothing
+	tracker.SetPipelineState(shadow);
+	tracker.SetPipelineState(shadow);
+	CHECK(context.calls.size() == 6);
+	CHECK(tracker.GetCallsSkipped() == 12);
+
+	// Shadow to scene: both shaders and the rasterizer
+	context.calls.clear();
+	tracker.SetPipelineState(scene);
+	tracker.SetPipelineState(scene);
+	CHECK(context.calls.size() == 3);
+	CHECK(Called(context, 0, "VertexShader", VertexShaderA()));
+	CHECK(Called(context, 1, "PixelShader", PixelShaderA()));
+	CHECK(Called(context, 2, "RSSetState", scene->GetRasterizerState()));
+
+	// Scene to sky and back: the rasterizer and depth-stencil state each way
+	context.calls.clear();
+	tracker.SetPipelineState(sky);
+	CHECK(context.calls.size() == 2);
+	CHECK(Called(context, 0, "RSSetState", sky->GetRasterizerState()));
+	CHECK(Called(context, 1, "OMSetDepthStencilState", sky->GetDepthStencilState()));
+	tracker.SetPipelineState(scene);
+	CHECK(context.calls.size() == 4);
+	CHECK(Called(context, 2, "RSSetState", scene->GetRasterizerState()));
+	CHECK(Called(context, 3, "OMSetDepthStencilState", scene->GetDepthStencilState()));
+	CHECK(tracker.GetPipelineState() == scene);
+
+	// 7 binds: 6 + 3 + 2 + 2 issued out of 42
+	CHECK(tracker.GetCallsIssued() == 13 && tracker.GetCallsSkipped() == 29);
+
+	// After Invalidate() nothing is assumed bound, so even the
+	// same PSO is bound in full
+	context.calls.clear();
+	tracker.Invalidate();
+	CHECK(tracker.GetPipelineState() == 0);
+	tracker.SetPipelineState(scene);
+	CHECK(context.calls.size() == 6);
+	CHECK(Called(context, 1, "PixelShader", PixelShaderA()));
+
+	tracker.ResetStats();
+	CHECK(tracker.GetCallsIssued() == 0 && tracker.GetCallsSkipped() == 0);
+	tracker.SetPipelineState(scene);
+	CHECK(tracker.GetCallsIssued() == 0 && tracker.GetCallsSkipped() == 6);
+	CHECK(cache.Size() == 3);
+}
+
+int main()
+{
+	TestCacheDeduplicates();
+	TestDefaults();
+	TestChangedParts();
+	TestTrackerIssuesOnlyDifferences();
+	return CheckResult();
+}
@@ -0,0 +1,215 @@
+#include "RenderGraph.h"
+#include "Check.h"
+#include <string>
+
+// --------------------------------------------------------
+// The renderer's frame in miniature: shadows into an imported
+// map, a G-buffer pass, SSAO and its blur, a combine and an
+// optional post pass.  Each pass appends a letter to ran.
+// --------------------------------------------------------
+static std::string ran;
+
+struct FrameResources
+{
+	RenderGraphResource Shadows, Depth;
+	RenderGraphResource Color, Ambient, Normals, Depths, SSAO, BlurredSSAO, Combined, Post;
+};
+
+static FrameResources BuildFrame(RenderGraph& graph, bool post)
+{
+	graph.Reset();
+	ran.clear();
+	RenderGraphTextureDesc color = { 800, 600, 28 };
+	RenderGraphTextureDesc depth = { 800, 600, 41 };
+
+	FrameResources r;
+	r.Shadows = graph.ImportTexture("Shadows");
+	r.Depth = graph.ImportTexture("Depth");
+	r.Color = graph.CreateTexture("Color", color);
+	r.Ambient = graph.CreateTexture("Ambient", color);
+	r.Normals = graph.CreateTexture("Normals", color);
+	r.Depths = graph.CreateTexture("Depths", depth);
+	r.SSAO = graph.CreateTexture("SSAO", color);
+	r.BlurredSSAO = graph.CreateTexture("Blurred SSAO", color);
+	r.Combined = graph.CreateTexture("Combined", color);
+	r.Post = graph.CreateTexture("Post", color);
+
+	RenderGraphPass pass = graph.AddPass("Shadows", [] { ran += "S"; });
+	graph.Write(pass, r.Shadows, RENDER_GRAPH_WRITE);
+
+	pass = graph.AddPass("GBuffer", [] { ran += "G"; });
+	graph.Write(pass, r.Color, RENDER_GRAPH_RENDER_TARGET, true);
+	graph.Write(pass, r.Ambient, RENDER_GRAPH_RENDER_TARGET, true);
+	graph.Write(pass, r.Normals, RENDER_GRAPH_RENDER_TARGET, true);
+	graph.Write(pass, r.Depths, RENDER_GRAPH_RENDER_TARGET, true);
+	graph.Write(pass, r.Depth, RENDER_GRAPH_DEPTH_STENCIL);
+	graph.Read(pass, r.Shadows);
+
+	pass = graph.AddPass("SSAO", [] { ran += "A"; });
+	graph.Read(pass, r.Normals);
+	graph.Read(pass, r.Depths);
+	graph.Write(pass, r.SSAO, RENDER_GRAPH_RENDER_TARGET);
+
+	pass = graph.AddPass("Blur", [] { ran += "B"; });
+	graph.Read(pass, r.SSAO);
+	graph.Write(pass, r.BlurredSSAO, RENDER_GRAPH_RENDER_TARGET);
+
+	pass = graph.AddPass("Combine", [] { ran += "C"; });
+	graph.Read(pass, r.Color);
+	graph.Read(pass, r.Ambient);
+	graph.Read(pass, r.BlurredSSAO);
+	graph.Write(pass, r.Combined, RENDER_GRAPH_RENDER_TARGET);
+
+	pass = graph.AddPass("Post", [] { ran += "P"; });
+	graph.Read(pass, r.Combined);
+	graph.Write(pass, r.Post, RENDER_GRAPH_RENDER_TARGET);
+
+	graph.SetOutput(post ? r.Post : r.Combined);
+	return r;
+}
+
+static void Run(const RenderGraph& graph)
+{
+	for (const RenderGraphCompiledPass& compiled : graph.GetSchedule())
+		graph.ExecutePass(compiled.Pass);
+}
+
+// Passes run in declaration order with their targets in order
+static void TestSchedule()
+{
+	RenderGraph graph;
+	FrameResources r = BuildFrame(graph, true);
+	CHECK(graph.Compile());
+	Run(graph);
+	CHECK(ran == "SGABCP");
+	CHECK(graph.GetCulledPassCount() == 0);
+
+	const std::vector<RenderGraphCompiledPass>& schedule = graph.GetSchedule();
+	CHECK(schedule.size() == 6);
+	CHECK(schedule[0].RenderTargets.empty() && schedule[0].DepthStencil == RenderGraph::NoResource);
+	CHECK(schedule[1].RenderTargets.size() == 4 && schedule[1].RenderTargets[0] == r.Color && schedule[1].RenderTargets[3] == r.Depths);
+	CHECK(schedule[1].DepthStencil == r.Depth);
+	CHECK(schedule[1].Clears.size() == 4);
+	CHECK(schedule[2].Clears.empty());
+}
+
+// Without post, its pass and texture drop out; the shadow pass
+// only writes an imported map but is kept all the same
+static void TestCulling()
+{
+	RenderGraph graph;
+	FrameResources r = BuildFrame(graph, false);
+	CHECK(graph.Compile());
+	Run(graph);
+	CHECK(ran == "SGABC");
+	CHECK(graph.GetCulledPassCount() == 1 && graph.IsCulled(5) && !graph.IsCulled(0));
+	CHECK(graph.GetPhysical(r.Post) == RenderGraph::NoPhysical);
+	CHECK(!graph.IsPhysicalTransient(graph.GetPhysical(r.Combined)));
+
+	// A write without clear builds on the earlier writer, so that
+	// writer stays; a clearing write makes it dead
+	RenderGraphResource target = RenderGraph::NoResource;
+	for (int clear = 0; clear < 2; clear++)
+	{
+		graph.Reset();
+		target = graph.CreateTexture("Target", { 1, 1, 1 });
+		RenderGraphPass first = graph.AddPass("First", [] {});
+		graph.Write(first, target, RENDER_GRAPH_RENDER_TARGET);
+		RenderGraphPass second = graph.AddPass("Second", [] {});
+		graph.Write(second, target, RENDER_GRAPH_RENDER_TARGET, clear == 1);
+		graph.SetOutput(target);
+		CHECK(graph.Compile());
+		CHECK(graph.IsCulled(first) == (clear == 1) && !graph.IsCulled(second));
+	}
+}
+
+// Transients whose lifetimes don't overlap share a texture when
+// their descriptions match; imports and the output never do
+static void TestAliasing()
+{
+	RenderGraph graph;
+	FrameResources r = BuildFrame(graph, true);
+	CHECK(graph.Compile());
+	CHECK(graph.GetTransientCount() == 7 && graph.GetTransientPhysicalCount() == 5);
+	CHECK(graph.GetPhysical(r.BlurredSSAO) == graph.GetPhysical(r.Normals));
+	CHECK(graph.GetPhysical(r.Combined) == graph.GetPhysical(r.SSAO));
+	CHECK(!graph.IsPhysicalTransient(graph.GetPhysical(r.Post)));
+	CHECK(!graph.IsPhysicalTransient(graph.GetPhysical(r.Shadows)));
+	CHECK(graph.GetPhysical(r.Shadows) != graph.GetPhysical(r.Depth));
+
+	// Depths never shares: its format differs from every other texture
+	for (RenderGraphResource other = 0; other < graph.GetResourceCount(); other++)
+		CHECK(other == r.Depths || graph.GetPhysical(other) != graph.GetPhysical(r.Depths));
+
+	// Color lives until the combine, so nothing created after it can
+	// have taken its texture
+	for (RenderGraphResource other = r.Ambient; other < graph.GetResourceCount(); other++)
+		CHECK(graph.GetPhysical(other) != graph.GetPhysical(r.Color));
+
+	for (uint32_t physical = 0; physical < graph.GetPhysicalCount(); physical++)
+		if (graph.IsPhysicalTransient(physical))
+			CHECK(graph.GetPhysicalDesc(physical).Width == 800);
+}
+
+// A pass writing a texture an earlier pass sampled must unbind it
+static void TestHazards()
+{
+	RenderGraph graph;
+	FrameResources r = BuildFrame(graph, true);
+	CHECK(graph.Compile());
+
+	const std::vector<RenderGraphCompiledPass>& schedule = graph.GetSchedule();
+	CHECK(schedule[1].Unbinds.empty() && schedule[2].Unbinds.empty());
+	CHECK(schedule[3].Unbinds.size() == 1 && schedule[3].Unbinds[0] == graph.GetPhysical(r.Normals));
+	CHECK(schedule[4].Unbinds.size() == 1 && schedule[4].Unbinds[0] == graph.GetPhysical(r.SSAO));
+	CHECK(schedule[5].Unbinds.empty());
+}
+
+static void TestErrors()
+{
+	RenderGraph graph;
+	graph.Reset();
+	RenderGraphResource output = graph.CreateTexture("Output", { 1, 1, 1 });
+	RenderGraphResource unwritten = graph.CreateTexture("Unwritten", { 1, 1, 1 });
+	RenderGraphPass pass = graph.AddPass("Pass", [] {});
+	graph.Read(pass, unwritten);
+	graph.Write(pass, output, RENDER_GRAPH_RENDER_TARGET);
+	graph.SetOutput(output);
+	CHECK(!graph.Compile());
+	CHECK(graph.GetError() == "Pass reads Unwritten before anything writes it");
+
+	graph.Reset();
+	output = graph.CreateTexture("Output", { 1, 1, 1 });
+	pass = graph.AddPass("Pass", [] {});
+	graph.Read(pass, output);
+	graph.Write(pass, output, RENDER_GRAPH_RENDER_TARGET);
+	graph.SetOutput(output);
+	CHECK(!graph.Compile());
+	CHECK(graph.GetError() == "Pass reads and writes Output");
+
+	graph.Reset();
+	output = graph.CreateTexture("Output", { 1, 1, 1 });
+	graph.AddPass("Pass", [] {});
+	graph.SetOutput(output);
+	CHECK(!graph.Compile());
+	CHECK(graph.GetError() == "Nothing writes the output, Output");
+
+	graph.Reset();
+	graph.AddPass("Pass", [] {});
+	CHECK(!graph.Compile());
+	CHECK(graph.GetError() == "The graph has no output");
+
+	// A good compile clears the last error
+	BuildFrame(graph, true);
+	CHECK(graph.Compile() && graph.GetError().empty());
+}
+
+int main()
+{
+	TestSchedule();
+	TestCulling();
+	TestAliasing();
+	TestHazards();
+	TestErrors();
+	return CheckResult();
+}
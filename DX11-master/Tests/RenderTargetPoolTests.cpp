@@ -0,0 +1,191 @@
+#include "RenderTargetPool.h"
+#include "Check.h"
+#include <memory>
+#include <vector>
+
+// --------------------------------------------------------
+// A mock device that keeps every texture and view it makes,
+// with its reference count, so the tests can see what the
+// pool created and what it let go of
+// --------------------------------------------------------
+template <typename Interface>
+struct MockObject : Interface
+{
+	unsigned long references = 1;
+	unsigned long AddRef() override { return ++references; }
+	unsigned long Release() override { return --references; }
+};
+
+struct MockTexture : MockObject<ID3D11Texture2D>
+{
+	D3D11_TEXTURE2D_DESC desc;
+};
+
+struct MockDevice : ID3D11Device
+{
+	std::vector<std::unique_ptr<MockTexture>> textures;
+	std::vector<std::unique_ptr<MockObject<ID3D11RenderTargetView>>> rtvs;
+	std::vector<std::unique_ptr<MockObject<ID3D11ShaderResourceView>>> srvs;
+
+	unsigned long AddRef() override { return 1; }
+	unsigned long Release() override { return 1; }
+
+	HRESULT CreateRasterizerState(const D3D11_RASTERIZER_DESC*, ID3D11RasterizerState**) override { return E_NOTIMPL; }
+	HRESULT CreateDepthStencilState(const D3D11_DEPTH_STENCIL_DESC*, ID3D11DepthStencilState**) override { return E_NOTIMPL; }
+	HRESULT CreateBlendState(const D3D11_BLEND_DESC*, ID3D11BlendState**) override { return E_NOTIMPL; }
+
+	HRESULT CreateTexture2D(const D3D11_TEXTURE2D_DESC* desc, const D3D11_SUBRESOURCE_DATA*, ID3D11Texture2D** texture) override
+	{
+		textures.emplace_back(new MockTexture());
+		textures.back()->desc = *desc;
+		*texture = textures.back().get();
+		return S_OK;
+	}
+
+	HRESULT CreateRenderTargetView(ID3D11Resource*, const D3D11_RENDER_TARGET_VIEW_DESC*, ID3D11RenderTargetView** view) override
+	{
+		rtvs.emplace_back(new MockObject<ID3D11RenderTargetView>());
+		*view = rtvs.back().get();
+		return S_OK;
+	}
+
+	HRESULT CreateShaderResourceView(ID3D11Resource*, const D3D11_SHADER_RESOURCE_VIEW_DESC*, ID3D11ShaderResourceView** view) override
+	{
+		srvs.emplace_back(new MockObject<ID3D11ShaderResourceView>());
+		*view = srvs.back().get();
+		return S_OK;
+	}
+
+	size_t LiveTextures() const
+	{
+		size_t live = 0;
+		for (const std::unique_ptr<MockTexture>& texture : textures)
+			live += texture->references > 0;
+		return live;
+	}
+};
+
+static const UINT ColorBinds = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
+
+// Same key, same texture from frame to frame; a new texture
+// for anything that differs in size, format or bind flags
+static void TestKeyedReuse()
+{
+	MockDevice device;
+	RenderTargetPool pool(&device, 2);
+	const RenderTargetDesc color = { 1280, 720, DXGI_FORMAT_R8G8B8A8_UNORM, ColorBinds };
+	const RenderTargetDesc depth = { 1280, 720, DXGI_FORMAT_R32_FLOAT, ColorBinds };
+	const RenderTargetDesc half = { 640, 360, DXGI_FORMAT_R8G8B8A8_UNORM, ColorBinds };
+	const RenderTargetDesc readOnly = { 1280, 720, DXGI_FORMAT_R8G8B8A8_UNORM, D3D11_BIND_SHADER_RESOURCE };
+
+	pool.BeginFrame();
+	const PooledRenderTarget* first[4] = { pool.Acquire(color), pool.Acquire(depth), pool.Acquire(half), pool.Acquire(readOnly) };
+	CHECK(device.textures.size() == 4);
+	CHECK(pool.GetStats().Allocations == 4);
+	for (int i = 0; i < 4; i++)
+		for (int j = i + 1; j < 4; j++)
+			CHECK(first[i] != first[j]);
+
+	// What the device was asked for
+	const D3D11_TEXTURE2D_DESC& created = device.textures[0]->desc;
+	CHECK(created.Width == 1280 && created.Height == 720);
+	CHECK(created.Format == DXGI_FORMAT_R8G8B8A8_UNORM && created.BindFlags == ColorBinds);
+	CHECK(created.MipLevels == 1 && created.ArraySize == 1 && created.SampleDesc.Count == 1);
+	CHECK(first[0]->RTV.Get() && first[0]->SRV.Get());
+	CHECK(!first[3]->RTV.Get() && first[3]->SRV.Get());
+	CHECK(device.rtvs.size() == 3 && device.srvs.size() == 4);
+
+	for (int frame = 0; frame < 5; frame++)
+	{
+		pool.BeginFrame();
+		CHECK(pool.Acquire(readOnly) == first[3]);
+		CHECK(pool.Acquire(half) == first[2]);
+		CHECK(pool.Acquire(color) == first[0]);
+		CHECK(pool.Acquire(depth) == first[1]);
+	}
+	CHECK(device.textures.size() == 4);
+	CHECK(pool.GetCount() == 4);
+	CHECK(pool.GetBytes() == 1280 * 720 * 4 * 3 + 640 * 360 * 4);
+
+	// Handing last frame's textures back out saves nothing
+	CHECK(pool.GetStats().Reuses == 0);
+}
+
+// A texture acquired this frame is never handed out twice,
+// even for the same key; it's free again next frame
+static void TestSameFrameExclusion()
+{
+	MockDevice device;
+	RenderTargetPool pool(&device, 2);
+	const RenderTargetDesc color = { 1280, 720, DXGI_FORMAT_R16G16B16A16_FLOAT, ColorBinds };
+
+	pool.BeginFrame();
+	const PooledRenderTarget* a = pool.Acquire(color);
+	const PooledRenderTarget* b = pool.Acquire(color);
+	CHECK(a != b);
+	CHECK(a->Texture.Get() != b->Texture.Get());
+	CHECK(device.textures.size() == 2);
+
+	// One request next frame takes one of them; two take both
+	pool.BeginFrame();
+	const PooledRenderTarget* c = pool.Acquire(color);
+	CHECK(c == a || c == b);
+	const PooledRenderTarget* d = pool.Acquire(color);
+	CHECK(d != c && (d == a || d == b));
+	CHECK(device.textures.size() == 2);
+
+	// A third is new
+	CHECK(pool.Acquire(color) != a && device.textures.size() == 3);
+}
+
+// Textures idle for more than idleFrames frames are released
+// at BeginFrame(); a texture coming back before then counts
+// as a reuse
+static void TestIdleRelease()
+{
+	MockDevice device;
+	RenderTargetPool pool(&device, 2);
+	const RenderTargetDesc small = { 800, 600, DXGI_FORMAT_R8G8B8A8_UNORM, ColorBinds };
+	const RenderTargetDesc large = { 1920, 1080, DXGI_FORMAT_R8G8B8A8_UNORM, ColorBinds };
+
+	pool.BeginFrame();
+	const PooledRenderTarget* original = pool.Acquire(small);
+
+	// Resized for a frame, then back: the small texture waited
+	pool.BeginFrame();
+	pool.Acquire(large);
+	pool.BeginFrame();
+	CHECK(pool.GetCount() == 2);
+	CHECK(pool.Acquire(small) == original);
+	CHECK(pool.GetStats().Reuses == 1);
+	CHECK(pool.GetStats().Allocations == 2);
+
+	// Now stays small: the large one goes once it has sat out
+	// two frames
+	pool.BeginFrame();
+	pool.Acquire(small);
+	CHECK(pool.GetCount() == 2);
+	pool.BeginFrame();
+	pool.Acquire(small);
+	CHECK(pool.GetCount() == 1);
+	CHECK(pool.GetStats().Releases == 1);
+	CHECK(device.LiveTextures() == 1);
+	CHECK(device.textures[1]->references == 0);
+	CHECK(device.rtvs[1]->references == 0 && device.srvs[1]->references == 0);
+
+	// Nothing acquired at all: everything goes
+	for (int frame = 0; frame < 3; frame++)
+		pool.BeginFrame();
+	CHECK(pool.GetCount() == 0);
+	CHECK(device.LiveTextures() == 0);
+	CHECK(pool.GetStats().Releases == 2);
+	CHECK(pool.GetStats().Reuses == 1);
+}
+
+int main()
+{
+	TestKeyedReuse();
+	TestSameFrameExclusion();
+	TestIdleRelease();
+	return CheckResult();
+}
@@ -0,0 +1,150 @@
+#include "SSAOResample.h"
+#include "Check.h"
+#include <cmath>
+#include <vector>
+
+// --------------------------------------------------------
+// A synthetic depth-edge scene: a background plane at z = 20,
+// darkened near the silhouette of a slanted foreground box at
+// z = 5.  The AO each low resolution texel gets is the true AO
+// of the G-buffer texel the downsample kept, so any error left
+// after upsampling comes from the upsample itself.
+// --------------------------------------------------------
+static const float NearPlane = 0.1f;
+static const float FarPlane = 100.0f;
+
+static float PostProjectionDepth(float z) { return FarPlane / (FarPlane - NearPlane) * (1.0f - NearPlane / z); }
+static float ViewDepth(float depth) { return NearPlane / (1.0f - depth * (FarPlane - NearPlane) / FarPlane); }
+
+struct EdgeScene
+{
+	static const uint32_t Width = 640;
+	static const uint32_t Height = 360;
+	std::vector<float> Depths, ViewDepths, Normals, AO;
+
+	EdgeScene() : Depths(Width * Height), ViewDepths(Width * Height), Normals(Width * Height * 4), AO(Width * Height)
+	{
+		for (uint32_t y = 0; y < Height; y++)
+		{
+			for (uint32_t x = 0; x < Width; x++)
+			{
+				size_t i = (size_t)y * Width + x;
+				bool box = x >= Width / 3 && x < 2 * Width / 3 && y >= Height / 4 && y < 3 * Height / 4;
+				ViewDepths[i] = box ? 5.0f + 0.01f * x : 20.0f;
+				Depths[i] = PostProjectionDepth(ViewDepths[i]);
+
+				float edgeDistance = fminf(fabsf(x - Width / 3.0f), fabsf(x - 2 * Width / 3.0f));
+				AO[i] = box ? 0.8f + 0.2f * sinf(x * 0.05f) * cosf(y * 0.05f) : 1.0f - 0.6f * expf(-edgeDistance / 12.0f);
+
+				// The "normal" records which texel it came from
+				Normals[i * 4] = (float)i;
+			}
+		}
+	}
+};
+
+struct UpsampleError
+{
+	double Mean;
+	unsigned int Bad;		// Pixels off by more than 0.1
+};
+
+static UpsampleError Measure(const EdgeScene& scene, int scale, float tolerance)
+{
+	uint32_t lowWidth = SSAOResample::LowSize(EdgeScene::Width, scale);
+	uint32_t lowHeight = SSAOResample::LowSize(EdgeScene::Height, scale);
+	std::vector<float> lowDepths(lowWidth * lowHeight), lowNormals(lowWidth * lowHeight * 4);
+	std::vector<float> lowViewDepths(lowWidth * lowHeight), lowAO(lowWidth * lowHeight);
+	SSAOResample::Downsample(scene.Depths.data(), scene.Normals.data(), EdgeScene::Width, EdgeScene::Height, scale,
+		lowDepths.data(), lowNormals.data());
+	for (size_t i = 0; i < lowDepths.size(); i++)
+	{
+		lowViewDepths[i] = ViewDepth(lowDepths[i]);
+		lowAO[i] = scene.AO[(size_t)lowNormals[i * 4]];
+	}
+
+	std::vector<float> ao(EdgeScene::Width * EdgeScene::Height);
+	SSAOResample::Upsample(lowAO.data(), lowViewDepths.data(), lowWidth, lowHeight,
+		scene.ViewDepths.data(), EdgeScene::Width, EdgeScene::Height, scale, tolerance, ao.data());
+
+	UpsampleError error = { 0.0, 0 };
+	for (size_t i = 0; i < ao.size(); i++)
+	{
+		double difference = fabs(ao[i] - scene.AO[i]);
+		error.Mean += difference;
+		error.Bad += difference > 0.1 ? 1 : 0;
+	}
+	error.Mean /= ao.size();
+	return error;
+}
+
+// The bilateral upsample against plain bilinear (a tolerance so
+// large every depth weight is 1) on the same low resolution AO
+static void TestBilateralBeatsBilinear()
+{
+	EdgeScene scene;
+	const float plainBilinear = 1e9f;
+
+	UpsampleError full = Measure(scene, 1, 0.05f);
+	CHECK(full.Mean < 1e-6 && full.Bad == 0);
+
+	UpsampleError half = Measure(scene, 2, 0.05f);
+	UpsampleError halfBilinear = Measure(scene, 2, plainBilinear);
+	CHECK(half.Bad == 0 && halfBilinear.Bad >= 300);
+	CHECK(half.Mean < 0.8 * halfBilinear.Mean);
+
+	UpsampleError quarter = Measure(scene, 4, 0.05f);
+	UpsampleError quarterBilinear = Measure(scene, 4, plainBilinear);
+	CHECK(quarter.Bad * 10 < quarterBilinear.Bad);
+	CHECK(quarter.Mean < 0.8 * quarterBilinear.Mean);
+}
+
+// Neighbouring texels alternate between the nearest and farthest
+// depth of their block, and carry that texel's normal
+static void TestDownsampleCheckerboard()
+{
+	const float depths[4 * 2] =
+	{
+		0.1f, 0.2f, 0.5f, 0.6f,
+		0.3f, 0.4f, 0.7f, 0.8f,
+	};
+	float normals[4 * 2 * 4] = {};
+	for (int i = 0; i < 8; i++)
+		normals[i * 4 + 1] = (float)i;
+
+	float lowDepths[2], lowNormals[2 * 4];
+	SSAOResample::Downsample(depths, normals, 4, 2, 2, lowDepths, lowNormals);
+	CHECK(lowDepths[0] == 0.1f && lowNormals[1] == 0.0f);
+	CHECK(lowDepths[1] == 0.8f && lowNormals[5] == 7.0f);
+
+	// Ragged edges round up and repeat the last row and column
+	CHECK(SSAOResample::LowSize(641, 4) == 161 && SSAOResample::LowSize(640, 4) == 160);
+	float odd[3] = { 0.9f, 0.3f, 0.5f };
+	float oddNormals[3 * 4] = {};
+	SSAOResample::Downsample(odd, oddNormals, 3, 1, 2, lowDepths, lowNormals);
+	CHECK(lowDepths[0] == 0.3f && lowDepths[1] == 0.5f);
+}
+
+// When no texel is on the pixel's surface it takes the nearest
+// in depth rather than dividing by next to nothing
+static void TestNearestFallback()
+{
+	const float lowAO[4] = { 0.1f, 0.2f, 0.3f, 0.4f };
+	const float lowViewDepths[4] = { 50.0f, 40.0f, 8.0f, 60.0f };
+	float ao = SSAOResample::UpsamplePixel(lowAO, lowViewDepths, 2, 2, 5.0f, 1, 1, 2, 1e-4f);
+	CHECK(ao == 0.3f);
+
+	// On a flat surface it's plain bilinear: pixel (1, 1) is a
+	// quarter texel from the first low resolution texel each way
+	const float flat[4] = { 10.0f, 10.0f, 10.0f, 10.0f };
+	ao = SSAOResample::UpsamplePixel(lowAO, flat, 2, 2, 10.0f, 1, 1, 2, 0.05f);
+	CHECK_NEAR(ao, 0.5625f * 0.1f + 0.1875f * 0.2f + 0.1875f * 0.3f + 0.0625f * 0.4f, 1e-6f);
+}
+
+int main()
+{
+	TestBilateralBeatsBilinear();
+	TestDownsampleCheckerboard();
+	TestNearestFallback();
+	return CheckResult();
+}
@@ -0,0 +1,103 @@
+#include "ShaderPermutations.h"
+#include "Check.h"
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+// Stands in for a compiled shader; only identity matters
+struct FakeShader
+{
+	unsigned int Features;
+};
+
+static std::shared_ptr<FakeShader> Variant(unsigned int features)
+{
+	return std::shared_ptr<FakeShader>(new FakeShader{ features });
+}
+
+static void TestFileNames()
+{
+	CHECK(GetPermutationFileName(L"PixelShader", 0) == L"PixelShader_00.cso");
+	CHECK(GetPermutationFileName(L"PixelShader", SHADER_FEATURE_SHADOWS | SHADER_FEATURE_METALNESS_MAP) == L"PixelShader_05.cso");
+	CHECK(GetPermutationFileName(L"PixelShader", SHADER_FEATURE_ALL) == L"PixelShader.cso");
+
+	// Bits past the known features are ignored
+	CHECK(GetPermutationFileName(L"PixelShader", SHADER_FEATURE_ALL | 0x100) == L"PixelShader.cso");
+}
+
+// With only the full variant loaded, everything draws with it
+static void TestFallsBackToFullVariant()
+{
+	ShaderPermutationTable<FakeShader> table;
+	CHECK(!table.Resolve(0) && table.GetLoadedCount() == 0);
+
+	table.Set(SHADER_FEATURE_ALL, Variant(SHADER_FEATURE_ALL));
+	for (unsigned int features = 0; features <= SHADER_FEATURE_ALL; features++)
+	{
+		CHECK(table.Resolve(features) && table.Resolve(features)->Features == SHADER_FEATURE_ALL);
+		CHECK(features == SHADER_FEATURE_ALL || !table.Get(features));
+	}
+}
+
+// A missing variant resolves to the loaded superset with the
+// fewest extra features, and never to one lacking a feature
+static void TestFewestExtraFeatures()
+{
+	ShaderPermutationTable<FakeShader> table;
+	table.Set(SHADER_FEATURE_ALL, Variant(SHADER_FEATURE_ALL));
+	table.Set(SHADER_FEATURE_SHADOWS, Variant(SHADER_FEATURE_SHADOWS));
+	table.Set(SHADER_FEATURE_SHADOWS | SHADER_FEATURE_NORMAL_MAP, Variant(SHADER_FEATURE_SHADOWS | SHADER_FEATURE_NORMAL_MAP));
+	CHECK(table.GetLoadedCount() == 3);
+
+	CHECK(table.Resolve(0)->Features == SHADER_FEATURE_SHADOWS);
+	CHECK(table.Resolve(SHADER_FEATURE_NORMAL_MAP)->Features == (SHADER_FEATURE_SHADOWS | SHADER_FEATURE_NORMAL_MAP));
+	CHECK(table.Resolve(SHADER_FEATURE_METALNESS_MAP)->Features == SHADER_FEATURE_ALL);
+
+	for (unsigned int wanted = 0; wanted <= SHADER_FEATURE_ALL; wanted++)
+		CHECK((table.Resolve(wanted)->Features & wanted) == wanted);
+
+	// Loading the exact variant later takes over from the fallback
+	table.Set(0, Variant(0));
+	CHECK(table.Resolve(0)->Features == 0);
+	CHECK(table.Get(0) == table.Resolve(0));
+}
+
+// The wrappers Tools/GenerateShaderPermutations.py writes must
+// define the features in the same bit order as ShaderFeature
+static void TestGeneratedWrappersMatchBits()
+{
+	const char* defines[SHADER_FEATURE_COUNT] =
+	{
+		"FEATURE_SHADOWS",
+		"FEATURE_NORMAL_MAP",
+		"FEATURE_METALNESS_MAP",
+		"FEATURE_SSAO_OUTPUTS",
+	};
+
+	for (unsigned int features = 0; features < SHADER_FEATURE_ALL; features++)
+	{
+		char suffix[16];
+		snprintf(suffix, sizeof(suffix), "_%02X.hlsl", features);
+		std::ifstream file(std::string(SOURCE_DIR) + "/Permutations/PixelShader" + suffix);
+		CHECK(file.good());
+		if (!file.good())
+			continue;
+
+		std::stringstream contents;
+		contents << file.rdbuf();
+		for (unsigned int bit = 0; bit < SHADER_FEATURE_COUNT; bit++)
+		{
+			std::string line = std::string("#define ") + defines[bit] + ((features & (1 << bit)) ? " 1" : " 0");
+			CHECK(contents.str().find(line) != std::string::npos);
+		}
+	}
+}
+
+int main()
+{
+	TestFileNames();
+	TestFallsBackToFullVariant();
+	TestFewestExtraFeatures();
+	TestGeneratedWrappersMatchBits();
+	return CheckResult();
+}
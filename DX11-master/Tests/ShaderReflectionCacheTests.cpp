@@ -0,0 +1,124 @@
+#include "ShaderReflectionCache.h"
+#include "Check.h"
+#include <cstring>
+
+static ShaderReflectionData MakeReflection()
+{
+	ShaderReflectionData reflection;
+	ReflectedBuffer perFrame = { "PerFrame", 0, 0, 96, {} };
+	perFrame.Variables.push_back({ "cameraPosition", 0, 12 });
+	perFrame.Variables.push_back({ "ambient", 16, 12 });
+	perFrame.Variables.push_back({ "view", 32, 64 });
+	reflection.Buffers.push_back(perFrame);
+	reflection.Buffers.push_back({ "Empty", 1, 3, 16, {} });
+	reflection.Textures.push_back({ "Albedo", 0 });
+	reflection.Textures.push_back({ "NormalMap", 2 });
+	reflection.Samplers.push_back({ "BasicSampler", 1 });
+	return reflection;
+}
+
+static bool Equal(const ShaderReflectionData& a, const ShaderReflectionData& b)
+{
+	if (a.Buffers.size() != b.Buffers.size() ||
+		a.Textures.size() != b.Textures.size() ||
+		a.Samplers.size() != b.Samplers.size())
+		return false;
+
+	for (size_t i = 0; i < a.Buffers.size(); i++)
+	{
+		const ReflectedBuffer& x = a.Buffers[i];
+		const ReflectedBuffer& y = b.Buffers[i];
+		if (x.Name != y.Name || x.Type != y.Type || x.BindIndex != y.BindIndex ||
+			x.Size != y.Size || x.Variables.size() != y.Variables.size())
+			return false;
+
+		for (size_t v = 0; v < x.Variables.size(); v++)
+			if (x.Variables[v].Name != y.Variables[v].Name ||
+				x.Variables[v].ByteOffset != y.Variables[v].ByteOffset ||
+				x.Variables[v].Size != y.Variables[v].Size)
+				return false;
+	}
+
+	for (size_t i = 0; i < a.Textures.size(); i++)
+		if (a.Textures[i].Name != b.Textures[i].Name || a.Textures[i].BindIndex != b.Textures[i].BindIndex)
+			return false;
+
+	for (size_t i = 0; i < a.Samplers.size(); i++)
+		if (a.Samplers[i].Name != b.Samplers[i].Name || a.Samplers[i].BindIndex != b.Samplers[i].BindIndex)
+			return false;
+
+	return true;
+}
+
+static void TestRoundTrip()
+{
+	ShaderReflectionData reflection = MakeReflection();
+	std::vector<unsigned char> bytes;
+	ShaderReflectionCache::Serialize(reflection, 42, bytes);
+
+	ShaderReflectionData loaded;
+	CHECK(ShaderReflectionCache::Deserialize(bytes.data(), bytes.size(), 42, loaded));
+	CHECK(Equal(reflection, loaded));
+
+	// Serializing what was loaded gives back the same bytes
+	std::vector<unsigned char> again;
+	ShaderReflectionCache::Serialize(loaded, 42, again);
+	CHECK(again == bytes);
+
+	ShaderReflectionData empty;
+	ShaderReflectionCache::Serialize(empty, 7, bytes);
+	CHECK(ShaderReflectionCache::Deserialize(bytes.data(), bytes.size(), 7, loaded));
+	CHECK(Equal(empty, loaded));
+}
+
+// A cache made from different bytecode is stale
+static void TestRejectsOtherBytecode()
+{
+	const char shaderA[] = "shader bytecode A";
+	const char shaderB[] = "shader bytecode B";
+	uint64_t hashA = ShaderReflectionCache::HashBytecode(shaderA, sizeof(shaderA));
+	uint64_t hashB = ShaderReflectionCache::HashBytecode(shaderB, sizeof(shaderB));
+	CHECK(hashA != hashB);
+	CHECK(hashA == ShaderReflectionCache::HashBytecode(shaderA, sizeof(shaderA)));
+
+	// FNV-1a of nothing is the offset basis
+	CHECK(ShaderReflectionCache::HashBytecode(0, 0) == 0xcbf29ce484222325ull);
+
+	std::vector<unsigned char> bytes;
+	ShaderReflectionCache::Serialize(MakeReflection(), hashA, bytes);
+	ShaderReflectionData loaded;
+	CHECK(!ShaderReflectionCache::Deserialize(bytes.data(), bytes.size(), hashB, loaded));
+}
+
+// Every truncation is rejected, and corrupt bytes never read
+// out of bounds (run under a sanitizer to check the latter)
+static void TestRejectsDamage()
+{
+	std::vector<unsigned char> bytes;
+	ShaderReflectionCache::Serialize(MakeReflection(), 42, bytes);
+
+	ShaderReflectionData loaded;
+	bool anyTruncationAccepted = false;
+	for (size_t size = 0; size < bytes.size(); size++)
+		anyTruncationAccepted |= ShaderReflectionCache::Deserialize(bytes.data(), size, 42, loaded);
+	CHECK(!anyTruncationAccepted);
+
+	std::vector<unsigned char> corrupt = bytes;
+	corrupt[0] ^= 0xFF;
+	CHECK(!ShaderReflectionCache::Deserialize(corrupt.data(), corrupt.size(), 42, loaded));
+
+	for (size_t i = 0; i < bytes.size(); i++)
+	{
+		corrupt = bytes;
+		corrupt[i] ^= 0xFF;
+		ShaderReflectionCache::Deserialize(corrupt.data(), corrupt.size(), 42, loaded);
+	}
+}
+
+int main()
+{
+	TestRoundTrip();
+	TestRejectsOtherBytecode();
+	TestRejectsDamage();
+	return CheckResult();
+}
@@ -0,0 +1,208 @@
+#include "ShadowAtlas.h"
+#include "Check.h"
+#include <random>
+#include <vector>
+
+static bool Overlap(const AtlasTile& a, const AtlasTile& b)
+{
+	return a.X < b.X + b.Size && b.X < a.X + a.Size && a.Y < b.Y + b.Size && b.Y < a.Y + a.Size;
+}
+
+static void TestRoundUp()
+{
+	CHECK(ShadowAtlasAllocator::RoundUpToPowerOfTwo(1) == 1);
+	CHECK(ShadowAtlasAllocator::RoundUpToPowerOfTwo(64) == 64);
+	CHECK(ShadowAtlasAllocator::RoundUpToPowerOfTwo(65) == 128);
+	CHECK(ShadowAtlasAllocator::RoundUpToPowerOfTwo(300) == 512);
+}
+
+// Filling the atlas with equal tiles, then freeing them all,
+// merges everything back into one free root
+static void TestFillAndMerge()
+{
+	ShadowAtlasAllocator allocator(1024, 64);
+	std::vector<AtlasTile> tiles;
+	AtlasTile tile;
+	for (int i = 0; i < 16; i++)
+	{
+		CHECK(allocator.Allocate(256, tile));
+		CHECK(tile.Size == 256);
+		tiles.push_back(tile);
+	}
+	CHECK(!allocator.Allocate(64, tile));
+	CHECK(allocator.GetUsedArea() == 1024ull * 1024);
+
+	bool overlap = false;
+	for (size_t i = 0; i < tiles.size(); i++)
+		for (size_t j = i + 1; j < tiles.size(); j++)
+			overlap |= Overlap(tiles[i], tiles[j]);
+	CHECK(!overlap);
+
+	for (const AtlasTile& t : tiles)
+		allocator.Free(t);
+	CHECK(allocator.GetUsedArea() == 0);
+	CHECK(allocator.Allocate(1024, tile) && tile.X == 0 && tile.Y == 0 && tile.Size == 1024);
+
+	// Sizes round up to a power of two, and to the minimum
+	allocator.Clear();
+	CHECK(allocator.Allocate(100, tile) && tile.Size == 128);
+	CHECK(allocator.Allocate(3, tile) && tile.Size == 64);
+	CHECK(!allocator.Allocate(2048, tile));
+}
+
+// Small tiles come from the smallest free node that fits, so
+// they pack together and leave large areas whole
+static void TestBestFit()
+{
+	ShadowAtlasAllocator allocator(1024, 64);
+	AtlasTile small1, large, small2, whole;
+	CHECK(allocator.Allocate(64, small1));
+	CHECK(allocator.Allocate(512, large));
+	CHECK(allocator.Allocate(64, small2));
+	CHECK(small2.X < 256 && small2.Y < 256);
+	CHECK(!Overlap(large, small1) && !Overlap(large, small2));
+
+	// Two more 512s still fit beside the first
+	AtlasTile more1, more2;
+	CHECK(allocator.Allocate(512, more1) && allocator.Allocate(512, more2));
+	CHECK(!allocator.Allocate(512, whole));
+
+	allocator.Free(small1);
+	allocator.Free(small2);
+	CHECK(allocator.Allocate(512, whole));
+}
+
+// Random allocate/free: tiles stay aligned to their size, inside
+// the atlas and apart, and everything merges back at the end
+static void TestRandom()
+{
+	ShadowAtlasAllocator allocator(1024, 64);
+	std::mt19937 random(1);
+	std::vector<AtlasTile> live;
+	uint64_t area = 0;
+	bool failed = false;
+	for (int step = 0; step < 20000 && !failed; step++)
+	{
+		AtlasTile tile;
+		if (live.empty() || random() % 2)
+		{
+			uint32_t size = 64u << (random() % 4);
+			if (!allocator.Allocate(size, tile))
+				continue;
+
+			failed |= tile.Size != size || tile.X % size != 0 || tile.Y % size != 0;
+			failed |= tile.X + size > 1024 || tile.Y + size > 1024;
+			for (const AtlasTile& l : live)
+				failed |= Overlap(l, tile);
+			live.push_back(tile);
+			area += (uint64_t)size * size;
+		}
+		else
+		{
+			size_t index = random() % live.size();
+			allocator.Free(live[index]);
+			area -= (uint64_t)live[index].Size * live[index].Size;
+			live.erase(live.begin() + index);
+		}
+		failed |= allocator.GetUsedArea() != area;
+	}
+	CHECK(!failed);
+
+	for (const AtlasTile& l : live)
+		allocator.Free(l);
+	AtlasTile whole;
+	CHECK(allocator.Allocate(1024, whole));
+}
+
+// The least recently requested tiles go first, and nothing
+// requested this frame is ever evicted
+static void TestLeastRecentlyUsedEviction()
+{
+	ShadowAtlas atlas(1024, 128, 512);
+	AtlasTile tile;
+	bool fresh;
+
+	atlas.BeginFrame();
+	for (uint64_t key = 0; key < 4; key++)
+		CHECK(atlas.Request(key, 512, tile, fresh) && fresh);
+	CHECK(atlas.Request(0, 512, tile, fresh) && !fresh);
+	CHECK(!atlas.Request(9, 512, tile, fresh));
+	CHECK(atlas.GetTileCount() == 4);
+
+	// Next frame 0 isn't requested before 9, so it's the oldest
+	atlas.BeginFrame();
+	atlas.Request(3, 512, tile, fresh);
+	atlas.Request(2, 512, tile, fresh);
+	atlas.Request(1, 512, tile, fresh);
+	AtlasTile nine;
+	CHECK(atlas.Request(9, 512, nine, fresh) && fresh);
+	CHECK(atlas.GetEvictions() == 1);
+	CHECK(!atlas.Request(0, 512, tile, fresh));
+
+	// Release frees the tile for someone else
+	atlas.BeginFrame();
+	atlas.Release(9);
+	CHECK(atlas.GetTileCount() == 3);
+	CHECK(atlas.Request(0, 512, tile, fresh) && fresh);
+	CHECK(atlas.GetEvictions() == 0);
+}
+
+// Falls back to smaller tiles when nothing can be evicted, and a
+// view only shrinks once it wants a quarter of its tile
+static void TestResizing()
+{
+	ShadowAtlas atlas(1024, 128, 512);
+	AtlasTile tile;
+	bool fresh;
+
+	atlas.BeginFrame();
+	for (uint64_t key = 0; key < 3; key++)
+		atlas.Request(key, 512, tile, fresh);
+	atlas.Request(3, 256, tile, fresh);
+	CHECK(atlas.Request(4, 512, tile, fresh) && tile.Size == 256);
+
+	atlas.Clear();
+	atlas.BeginFrame();
+	CHECK(atlas.Request(1, 512, tile, fresh) && tile.Size == 512);
+	CHECK(atlas.Request(1, 300, tile, fresh) && !fresh && tile.Size == 512);
+	CHECK(atlas.Request(1, 128, tile, fresh) && fresh && tile.Size == 128);
+	CHECK(atlas.Request(1, 512, tile, fresh) && fresh && tile.Size == 512);
+
+	// Requests are clamped to the maximum tile size
+	CHECK(atlas.Request(2, 4096, tile, fresh) && tile.Size == 512);
+}
+
+static void TestHeuristics()
+{
+	ShadowAtlas atlas(4096, 128, 1024);
+	CHECK(ShadowAtlas::ScreenCoverage({ 0, 0, 0 }, 5.0f, { 0, 0, 1 }, 1.0f) == 1.0f);
+	float far = ShadowAtlas::ScreenCoverage({ 0, 0, 100 }, 1.0f, { 0, 0, 0 }, 1.0f);
+	float near = ShadowAtlas::ScreenCoverage({ 0, 0, 10 }, 1.0f, { 0, 0, 0 }, 1.0f);
+	CHECK(far > 0.0f && far < near && near < 1.0f);
+	CHECK_NEAR(near, 1.0f / sqrtf(99.0f), 1e-5f);
+
+	CHECK(atlas.TileSizeFor(1.0f) == 1024);
+	CHECK(atlas.TileSizeFor(0.3f) == 512);
+	CHECK(atlas.TileSizeFor(0.0f) == 128);
+
+	// Waiting raises priority so a small light eventually wins
+	CHECK(ShadowAtlas::UpdatePriority(0.1f, 10) > ShadowAtlas::UpdatePriority(0.5f, 0));
+
+	std::vector<ShadowUpdateCandidate> candidates = { { 0, 1 }, { 1, 5 }, { 2, 3 }, { 3, 4 } };
+	ShadowAtlas::SelectUpdates(candidates, 2);
+	CHECK(candidates.size() == 2 && candidates[0].Light == 1 && candidates[1].Light == 3);
+	ShadowAtlas::SelectUpdates(candidates, 5);
+	CHECK(candidates.size() == 2);
+}
+
+int main()
+{
+	TestRoundUp();
+	TestFillAndMerge();
+	TestBestFit();
+	TestRandom();
+	TestLeastRecentlyUsedEviction();
+	TestResizing();
+	TestHeuristics();
+	return CheckResult();
+}
@@ -0,0 +1,226 @@
+#include "ShadowCascades.h"
+#include "Check.h"
+#include <cmath>
+#include <cstring>
+
+static CascadeCamera MakeCamera()
+{
+	CascadeCamera camera = {};
+	camera.Position = { 0, 5, -20 };
+	camera.Forward = { 0, 0, 1 };
+	camera.Right = { 1, 0, 0 };
+	camera.Up = { 0, 1, 0 };
+	camera.TanHalfFovY = tanf(0.3927f);
+	camera.AspectRatio = 16.0f / 9.0f;
+	return camera;
+}
+
+// Light-space center of the cascade's square along x
+static float CenterX(const ShadowCascade& cascade)
+{
+	return -cascade.Projection[12] / cascade.Projection[0];
+}
+
+static void TestSplitDistances()
+{
+	float splits[ShadowCascades::MaxCascades];
+
+	// Uniform: equal slices
+	ShadowCascades::ComputeSplits(0.1f, 100.0f, 4, 0.0f, splits);
+	CHECK_NEAR(splits[0], 25.075f, 1e-3f);
+	CHECK_NEAR(splits[1], 50.05f, 1e-3f);
+	CHECK_NEAR(splits[2], 75.025f, 1e-3f);
+	CHECK(splits[3] == 100.0f);
+
+	// Logarithmic: equal ratios
+	ShadowCascades::ComputeSplits(0.1f, 100.0f, 4, 1.0f, splits);
+	CHECK_NEAR(splits[0], 0.1f * powf(1000.0f, 0.25f), 1e-4f);
+	CHECK_NEAR(splits[1], 0.1f * powf(1000.0f, 0.5f), 1e-4f);
+	CHECK_NEAR(splits[2], 0.1f * powf(1000.0f, 0.75f), 1e-3f);
+	CHECK(splits[3] == 100.0f);
+
+	// A blend sits between the two and still increases
+	float uniform[4], logarithmic[4];
+	ShadowCascades::ComputeSplits(0.1f, 100.0f, 4, 0.0f, uniform);
+	ShadowCascades::ComputeSplits(0.1f, 100.0f, 4, 1.0f, logarithmic);
+	ShadowCascades::ComputeSplits(0.1f, 100.0f, 4, 0.75f, splits);
+	for (unsigned int i = 0; i < 3; i++)
+	{
+		CHECK_NEAR(splits[i], 0.75f * logarithmic[i] + 0.25f * uniform[i], 1e-3f);
+		CHECK(splits[i] < splits[i + 1]);
+	}
+
+	ShadowCascades::ComputeSplits(0.5f, 40.0f, 1, 0.5f, splits);
+	CHECK(splits[0] == 40.0f);
+}
+
+// Every corner of each slice of the view frustum lands inside
+// its cascade's map
+static void TestCascadesContainSlices()
+{
+	CascadeCamera camera = MakeCamera();
+	ShadowCascade cascades[ShadowCascades::MaxCascades];
+	unsigned int count = ShadowCascades::Fit(camera, 0.1f, 100.0f, 4, 0.75f, { 0, -1, 1 }, 1280, 720, 20.0f, cascades);
+	CHECK(count == 4);
+	CHECK(cascades[0].NearDepth == 0.1f && cascades[3].FarDepth == 100.0f);
+
+	for (unsigned int i = 0; i < count; i++)
+	{
+		if (i > 0)
+			CHECK(cascades[i].NearDepth == cascades[i - 1].FarDepth);
+
+		float depths[2] = { cascades[i].NearDepth, cascades[i].FarDepth };
+		for (float depth : depths)
+			for (int sx = -1; sx <= 1; sx += 2)
+				for (int sy = -1; sy <= 1; sy += 2)
+				{
+					CascadeVector corner = {
+						camera.Position.X + sx * depth * camera.TanHalfFovY * camera.AspectRatio,
+						camera.Position.Y + sy * depth * camera.TanHalfFovY,
+						camera.Position.Z + depth };
+					CascadeVector ndc = ShadowCascades::Transform(cascades[i], corner);
+					CHECK(fabsf(ndc.X) <= 1.001f && fabsf(ndc.Y) <= 1.001f);
+					CHECK(ndc.Z >= 0.0f && ndc.Z <= 1.001f);
+				}
+	}
+
+	// Count is clamped to what the renderer supports
+	CHECK(ShadowCascades::Fit(camera, 0.1f, 100.0f, 9, 0.5f, { 0, -1, 1 }, 512, 512, 0.0f, cascades) == ShadowCascades::MaxCascades);
+	CHECK(ShadowCascades::Fit(camera, 0.1f, 100.0f, 0, 0.5f, { 0, -1, 1 }, 512, 512, 0.0f, cascades) == 1);
+}
+
+// Turning the camera never changes a cascade's size
+static void TestRadiusIgnoresRotation()
+{
+	CascadeCamera camera = MakeCamera();
+	ShadowCascade straight = ShadowCascades::FitCascade(camera, 5.0f, 30.0f, { 0, -1, 1 }, 1024, 1024, 10.0f);
+
+	camera.Forward = { 0.6f, 0.0f, 0.8f };
+	camera.Right = { 0.8f, 0.0f, -0.6f };
+	ShadowCascade turned = ShadowCascades::FitCascade(camera, 5.0f, 30.0f, { 0, -1, 1 }, 1024, 1024, 10.0f);
+	CHECK(straight.Radius == turned.Radius);
+	CHECK(straight.Projection[0] == turned.Projection[0]);
+}
+
+// The center snaps to whole texels: sub-texel moves give the same
+// matrices bit for bit, and larger ones move by whole texels
+static void TestTexelSnapping()
+{
+	const uint32_t resolution = 1024;
+	CascadeCamera camera = MakeCamera();
+	ShadowCascade start = ShadowCascades::FitCascade(camera, 5.0f, 30.0f, { 0, -1, 1 }, resolution, resolution, 10.0f);
+	float texel = 2.0f * start.Radius / resolution;
+
+	CHECK_NEAR(CenterX(start) / texel, roundf(CenterX(start) / texel), 1e-2f);
+
+	// With this light direction, light-space x is world x.  Start
+	// off a texel boundary so the 40 steps cross exactly four.
+	camera.Position.X = 0.05f * texel;
+	start = ShadowCascades::FitCascade(camera, 5.0f, 30.0f, { 0, -1, 1 }, resolution, resolution, 10.0f);
+	unsigned int changes = 0;
+	ShadowCascade previous = start;
+	for (int step = 1; step <= 40; step++)
+	{
+		camera.Position.X = (0.05f + 0.1f * step) * texel;
+		ShadowCascade moved = ShadowCascades::FitCascade(camera, 5.0f, 30.0f, { 0, -1, 1 }, resolution, resolution, 10.0f);
+		CHECK(memcmp(moved.View, start.View, sizeof(start.View)) == 0);
+
+		if (memcmp(moved.Projection, previous.Projection, sizeof(previous.Projection)) != 0)
+		{
+			changes++;
+			float shift = (CenterX(moved) - CenterX(previous)) / texel;
+			CHECK_NEAR(shift, 1.0f, 1e-2f);
+			CHECK(moved.Projection[13] == previous.Projection[13]);
+			CHECK(moved.Projection[14] == previous.Projection[14]);
+		}
+		previous = moved;
+	}
+
+	CHECK(changes == 4);
+}
+
+static void TestOverlaps()
+{
+	CascadeCamera camera = MakeCamera();
+	ShadowCascade cascade = ShadowCascades::FitCascade(camera, 0.1f, 20.0f, { 0, -1, 1 }, 1024, 1024, 10.0f);
+	CHECK(ShadowCascades::Overlaps(cascade, camera.Position, 0.5f));
+	CHECK(!ShadowCascades::Overlaps(cascade, { 500, 0, 0 }, 1.0f));
+
+	// Casters between the light and the cascade always count
+	CascadeVector towardsLight = { camera.Position.X, camera.Position.Y + 300.0f, camera.Position.Z - 300.0f };
+	CHECK(ShadowCascades::Overlaps(cascade, towardsLight, 1.0f));
+
+	// A light straight down still gives a usable basis
+	ShadowCascade down = ShadowCascades::FitCascade(camera, 1.0f, 10.0f, { 0, -1, 0 }, 512, 512, 5.0f);
+	for (float value : down.View)
+		CHECK(std::isfinite(value));
+}
+
+// A world point lands on the same cached texel and depth whether
+// it's looked up through the cascade (plus its offset) or the region
+static void CheckSamePlace(const ShadowCascade& cascade, const ShadowCascade& region, uint32_t resolution, uint32_t margin,
+	uint32_t offsetX, uint32_t offsetY, const CascadeVector& point)
+{
+	CascadeVector inCascade = ShadowCascades::Transform(cascade, point);
+	CascadeVector inRegion = ShadowCascades::Transform(region, point);
+	float regionResolution = (float)(resolution + 2 * margin);
+	CHECK_NEAR((inCascade.X + 1) * 0.5f * resolution + offsetX, (inRegion.X + 1) * 0.5f * regionResolution, 1e-2f);
+	CHECK_NEAR((1 - inCascade.Y) * 0.5f * resolution + offsetY, (1 - inRegion.Y) * 0.5f * regionResolution, 1e-2f);
+	CHECK_NEAR(inCascade.Z, inRegion.Z, 1e-5f);
+}
+
+// The cache region stays valid while the camera moves less than
+// the margin, and the cascade's place in it follows the camera
+static void TestCacheRegion()
+{
+	const uint32_t resolution = 1024;
+	const uint32_t margin = 128;
+	const CascadeVector light = { 0, -1, 1 };
+	CascadeCamera camera = MakeCamera();
+	ShadowCascade cascade = ShadowCascades::FitCascade(camera, 5.0f, 30.0f, light, resolution, resolution, 10.0f);
+	float texel = 2.0f * cascade.Radius / resolution;
+
+	ShadowCascade region = ShadowCascades::FitCacheRegion(cascade, resolution, margin);
+	CHECK_NEAR(2.0f * region.Radius / (resolution + 2 * margin), texel, 1e-6f);
+	CHECK(ShadowCascades::CacheRegionCovers(region, cascade, resolution, margin));
+
+	uint32_t offsetX, offsetY;
+	ShadowCascade placed = cascade;
+	ShadowCascades::PlaceInCacheRegion(placed, region, resolution, margin, offsetX, offsetY);
+	CHECK(offsetX == margin && offsetY == margin);
+	CheckSamePlace(placed, region, resolution, margin, offsetX, offsetY, { 1.0f, 2.0f, 0.0f });
+
+	// 100 texels right and a little up: still covered, no rebuild
+	CascadeCamera moved = camera;
+	moved.Position.X += 100.25f * texel;
+	moved.Position.Y += 10.0f * texel;
+	placed = ShadowCascades::FitCascade(moved, 5.0f, 30.0f, light, resolution, resolution, 10.0f);
+	CHECK(ShadowCascades::CacheRegionCovers(region, placed, resolution, margin));
+	ShadowCascades::PlaceInCacheRegion(placed, region, resolution, margin, offsetX, offsetY);
+	CHECK(offsetX == margin + 100);
+	CHECK(offsetY < margin && offsetY >= margin - 8);
+	CheckSamePlace(placed, region, resolution, margin, offsetX, offsetY, { moved.Position.X, 0.0f, 5.0f });
+	CheckSamePlace(placed, region, resolution, margin, offsetX, offsetY, { moved.Position.X - 3.0f, 4.0f, 15.0f });
+
+	// Past the margin it has to be refit
+	moved.Position.X = camera.Position.X + 130.5f * texel;
+	placed = ShadowCascades::FitCascade(moved, 5.0f, 30.0f, light, resolution, resolution, 10.0f);
+	CHECK(!ShadowCascades::CacheRegionCovers(region, placed, resolution, margin));
+
+	// As does turning the light or resizing the cascade
+	ShadowCascade turned = ShadowCascades::FitCascade(camera, 5.0f, 30.0f, { 0.1f, -1, 1 }, resolution, resolution, 10.0f);
+	CHECK(!ShadowCascades::CacheRegionCovers(region, turned, resolution, margin));
+	ShadowCascade longer = ShadowCascades::FitCascade(camera, 5.0f, 35.0f, light, resolution, resolution, 10.0f);
+	CHECK(!ShadowCascades::CacheRegionCovers(region, longer, resolution, margin));
+}
+
+int main()
+{
+	TestSplitDistances();
+	TestCascadesContainSlices();
+	TestRadiusIgnoresRotation();
+	TestTexelSnapping();
+	TestOverlaps();
+	TestCacheRegion();
+	return CheckResult();
+}
@@ -0,0 +1,117 @@
+#include "ShadowMoments.h"
+#include "Check.h"
+#include <cmath>
+#include <vector>
+
+// --------------------------------------------------------
+// Golden values for a 16x4 step edge: depth 0.25 in the left
+// half, 0.75 in the right, prefiltered with a radius 2 box at
+// MaxExponent16.  The warps are e^(+-2.77) and the blurred
+// texels are the 1:4, 2:3, 3:2 and 4:1 mixes across the edge.
+// --------------------------------------------------------
+static const uint32_t Width = 16;
+static const uint32_t Height = 4;
+static const float Exponent = ShadowMoments::MaxExponent16;
+static const float Near = 0.062662f;	// e^(-2.77)
+static const float Far = 15.958633f;	// e^(2.77)
+
+static std::vector<EVSMMoments> StepEdge()
+{
+	std::vector<float> depths(Width * Height);
+	for (uint32_t y = 0; y < Height; y++)
+		for (uint32_t x = 0; x < Width; x++)
+			depths[y * Width + x] = x < Width / 2 ? 0.25f : 0.75f;
+
+	std::vector<EVSMMoments> moments(Width * Height);
+	ShadowMoments::Prefilter(depths.data(), Width, Height, Exponent, Exponent, 2, moments.data());
+	return moments;
+}
+
+static void TestWarp()
+{
+	EVSMMoments nearWarp = ShadowMoments::Warp(0.25f, Exponent, Exponent);
+	CHECK_NEAR(nearWarp.Positive, Near, 1e-5f);
+	CHECK_NEAR(nearWarp.PositiveSquared, Near * Near, 1e-6f);
+	CHECK_NEAR(nearWarp.Negative, -Far, 1e-4f);
+	CHECK_NEAR(nearWarp.NegativeSquared, Far * Far, 1e-2f);
+
+	// Depth 0.5 is the warp's midpoint
+	EVSMMoments middle = ShadowMoments::Warp(0.5f, Exponent, Exponent);
+	CHECK(middle.Positive == 1.0f && middle.Negative == -1.0f);
+
+	// The largest squared warp still fits in a 16-bit float
+	CHECK(ShadowMoments::Warp(1.0f, Exponent, Exponent).PositiveSquared < 65504.0f);
+	CHECK(ShadowMoments::Warp(0.0f, Exponent, Exponent).NegativeSquared < 65504.0f);
+}
+
+// Clamped edges keep the flat regions exact; only the five
+// texels whose kernel straddles the edge get mixed moments
+static void TestBlur()
+{
+	std::vector<EVSMMoments> moments = StepEdge();
+	for (uint32_t y = 0; y < Height; y++)
+	{
+		const EVSMMoments* row = moments.data() + y * Width;
+		CHECK_NEAR(row[0].Positive, Near, 1e-5f);
+		CHECK_NEAR(row[5].Negative, -Far, 1e-4f);
+		CHECK_NEAR(row[10].Positive, Far, 1e-4f);
+		CHECK_NEAR(row[15].Negative, -Near, 1e-5f);
+
+		for (uint32_t x = 6; x < 10; x++)
+		{
+			float farShare = (x - 5) / 5.0f;
+			CHECK_NEAR(row[x].Positive, (1 - farShare) * Near + farShare * Far, 1e-4f);
+			CHECK_NEAR(row[x].PositiveSquared, (1 - farShare) * Near * Near + farShare * Far * Far, 1e-2f);
+			CHECK_NEAR(row[x].Negative, -(1 - farShare) * Far - farShare * Near, 1e-4f);
+		}
+	}
+
+	// A zero radius leaves the warped depths alone
+	std::vector<float> depths(Width * Height, 0.4f);
+	std::vector<EVSMMoments> unblurred(Width * Height);
+	ShadowMoments::Prefilter(depths.data(), Width, Height, Exponent, Exponent, 0, unblurred.data());
+	EVSMMoments warped = ShadowMoments::Warp(0.4f, Exponent, Exponent);
+	CHECK(unblurred[17].Positive == warped.Positive && unblurred[17].NegativeSquared == warped.NegativeSquared);
+}
+
+static void TestVisibility()
+{
+	std::vector<EVSMMoments> moments = StepEdge();
+	const EVSMMoments* row = moments.data() + Width;
+
+	// A receiver at 0.5 is shadowed by the left half and lit on the
+	// right, with a smooth ramp across the blurred edge
+	const float ramp[4] = { 0.225629f, 0.450521f, 0.673583f, 0.889431f };
+	for (uint32_t x = 0; x < 6; x++)
+		CHECK(ShadowMoments::Visibility(row[x], 0.5f, Exponent, Exponent, 0.0f) < 1e-6f);
+	for (uint32_t x = 6; x < 10; x++)
+		CHECK_NEAR(ShadowMoments::Visibility(row[x], 0.5f, Exponent, Exponent, 0.0f), ramp[x - 6], 1e-4f);
+	for (uint32_t x = 10; x < Width; x++)
+		CHECK(ShadowMoments::Visibility(row[x], 0.5f, Exponent, Exponent, 0.0f) == 1.0f);
+
+	// Light bleed reduction rescales the ramp and cuts off its foot
+	CHECK(ShadowMoments::Visibility(row[6], 0.5f, Exponent, Exponent, 0.3f) == 0.0f);
+	CHECK_NEAR(ShadowMoments::Visibility(row[7], 0.5f, Exponent, Exponent, 0.3f), (ramp[1] - 0.3f) / 0.7f, 1e-4f);
+
+	// In front of every occluder is fully lit, behind all of them dark
+	CHECK(ShadowMoments::Visibility(row[7], 0.2f, Exponent, Exponent, 0.0f) == 1.0f);
+	CHECK(ShadowMoments::Visibility(row[15], 0.9f, Exponent, Exponent, 0.0f) < 1e-5f);
+}
+
+static void TestChebyshev()
+{
+	CHECK(ShadowMoments::ChebyshevUpperBound(2.0f, 5.0f, 1.5f, 0.0f) == 1.0f);
+	CHECK_NEAR(ShadowMoments::ChebyshevUpperBound(2.0f, 5.0f, 3.0f, 0.0f), 0.5f, 1e-6f);
+
+	// The variance floor applies to a flat distribution
+	CHECK_NEAR(ShadowMoments::ChebyshevUpperBound(1.0f, 1.0f, 2.0f, 0.25f), 0.2f, 1e-6f);
+}
+
+int main()
+{
+	TestWarp();
+	TestBlur();
+	TestVisibility();
+	TestChebyshev();
+	return CheckResult();
+}
@@ -0,0 +1,272 @@
+#include "TemporalAO.h"
+#include "Check.h"
+#include <cmath>
+#include <random>
+
+// --------------------------------------------------------
+// Matrices built the way DirectXMath builds them (left-handed,
+// row vectors): a camera at a position turned by yaw about y,
+// and a perspective projection
+// --------------------------------------------------------
+static void LookTo(float x, float y, float z, float yaw, float* m)
+{
+	float forwardX = sinf(yaw), forwardZ = cosf(yaw);
+	float rightX = cosf(yaw), rightZ = -sinf(yaw);
+	const float view[16] =
+	{
+		rightX, 0, forwardX, 0,
+		0, 1, 0, 0,
+		rightZ, 0, forwardZ, 0,
+		-(x * rightX + z * rightZ), -y, -(x * forwardX + z * forwardZ), 1,
+	};
+	for (int i = 0; i < 16; i++)
+		m[i] = view[i];
+}
+
+static void Perspective(float fovY, float aspect, float nearZ, float farZ, float* m)
+{
+	float h = 1.0f / tanf(fovY * 0.5f);
+	float q = farZ / (farZ - nearZ);
+	const float projection[16] =
+	{
+		h / aspect, 0, 0, 0,
+		0, h, 0, 0,
+		0, 0, q, 1,
+		0, 0, -q * nearZ, 0,
+	};
+	for (int i = 0; i < 16; i++)
+		m[i] = projection[i];
+}
+
+static float Random(std::mt19937& random, float low, float high)
+{
+	return low + (high - low) * (random() / (float)random.max());
+}
+
+static void TestInvert()
+{
+	float view[16], projection[16], viewProjection[16], inverse[16], identity[16];
+	LookTo(1, 2, -5, 0.3f, view);
+	Perspective(1.0f, 16.0f / 9.0f, 0.1f, 100.0f, projection);
+	TemporalAO::Multiply(view, projection, viewProjection);
+	CHECK(TemporalAO::Invert(viewProjection, inverse));
+	TemporalAO::Multiply(viewProjection, inverse, identity);
+	for (int i = 0; i < 16; i++)
+		CHECK_NEAR(identity[i], i % 5 == 0 ? 1.0f : 0.0f, 1e-4f);
+
+	const float singular[16] = { 1, 2, 3, 4, 2, 4, 6, 8, 0, 0, 1, 0, 0, 0, 0, 1 };
+	CHECK(!TemporalAO::Invert(singular, inverse));
+}
+
+// Reprojection lands where projecting the world point with the
+// previous camera does, for a still and a moving camera
+static void TestReprojection()
+{
+	float view[16], projection[16], viewProjection[16], inverseProjection[16], currentToPrevious[16];
+	LookTo(1, 2, -5, 0.3f, view);
+	Perspective(1.0f, 16.0f / 9.0f, 0.1f, 100.0f, projection);
+	TemporalAO::Multiply(view, projection, viewProjection);
+	TemporalAO::Invert(projection, inverseProjection);
+	std::mt19937 random(7);
+
+	CHECK(TemporalAO::CurrentToPreviousView(view, projection, view, currentToPrevious));
+	for (int i = 0; i < 1000; i++)
+	{
+		float u = Random(random, 0, 1), v = Random(random, 0, 1), depth = Random(random, 0.9f, 1.0f);
+		TemporalAOPixel pixel = TemporalAO::Reproject(currentToPrevious, projection, u, v, depth);
+		CHECK(pixel.OnScreen);
+		CHECK_NEAR(pixel.U, u, 1e-5f);
+		CHECK_NEAR(pixel.V, v, 1e-5f);
+	}
+
+	float previousView[16], previousViewProjection[16];
+	LookTo(1.3f, 2, -4.6f, 0.35f, previousView);
+	TemporalAO::Multiply(previousView, projection, previousViewProjection);
+	CHECK(TemporalAO::CurrentToPreviousView(view, projection, previousView, currentToPrevious));
+	unsigned int onScreen = 0, offScreen = 0;
+	for (int i = 0; i < 1000; i++)
+	{
+		float world[4] = { Random(random, -10, 10), Random(random, -1, 5), Random(random, 2, 32), 1 };
+		float clip[4];
+		TemporalAO::Transform(world, viewProjection, clip);
+		float u = clip[0] / clip[3] * 0.5f + 0.5f;
+		float v = 0.5f - clip[1] / clip[3] * 0.5f;
+		float depth = clip[2] / clip[3];
+		if (clip[3] <= 0.1f || u < 0 || u > 1 || v < 0 || v > 1)
+			continue;
+
+		float cameraSpace[4];
+		TemporalAO::Transform(world, view, cameraSpace);
+		CHECK_NEAR(TemporalAO::ViewDepth(inverseProjection, depth) / cameraSpace[2], 1.0f, 1e-3f);
+
+		float previousClip[4], previousCameraSpace[4];
+		TemporalAO::Transform(world, previousViewProjection, previousClip);
+		TemporalAO::Transform(world, previousView, previousCameraSpace);
+		float expectedU = previousClip[0] / previousClip[3] * 0.5f + 0.5f;
+		float expectedV = 0.5f - previousClip[1] / previousClip[3] * 0.5f;
+
+		// Skip points right on the previous frame's border
+		if (fabsf(expectedU - 0.5f) > 0.499f && fabsf(expectedU - 0.5f) < 0.501f)
+			continue;
+		if (fabsf(expectedV - 0.5f) > 0.499f && fabsf(expectedV - 0.5f) < 0.501f)
+			continue;
+
+		TemporalAOPixel pixel = TemporalAO::Reproject(currentToPrevious, projection, u, v, depth);
+		bool expectedOnScreen = expectedU >= 0 && expectedU <= 1 && expectedV >= 0 && expectedV <= 1;
+		CHECK(pixel.OnScreen == expectedOnScreen);
+		if (!expectedOnScreen)
+		{
+			offScreen++;
+			continue;
+		}
+
+		onScreen++;
+		CHECK_NEAR(pixel.U, expectedU, 1e-4f);
+		CHECK_NEAR(pixel.V, expectedV, 1e-4f);
+		CHECK_NEAR(pixel.PreviousViewDepth / previousCameraSpace[2], 1.0f, 1e-3f);
+	}
+	CHECK(onScreen > 500 && offScreen > 0);
+}
+
+static void TestDisocclusion()
+{
+	CHECK(!TemporalAO::Disoccluded(10.0f, 10.2f, 0.05f));
+	CHECK(TemporalAO::Disoccluded(10.0f, 5.0f, 0.05f));
+	CHECK(TemporalAO::Disoccluded(10.0f, 10.6f, 0.05f));
+	CHECK(!TemporalAO::Disoccluded(100.0f, 104.0f, 0.05f));
+}
+
+static void RandomKernel(std::mt19937& random, float* kernel)
+{
+	for (int i = 0; i < TemporalAO::KernelSize; i++)
+	{
+		float* offset = kernel + i * 4;
+		do
+		{
+			offset[0] = Random(random, -1, 1);
+			offset[1] = Random(random, -1, 1);
+			offset[2] = Random(random, 0, 1);
+		} while (offset[0] * offset[0] + offset[1] * offset[1] + offset[2] * offset[2] > 1);
+		offset[3] = 0;
+	}
+}
+
+// MaxHistory frames use every kernel offset exactly once, each
+// only spun about the normal
+static void TestFrameKernelCoversKernel()
+{
+	std::mt19937 random(11);
+	float kernel[TemporalAO::KernelSize * 4];
+	RandomKernel(random, kernel);
+
+	int used[TemporalAO::KernelSize] = {};
+	for (uint32_t frame = 0; frame < TemporalAO::MaxHistory; frame++)
+	{
+		float frameKernel[TemporalAO::FrameSamples * 4];
+		TemporalAO::FrameKernel(kernel, frame, frameKernel);
+		for (int i = 0; i < TemporalAO::FrameSamples; i++)
+		{
+			int index = frame % TemporalAO::FrameSamples + i * TemporalAO::FrameSamples;
+			used[index]++;
+			const float* offset = kernel + index * 4;
+			CHECK_NEAR(hypotf(frameKernel[i * 4], frameKernel[i * 4 + 1]), hypotf(offset[0], offset[1]), 1e-5f);
+			CHECK(frameKernel[i * 4 + 2] == offset[2]);
+		}
+	}
+	for (int count : used)
+		CHECK(count == 1);
+
+	for (uint32_t frame = 0; frame < 100; frame++)
+		CHECK(TemporalAO::KernelAngle(frame) >= 0.0f && TemporalAO::KernelAngle(frame) < 6.2832f);
+	CHECK(TemporalAO::KernelAngle(0) == 0.0f);
+}
+
+// The first MaxHistory frames average evenly; after that each new
+// frame keeps a 1 / MaxHistory share
+static void TestAccumulate()
+{
+	float history = 0.0f, count = 0.0f, total = 0.0f;
+	for (int frame = 0; frame < TemporalAO::MaxHistory; frame++)
+	{
+		float current = (frame % 3) * 0.25f;
+		total += current;
+		history = TemporalAO::Accumulate(history, count, current, count);
+		CHECK(count == frame + 1.0f);
+		CHECK_NEAR(history, total / (frame + 1), 1e-6f);
+	}
+
+	history = TemporalAO::Accumulate(history, count, 1.0f, count);
+	CHECK(count == TemporalAO::MaxHistory);
+	CHECK_NEAR(history, total / TemporalAO::MaxHistory + (1.0f - total / TemporalAO::MaxHistory) / TemporalAO::MaxHistory, 1e-6f);
+}
+
+// Spins every kernel offset by angle about the normal
+static float OccludedFraction(const float* offsets, int count, float angle, float planeX, float planeY, float planeZ, float planeOffset)
+{
+	float c = cosf(angle), s = sinf(angle);
+	float occluded = 0.0f;
+	for (int i = 0; i < count; i++)
+	{
+		const float* o = offsets + i * 4;
+		float x = o[0] * c - o[1] * s;
+		float y = o[0] * s + o[1] * c;
+		occluded += x * planeX + y * planeY + o[2] * planeZ > planeOffset ? 1.0f : 0.0f;
+	}
+	return occluded / count;
+}
+
+// A pixel under a tilted occluding half-space, AO as the fraction of
+// offsets in front of it.  Eight samples a frame, accumulated, should
+// converge on what the whole kernel gives averaged over every spin,
+// doing about as well as all 64 samples in one frame
+static void TestConvergence()
+{
+	std::mt19937 random(5);
+	float kernel[TemporalAO::KernelSize * 4];
+	RandomKernel(random, kernel);
+
+	const int pixels = 500;
+	double oneFrameError = 0, fullKernelError = 0, accumulatedError = 0;
+	for (int p = 0; p < pixels; p++)
+	{
+		float angle = Random(random, 0, 6.2831853f);
+		float planeX = cosf(angle) * 0.7f, planeY = sinf(angle) * 0.7f, planeZ = 0.3f, planeOffset = Random(random, 0, 0.3f);
+
+		double converged = 0;
+		const int spins = 256;
+		for (int i = 0; i < spins; i++)
+			converged += OccludedFraction(kernel, TemporalAO::KernelSize, 6.2831853f * i / spins, planeX, planeY, planeZ, planeOffset);
+		converged /= spins;
+
+		float fullKernel = OccludedFraction(kernel, TemporalAO::KernelSize, TemporalAO::KernelAngle(p), planeX, planeY, planeZ, planeOffset);
+
+		float history = 0.0f, count = 0.0f, first = 0.0f;
+		for (uint32_t frame = 0; frame < 4 * TemporalAO::MaxHistory; frame++)
+		{
+			float frameKernel[TemporalAO::FrameSamples * 4];
+			TemporalAO::FrameKernel(kernel, frame + p, frameKernel);
+			float current = OccludedFraction(frameKernel, TemporalAO::FrameSamples, 0.0f, planeX, planeY, planeZ, planeOffset);
+			if (frame == 0)
+				first = current;
+			history = TemporalAO::Accumulate(history, count, current, count);
+		}
+
+		oneFrameError += fabs(first - converged);
+		fullKernelError += fabs(fullKernel - converged);
+		accumulatedError += fabs(history - converged);
+	}
+
+	CHECK(accumulatedError * 2 < oneFrameError);
+	CHECK(accumulatedError < 1.5 * fullKernelError);
+}
+
+int main()
+{
+	TestInvert();
+	TestReprojection();
+	TestDisocclusion();
+	TestFrameKernelCoversKernel();
+	TestAccumulate();
+	TestConvergence();
+	return CheckResult();
+}
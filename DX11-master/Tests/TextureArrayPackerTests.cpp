@@ -0,0 +1,116 @@
+#include "TextureArrayPacker.h"
+#include "Check.h"
+
+// Every slice ends up at the array size, whatever it started as
+static void TestPackScalesEverySlice()
+{
+	TextureArrayPacker packer(0, true);
+	CHECK(packer.AddSlice(PackedImage::Solid(1024, 1024, 255, 0, 0, 255)) == 0);
+	CHECK(packer.AddSlice(PackedImage::Solid(128, 128, 0, 255, 0, 255)) == 1);
+	CHECK(packer.AddSlice(PackedImage::Solid(100, 60, 10, 20, 30, 40)) == 2);
+	packer.Pack();
+
+	CHECK(packer.GetSize() == 1024 && packer.GetMipCount() == 11 && packer.GetSliceCount() == 3);
+	for (uint32_t slice = 0; slice < 3; slice++)
+	{
+		for (uint32_t mip = 0; mip < packer.GetMipCount(); mip++)
+		{
+			const PackedImage& image = packer.GetMip(slice, mip);
+			CHECK(image.Width == (1024u >> mip) && image.Height == (1024u >> mip));
+			CHECK(image.Pixels.size() == (size_t)image.Width * image.Height * 4);
+		}
+	}
+
+	// Solid colors survive scaling and every mip
+	CHECK(packer.GetMip(1, 0).Pixels[1] == 255);
+	const PackedImage& smallest = packer.GetMip(2, 10);
+	CHECK(smallest.Pixels[0] == 10 && smallest.Pixels[1] == 20 && smallest.Pixels[2] == 30 && smallest.Pixels[3] == 40);
+}
+
+// Power-of-two ratios that differ per axis: each axis must stop
+// at its own target instead of both halving together
+static void TestUnequalPowerOfTwoRatios()
+{
+	PackedImage wide = PackedImage::Solid(2048, 1024, 50, 100, 150, 200);
+	PackedImage resized = TextureArrayPacker::Resize(wide, 1024, 1024, false);
+	CHECK(resized.Width == 1024 && resized.Height == 1024);
+	CHECK(resized.Pixels.size() == (size_t)1024 * 1024 * 4);
+	CHECK(resized.Pixels[0] == 50 && resized.Pixels[resized.Pixels.size() - 1] == 200);
+
+	PackedImage tall = PackedImage::Solid(64, 512, 1, 2, 3, 4);
+	resized = TextureArrayPacker::Resize(tall, 16, 32, false);
+	CHECK(resized.Width == 16 && resized.Height == 32);
+
+	// Only the rows are averaged when just the height halves
+	PackedImage stripes(2, 4);
+	for (uint32_t y = 0; y < 4; y++)
+		for (uint32_t x = 0; x < 2; x++)
+			stripes.Pixels[(y * 2 + x) * 4] = (uint8_t)(x == 0 ? (y % 2 ? 200 : 100) : 0);
+	resized = TextureArrayPacker::Resize(stripes, 2, 2, false);
+	CHECK(resized.Width == 2 && resized.Height == 2);
+	CHECK(resized.Pixels[0] == 150 && resized.Pixels[4] == 0);
+
+	// And a non-square slice packs into a square array
+	TextureArrayPacker packer(1024, false);
+	packer.AddSlice(wide);
+	packer.Pack();
+	CHECK(packer.GetMip(0, 0).Width == 1024 && packer.GetMip(0, 0).Height == 1024);
+}
+
+// Gamma-encoded images average in linear space; alpha never does
+static void TestDownsampleGamma()
+{
+	PackedImage checker(2, 2);
+	for (int i = 0; i < 4; i++)
+	{
+		uint8_t v = (i == 0 || i == 3) ? 255 : 0;
+		for (int c = 0; c < 4; c++)
+			checker.Pixels[i * 4 + c] = v;
+	}
+
+	PackedImage gamma = TextureArrayPacker::Downsample(checker, true);
+	PackedImage linear = TextureArrayPacker::Downsample(checker, false);
+	CHECK(gamma.Width == 1 && gamma.Height == 1);
+	CHECK(gamma.Pixels[0] == 186);
+	CHECK(linear.Pixels[0] == 128);
+	CHECK(gamma.Pixels[3] == 128);
+
+	// Odd sizes round down and never reach 0
+	PackedImage odd = TextureArrayPacker::Downsample(PackedImage::Solid(3, 1, 9, 9, 9, 9), false);
+	CHECK(odd.Width == 1 && odd.Height == 1 && odd.Pixels[0] == 9);
+}
+
+// Non-power-of-two ratios go through the bilinear path
+static void TestBilinearResize()
+{
+	PackedImage ramp(3, 1);
+	ramp.Pixels[0] = 0;
+	ramp.Pixels[4] = 150;
+	ramp.Pixels[8] = 255;
+	PackedImage resized = TextureArrayPacker::Resize(ramp, 5, 2, false);
+	CHECK(resized.Width == 5 && resized.Height == 2);
+
+	// Monotonic, clamped at the ends
+	CHECK(resized.Pixels[0] == 0 && resized.Pixels[16] == 255);
+	for (uint32_t x = 1; x < 5; x++)
+		CHECK(resized.Pixels[x * 4] >= resized.Pixels[(x - 1) * 4]);
+}
+
+static void TestMergeChannels()
+{
+	PackedImage roughness = PackedImage::Solid(256, 256, 200, 0, 0, 255);
+	PackedImage metalness = PackedImage::Solid(64, 64, 30, 0, 0, 255);
+	PackedImage merged = TextureArrayPacker::MergeChannels(roughness, metalness);
+	CHECK(merged.Width == 256 && merged.Height == 256);
+	CHECK(merged.Pixels[0] == 200 && merged.Pixels[1] == 30 && merged.Pixels[2] == 0 && merged.Pixels[3] == 255);
+}
+
+int main()
+{
+	TestPackScalesEverySlice();
+	TestUnequalPowerOfTwoRatios();
+	TestDownsampleGamma();
+	TestBilinearResize();
+	TestMergeChannels();
+	return CheckResult();
+}
@@ -0,0 +1,210 @@
+#include "TextureArrayPacker.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+PackedImage::PackedImage(uint32_t width, uint32_t height)
+	: Width(width), Height(height), Pixels((size_t)width * height * 4)
+{
+}
+
+PackedImage PackedImage::Solid(uint32_t width, uint32_t height, uint8_t r, uint8_t g, uint8_t b, uint8_t a)
+{
+	PackedImage image(width, height);
+	for (size_t i = 0; i < image.Pixels.size(); i += 4)
+	{
+		image.Pixels[i + 0] = r;
+		image.Pixels[i + 1] = g;
+		image.Pixels[i + 2] = b;
+		image.Pixels[i + 3] = a;
+	}
+	return image;
+}
+
+// --------------------------------------------------------
+// 8-bit <-> linear conversion.  Alpha is never gamma encoded.
+// --------------------------------------------------------
+static float Decode(uint8_t value, bool gammaEncoded, int channel)
+{
+	static float linear[256];
+	static bool built = false;
+	if (!built)
+	{
+		for (int i = 0; i < 256; i++)
+			linear[i] = powf(i / 255.0f, 2.2f);
+		built = true;
+	}
+
+	if (gammaEncoded && channel < 3)
+		return linear[value];
+	return value / 255.0f;
+}
+
+static uint8_t Encode(float value, bool gammaEncoded, int channel)
+{
+	if (gammaEncoded && channel < 3)
+		value = powf(value, 1.0f / 2.2f);
+	value = std::min(std::max(value, 0.0f), 1.0f);
+	return (uint8_t)(value * 255.0f + 0.5f);
+}
+
+static bool IsPowerOfTwoMultiple(uint32_t big, uint32_t small)
+{
+	if (small == 0 || big < small || big % small != 0)
+		return false;
+	uint32_t ratio = big / small;
+	return (ratio & (ratio - 1)) == 0;
+}
+
+TextureArrayPacker::TextureArrayPacker(uint32_t size, bool gammaEncoded)
+{
+	this->size = size;
+	this->gammaEncoded = gammaEncoded;
+	mipCount = 0;
+}
+
+uint32_t TextureArrayPacker::AddSlice(const PackedImage& image)
+{
+	sources.push_back(image);
+	return (uint32_t)sources.size() - 1;
+}
+
+void TextureArrayPacker::Pack()
+{
+	if (size == 0)
+	{
+		uint32_t largest = 1;
+		for (const PackedImage& image : sources)
+			largest = std::max(largest, std::max(image.Width, image.Height));
+
+		size = 1;
+		while (size < largest)
+			size *= 2;
+	}
+
+	mipCount = 1;
+	for (uint32_t s = size; s > 1; s /= 2)
+		mipCount++;
+
+	slices.clear();
+	slices.resize(sources.size());
+	for (size_t i = 0; i < sources.size(); i++)
+	{
+		std::vector<PackedImage>& mips = slices[i];
+		mips.reserve(mipCount);
+		mips.push_back(Resize(sources[i], size, size, gammaEncoded));
+		for (uint32_t m = 1; m < mipCount; m++)
+			mips.push_back(Downsample(mips.back(), gammaEncoded));
+
+		// The upload reads exactly size >> m square texels per mip
+		for (uint32_t m = 0; m < mipCount; m++)
+			assert(mips[m].Width == std::max(size >> m, 1u) && mips[m].Height == std::max(size >> m, 1u));
+	}
+}
+
+PackedImage TextureArrayPacker::Downsample(const PackedImage& source, bool gammaEncoded)
+{
+	return Halve(source, true, true, gammaEncoded);
+}
+
+// --------------------------------------------------------
+// Downsample() along either axis or both; an axis that isn't
+// halved keeps its size and the filter stays 1 texel wide
+// along it
+// --------------------------------------------------------
+PackedImage TextureArrayPacker::Halve(const PackedImage& source, bool halveX, bool halveY, bool gammaEncoded)
+{
+	uint32_t stepX = halveX ? 2 : 1;
+	uint32_t stepY = halveY ? 2 : 1;
+	PackedImage result(std::max(source.Width / stepX, 1u), std::max(source.Height / stepY, 1u));
+	for (uint32_t y = 0; y < result.Height; y++)
+	{
+		// Odd edges just repeat the last row or column
+		uint32_t y0 = std::min(y * stepY, source.Height - 1);
+		uint32_t y1 = std::min(y * stepY + stepY - 1, source.Height - 1);
+		for (uint32_t x = 0; x < result.Width; x++)
+		{
+			uint32_t x0 = std::min(x * stepX, source.Width - 1);
+			uint32_t x1 = std::min(x * stepX + stepX - 1, source.Width - 1);
+			const uint8_t* p00 = &source.Pixels[((size_t)y0 * source.Width + x0) * 4];
+			const uint8_t* p10 = &source.Pixels[((size_t)y0 * source.Width + x1) * 4];
+			const uint8_t* p01 = &source.Pixels[((size_t)y1 * source.Width + x0) * 4];
+			const uint8_t* p11 = &source.Pixels[((size_t)y1 * source.Width + x1) * 4];
+			uint8_t* out = &result.Pixels[((size_t)y * result.Width + x) * 4];
+			for (int c = 0; c < 4; c++)
+			{
+				float sum =
+					Decode(p00[c], gammaEncoded, c) + Decode(p10[c], gammaEncoded, c) +
+					Decode(p01[c], gammaEncoded, c) + Decode(p11[c], gammaEncoded, c);
+				out[c] = Encode(sum * 0.25f, gammaEncoded, c);
+			}
+		}
+	}
+	return result;
+}
+
+PackedImage TextureArrayPacker::Resize(const PackedImage& source, uint32_t width, uint32_t height, bool gammaEncoded)
+{
+	if (source.Width == width && source.Height == height)
+		return source;
+
+	// Exact halvings keep every source texel's contribution.  The
+	// two ratios can differ (2048x1024 down to 1024x1024), so each
+	// axis stops halving once it reaches its own target.
+	if (IsPowerOfTwoMultiple(source.Width, width) && IsPowerOfTwoMultiple(source.Height, height))
+	{
+		PackedImage result = source;
+		while (result.Width > width || result.Height > height)
+			result = Halve(result, result.Width > width, result.Height > height, gammaEncoded);
+		return result;
+	}
+
+	// Bilinear, sampling at texel centers with clamped edges
+	PackedImage result(width, height);
+	float scaleX = (float)source.Width / width;
+	float scaleY = (float)source.Height / height;
+	for (uint32_t y = 0; y < height; y++)
+	{
+		float sy = std::max((y + 0.5f) * scaleY - 0.5f, 0.0f);
+		uint32_t y0 = std::min((uint32_t)sy, source.Height - 1);
+		uint32_t y1 = std::min(y0 + 1, source.Height - 1);
+		float fy = sy - y0;
+		for (uint32_t x = 0; x < width; x++)
+		{
+			float sx = std::max((x + 0.5f) * scaleX - 0.5f, 0.0f);
+			uint32_t x0 = std::min((uint32_t)sx, source.Width - 1);
+			uint32_t x1 = std::min(x0 + 1, source.Width - 1);
+			float fx = sx - x0;
+			const uint8_t* p00 = &source.Pixels[((size_t)y0 * source.Width + x0) * 4];
+			const uint8_t* p10 = &source.Pixels[((size_t)y0 * source.Width + x1) * 4];
+			const uint8_t* p01 = &source.Pixels[((size_t)y1 * source.Width + x0) * 4];
+			const uint8_t* p11 = &source.Pixels[((size_t)y1 * source.Width + x1) * 4];
+			uint8_t* out = &result.Pixels[((size_t)y * width + x) * 4];
+			for (int c = 0; c < 4; c++)
+			{
+				float top = Decode(p00[c], gammaEncoded, c) * (1 - fx) + Decode(p10[c], gammaEncoded, c) * fx;
+				float bottom = Decode(p01[c], gammaEncoded, c) * (1 - fx) + Decode(p11[c], gammaEncoded, c) * fx;
+				out[c] = Encode(top * (1 - fy) + bottom * fy, gammaEncoded, c);
+			}
+		}
+	}
+	return result;
+}
+
+PackedImage TextureArrayPacker::MergeChannels(const PackedImage& red, const PackedImage& green)
+{
+	uint32_t width = std::max(red.Width, green.Width);
+	uint32_t height = std::max(red.Height, green.Height);
+	PackedImage r = Resize(red, width, height, false);
+	PackedImage g = Resize(green, width, height, false);
+
+	PackedImage result(width, height);
+	for (size_t i = 0; i < result.Pixels.size(); i += 4)
+	{
+		result.Pixels[i + 0] = r.Pixels[i];
+		result.Pixels[i + 1] = g.Pixels[i];
+		result.Pixels[i + 2] = 0;
+		result.Pixels[i + 3] = 255;
+	}
+	return result;
+}
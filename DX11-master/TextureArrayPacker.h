@@ -0,0 +1,73 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// --------------------------------------------------------
+// An 8-bit RGBA image in CPU memory, rows tightly packed
+// --------------------------------------------------------
+struct PackedImage
+{
+	uint32_t Width = 0;
+	uint32_t Height = 0;
+	std::vector<uint8_t> Pixels;
+
+	PackedImage() {}
+	PackedImage(uint32_t width, uint32_t height);
+
+	bool IsEmpty() const { return Width == 0 || Height == 0; }
+
+	// Every pixel the same color, for maps a material doesn't have
+	static PackedImage Solid(uint32_t width, uint32_t height, uint8_t r, uint8_t g, uint8_t b, uint8_t a);
+};
+
+// --------------------------------------------------------
+// Packs same-purpose textures (every material's albedo, say)
+// into the slices and mips of one texture array, entirely on
+// the CPU; the caller uploads the result however it likes.
+//
+//  - Every slice is scaled to one square size, by repeated
+//    box filtering when both ratios are powers of two (each
+//    axis halved until it fits) and bilinear filtering
+//    otherwise
+//  - Mips go all the way down to 1x1
+//  - Gamma-encoded images (albedo) are filtered in linear
+//    space, matching the pow(2.2) the shaders decode with
+// --------------------------------------------------------
+class TextureArrayPacker
+{
+public:
+	// size 0 picks the largest source edge, rounded up to a power of two
+	TextureArrayPacker(uint32_t size = 0, bool gammaEncoded = false);
+
+	// Returns the slice index
+	uint32_t AddSlice(const PackedImage& image);
+
+	// Scales every slice and builds its mips
+	void Pack();
+
+	uint32_t GetSize() const { return size; }
+	uint32_t GetMipCount() const { return mipCount; }
+	uint32_t GetSliceCount() const { return (uint32_t)sources.size(); }
+
+	// Only valid after Pack()
+	const PackedImage& GetMip(uint32_t slice, uint32_t mip) const { return slices[slice][mip]; }
+
+	// Half size (rounding down, never below 1) with a 2x2 box filter
+	static PackedImage Downsample(const PackedImage& source, bool gammaEncoded);
+	static PackedImage Resize(const PackedImage& source, uint32_t width, uint32_t height, bool gammaEncoded);
+
+	// Red of "red" and red of "green" side by side in one image (the
+	// roughness & metalness maps, say), at the larger of their sizes
+	static PackedImage MergeChannels(const PackedImage& red, const PackedImage& green);
+
+private:
+	static PackedImage Halve(const PackedImage& source, bool halveX, bool halveY, bool gammaEncoded);
+
+	uint32_t size;
+	uint32_t mipCount;
+	bool gammaEncoded;
+
+	std::vector<PackedImage> sources;
+	std::vector<std::vector<PackedImage>> slices;
+};
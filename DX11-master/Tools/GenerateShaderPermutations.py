@@ -0,0 +1,112 @@
+"""
+Generates the shader permutation wrappers in Permutations/: one tiny
+.hlsl per combination of feature bits, which sets the FEATURE_ defines
+and includes the real shader.  Visual Studio compiles each wrapper to
+its own .cso (PixelShader_05.cso, ...), so every variant is built
+offline alongside the rest of the shaders.
+
+    python Tools/GenerateShaderPermutations.py          (rewrite the wrappers)
+    python Tools/GenerateShaderPermutations.py --check  (exit 1 if out of date)
+
+The variant with every feature on is the shader itself, so it gets no
+wrapper.  FEATURES must stay in the same order as the ShaderFeature
+bits in ShaderPermutations.h.  --check also makes sure every wrapper
+is listed in DX11Starter.vcxproj.
+"""
+
+import argparse
+import os
+import sys
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+OUTPUT_DIR = os.path.join(ROOT, "Permutations")
+PROJECT = os.path.join(ROOT, "DX11Starter.vcxproj")
+
+# Bit order matches ShaderFeature
+FEATURES = [
+    ("FEATURE_SHADOWS", "shadows"),
+    ("FEATURE_NORMAL_MAP", "normal map"),
+    ("FEATURE_METALNESS_MAP", "roughness & metalness maps"),
+    ("FEATURE_SSAO_OUTPUTS", "SSAO outputs"),
+]
+
+# Shaders that are built as permutations
+SHADERS = [
+    "PixelShader.hlsl",
+]
+
+
+def wrapper_name(shader, features):
+    return "%s_%02X.hlsl" % (os.path.splitext(shader)[0], features)
+
+
+def wrapper_source(shader, features):
+    enabled = [desc for bit, (_, desc) in enumerate(FEATURES) if features & (1 << bit)]
+    lines = [
+        "// Generated by Tools/GenerateShaderPermutations.py - do not edit",
+        "// %s with: %s" % (shader, ", ".join(enabled) if enabled else "no optional features"),
+    ]
+    for bit, (define, _) in enumerate(FEATURES):
+        lines.append("#define %s %d" % (define, 1 if features & (1 << bit) else 0))
+    lines.append('#include "../%s"' % shader)
+    lines.append("")
+    return "\n".join(lines)
+
+
+def generate():
+    """Returns {file name: source} for every wrapper"""
+    everything = (1 << len(FEATURES)) - 1
+    files = {}
+    for shader in SHADERS:
+        for features in range(everything):
+            files[wrapper_name(shader, features)] = wrapper_source(shader, features)
+    return files
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--check", action="store_true", help="fail if the wrappers are out of date")
+    args = parser.parse_args()
+
+    files = generate()
+
+    if args.check:
+        stale = []
+        for name, source in sorted(files.items()):
+            path = os.path.join(OUTPUT_DIR, name)
+            if not os.path.exists(path):
+                stale.append(name)
+                continue
+            with open(path, encoding="utf-8", newline="") as f:
+                if f.read() != source:
+                    stale.append(name)
+
+        with open(PROJECT, encoding="utf-8") as f:
+            project = f.read()
+        unlisted = [n for n in sorted(files) if 'Include="Permutations\\%s"' % n not in project]
+
+        for name in stale:
+            print("Permutations/%s is out of date; run Tools/GenerateShaderPermutations.py" % name, file=sys.stderr)
+        for name in unlisted:
+            print("Permutations\\%s is not in DX11Starter.vcxproj" % name, file=sys.stderr)
+        if stale or unlisted:
+            return 1
+        print("Shader permutations are up to date")
+        return 0
+
+    os.makedirs(OUTPUT_DIR, exist_ok=True)
+    for name, source in sorted(files.items()):
+        path = os.path.join(OUTPUT_DIR, name)
+        existing = None
+        if os.path.exists(path):
+            with open(path, encoding="utf-8", newline="") as f:
+                existing = f.read()
+        if existing != source:
+            with open(path, "w", encoding="utf-8", newline="") as f:
+                f.write(source)
+            print("Wrote %s" % path)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
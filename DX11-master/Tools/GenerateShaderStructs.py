@@ -0,0 +1,239 @@
+"""
+Generates BufferStructs.h: one C++ struct per cbuffer in the project's
+shaders, laid out to match HLSL constant buffer packing.
+
+    python Tools/GenerateShaderStructs.py          (rewrite BufferStructs.h)
+    python Tools/GenerateShaderStructs.py --check  (exit 1 if it's out of date)
+
+Runs anywhere Python 3 does; it reads the .hlsl source rather than
+compiled shaders, so no D3D compiler is needed.  The packing rules it
+applies (the same ones fxc uses):
+
+ - A variable never straddles a 16-byte register; if it would, it
+   starts at the next one
+ - Structs and array elements always start a new register, and
+   nothing packs into the register after a struct
+ - Matrices are four registers (float4x4 only)
+
+Every offset is written out as a static_assert, so if the C++ side
+disagrees with the packing computed here the build fails; --check
+catches shader edits that haven't been regenerated.
+"""
+
+import argparse
+import os
+import re
+import sys
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+OUTPUT = os.path.join(ROOT, "BufferStructs.h")
+
+# Shaders whose cbuffers get structs, in output order
+SHADERS = [
+    "VertexShader.hlsl",
+    "VertexShaderInstanced.hlsl",
+    "PixelShader.hlsl",
+    "ShadowVShader.hlsl",
+    "SkyVertexShader.hlsl",
+    "CustomPs.hlsl",
+    "SSAOPixelShader.hlsl",
+    "BlurSSAOPShader.hlsl",
+    "PPPixelShader.hlsl",
+]
+
+# HLSL type -> (C++ type, size in bytes)
+BASIC_TYPES = {
+    "float": ("float", 4),
+    "float2": ("DirectX::XMFLOAT2", 8),
+    "float3": ("DirectX::XMFLOAT3", 12),
+    "float4": ("DirectX::XMFLOAT4", 16),
+    "int": ("int", 4),
+    "int2": ("DirectX::XMINT2", 8),
+    "int3": ("DirectX::XMINT3", 12),
+    "int4": ("DirectX::XMINT4", 16),
+    "uint": ("unsigned int", 4),
+    "uint2": ("DirectX::XMUINT2", 8),
+    "uint3": ("DirectX::XMUINT3", 12),
+    "uint4": ("DirectX::XMUINT4", 16),
+    "bool": ("int", 4),
+    "matrix": ("DirectX::XMFLOAT4X4", 64),
+    "float4x4": ("DirectX::XMFLOAT4X4", 64),
+}
+
+# HLSL structs used in cbuffers must have a C++ twin of the same name
+STRUCT_HEADERS = {
+    "Light": "Lights.h",
+}
+
+CBUFFER_RE = re.compile(r"cbuffer\s+(\w+)\s*(?::\s*register\s*\(\s*\w+\s*\))?\s*\{(.*?)\}", re.S)
+STRUCT_RE = re.compile(r"struct\s+(\w+)\s*\{(.*?)\}\s*;", re.S)
+MEMBER_RE = re.compile(r"^\s*(?:row_major\s+|column_major\s+)?(\w+)\s+(\w+)\s*(?:\[\s*(\d+)\s*\])?\s*(?::[^;]*)?;\s*$")
+
+
+class LayoutError(Exception):
+    pass
+
+
+def read_source(path):
+    with open(path, encoding="latin-1") as f:
+        text = f.read()
+    text = re.sub(r"/\*.*?\*/", "", text, flags=re.S)
+    return re.sub(r"//[^\n]*", "", text)
+
+
+def parse_members(body, where):
+    members = []
+    for statement in body.split(";"):
+        statement = statement.strip()
+        if not statement:
+            continue
+        match = MEMBER_RE.match(statement + ";")
+        if not match:
+            raise LayoutError("%s: can't parse '%s'" % (where, statement))
+        hlsl_type, name, count = match.groups()
+        members.append((hlsl_type, name, int(count) if count else 0))
+    return members
+
+
+def find_structs(shader_path):
+    # Structs from the shader and anything it includes
+    text = read_source(shader_path)
+    sources = [text]
+    for include in re.findall(r'#include\s+"([^"]+)"', text):
+        sources.append(read_source(os.path.join(os.path.dirname(shader_path), include)))
+
+    structs = {}
+    for source in sources:
+        for name, body in STRUCT_RE.findall(source):
+            if name in STRUCT_HEADERS:
+                structs[name] = parse_members(body, "struct " + name)
+    return structs
+
+
+def align16(offset):
+    return (offset + 15) & ~15
+
+
+def pack(members, structs, where):
+    """Returns [(hlsl_type, name, count, offset, size)] and the packed size."""
+    laid_out = []
+    offset = 0
+    after_struct = False
+    for hlsl_type, name, count in members:
+        if hlsl_type in BASIC_TYPES:
+            element_size = BASIC_TYPES[hlsl_type][1]
+            is_struct = False
+        elif hlsl_type in structs:
+            _, element_size = pack(structs[hlsl_type], structs, "struct " + hlsl_type)
+            is_struct = True
+        else:
+            raise LayoutError("%s: unsupported type '%s' for '%s'" % (where, hlsl_type, name))
+
+        if count > 0 and element_size % 16 != 0:
+            # Each element would be padded out to a register, which
+            # has no plain C++ equivalent
+            raise LayoutError("%s: array '%s' of %s needs 16-byte elements" % (where, name, hlsl_type))
+
+        if is_struct or count > 0 or after_struct:
+            offset = align16(offset)
+        elif offset // 16 != (offset + element_size - 1) // 16:
+            offset = align16(offset)
+
+        size = element_size * max(count, 1)
+        laid_out.append((hlsl_type, name, count, offset, size))
+        offset += size
+        after_struct = is_struct
+
+    return laid_out, offset
+
+
+def struct_name(shader, cbuffer):
+    base = os.path.splitext(shader)[0]
+    return base + cbuffer[0].upper() + cbuffer[1:]
+
+
+def generate():
+    lines = []
+    includes = set()
+    for shader in SHADERS:
+        path = os.path.join(ROOT, shader)
+        text = read_source(path)
+        structs = find_structs(path)
+
+        for cbuffer, body in CBUFFER_RE.findall(text):
+            where = "%s, cbuffer %s" % (shader, cbuffer)
+            laid_out, size = pack(parse_members(body, where), structs, where)
+            name = struct_name(shader, cbuffer)
+
+            lines.append("// %s, cbuffer %s" % (shader, cbuffer))
+            lines.append("struct alignas(16) %s" % name)
+            lines.append("{")
+            cpp_offset = 0
+            padding = 0
+            for hlsl_type, member, count, offset, member_size in laid_out:
+                if offset > cpp_offset:
+                    lines.append("\tfloat _pad%d[%d];" % (padding, (offset - cpp_offset) // 4))
+                    padding += 1
+                if hlsl_type in BASIC_TYPES:
+                    cpp_type = BASIC_TYPES[hlsl_type][0]
+                else:
+                    cpp_type = hlsl_type
+                    includes.add(STRUCT_HEADERS[hlsl_type])
+                lines.append("\t%s %s%s;" % (cpp_type, member, "[%d]" % count if count else ""))
+                cpp_offset = offset + member_size
+            lines.append("};")
+
+            lines.append("static_assert(sizeof(%s) == %d, \"%s does not match %s\");" %
+                         (name, align16(size), name, shader))
+            for hlsl_type, member, count, offset, member_size in laid_out:
+                lines.append("static_assert(offsetof(%s, %s) == %d, \"%s::%s does not match %s\");" %
+                             (name, member, offset, name, member, shader))
+                if hlsl_type in STRUCT_HEADERS:
+                    lines.append("static_assert(sizeof(%s) == %d, \"%s does not match the HLSL struct\");" %
+                                 (hlsl_type, member_size // max(count, 1), hlsl_type))
+            lines.append("")
+
+    header = [
+        "// Generated by Tools/GenerateShaderStructs.py from the shaders' cbuffers.",
+        "// Don't edit by hand; change the HLSL and rerun the script.",
+        "#pragma once",
+        "#include <cstddef>",
+        "#include <DirectXMath.h>",
+    ]
+    header += ['#include "%s"' % h for h in sorted(includes)]
+    header.append("")
+    return "\n".join(header + lines)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--check", action="store_true", help="fail if BufferStructs.h is out of date")
+    args = parser.parse_args()
+
+    try:
+        generated = generate()
+    except LayoutError as e:
+        print("error: %s" % e, file=sys.stderr)
+        return 2
+
+    existing = None
+    if os.path.exists(OUTPUT):
+        with open(OUTPUT, encoding="utf-8", newline="") as f:
+            existing = f.read()
+
+    if args.check:
+        if existing != generated:
+            print("BufferStructs.h is out of date; run Tools/GenerateShaderStructs.py", file=sys.stderr)
+            return 1
+        print("BufferStructs.h is up to date")
+        return 0
+
+    if existing != generated:
+        with open(OUTPUT, "w", encoding="utf-8", newline="") as f:
+            f.write(generated)
+        print("Wrote %s" % OUTPUT)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -8,36 +8,50 @@ Transform::Transform()
 
     DirectX::XMStoreFloat4x4(&worldMatrix, DirectX::XMMatrixIdentity());
     DirectX::XMStoreFloat4x4(&worldInverseTransposeMatrix, DirectX::XMMatrixIdentity());
+    matricesDirty = false;
+    version = 0;
 }
 
 void Transform::SetPosition(float x, float y, float z)
 {
     position = DirectX::XMFLOAT3(x, y, z);
+    matricesDirty = true;
+    version++;
 }
 
 void Transform::SetPosition(DirectX::XMFLOAT3 _position)
 {
     position = _position;
+    matricesDirty = true;
+    version++;
 }
 
 void Transform::SetRotation(float pitch, float yaw, float roll)
 {
     rotation = DirectX::XMFLOAT3(pitch, yaw, roll);
+    matricesDirty = true;
+    version++;
 }
 
 void Transform::SetRotation(DirectX::XMFLOAT3 _rotation)
 {
     rotation = _rotation;
+    matricesDirty = true;
+    version++;
 }
 
 void Transform::SetScale(float x, float y, float z)
 {
     scale = DirectX::XMFLOAT3(x, y, z);
+    matricesDirty = true;
+    version++;
 }
 
 void Transform::SetScale(DirectX::XMFLOAT3 _scale)
 {
     scale = _scale;
+    matricesDirty = true;
+    version++;
 }
 
 DirectX::XMFLOAT3 Transform::GetPosition()
@@ -57,13 +71,15 @@ DirectX::XMFLOAT3 Transform::GetScale()
 
 DirectX::XMFLOAT4X4 Transform::GetWorldMatrix()
 {
-    UpdateMatrices();
+    if (matricesDirty)
+        UpdateMatrices();
     return worldMatrix;
 }
 
 DirectX::XMFLOAT4X4 Transform::GetWorldInverseTransposeMatrix()
 {
-    UpdateMatrices();
+    if (matricesDirty)
+        UpdateMatrices();
     return worldInverseTransposeMatrix;
 }
 
@@ -72,6 +88,8 @@ void Transform::MoveAbsolute(float x, float y, float z)
     position.x += x;
     position.y += y;
     position.z += z;
+    matricesDirty = true;
+    version++;
 }
 
 void Transform::MoveAbsolute(DirectX::XMFLOAT3 offset)
@@ -79,6 +97,8 @@ void Transform::MoveAbsolute(DirectX::XMFLOAT3 offset)
     position.x += offset.x;
     position.y += offset.y;
     position.z += offset.z;
+    matricesDirty = true;
+    version++;
 }
 
 void Transform::Rotate(float pitch, float yaw, float roll)
@@ -86,6 +106,8 @@ void Transform::Rotate(float pitch, float yaw, float roll)
     rotation.x += pitch;
     rotation.y += yaw;
     rotation.z += roll;
+    matricesDirty = true;
+    version++;
 }
 
 void Transform::Rotate(DirectX::XMFLOAT3 _rotation)
@@ -93,6 +115,8 @@ void Transform::Rotate(DirectX::XMFLOAT3 _rotation)
     rotation.x += _rotation.x;
     rotation.y += _rotation.y;
     rotation.z += _rotation.z;
+    matricesDirty = true;
+    version++;
 }
 
 void Transform::Scale(float x, float y, float z)
@@ -100,6 +124,8 @@ void Transform::Scale(float x, float y, float z)
     scale.x *= x;
     scale.y *= y;
     scale.z *= z;
+    matricesDirty = true;
+    version++;
 }
 
 void Transform::Scale(DirectX::XMFLOAT3 _scale)
@@ -107,6 +133,8 @@ void Transform::Scale(DirectX::XMFLOAT3 _scale)
     scale.x *= _scale.x;
     scale.y *= _scale.y;
     scale.z *= _scale.z;
+    matricesDirty = true;
+    version++;
 }
 
 void Transform::MoveRelative(float x, float y, float z)
@@ -117,6 +145,8 @@ void Transform::MoveRelative(float x, float y, float z)
     DirectX::XMVECTOR currentPos = DirectX::XMLoadFloat3(&position);
     direc = DirectX::XMVectorAdd(direc, currentPos);
     DirectX::XMStoreFloat3(&position, direc);
+    matricesDirty = true;
+    version++;
 }
 
 DirectX::XMFLOAT3 Transform::GetRight()
@@ -159,4 +189,15 @@ void Transform::UpdateMatrices()
 
     DirectX::XMStoreFloat4x4(&worldMatrix, world);
     DirectX::XMStoreFloat4x4(&worldInverseTransposeMatrix, DirectX::XMMatrixInverse(0, DirectX::XMMatrixTranspose(world)));
+    matricesDirty = false;
+}
+
+bool Transform::IsDirty()
+{
+    return matricesDirty;
+}
+
+unsigned int Transform::GetVersion()
+{
+    return version;
 }
@@ -11,6 +11,15 @@ private:
 
 	DirectX::XMFLOAT4X4 worldMatrix;
 	DirectX::XMFLOAT4X4 worldInverseTransposeMatrix;
+
+	// Set whenever position/rotation/scale change, so the
+	// matrices are only rebuilt when something moved
+	bool matricesDirty;
+
+	// Bumped by every change and never reset, unlike matricesDirty
+	// which the lazy getters clear - lets systems that cache derived
+	// data (bounds) notice edits made after they last ran
+	unsigned int version;
 public:
 	Transform();
 	//setters
@@ -42,5 +51,7 @@ public:
 	DirectX::XMFLOAT3 GetForward();
 
 	void UpdateMatrices();
+	bool IsDirty();
+	unsigned int GetVersion();
 };
 
@@ -1,13 +1,20 @@
 #include "ShaderIncludes.hlsli"
 
-cbuffer ExternalData : register(b0)
+// Constants are split by how often they change, so each
+// buffer is only uploaded when its own data does
+
+// Set once per frame
+cbuffer PerFrame : register(b0)
 {
-	matrix world;
 	matrix view;
 	matrix projection;
+}
+
+// Set for every draw
+cbuffer PerObject : register(b1)
+{
+	matrix world;
 	matrix worldInverseTranspose;
-	matrix lightView;
-	matrix lightProjection;
 }
 
 
@@ -61,8 +68,6 @@ VertexToPixel main(VertexShaderInput input )
 
 	output.tangent = mul((float3x3)world, input.tangent);
 
-	matrix shadowWVP = mul(lightProjection, mul(lightView, world));
-	output.shadowMapPos = mul(shadowWVP, float4(input.localPosition, 1.0f));
 	// Whatever we return will make its way through the pipeline to the
 	// next programmable stage we're using (the pixel shader for now)
 	return output;
@@ -0,0 +1,49 @@
+#include "ShaderIncludes.hlsli"
+
+// Same layout as the PerFrame buffer in VertexShader.hlsl; the
+// per-object data comes in through the instance buffer instead
+cbuffer PerFrame : register(b0)
+{
+	matrix view;
+	matrix projection;
+}
+
+// Same vertex layout as VertexShader.hlsl, plus per-instance data
+// - Semantics ending in _PER_INSTANCE are read from input slot 1
+//   (see SimpleVertexShader::CreateShader)
+// - Each matrix arrives as four rows, in the same row-major
+//   layout as the C++ XMFLOAT4X4, so it is applied row-vector style
+struct VertexShaderInput
+{
+	float3 localPosition	: POSITION;
+	float3 normal           : NORMAL;
+	float2 uv				: TEXCOORD;
+	float3 tangent			: TANGENT;
+
+	float4 world0			: WORLD_PER_INSTANCE0;
+	float4 world1			: WORLD_PER_INSTANCE1;
+	float4 world2			: WORLD_PER_INSTANCE2;
+	float4 world3			: WORLD_PER_INSTANCE3;
+	float4 worldInvTrans0	: WORLD_INVERSE_TRANSPOSE_PER_INSTANCE0;
+	float4 worldInvTrans1	: WORLD_INVERSE_TRANSPOSE_PER_INSTANCE1;
+	float4 worldInvTrans2	: WORLD_INVERSE_TRANSPOSE_PER_INSTANCE2;
+	float4 worldInvTrans3	: WORLD_INVERSE_TRANSPOSE_PER_INSTANCE3;
+};
+
+VertexToPixel main(VertexShaderInput input)
+{
+	VertexToPixel output;
+
+	float4x4 world = float4x4(input.world0, input.world1, input.world2, input.world3);
+	float3x3 worldInverseTranspose = (float3x3)float4x4(input.worldInvTrans0, input.worldInvTrans1, input.worldInvTrans2, input.worldInvTrans3);
+
+	float4 worldPos = mul(float4(input.localPosition, 1.0f), world);
+
+	output.screenPosition = mul(mul(projection, view), worldPos);
+	output.uv = input.uv;
+	output.normal = mul(input.normal, worldInverseTranspose);
+	output.worldPos = worldPos.xyz;
+	output.tangent = mul(input.tangent, (float3x3)world);
+
+	return output;
+}
@@ -2,11 +2,16 @@
 #include "BufferStructs.h"
 #include "Vertex.h"
 
-gameEntity::gameEntity(std::shared_ptr<Mesh> _mesh, std::shared_ptr<Material> _material)
+gameEntity::gameEntity(EntityStore& _store, MeshHandle _mesh, MaterialHandle _material)
 {
-	mesh = _mesh;
-	transformObj = Transform();
-	material = _material;
+	store = &_store;
+	id = store->Create(_mesh, _material);
+}
+
+gameEntity::gameEntity(EntityStore& _store, EntityID _id)
+{
+	store = &_store;
+	id = _id;
 }
 
 gameEntity::~gameEntity()
@@ -14,29 +19,35 @@ gameEntity::~gameEntity()
 	
 }
 
-std::shared_ptr<Mesh> gameEntity::GetMesh()
+EntityID gameEntity::GetID()
+{
+	return id;
+}
+
+Mesh* gameEntity::GetMesh()
 {
-	return mesh;
+	return store->GetResources().Meshes.Get(store->GetMesh(id));
 }
 
 Transform& gameEntity::GetTransform()
 {
-	return transformObj;
+	return store->GetTransform(id);
 }
 
-std::shared_ptr<Material> gameEntity::getMaterial()
+Material* gameEntity::getMaterial()
 {
-	return material;
+	return store->GetResources().Materials.Get(store->GetMaterial(id));
 }
 
-void gameEntity::setMaterial(std::shared_ptr<Material> _material)
+void gameEntity::setMaterial(MaterialHandle _material)
 {
-	material = _material;
+	store->SetMaterial(id, _material);
 }
 
-void gameEntity::DrawEntity(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, std::shared_ptr<Camera> camera)
+void gameEntity::DrawEntity(const Microsoft::WRL::ComPtr<ID3D11DeviceContext>& context, const std::shared_ptr<Camera>& camera)
 {
-	material->setShaders(transformObj.GetWorldMatrix(), camera->GetViewMatrix(), camera->GetProjectionMatrix(), transformObj.GetWorldInverseTransposeMatrix(), camera->GetTransform()->GetPosition());
+	Transform& transformObj = store->GetTransform(id);
+	getMaterial()->setShaders(transformObj.GetWorldMatrix(), camera->GetViewMatrix(), camera->GetProjectionMatrix(), transformObj.GetWorldInverseTransposeMatrix(), camera->GetTransform()->GetPosition());
 
-	mesh->Draw();
+	GetMesh()->Draw();
 }
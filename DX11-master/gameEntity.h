@@ -4,23 +4,34 @@
 #include <memory>
 #include "Camera.h"
 #include "material.h"
+#include "EntityStore.h"
+#include "ResourceRegistry.h"
 
+// --------------------------------------------------------
+// Thin handle to an entity living in an EntityStore.  The
+// components themselves are stored in the store's arrays,
+// so this is cheap to copy and keep by value.
+//
+// The Transform& handed out points into the store, and is
+// only valid until the next entity is created or destroyed.
+// --------------------------------------------------------
 class gameEntity
 {
 private:
-	Transform transformObj;
-	std::shared_ptr<Mesh> mesh;
-	std::shared_ptr<Material> material;
+	EntityStore* store;
+	EntityID id;
 
 public:
-	gameEntity(std::shared_ptr<Mesh> _mesh, std::shared_ptr<Material> _material);
+	gameEntity(EntityStore& _store, MeshHandle _mesh, MaterialHandle _material);
+	gameEntity(EntityStore& _store, EntityID _id);
 	~gameEntity();
 
-	std::shared_ptr<Mesh> GetMesh();
+	EntityID GetID();
+	Mesh* GetMesh();
 	Transform& GetTransform();
-	std::shared_ptr<Material> getMaterial();
-	void setMaterial(std::shared_ptr<Material> _material);
+	Material* getMaterial();
+	void setMaterial(MaterialHandle _material);
 
-	void DrawEntity(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, std::shared_ptr<Camera> camera);
+	void DrawEntity(const Microsoft::WRL::ComPtr<ID3D11DeviceContext>& context, const std::shared_ptr<Camera>& camera);
 };
 
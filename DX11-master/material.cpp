@@ -1,19 +1,31 @@
 #include "material.h"
 
+// Unique per material, used when sorting draws
+unsigned int Material::nextID = 0;
+
+bool Material::UseShaderHandles = true;
+
+// Binding table contents -> ID, shared by every material
+std::map<std::vector<uintptr_t>, unsigned int> Material::bindingTableIDs;
+
 Material::Material(DirectX::XMFLOAT4 _colorTint, std::shared_ptr<SimpleVertexShader> _vertexShader, std::shared_ptr<SimplePixelShader> _pixelShader, float _roughness)
 {
     colorTint = _colorTint;
     vertexShader = _vertexShader;
     pixelShader = _pixelShader;
     roughness = _roughness;
+    textureSlice = 0;
+    id = nextID++;
+    shaderFeatures = SHADER_FEATURE_ALL;
+    ResolveHandles();
 }
 
-std::shared_ptr<SimpleVertexShader> Material::getVertexShader()
+const std::shared_ptr<SimpleVertexShader>& Material::getVertexShader()
 {
     return vertexShader;
 }
 
-std::shared_ptr<SimplePixelShader> Material::getPixelShader()
+const std::shared_ptr<SimplePixelShader>& Material::getPixelShader()
 {
     return pixelShader;
 }
@@ -28,14 +40,27 @@ float Material::getRoughness()
     return roughness;
 }
 
+unsigned int Material::GetID()
+{
+    return id;
+}
+
+// Number of SRV and sampler binds this material issues
+unsigned int Material::GetBindingCount()
+{
+    return (unsigned int)(textureSRVs.size() + samplers.size());
+}
+
 void Material::setVertexShader(std::shared_ptr<SimpleVertexShader> _vertexShader)
 {
     vertexShader = _vertexShader;
+    ResolveHandles();
 }
 
 void Material::setPixelShader(std::shared_ptr<SimplePixelShader> _pixelShader)
 {
     pixelShader = _pixelShader;
+    ResolveHandles();
 }
 
 void Material::setColorTint(DirectX::XMFLOAT4 _colorTint)
@@ -43,6 +68,17 @@ void Material::setColorTint(DirectX::XMFLOAT4 _colorTint)
     colorTint = _colorTint;
 }
 
+void Material::SetShaderFeatures(unsigned int features, const ShaderPermutationTable<SimplePixelShader>& variants)
+{
+    const std::shared_ptr<SimplePixelShader>& variant = variants.Resolve(features);
+    if (!variant)
+        return;
+
+    shaderFeatures = features & SHADER_FEATURE_ALL;
+    if (variant != pixelShader)
+        setPixelShader(variant);
+}
+
 
 void Material::setShaders(DirectX::XMFLOAT4X4 worldMatrix, 
     DirectX::XMFLOAT4X4 viewMatrix, 
@@ -50,36 +86,183 @@ void Material::setShaders(DirectX::XMFLOAT4X4 worldMatrix,
     DirectX::XMFLOAT4X4 worldInverseTransposeMatrix,
     DirectX::XMFLOAT3 position)
 {
-    getVertexShader()->SetShader();
-    getPixelShader()->SetShader();
+    BindShaders();
+    SetPerFrameData(viewMatrix, projectionMatrix, position);
+    SetMaterialData();
+    SetPerObjectData(worldMatrix, worldInverseTransposeMatrix);
+    BindResources();
+}
+
+void Material::BindShaders()
+{
+    vertexShader->SetShader();
+    pixelShader->SetShader();
+}
+
+void Material::BindResources()
+{
+    if (!UseShaderHandles)
+    {
+        for (auto& t : textureSRVs) { pixelShader->SetShaderResourceView(t.first.c_str(), t.second); }
+        for (auto& s : samplers) { pixelShader->SetSamplerState(s.first.c_str(), s.second); }
+        return;
+    }
 
-    std::shared_ptr<SimpleVertexShader> vs = getVertexShader();
+    SimplePixelShader* ps = pixelShader.get();
+    ps->SetShaderResourceViews(firstSRVSlot, (unsigned int)srvTable.size(), srvTable.data());
+    ps->SetSamplerStates(firstSamplerSlot, (unsigned int)samplerTable.size(), samplerTable.data());
+}
 
+// Camera data, in the shaders' PerFrame buffers.  Lights and
+// shadows live there too, but are set by whoever owns them.
+void Material::SetPerFrameData(const DirectX::XMFLOAT4X4& viewMatrix,
+    const DirectX::XMFLOAT4X4& projectionMatrix,
+    const DirectX::XMFLOAT3& position)
+{
+    SimpleVertexShader* vs = vertexShader.get();
+    SimplePixelShader* ps = pixelShader.get();
 
-    vs->SetMatrix4x4("world", worldMatrix);
-    vs->SetMatrix4x4("view", viewMatrix);
-    vs->SetMatrix4x4("projection", projectionMatrix);
-    vs->SetMatrix4x4("worldInverseTranspose", worldInverseTransposeMatrix);
+    if (UseShaderHandles)
+    {
+        vs->SetMatrix4x4(viewHandle, viewMatrix);
+        vs->SetMatrix4x4(projectionHandle, projectionMatrix);
+        ps->SetFloat3(cameraPosHandle, position);
+        vs->CopyBufferData(viewHandle.ConstantBufferIndex);
+        ps->CopyBufferData(cameraPosHandle.ConstantBufferIndex);
+    }
+    else
+    {
+        vs->SetMatrix4x4("view", viewMatrix);
+        vs->SetMatrix4x4("projection", projectionMatrix);
+        ps->SetFloat3("cameraPos", position);
+        vs->CopyBufferData("PerFrame");
+        ps->CopyBufferData("PerFrame");
+    }
+}
 
-    vs->CopyAllBufferData();
+// Only needs calling when a different material is bound
+void Material::SetMaterialData()
+{
+    SimplePixelShader* ps = pixelShader.get();
 
-    std::shared_ptr<SimplePixelShader> ps = getPixelShader();
+    if (UseShaderHandles)
+    {
+        PixelShaderPerMaterial data = {};
+        data.colorTint = colorTint;
+        data.roughness = roughness;
+        data.materialIndex = textureSlice;
+        ps->SetBufferData(perMaterialBuffer, &data, sizeof(data));
+        ps->CopyBufferData(perMaterialBuffer);
+    }
+    else
+    {
+        ps->SetFloat4("colorTint", colorTint);
+        ps->SetFloat("roughness", roughness);
+        ps->SetData("materialIndex", &textureSlice, sizeof(unsigned int));
+        ps->CopyBufferData("PerMaterial");
+    }
+}
 
-    ps->SetFloat4("colorTint", getColorTint());
-    ps->SetFloat("roughness", getRoughness());
-    ps->SetFloat3("cameraPos", position);
-    for (auto& t : textureSRVs) { ps->SetShaderResourceView(t.first.c_str(), t.second); }
-    for (auto& s : samplers) { ps->SetSamplerState(s.first.c_str(), s.second); }
+// The only constants that change from draw to draw (128 bytes)
+void Material::SetPerObjectData(const DirectX::XMFLOAT4X4& worldMatrix,
+    const DirectX::XMFLOAT4X4& worldInverseTransposeMatrix)
+{
+    SimpleVertexShader* vs = vertexShader.get();
 
-    ps->CopyAllBufferData();
+    if (UseShaderHandles)
+    {
+        VertexShaderPerObject data;
+        data.world = worldMatrix;
+        data.worldInverseTranspose = worldInverseTransposeMatrix;
+        vs->SetBufferData(perObjectBuffer, &data, sizeof(data));
+        vs->CopyBufferData(perObjectBuffer);
+    }
+    else
+    {
+        vs->SetMatrix4x4("world", worldMatrix);
+        vs->SetMatrix4x4("worldInverseTranspose", worldInverseTransposeMatrix);
+        vs->CopyBufferData("PerObject");
+    }
 }
 
 void Material::AddTextureSRV(std::string shaderName, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
 {
     textureSRVs.insert({shaderName, srv});
+    ResolveHandles();
 }
 
 void Material::AddSampler(std::string shaderName, Microsoft::WRL::ComPtr<ID3D11SamplerState> sampler)
 {
     samplers.insert({shaderName, sampler});
+    ResolveHandles();
+}
+
+// --------------------------------------------------------
+// Looks up every variable and slot this material sets, so
+// the draw-time setters can go straight to the data
+// --------------------------------------------------------
+void Material::ResolveHandles()
+{
+    viewHandle = vertexShader->GetVariableHandle("view");
+    projectionHandle = vertexShader->GetVariableHandle("projection");
+    cameraPosHandle = pixelShader->GetVariableHandle("cameraPos");
+
+    perObjectBuffer = vertexShader->GetBufferIndex("PerObject");
+    perMaterialBuffer = pixelShader->GetBufferIndex("PerMaterial");
+
+    BuildBindingTable();
+}
+
+// --------------------------------------------------------
+// Lays the material's textures and samplers out by the slot
+// each one has in the pixel shader.  Anything the shader
+// doesn't use is left out.
+// --------------------------------------------------------
+void Material::BuildBindingTable()
+{
+    std::map<unsigned int, ID3D11ShaderResourceView*> srvSlots;
+    for (auto& t : textureSRVs)
+    {
+        SimpleShaderResourceHandle slot = pixelShader->GetShaderResourceViewHandle(t.first);
+        if (slot.IsValid())
+            srvSlots[slot.BindIndex] = t.second.Get();
+    }
+
+    std::map<unsigned int, ID3D11SamplerState*> samplerSlots;
+    for (auto& s : samplers)
+    {
+        SimpleShaderResourceHandle slot = pixelShader->GetSamplerHandle(s.first);
+        if (slot.IsValid())
+            samplerSlots[slot.BindIndex] = s.second.Get();
+    }
+
+    // Maps are ordered, so the first and last entries bound the range
+    srvTable.clear();
+    firstSRVSlot = srvSlots.empty() ? 0 : srvSlots.begin()->first;
+    if (!srvSlots.empty())
+        srvTable.resize(srvSlots.rbegin()->first - firstSRVSlot + 1, 0);
+    for (auto& t : srvSlots)
+        srvTable[t.first - firstSRVSlot] = t.second;
+
+    samplerTable.clear();
+    firstSamplerSlot = samplerSlots.empty() ? 0 : samplerSlots.begin()->first;
+    if (!samplerSlots.empty())
+        samplerTable.resize(samplerSlots.rbegin()->first - firstSamplerSlot + 1, 0);
+    for (auto& s : samplerSlots)
+        samplerTable[s.first - firstSamplerSlot] = s.second;
+
+    // Identical contents get the same ID, so binding one straight
+    // after another can be skipped
+    std::vector<uintptr_t> key;
+    key.push_back(firstSRVSlot);
+    key.push_back(srvTable.size());
+    for (ID3D11ShaderResourceView* srv : srvTable) { key.push_back((uintptr_t)srv); }
+    key.push_back(firstSamplerSlot);
+    key.push_back(samplerTable.size());
+    for (ID3D11SamplerState* sampler : samplerTable) { key.push_back((uintptr_t)sampler); }
+
+    auto found = bindingTableIDs.find(key);
+    if (found == bindingTableIDs.end())
+        found = bindingTableIDs.insert({ key, (unsigned int)bindingTableIDs.size() }).first;
+    bindingTableID = found->second;
 }
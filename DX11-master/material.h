@@ -2,7 +2,11 @@
 #include <DirectXMath.h>
 #include <memory>
 #include "SimpleShader.h"
+#include "BufferStructs.h"
+#include "ShaderPermutations.h"
 #include <unordered_map>
+#include <map>
+#include <vector>
 
 class Material
 {
@@ -11,26 +15,81 @@ private:
 	std::shared_ptr<SimpleVertexShader> vertexShader;
 	std::shared_ptr<SimplePixelShader> pixelShader;
 	float roughness;
+	unsigned int textureSlice;
 	float offset;
 	std::unordered_map<std::string, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>> textureSRVs;
 	std::unordered_map<std::string, Microsoft::WRL::ComPtr<ID3D11SamplerState>> samplers;
+	unsigned int id;
+	unsigned int shaderFeatures;
+
+	static unsigned int nextID;
+
+	// Shader variables and slots, resolved by name whenever the shaders
+	// or resources change so per-draw code never looks anything up
+	//
+	// Textures and samplers are resolved into one contiguous run of
+	// slots each (unused slots in between are null), so binding is a
+	// single ranged call for each.  The pointers are owned by the maps
+	// above.  Materials with identical tables share a table ID.
+	unsigned int firstSRVSlot;
+	std::vector<ID3D11ShaderResourceView*> srvTable;
+	unsigned int firstSamplerSlot;
+	std::vector<ID3D11SamplerState*> samplerTable;
+	unsigned int bindingTableID;
+	static std::map<std::vector<uintptr_t>, unsigned int> bindingTableIDs;
+	SimpleShaderVariableHandle viewHandle;
+	SimpleShaderVariableHandle projectionHandle;
+	SimpleShaderVariableHandle cameraPosHandle;
+
+	// Filled in whole from the structs in BufferStructs.h
+	unsigned int perObjectBuffer;
+	unsigned int perMaterialBuffer;
+	void ResolveHandles();
+	void BuildBindingTable();
 
 public:
+	// Set per-draw data through pre-resolved handles and generated
+	// structs (true) or by name (false).  Only exists to compare
+	// the two in the UI.
+	static bool UseShaderHandles;
+
 	Material(DirectX::XMFLOAT4 _colorTint, std::shared_ptr<SimpleVertexShader> _vertexShader, std::shared_ptr<SimplePixelShader> _pixelShader, float _roughness);
 	
-	std::shared_ptr<SimpleVertexShader> getVertexShader();
-	std::shared_ptr<SimplePixelShader> getPixelShader();
+	const std::shared_ptr<SimpleVertexShader>& getVertexShader();
+	const std::shared_ptr<SimplePixelShader>& getPixelShader();
 	DirectX::XMFLOAT4 getColorTint();
 	float getRoughness();
+	unsigned int GetID();
+	unsigned int GetBindingCount();
+	unsigned int GetBindingTableID() { return bindingTableID; }
+	unsigned int GetShaderFeatures() { return shaderFeatures; }
+	unsigned int GetTextureSlice() { return textureSlice; }
 
 	void setVertexShader(std::shared_ptr<SimpleVertexShader> _vertexShader);
 	void setPixelShader(std::shared_ptr<SimplePixelShader> _pixelShader);
 	void setColorTint(DirectX::XMFLOAT4 _colorTint);
+
+	// Which slice of the shared material texture arrays this material reads
+	void SetTextureSlice(unsigned int slice) { textureSlice = slice; }
+
+	// Switches to the pixel shader variant for these ShaderFeature bits
+	void SetShaderFeatures(unsigned int features, const ShaderPermutationTable<SimplePixelShader>& variants);
 	void setShaders(DirectX::XMFLOAT4X4 worldMatrix,
 		DirectX::XMFLOAT4X4 viewMatrix,
 		DirectX::XMFLOAT4X4 projectionMatrix,
 		DirectX::XMFLOAT4X4 worldInverseTransposeMatrix,
 		DirectX::XMFLOAT3 position);
+
+	// Pieces of setShaders(), so a sorted draw loop can skip redundant binds
+	// and upload each constant buffer only as often as its data changes
+	void BindShaders();
+	void BindResources();
+	void SetPerFrameData(const DirectX::XMFLOAT4X4& viewMatrix,
+		const DirectX::XMFLOAT4X4& projectionMatrix,
+		const DirectX::XMFLOAT3& position);
+	void SetMaterialData();
+	void SetPerObjectData(const DirectX::XMFLOAT4X4& worldMatrix,
+		const DirectX::XMFLOAT4X4& worldInverseTransposeMatrix);
 	void AddTextureSRV(std::string shaderName, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
 	void AddSampler(std::string shaderName, Microsoft::WRL::ComPtr<ID3D11SamplerState> sampler);
 };